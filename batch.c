@@ -0,0 +1,427 @@
+/**
+ * @file
+ * Apply commands to a mailbox without the user interface
+ *
+ * @authors
+ * Copyright (C) 2019 NeoMutt developers <neomutt-devel@neomutt.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @page batch Apply commands to a mailbox without the user interface
+ *
+ * Driving the index with `-e 'push ...'` means starting curses, drawing every
+ * screen and replaying every keystroke.  Batch mode (`-X <command>`) opens
+ * the mailbox with mx_mbox_open() and applies each command straight to the
+ * Emails that match a pattern.
+ *
+ * | Command                   | Effect on the matching Emails
+ * | :------------------------ | :------------------------------------
+ * | `tag <pattern>`           | Tag (can be matched later with `~T`)
+ * | `untag <pattern>`         | Untag
+ * | `delete <pattern>`        | Mark as deleted
+ * | `undelete <pattern>`      | Unmark as deleted
+ * | `flag <pattern>`          | Mark as important
+ * | `unflag <pattern>`        | Unmark as important
+ * | `read <pattern>`          | Mark as read
+ * | `unread <pattern>`        | Mark as unread
+ * | `copy <mailbox> <pattern>`| Append to another mailbox
+ * | `save <mailbox> <pattern>`| Append to another mailbox, then delete
+ * | `sync`                    | Write the changes to the mailbox now
+ *
+ * The mailbox is synced when it's closed.  Quad-options that would ask a
+ * question, e.g. `$delete`, take their default answer.
+ *
+ * The mailbox is opened unsorted, unless a pattern looks at the threads, e.g.
+ * `~(...)`.  Then it is threaded, whatever `$sort` says.
+ */
+
+#include "config.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "mutt/mutt.h"
+#include "email/lib.h"
+#include "mutt.h"
+#include "batch.h"
+#include "commands.h"
+#include "context.h"
+#include "globals.h"
+#include "hook.h"
+#include "mailbox.h"
+#include "muttlib.h"
+#include "mx.h"
+#include "pattern.h"
+#include "protos.h"
+#include "sort.h"
+#ifdef USE_IMAP
+#include "imap/imap.h"
+#endif
+#ifdef ENABLE_NLS
+#include <libintl.h>
+#endif
+
+/**
+ * struct BatchCommand - A command that can be run in batch mode
+ */
+struct BatchCommand
+{
+  const char *name; ///< Name of the command, e.g. "delete"
+  int flag;         ///< Flag to change, e.g. #MUTT_DELETE (0: none)
+  bool set;         ///< Value to give the flag
+  bool target;      ///< Command takes a destination mailbox
+  bool pattern;     ///< Command takes a pattern
+};
+
+// clang-format off
+/**
+ * BatchCommands - Commands that can be run in batch mode
+ */
+static const struct BatchCommand BatchCommands[] = {
+  { "copy",     0,           false, true,  true  },
+  { "delete",   MUTT_DELETE, true,  false, true  },
+  { "flag",     MUTT_FLAG,   true,  false, true  },
+  { "read",     MUTT_READ,   true,  false, true  },
+  { "save",     MUTT_DELETE, true,  true,  true  },
+  { "sync",     0,           false, false, false },
+  { "tag",      MUTT_TAG,    true,  false, true  },
+  { "undelete", MUTT_DELETE, false, false, true  },
+  { "unflag",   MUTT_FLAG,   false, false, true  },
+  { "unread",   MUTT_READ,   false, false, true  },
+  { "untag",    MUTT_TAG,    false, false, true  },
+  { NULL,       0,           false, false, false },
+};
+// clang-format on
+
+/**
+ * struct BatchOp - A parsed batch command
+ */
+struct BatchOp
+{
+  const struct BatchCommand *cmd; ///< Command to run
+  struct PatternHead *pat;        ///< Compiled pattern
+  char *target;                   ///< Expanded destination mailbox
+};
+
+/**
+ * batch_quad - Answer a quad-option without asking
+ * @param opt Quad-option
+ * @retval enum Default answer, #MUTT_YES or #MUTT_NO
+ */
+static unsigned char batch_quad(unsigned char opt)
+{
+  return ((opt == MUTT_YES) || (opt == MUTT_ASKYES)) ? MUTT_YES : MUTT_NO;
+}
+
+/**
+ * batch_needs_threads - Does a pattern look at the threads?
+ * @param pat Pattern
+ * @retval true The Mailbox must be threaded to match the pattern
+ */
+static bool batch_needs_threads(const struct PatternHead *pat)
+{
+  const struct Pattern *p = NULL;
+  SLIST_FOREACH(p, pat, entries)
+  {
+    if ((p->op == MUTT_PAT_THREAD) || (p->op == MUTT_PAT_PARENT) ||
+        (p->op == MUTT_PAT_CHILDREN))
+    {
+      return true;
+    }
+    if (p->child && batch_needs_threads(p->child))
+      return true;
+  }
+  return false;
+}
+
+/**
+ * batch_parse - Parse and compile a batch command
+ * @param line Command, e.g. "save =archive ~d>1y"
+ * @param op   Op to fill in
+ * @retval  0 Success
+ * @retval -1 Error
+ */
+static int batch_parse(const char *line, struct BatchOp *op)
+{
+  const char *s = mutt_str_skip_whitespace(line);
+  size_t len = strcspn(s, " \t");
+
+  for (op->cmd = BatchCommands; op->cmd->name; op->cmd++)
+  {
+    if ((mutt_str_strlen(op->cmd->name) == len) &&
+        (mutt_str_strncmp(op->cmd->name, s, len) == 0))
+    {
+      break;
+    }
+  }
+
+  if (!op->cmd->name)
+  {
+    mutt_error(_("%s: unknown batch command"), line);
+    return -1;
+  }
+  s = mutt_str_skip_whitespace(s + len);
+
+  if (op->cmd->target)
+  {
+    len = strcspn(s, " \t");
+    if (len == 0)
+    {
+      mutt_error(_("%s: no mailbox"), line);
+      return -1;
+    }
+
+    struct Buffer *target = mutt_buffer_pool_get();
+    mutt_buffer_addstr_n(target, s, len);
+    mutt_buffer_expand_path(target);
+    op->target = mutt_str_strdup(mutt_b2s(target));
+    mutt_buffer_pool_release(&target);
+    s = mutt_str_skip_whitespace(s + len);
+  }
+
+  if (!op->cmd->pattern)
+  {
+    if (*s != '\0')
+    {
+      mutt_error(_("%s: too many arguments"), line);
+      return -1;
+    }
+    return 0;
+  }
+
+  if (*s == '\0')
+  {
+    mutt_error(_("%s: no pattern"), line);
+    return -1;
+  }
+
+  struct Buffer *buf = mutt_buffer_pool_get();
+  struct Buffer *err = mutt_buffer_pool_get();
+  mutt_buffer_strcpy(buf, s);
+  mutt_check_simple(buf, NONULL(C_SimpleSearch));
+  op->pat = mutt_pattern_comp(buf->data, MUTT_FULL_MSG, err);
+  if (!op->pat)
+    mutt_error("%s: %s", line, mutt_b2s(err));
+  mutt_buffer_pool_release(&buf);
+  mutt_buffer_pool_release(&err);
+
+  return op->pat ? 0 : -1;
+}
+
+/**
+ * batch_update - Update the view after checking a Mailbox
+ * @param ctx    Mailbox view
+ * @param check  Result of the check, e.g. #MUTT_NEW_MAIL
+ * @param sorted The Mailbox was opened sorted
+ * @retval true  The view was updated, try the sync or close again
+ * @retval false Nothing changed
+ *
+ * Like the index, new Emails are sorted in, or the view is rebuilt if the
+ * Mailbox was reopened.  The flags set so far are kept.
+ */
+static bool batch_update(struct Context *ctx, int check, bool sorted)
+{
+  if ((check != MUTT_NEW_MAIL) && (check != MUTT_REOPENED))
+    return false;
+
+  if (sorted)
+    mutt_sort_headers(ctx, (check == MUTT_REOPENED));
+  else
+    ctx_update(ctx);
+
+  return true;
+}
+
+/**
+ * batch_close - Close a Mailbox, writing the changes
+ * @param ptr    Mailbox view, freed
+ * @param sorted The Mailbox was opened sorted
+ * @retval  0 Success
+ * @retval -1 Error
+ *
+ * If the close fails, the Mailbox is closed without saving.
+ */
+static int batch_close(struct Context **ptr, bool sorted)
+{
+  int check;
+  do
+  {
+    check = mx_mbox_close(ptr);
+  } while (*ptr && batch_update(*ptr, check, sorted));
+
+  if (!*ptr)
+    return 0;
+
+  mx_fastclose_mailbox((*ptr)->mailbox);
+  ctx_free(ptr);
+  return -1;
+}
+
+/**
+ * batch_exec - Run a batch command on a Mailbox
+ * @param ctx    Mailbox view
+ * @param op     Command to run
+ * @param sorted The Mailbox was opened sorted
+ * @retval  0 Success
+ * @retval -1 Error
+ */
+static int batch_exec(struct Context *ctx, struct BatchOp *op, bool sorted)
+{
+  struct Mailbox *m = ctx->mailbox;
+
+  if (!op->pat)
+  {
+    int check;
+    do
+    {
+      check = mx_mbox_sync(m, NULL);
+    } while (batch_update(ctx, check, sorted));
+
+    return (check == -1) ? -1 : 0;
+  }
+
+#ifdef USE_IMAP
+  if ((m->magic == MUTT_IMAP) && (imap_search(m, op->pat) < 0))
+    return -1;
+#endif
+
+  struct Context *ctx_save = NULL;
+  if (op->target)
+  {
+    struct Mailbox *m_save = mx_path_resolve(op->target);
+    ctx_save = mx_mbox_open(m_save, MUTT_APPEND | MUTT_QUIET);
+    if (!ctx_save)
+    {
+      mailbox_free(&m_save);
+      return -1;
+    }
+  }
+
+  int rc = 0;
+  int matched = 0;
+  for (int i = 0; i < m->msg_count; i++)
+  {
+    struct Email *e = m->emails[i];
+    if (!mutt_pattern_exec(SLIST_FIRST(op->pat), MUTT_MATCH_FULL_ADDRESS, m, e, NULL))
+      continue;
+
+    matched++;
+    if (ctx_save)
+    {
+      rc = mutt_save_message_ctx(e, op->cmd->set, false, false, ctx_save->mailbox);
+      if (rc != 0)
+        break;
+      continue;
+    }
+
+    if ((op->cmd->flag == MUTT_DELETE) && !op->cmd->set)
+      mutt_set_flag(m, e, MUTT_PURGE, false);
+    mutt_set_flag(m, e, op->cmd->flag, op->cmd->set);
+  }
+
+  if (ctx_save && (batch_close(&ctx_save, false) != 0))
+    rc = -1;
+
+  mutt_message(ngettext("%s: %d message", "%s: %d messages", matched),
+               op->cmd->name, matched);
+  return rc;
+}
+
+/**
+ * mutt_batch_run - Apply a list of commands to a mailbox
+ * @param path     Path of the mailbox
+ * @param cmds     Commands, e.g. "delete ~d>1y"
+ * @param readonly Open the mailbox read-only
+ * @retval  0 Success
+ * @retval -1 Error
+ *
+ * Every command is checked before the mailbox is opened.  If a command fails,
+ * the remaining ones are skipped and the flags changed since the last `sync`
+ * are not written.  Emails that have already been copied or saved to another
+ * mailbox stay there.
+ */
+int mutt_batch_run(const char *path, struct ListHead *cmds, bool readonly)
+{
+  int count = 0;
+  int rc = -1;
+  struct ListNode *np = NULL;
+
+  STAILQ_FOREACH(np, cmds, entries)
+  {
+    count++;
+  }
+
+  struct BatchOp *ops = mutt_mem_calloc(count, sizeof(struct BatchOp));
+  OpenMailboxFlags flags = MUTT_NOSORT | MUTT_QUIET | (readonly ? MUTT_READONLY : 0);
+  int i = 0;
+  STAILQ_FOREACH(np, cmds, entries)
+  {
+    if (batch_parse(np->data, &ops[i]) != 0)
+      goto done;
+    if (ops[i].pat && batch_needs_threads(ops[i].pat))
+      flags &= ~MUTT_NOSORT;
+    i++;
+  }
+
+  unsigned char old_delete = C_Delete;
+  unsigned char old_move = C_Move;
+  C_Delete = batch_quad(C_Delete);
+  C_Move = batch_quad(C_Move);
+
+  mutt_folder_hook(path, NULL);
+
+  /* Thread patterns need a threaded Mailbox, whatever a folder-hook set */
+  short old_sort = C_Sort;
+  if (!(flags & MUTT_NOSORT))
+    C_Sort = SORT_THREADS;
+
+  struct Mailbox *m = mx_path_resolve(path);
+  Context = mx_mbox_open(m, flags);
+  if (Context)
+  {
+    rc = 0;
+    for (i = 0; i < count; i++)
+    {
+      rc = batch_exec(Context, &ops[i], !(flags & MUTT_NOSORT));
+      if (rc != 0)
+        break;
+    }
+
+    /* Don't write half of the changes */
+    if (rc != 0)
+      Context->mailbox->dontwrite = true;
+
+    if (batch_close(&Context, !(flags & MUTT_NOSORT)) != 0)
+      rc = -1;
+  }
+  else
+  {
+    mailbox_free(&m);
+  }
+
+  C_Delete = old_delete;
+  C_Move = old_move;
+  C_Sort = old_sort;
+
+done:
+  for (i = 0; i < count; i++)
+  {
+    mutt_pattern_free(&ops[i].pat);
+    FREE(&ops[i].target);
+  }
+  FREE(&ops);
+  return rc;
+}
@@ -0,0 +1,32 @@
+/**
+ * @file
+ * Apply commands to a mailbox without the user interface
+ *
+ * @authors
+ * Copyright (C) 2019 NeoMutt developers <neomutt-devel@neomutt.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MUTT_BATCH_H
+#define MUTT_BATCH_H
+
+#include <stdbool.h>
+
+struct ListHead;
+
+int mutt_batch_run(const char *path, struct ListHead *cmds, bool readonly);
+
+#endif /* MUTT_BATCH_H */
@@ -605,9 +605,13 @@ static int pipe_message(struct Mailbox *m, struct EmailList *el, char *cmd,
         if (pid < 0)
         {
           mutt_perror(_("Can't create filter process"));
+          if ((WithCrypto & APPLICATION_PGP) && decode)
+            crypt_pgp_decrypt_ahead_done();
           return 1;
         }
         OptKeepQuiet = true;
+        if ((WithCrypto & APPLICATION_PGP) && decode)
+          crypt_pgp_decrypt_ahead(m, en);
         pipe_msg(m, en->email, fp_out, decode, print);
         /* add the message separator */
         if (sep)
@@ -617,6 +621,8 @@ static int pipe_message(struct Mailbox *m, struct EmailList *el, char *cmd,
           rc = 1;
         OptKeepQuiet = false;
       }
+      if ((WithCrypto & APPLICATION_PGP) && decode)
+        crypt_pgp_decrypt_ahead_done();
     }
     else
     {
@@ -631,11 +637,15 @@ static int pipe_message(struct Mailbox *m, struct EmailList *el, char *cmd,
       STAILQ_FOREACH(en, el, entries)
       {
         mutt_message_hook(m, en->email, MUTT_MESSAGE_HOOK);
+        if ((WithCrypto & APPLICATION_PGP) && decode)
+          crypt_pgp_decrypt_ahead(m, en);
         pipe_msg(m, en->email, fp_out, decode, print);
         /* add the message separator */
         if (sep)
           fputs(sep, fp_out);
       }
+      if ((WithCrypto & APPLICATION_PGP) && decode)
+        crypt_pgp_decrypt_ahead_done();
       mutt_file_fclose(&fp_out);
       if (mutt_wait_filter(pid) != 0)
         rc = 1;
@@ -1127,6 +1137,8 @@ int mutt_save_message(struct Mailbox *m, struct EmailList *el, bool delete,
     STAILQ_FOREACH(en, el, entries)
     {
       mutt_message_hook(m, en->email, MUTT_MESSAGE_HOOK);
+      if ((WithCrypto & APPLICATION_PGP) && (decode || decrypt))
+        crypt_pgp_decrypt_ahead(m, en);
       rc = mutt_save_message_ctx(en->email, delete, decode, decrypt, ctx_save->mailbox);
       if (rc != 0)
         break;
@@ -1150,6 +1162,8 @@ int mutt_save_message(struct Mailbox *m, struct EmailList *el, bool delete,
     if (m->magic == MUTT_NOTMUCH)
       nm_db_longrun_done(m);
 #endif
+    if (WithCrypto & APPLICATION_PGP)
+      crypt_pgp_decrypt_ahead_done();
     if (rc != 0)
     {
       m_save->append = old_append;
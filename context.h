@@ -48,6 +48,7 @@ struct Context
   struct Menu *menu; /**< needed for pattern compilation */
 
   bool collapsed : 1; /**< are all threads collapsed? */
+  bool threads_cached : 1; /**< the thread tree is saved in the header cache */
 
   struct Mailbox *mailbox;
 };
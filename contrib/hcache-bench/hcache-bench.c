@@ -0,0 +1,626 @@
+/**
+ * @file
+ * Benchmark the header cache backends in-process
+ *
+ * @authors
+ * Copyright (C) 2019 NeoMutt developers <neomutt-devel@neomutt.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @page hcache_bench In-process header cache benchmark
+ *
+ * Generate a set of synthetic Emails and time every header cache operation
+ * against each compiled-in backend:
+ *
+ * | Operation    | Function
+ * | :----------- | :----------------------
+ * | dump         | mutt_hcache_dump()
+ * | restore      | mutt_hcache_restore()
+ * | store        | mutt_hcache_store()
+ * | fetch (cold) | mutt_hcache_fetch() after reopening the cache
+ * | fetch (warm) | mutt_hcache_fetch() again, on the same handle
+ * | delete       | mutt_hcache_delete()
+ *
+ * Unlike neomutt-hcache-bench.sh, no mailbox is parsed and no UI is drawn, so
+ * the numbers only contain the cost of the serialisation and the backend.
+ */
+
+#include "config.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "mutt/mutt.h"
+#include "address/lib.h"
+#include "email/lib.h"
+#include "hcache/hcache.h"
+#include "hcache/serialize.h"
+
+/* These Config Variables are normally defined by neomutt itself */
+char *C_HeaderCachePagesize = "16384"; ///< Config: (hcache) Database page size (gdbm,bdb4)
+bool C_HeaderCacheCompress = false; ///< Config: (hcache) Enable database compression (qdbm,tokyocabinet,kyotocabinet)
+#ifdef HAVE_ZSTD
+extern char *C_HeaderCacheCompressMethod;
+extern short C_HeaderCacheCompressLevel;
+#endif
+
+/**
+ * struct BenchOptions - Command line options
+ */
+struct BenchOptions
+{
+  unsigned int count; ///< Number of Emails to generate
+  unsigned int seed;  ///< Seed for the random generator
+  const char *dir;    ///< Directory for the databases
+  const char *only;   ///< Only run this backend
+};
+
+static unsigned int RandState = 1;
+
+/**
+ * mutt_encode_path - Convert a path into the user's preferred character set
+ * @param buf    Buffer for the result
+ * @param buflen Length of buffer
+ * @param src    Path to convert (OPTIONAL)
+ *
+ * The benchmark only uses ASCII paths, so they are copied unchanged.
+ */
+void mutt_encode_path(char *buf, size_t buflen, const char *src)
+{
+  if (buf != src)
+    mutt_str_strfcpy(buf, src, buflen);
+}
+
+/**
+ * bench_rand - Get a pseudo-random number
+ * @param max Upper bound (exclusive)
+ * @retval num Number in [0, max)
+ *
+ * A fixed xorshift generator keeps the synthetic Emails identical between runs.
+ */
+static unsigned int bench_rand(unsigned int max)
+{
+  RandState ^= RandState << 13;
+  RandState ^= RandState >> 17;
+  RandState ^= RandState << 5;
+  return RandState % max;
+}
+
+/**
+ * now_ns - Get a monotonic timestamp
+ * @retval num Nanoseconds
+ */
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t) ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+/**
+ * bench_words - Append some random words to a Buffer
+ * @param buf   Buffer for the result
+ * @param words Number of words
+ */
+static void bench_words(struct Buffer *buf, int words)
+{
+  static const char *dict[] = {
+    "header", "cache",   "thread",  "mailbox", "review", "patch",
+    "meeting", "release", "update", "question", "report", "invoice",
+    "weekly",  "status",  "build",  "failure",  "fix",    "notes",
+  };
+
+  for (int i = 0; i < words; i++)
+  {
+    if (i > 0)
+      mutt_buffer_addch(buf, ' ');
+    mutt_buffer_addstr(buf, dict[bench_rand(mutt_array_size(dict))]);
+  }
+}
+
+/**
+ * bench_address - Create a random Address
+ * @retval ptr New Address
+ */
+static struct Address *bench_address(void)
+{
+  char personal[64];
+  char mailbox[64];
+  unsigned int user = bench_rand(5000);
+
+  snprintf(personal, sizeof(personal), "Bench User %u", user);
+  snprintf(mailbox, sizeof(mailbox), "user%u@example%u.org", user, user % 50);
+  return mutt_addr_create(bench_rand(4) ? personal : NULL, mailbox);
+}
+
+/**
+ * bench_email - Create a synthetic Email
+ * @param i Index of the Email
+ * @retval ptr New Email
+ *
+ * The Emails look like a busy mailing list: a few recipients, most messages
+ * are replies with a chain of references and the body is a single text part.
+ */
+static struct Email *bench_email(unsigned int i)
+{
+  struct Email *e = mutt_email_new();
+  struct Envelope *env = mutt_env_new();
+  struct Buffer *buf = mutt_buffer_pool_get();
+  bool reply = (i > 0) && bench_rand(4);
+
+  mutt_addrlist_append(&env->from, bench_address());
+  for (int n = bench_rand(4); n >= 0; n--)
+    mutt_addrlist_append(&env->to, bench_address());
+  for (int n = bench_rand(3); n > 0; n--)
+    mutt_addrlist_append(&env->cc, bench_address());
+
+  mutt_buffer_strcpy(buf, reply ? "Re: " : "");
+  bench_words(buf, 3 + bench_rand(8));
+  env->subject = mutt_str_strdup(mutt_b2s(buf));
+  env->real_subj = env->subject + (reply ? 4 : 0);
+
+  mutt_buffer_printf(buf, "<%u.%u@bench.example.org>", i, bench_rand(100000));
+  env->message_id = mutt_str_strdup(mutt_b2s(buf));
+
+  if (reply)
+  {
+    for (int n = bench_rand(8); n >= 0; n--)
+    {
+      mutt_buffer_printf(buf, "<%u.%u@bench.example.org>", bench_rand(i),
+                         bench_rand(100000));
+      mutt_list_insert_tail(&env->references, mutt_str_strdup(mutt_b2s(buf)));
+    }
+    mutt_list_insert_tail(&env->in_reply_to,
+                          mutt_str_strdup(STAILQ_FIRST(&env->references)->data));
+  }
+
+  if (!bench_rand(3))
+  {
+    mutt_buffer_strcpy(buf, "Example ");
+    bench_words(buf, 2);
+    env->organization = mutt_str_strdup(mutt_b2s(buf));
+  }
+
+  e->env = env;
+  e->date_sent = 1546300800 + (i * 60);
+  e->received = e->date_sent + bench_rand(600);
+  e->read = bench_rand(2);
+  e->flagged = !bench_rand(10);
+  e->replied = !bench_rand(5);
+  e->index = i;
+
+  struct Body *b = mutt_body_new();
+  b->type = TYPE_TEXT;
+  b->subtype = mutt_str_strdup("plain");
+  b->encoding = bench_rand(2) ? ENC_8BIT : ENC_QUOTED_PRINTABLE;
+  b->disposition = DISP_INLINE;
+  b->length = 200 + bench_rand(20000);
+  b->offset = 500 + bench_rand(2000);
+  mutt_param_set(&b->parameter, "charset", "utf-8");
+  if (!bench_rand(4))
+    mutt_param_set(&b->parameter, "format", "flowed");
+  e->content = b;
+  e->lines = b->length / 60;
+
+  mutt_buffer_pool_release(&buf);
+  return e;
+}
+
+/**
+ * bench_key - Create a Maildir-like key for an Email
+ * @param i      Index of the Email
+ * @param buf    Buffer for the result
+ * @param buflen Length of the buffer
+ * @retval num Length of the key
+ */
+static size_t bench_key(unsigned int i, char *buf, size_t buflen)
+{
+  return snprintf(buf, buflen, "/%u.M%uP%u.bench.example.org", 1546300800 + i,
+                  (i * 7919) % 1000000, 1000 + i);
+}
+
+/**
+ * cmp_u64 - Compare two timings - Implements ::sort_t
+ */
+static int cmp_u64(const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *) a;
+  uint64_t y = *(const uint64_t *) b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * report - Print the statistics for one operation
+ * @param backend Name of the backend
+ * @param op      Name of the operation
+ * @param ns      Time taken by each operation, in nanoseconds
+ * @param count   Number of operations
+ * @param errors  Number of failed operations
+ */
+static void report(const char *backend, const char *op, uint64_t *ns,
+                   unsigned int count, unsigned int errors)
+{
+  uint64_t total = 0;
+  for (unsigned int i = 0; i < count; i++)
+    total += ns[i];
+
+  qsort(ns, count, sizeof(*ns), cmp_u64);
+
+  const double us = 1000.0;
+  printf("%-14s %-14s %8u %12.0f %9.2f %9.2f %9.2f %9.2f %6u\n", backend, op, count,
+         total ? (count * 1e9 / total) : 0.0, ns[count / 2] / us,
+         ns[(count * 90) / 100] / us, ns[(count * 99) / 100] / us,
+         ns[count - 1] / us, errors);
+}
+
+/**
+ * drop_cache - Ask the kernel to forget the cached pages of a directory
+ * @param dir Directory containing the database files
+ *
+ * Reading a database straight after writing it, would always find it in the
+ * page cache.  Flush and drop every file, so that the "cold" fetches have to
+ * go back to the disk.  This is only advice to the kernel.
+ */
+static void drop_cache(const char *dir)
+{
+  DIR *dp = opendir(dir);
+  if (!dp)
+    return;
+
+  char path[PATH_MAX];
+  struct dirent *de = NULL;
+  while ((de = readdir(dp)))
+  {
+    if (de->d_name[0] == '.')
+      continue;
+
+    if (snprintf(path, sizeof(path), "%s/%s", dir, de->d_name) >= sizeof(path))
+      continue;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+      continue;
+    fdatasync(fd);
+#ifdef POSIX_FADV_DONTNEED
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+    close(fd);
+  }
+  closedir(dp);
+}
+
+/**
+ * remove_dir - Delete a directory of database files
+ * @param dir Directory to delete
+ */
+static void remove_dir(const char *dir)
+{
+  DIR *dp = opendir(dir);
+  if (!dp)
+    return;
+
+  char path[PATH_MAX];
+  struct dirent *de = NULL;
+  while ((de = readdir(dp)))
+  {
+    if ((strcmp(de->d_name, ".") == 0) || (strcmp(de->d_name, "..") == 0))
+      continue;
+    if (snprintf(path, sizeof(path), "%s/%s", dir, de->d_name) >= sizeof(path))
+      continue;
+    unlink(path);
+  }
+  closedir(dp);
+  rmdir(dir);
+}
+
+/**
+ * bench_fetch - Time fetching every Email from the cache
+ * @param hc      Header cache handle
+ * @param order   Order in which to fetch the Emails
+ * @param count   Number of Emails
+ * @param ns      Array for the timings
+ * @retval num Number of failed fetches
+ */
+static unsigned int bench_fetch(header_cache_t *hc, const unsigned int *order,
+                                unsigned int count, uint64_t *ns)
+{
+  char key[128];
+  unsigned int errors = 0;
+
+  for (unsigned int i = 0; i < count; i++)
+  {
+    size_t klen = bench_key(order[i], key, sizeof(key));
+    uint64_t start = now_ns();
+    void *data = mutt_hcache_fetch(hc, key, klen);
+    ns[i] = now_ns() - start;
+    if (data)
+      mutt_hcache_free(hc, &data);
+    else
+      errors++;
+  }
+
+  return errors;
+}
+
+/**
+ * bench_backend - Benchmark one header cache backend
+ * @param backend Name of the backend
+ * @param emails  Synthetic Emails
+ * @param order   Random order for the fetches
+ * @param opts    Command line options
+ * @retval true Success
+ */
+static bool bench_backend(const char *backend, struct Email **emails,
+                          const unsigned int *order, const struct BenchOptions *opts)
+{
+  const unsigned int count = opts->count;
+  char dir[PATH_MAX];
+  char path[PATH_MAX];
+  char key[128];
+  unsigned int errors;
+  bool rc = false;
+
+  if ((snprintf(dir, sizeof(dir), "%s/%s", opts->dir, backend) >= sizeof(dir)) ||
+      (snprintf(path, sizeof(path), "%s/cache", dir) >= sizeof(path)))
+  {
+    fprintf(stderr, "Path too long: %s/%s\n", opts->dir, backend);
+    return false;
+  }
+  remove_dir(dir);
+  if (mkdir(dir, 0700) != 0)
+  {
+    fprintf(stderr, "Can't create %s: %s\n", dir, strerror(errno));
+    return false;
+  }
+
+  mutt_str_replace(&C_HeaderCacheBackend, backend);
+  header_cache_t *hc = mutt_hcache_open(path, "bench", NULL);
+  if (!hc)
+  {
+    fprintf(stderr, "Can't open a %s header cache in %s\n", backend, dir);
+    remove_dir(dir);
+    return false;
+  }
+
+  uint64_t *ns = mutt_mem_calloc(count, sizeof(uint64_t));
+  void **blobs = mutt_mem_calloc(count, sizeof(void *));
+
+  /* dump */
+  for (unsigned int i = 0; i < count; i++)
+  {
+    int len = 0;
+    uint64_t start = now_ns();
+    blobs[i] = mutt_hcache_dump(hc, emails[i], &len, 0);
+    ns[i] = now_ns() - start;
+  }
+  report(backend, "dump", ns, count, 0);
+
+  /* restore */
+  for (unsigned int i = 0; i < count; i++)
+  {
+    uint64_t start = now_ns();
+    struct Email *e = mutt_hcache_restore(blobs[i]);
+    ns[i] = now_ns() - start;
+    mutt_email_free(&e);
+    FREE(&blobs[i]);
+  }
+  report(backend, "restore", ns, count, 0);
+
+  /* store */
+  errors = 0;
+  for (unsigned int i = 0; i < count; i++)
+  {
+    size_t klen = bench_key(i, key, sizeof(key));
+    uint64_t start = now_ns();
+    if (mutt_hcache_store(hc, key, klen, emails[i], 0) != 0)
+      errors++;
+    ns[i] = now_ns() - start;
+  }
+  report(backend, "store", ns, count, errors);
+
+  /* Close the cache, drop it from memory and open it again */
+  mutt_hcache_close(hc);
+  drop_cache(dir);
+  uint64_t start = now_ns();
+  hc = mutt_hcache_open(path, "bench", NULL);
+  ns[0] = now_ns() - start;
+  report(backend, "open (cold)", ns, 1, hc ? 0 : 1);
+  if (!hc)
+    goto done;
+
+  errors = bench_fetch(hc, order, count, ns);
+  report(backend, "fetch (cold)", ns, count, errors);
+
+  errors = bench_fetch(hc, order, count, ns);
+  report(backend, "fetch (warm)", ns, count, errors);
+
+  /* delete */
+  errors = 0;
+  for (unsigned int i = 0; i < count; i++)
+  {
+    size_t klen = bench_key(order[i], key, sizeof(key));
+    start = now_ns();
+    if (mutt_hcache_delete(hc, key, klen) != 0)
+      errors++;
+    ns[i] = now_ns() - start;
+  }
+  report(backend, "delete", ns, count, errors);
+
+  mutt_hcache_close(hc);
+  rc = true;
+
+done:
+  FREE(&blobs);
+  FREE(&ns);
+  remove_dir(dir);
+  return rc;
+}
+
+/**
+ * usage - Print the command line options
+ * @param prog Name of the program
+ */
+static void usage(const char *prog)
+{
+  printf("Usage: %s [-b backend] [-d dir] [-n count] [-s seed]"
+#ifdef HAVE_ZSTD
+         " [-z method[:level]]"
+#endif
+         "\n",
+         prog);
+  printf("  -b backend  Only benchmark one backend\n");
+  printf("  -d dir      Directory for the databases (default: $TMPDIR or /tmp)\n");
+  printf("  -n count    Number of Emails (default: 10000)\n");
+  printf("  -s seed     Seed for the synthetic Emails (default: 1)\n");
+#ifdef HAVE_ZSTD
+  printf("  -z method   Compress the cache, e.g. 'zstd:3'\n");
+#endif
+
+  const char *backends = mutt_hcache_backend_list();
+  printf("\nBackends: %s\n", backends);
+  FREE(&backends);
+}
+
+/**
+ * main - Benchmark the header cache backends
+ * @param argc Number of command line arguments
+ * @param argv List of command line arguments
+ * @retval 0 Success
+ * @retval 1 Error
+ */
+int main(int argc, char *argv[])
+{
+  struct BenchOptions opts = { 10000, 1, NULL, NULL };
+  int opt;
+
+  while ((opt = getopt(argc, argv, "b:d:hn:s:z:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'b':
+        opts.only = optarg;
+        break;
+      case 'd':
+        opts.dir = optarg;
+        break;
+      case 'n':
+        if ((mutt_str_atoui(optarg, &opts.count) < 0) || (opts.count == 0))
+        {
+          fprintf(stderr, "Invalid count: %s\n", optarg);
+          return 1;
+        }
+        break;
+      case 's':
+        if ((mutt_str_atoui(optarg, &opts.seed) < 0) || (opts.seed == 0))
+        {
+          fprintf(stderr, "Invalid seed: %s\n", optarg);
+          return 1;
+        }
+        break;
+#ifdef HAVE_ZSTD
+      case 'z':
+      {
+        char *colon = strchr(optarg, ':');
+        if (colon)
+        {
+          *colon = '\0';
+          C_HeaderCacheCompressLevel = atoi(colon + 1);
+        }
+        C_HeaderCacheCompressMethod = optarg;
+        break;
+      }
+#endif
+      default:
+        usage(argv[0]);
+        return (opt == 'h') ? 0 : 1;
+    }
+  }
+
+  if (opts.only && !mutt_hcache_is_valid_backend(opts.only))
+  {
+    fprintf(stderr, "Unknown backend: %s\n", opts.only);
+    usage(argv[0]);
+    return 1;
+  }
+
+  char tmpl[PATH_MAX];
+  if (!opts.dir)
+  {
+    const char *tmp = mutt_str_getenv("TMPDIR");
+    snprintf(tmpl, sizeof(tmpl), "%s/hcache-bench-XXXXXX", tmp ? tmp : "/tmp");
+    opts.dir = mkdtemp(tmpl);
+    if (!opts.dir)
+    {
+      fprintf(stderr, "Can't create a temporary directory: %s\n", strerror(errno));
+      return 1;
+    }
+  }
+
+  RandState = opts.seed;
+  struct Email **emails = mutt_mem_calloc(opts.count, sizeof(struct Email *));
+  unsigned int *order = mutt_mem_calloc(opts.count, sizeof(unsigned int));
+  for (unsigned int i = 0; i < opts.count; i++)
+  {
+    emails[i] = bench_email(i);
+    order[i] = i;
+  }
+
+  /* Fetch and delete in a random order, like a resorted mailbox would */
+  for (unsigned int i = opts.count - 1; i > 0; i--)
+  {
+    unsigned int j = bench_rand(i + 1);
+    unsigned int swap = order[i];
+    order[i] = order[j];
+    order[j] = swap;
+  }
+
+  printf("%u emails, times in microseconds\n\n", opts.count);
+  printf("%-14s %-14s %8s %12s %9s %9s %9s %9s %6s\n", "backend", "operation",
+         "count", "ops/sec", "p50", "p90", "p99", "max", "errors");
+
+  int rc = 0;
+  const char *list = mutt_hcache_backend_list();
+  char *backends = mutt_str_strdup(list);
+  char *saveptr = NULL;
+  for (char *name = strtok_r(backends, ", ", &saveptr); name;
+       name = strtok_r(NULL, ", ", &saveptr))
+  {
+    if (opts.only && (mutt_str_strcmp(name, opts.only) != 0))
+      continue;
+    if (!bench_backend(name, emails, order, &opts))
+      rc = 1;
+  }
+
+  FREE(&backends);
+  FREE(&list);
+  for (unsigned int i = 0; i < opts.count; i++)
+    mutt_email_free(&emails[i]);
+  FREE(&emails);
+  FREE(&order);
+  if (opts.dir == tmpl)
+    rmdir(tmpl);
+  FREE(&C_HeaderCacheBackend);
+
+  return rc;
+}
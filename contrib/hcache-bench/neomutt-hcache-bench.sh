@@ -25,16 +25,19 @@
 
 usage()
 {
-    echo "Usage: $(basename "$0") -e <neomutt> -m <mdir> -t <times> -b <backends>"
+    echo "Usage: $(basename "$0") -e <neomutt> -m <mdir> -t <times> -b <backends> [-c <methods>]"
     echo ""
     echo "   -e Path to the neomutt executable"
     echo "   -m Path to a maildir directory"
     echo "   -t Number of times to repeat the test"
     echo "   -b List of backends to test"
+    echo "   -c List of compression methods to test, 'none' for no compression"
     echo ""
 }
 
-while getopts e:m:t:b: OPT; do
+COMPRESS="none"
+
+while getopts e:m:t:b:c: OPT; do
     case "$OPT" in
         e)
             NEOMUTT="$OPTARG"
@@ -48,6 +51,9 @@ while getopts e:m:t:b: OPT; do
         b)
             BACKENDS="$OPTARG"
             ;;
+        c)
+            COMPRESS="$OPTARG"
+            ;;
         *)
             usage
             exit 1
@@ -67,15 +73,31 @@ echo "Running in $TMPDIR"
 exe()
 {
     export my_backend=$1
+    export my_hcache=$2
     export my_maildir=$MAILDIR
     export my_tmpdir=$TMPDIR
-    t=$(time -p $NEOMUTT -F "$CWD"/neomuttrc 2>&1 > /dev/null)
+    if [ "$3" = "none" ]; then
+        t=$(time -p $NEOMUTT -F "$CWD"/neomuttrc 2>&1 > /dev/null)
+    else
+        t=$(time -p $NEOMUTT -F "$CWD"/neomuttrc \
+            -e "set header_cache_compress_method=$3" 2>&1 > /dev/null)
+    fi
     echo "$t" | xargs
 }
 
+# name of a backend / compression method combination
+label()
+{
+    if [ "$2" = "none" ]; then
+        echo "$1"
+    else
+        echo "$1-$2"
+    fi
+}
+
 extract()
 {
-    grep "$2" "$TMPDIR/result-$1.txt" | awk "{print \$$3}" | xargs
+    grep "^$2 " "$TMPDIR/result-$1.txt" | awk "{print \$$3}" | xargs
 }
 
 avg()
@@ -88,15 +110,18 @@ width=${#TIMES}
 # generate
 for i in $(seq "$TIMES"); do
     for b in $BACKENDS; do
-        rm -f "$TMPDIR"/hcache*
-        # do it twice - the first will populate the cache, the second will reload it
-        printf "%${width}d - populating - $b\n" "$i"
-        t1=$(exe "$b")
-        printf "%${width}d - reloading  - $b\n" "$i"
-        t2=$(exe "$b")
-        s=$(du -k "$TMPDIR/hcache-$b" | awk '{print $1}')
-        echo "$b $s $t1" >> "$TMPDIR"/result-populate.txt
-        echo "$b $s $t2" >> "$TMPDIR"/result-reload.txt
+        for c in $COMPRESS; do
+            l=$(label "$b" "$c")
+            rm -f "$TMPDIR"/hcache*
+            # do it twice - the first will populate the cache, the second will reload it
+            printf "%${width}d - populating - $l\n" "$i"
+            t1=$(exe "$b" "$l" "$c")
+            printf "%${width}d - reloading  - $l\n" "$i"
+            t2=$(exe "$b" "$l" "$c")
+            s=$(du -k "$TMPDIR/hcache-$l" | awk '{print $1}')
+            echo "$l $s $t1" >> "$TMPDIR"/result-populate.txt
+            echo "$l $s $t2" >> "$TMPDIR"/result-reload.txt
+        done
     done
 done
 
@@ -104,10 +129,14 @@ for f in populate reload; do
     echo ""
     echo "*** $f"
     for b in $BACKENDS; do
-        real=$(avg "$(extract "$f" "$b" 4)")
-        user=$(avg "$(extract "$f" "$b" 6)")
-        sys=$(avg "$(extract "$f" "$b" 8)")
-        printf "%-15s" "$b"
-        echo "$real real $user user $sys sys"
+        for c in $COMPRESS; do
+            l=$(label "$b" "$c")
+            size=$(avg "$(extract "$f" "$l" 2)")
+            real=$(avg "$(extract "$f" "$l" 4)")
+            user=$(avg "$(extract "$f" "$l" 6)")
+            sys=$(avg "$(extract "$f" "$l" 8)")
+            printf "%-20s" "$l"
+            echo "$real real $user user $sys sys $size KiB"
+        done
     done
 done
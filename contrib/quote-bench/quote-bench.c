@@ -0,0 +1,497 @@
+/**
+ * @file
+ * Benchmark the pager's quote classification
+ *
+ * @authors
+ * Copyright (C) 2019 NeoMutt developers <neomutt-devel@neomutt.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @page quote_bench Benchmark the pager's quote classification
+ *
+ * Generate a heavily quoted mailing list digest (or read one from a file) and
+ * time the two steps the pager runs for every line:
+ *
+ * | Step     | Function
+ * | :------- | :----------------------
+ * | detect   | mutt_is_quote_line()
+ * | classify | mutt_is_quote_line(), then mutt_quote_classify() if it's quoted
+ *
+ * Each step is timed twice: with the default $quote_regex and $smileys, which
+ * use the hand-written scanner, and with equivalent patterns that are spelt
+ * differently, which force the regexec() path.  Both runs must find the same
+ * quotes and the same classes, otherwise the benchmark fails.
+ */
+
+#include "config.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "mutt/mutt.h"
+#include "protos.h"
+#include "quoted.h"
+
+/* These variables are normally defined by neomutt itself */
+struct Regex *C_QuoteRegex; ///< Config: Regex to match quoted text in a reply
+struct Regex *C_Smileys;    ///< Config: Regex to match smileys to prevent mistakes when quoting text
+int *ColorQuote;            ///< Array of colours for quoted email text
+int ColorQuoteUsed;         ///< Number of colours for quoted email text
+
+/* The default patterns (see quoted.h) spelt differently */
+#define QUOTE_REGEX "^([\t ]*[|>:}#])+"
+#define SMILEYS_REGEX "(:[-^]?[][)(><}{|/DP])|(>From )"
+
+/**
+ * struct BenchOptions - Command line options
+ */
+struct BenchOptions
+{
+  unsigned int count;  ///< Number of lines to generate
+  unsigned int seed;   ///< Seed for the random generator
+  unsigned int rounds; ///< Number of times to repeat each step
+  const char *file;    ///< Read the digest from this file
+};
+
+/**
+ * struct BenchResult - What one run found
+ */
+struct BenchResult
+{
+  regoff_t *length;          ///< Length of the quote prefix of each line (-1 if not quoted)
+  struct QClass **classes;   ///< Class of each quoted line
+  struct QClass *quote_list; ///< Tree of classes
+  uint64_t detect_ns;        ///< Fastest time to detect the quotes
+  uint64_t classify_ns;      ///< Fastest time to detect and classify the quotes
+  unsigned int num_quoted;   ///< Number of quoted lines
+  int num_classes;           ///< Number of classes
+};
+
+static unsigned int RandState = 1;
+
+/**
+ * bench_rand - Get a pseudo-random number
+ * @param max Upper bound (exclusive)
+ * @retval num Number in [0, max)
+ *
+ * A fixed xorshift generator keeps the synthetic digest identical between runs.
+ */
+static unsigned int bench_rand(unsigned int max)
+{
+  RandState ^= RandState << 13;
+  RandState ^= RandState >> 17;
+  RandState ^= RandState << 5;
+  return RandState % max;
+}
+
+/**
+ * now_ns - Get a monotonic timestamp
+ * @retval num Nanoseconds
+ */
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t) ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+/**
+ * bench_style - Pick the quote marks for a message
+ * @param style Quote mark for each level of quoting
+ * @param depth Number of levels
+ *
+ * Mailers disagree about quoting, so a digest contains "> > ", ">>", "| ",
+ * ": " and indented quotes.  Within one message, each level of quoting was
+ * written by one mailer, so it keeps its mark.
+ */
+static void bench_style(const char **style, int depth)
+{
+  static const char *marks[] = { "> ", "> ", "> ", ">", "| ", ": ", "} ", " > " };
+
+  for (int i = 0; i < depth; i++)
+    style[i] = marks[bench_rand(mutt_array_size(marks))];
+}
+
+/**
+ * bench_text - Append some random text to a Buffer
+ * @param buf Buffer for the result
+ */
+static void bench_text(struct Buffer *buf)
+{
+  static const char *dict[] = {
+    "the",   "patch", "looks",   "fine", "but",    "please", "rebase", "onto",
+    "master", "and",  "update",  "the",  "docs",   "thanks", "for",    "review",
+    "this",  "breaks", "build",  "on",   "BSD",    "see",    "thread", "above",
+  };
+  static const char *smileys[] = { ":-)", ":)", ";-)", ":-P", ":D", ":^)", ":-/" };
+
+  int words = 4 + bench_rand(10);
+  for (int i = 0; i < words; i++)
+  {
+    if (i > 0)
+      mutt_buffer_addch(buf, ' ');
+    mutt_buffer_addstr(buf, dict[bench_rand(mutt_array_size(dict))]);
+  }
+
+  if (bench_rand(12) == 0)
+  {
+    mutt_buffer_addch(buf, ' ');
+    mutt_buffer_addstr(buf, smileys[bench_rand(mutt_array_size(smileys))]);
+  }
+}
+
+/**
+ * bench_digest - Generate a synthetic digest
+ * @param count Number of lines
+ * @param buf   Buffer for the lines, separated by '\0'
+ *
+ * Each message has a few headers, then quoted text that gets deeper and
+ * shallower, with the odd smiley, ">From " line and unquoted reply.
+ */
+static void bench_digest(unsigned int count, struct Buffer *buf)
+{
+  const char *style[8];
+  unsigned int line = 0;
+  int depth = 0;
+
+  bench_style(style, mutt_array_size(style));
+
+  while (line < count)
+  {
+    if (bench_rand(40) == 0)
+    {
+      mutt_buffer_add_printf(buf, "------------------------------");
+      mutt_buffer_addch(buf, '\0');
+      mutt_buffer_add_printf(buf, "From: user%u@example.org", bench_rand(500));
+      mutt_buffer_addch(buf, '\0');
+      mutt_buffer_add_printf(buf, "Subject: Re: [dev] digest topic %u", bench_rand(100));
+      mutt_buffer_addch(buf, '\0');
+      mutt_buffer_addch(buf, '\0');
+      line += 4;
+      depth = 1 + bench_rand(6);
+      bench_style(style, mutt_array_size(style));
+      continue;
+    }
+
+    switch (bench_rand(8))
+    {
+      case 0:
+        if (depth > 0)
+          depth--;
+        break;
+      case 1:
+        if (depth < 8)
+          depth++;
+        break;
+    }
+
+    if ((depth == 0) || (bench_rand(10) == 0))
+    {
+      /* Unquoted reply */
+      bench_text(buf);
+    }
+    else
+    {
+      for (int i = 0; i < depth; i++)
+        mutt_buffer_addstr(buf, style[i]);
+      if (bench_rand(60) == 0)
+        mutt_buffer_addstr(buf, ">From the archive:");
+      else
+        bench_text(buf);
+    }
+    mutt_buffer_addch(buf, '\0');
+    line++;
+  }
+}
+
+/**
+ * bench_read - Read a digest from a file
+ * @param file File to read
+ * @param buf  Buffer for the lines, separated by '\0'
+ * @retval num Number of lines
+ * @retval -1  Error
+ */
+static int bench_read(const char *file, struct Buffer *buf)
+{
+  FILE *fp = fopen(file, "r");
+  if (!fp)
+    return -1;
+
+  char *line = NULL;
+  size_t linelen = 0;
+  int count = 0;
+  while ((line = mutt_file_read_line(line, &linelen, fp, NULL, 0)))
+  {
+    mutt_buffer_addstr(buf, line);
+    mutt_buffer_addch(buf, '\0');
+    count++;
+  }
+
+  FREE(&line);
+  mutt_file_fclose(&fp);
+  return count;
+}
+
+/**
+ * set_regex - Set a regex config variable
+ * @param ptr     Variable to set
+ * @param pattern Pattern to compile
+ */
+static void set_regex(struct Regex **ptr, const char *pattern)
+{
+  mutt_regex_free(ptr);
+  /* The config system ignores case for lower-case patterns, so match it */
+  *ptr = mutt_regex_compile(pattern, mutt_mb_is_lower(pattern) ? REG_ICASE : 0);
+  if (!*ptr)
+  {
+    fprintf(stderr, "Can't compile: %s\n", pattern);
+    exit(1);
+  }
+}
+
+/**
+ * bench_run - Time the quote detection and classification
+ * @param lines  Start of each line
+ * @param count  Number of lines
+ * @param rounds Number of times to repeat each step
+ * @param res    Results
+ */
+static void bench_run(char **lines, unsigned int count, unsigned int rounds,
+                      struct BenchResult *res)
+{
+  regmatch_t pmatch[1];
+
+  res->length = mutt_mem_calloc(count, sizeof(regoff_t));
+  res->classes = mutt_mem_calloc(count, sizeof(struct QClass *));
+  res->detect_ns = UINT64_MAX;
+  res->classify_ns = UINT64_MAX;
+
+  for (unsigned int r = 0; r < rounds; r++)
+  {
+    uint64_t start = now_ns();
+    res->num_quoted = 0;
+    for (unsigned int i = 0; i < count; i++)
+    {
+      if (mutt_is_quote_line(lines[i], pmatch))
+      {
+        res->length[i] = pmatch[0].rm_eo - pmatch[0].rm_so;
+        res->num_quoted++;
+      }
+      else
+        res->length[i] = -1;
+    }
+    uint64_t ns = now_ns() - start;
+    if (ns < res->detect_ns)
+      res->detect_ns = ns;
+  }
+
+  for (unsigned int r = 0; r < rounds; r++)
+  {
+    bool force_redraw = false;
+    int q_level = 0;
+
+    mutt_quote_free(&res->quote_list);
+
+    uint64_t start = now_ns();
+    for (unsigned int i = 0; i < count; i++)
+    {
+      if (!mutt_is_quote_line(lines[i], pmatch))
+        continue;
+      mutt_quote_classify(&res->quote_list, lines[i] + pmatch[0].rm_so,
+                          pmatch[0].rm_eo - pmatch[0].rm_so, &force_redraw, &q_level);
+    }
+    uint64_t ns = now_ns() - start;
+    if (ns < res->classify_ns)
+      res->classify_ns = ns;
+
+    res->num_classes = q_level;
+  }
+
+  /* Once the tree is complete, record each line's class */
+  for (unsigned int i = 0; i < count; i++)
+  {
+    bool force_redraw = false;
+    if (res->length[i] < 0)
+      continue;
+    res->classes[i] = mutt_quote_classify(&res->quote_list, lines[i],
+                                          res->length[i], &force_redraw, &res->num_classes);
+  }
+}
+
+/**
+ * bench_free - Free the results of a run
+ * @param res Results
+ */
+static void bench_free(struct BenchResult *res)
+{
+  mutt_quote_free(&res->quote_list);
+  FREE(&res->length);
+  FREE(&res->classes);
+}
+
+/**
+ * report - Print the timings for one run
+ * @param name  Name of the run
+ * @param res   Results
+ * @param count Number of lines
+ */
+static void report(const char *name, const struct BenchResult *res, unsigned int count)
+{
+  printf("%-8s %-10s %10.2f %10.1f %10.0f\n", name, "detect", res->detect_ns / 1e6,
+         (double) res->detect_ns / count, count * 1e9 / res->detect_ns);
+  printf("%-8s %-10s %10.2f %10.1f %10.0f\n", name, "classify", res->classify_ns / 1e6,
+         (double) res->classify_ns / count, count * 1e9 / res->classify_ns);
+}
+
+/**
+ * usage - Print the command line options
+ * @param prog Name of the program
+ */
+static void usage(const char *prog)
+{
+  printf("Usage: %s [-f file] [-n count] [-r rounds] [-s seed]\n", prog);
+  printf("  -f file     Read the digest from a file\n");
+  printf("  -n count    Number of lines to generate (default: 50000)\n");
+  printf("  -r rounds   Repeat each step, keep the fastest (default: 5)\n");
+  printf("  -s seed     Seed for the synthetic digest (default: 1)\n");
+}
+
+/**
+ * main - Benchmark the pager's quote classification
+ * @param argc Number of command line arguments
+ * @param argv List of command line arguments
+ * @retval 0 Success
+ * @retval 1 Error, or the scanner and regex disagree
+ */
+int main(int argc, char *argv[])
+{
+  struct BenchOptions opts = { 50000, 1, 5, NULL };
+  int opt;
+
+  while ((opt = getopt(argc, argv, "f:hn:r:s:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'f':
+        opts.file = optarg;
+        break;
+      case 'n':
+        if ((mutt_str_atoui(optarg, &opts.count) < 0) || (opts.count == 0))
+        {
+          fprintf(stderr, "Invalid count: %s\n", optarg);
+          return 1;
+        }
+        break;
+      case 'r':
+        if ((mutt_str_atoui(optarg, &opts.rounds) < 0) || (opts.rounds == 0))
+        {
+          fprintf(stderr, "Invalid rounds: %s\n", optarg);
+          return 1;
+        }
+        break;
+      case 's':
+        if ((mutt_str_atoui(optarg, &opts.seed) < 0) || (opts.seed == 0))
+        {
+          fprintf(stderr, "Invalid seed: %s\n", optarg);
+          return 1;
+        }
+        break;
+      default:
+        usage(argv[0]);
+        return (opt == 'h') ? 0 : 1;
+    }
+  }
+
+  struct Buffer *text = mutt_buffer_new();
+  if (opts.file)
+  {
+    int count = bench_read(opts.file, text);
+    if (count <= 0)
+    {
+      fprintf(stderr, "Can't read: %s\n", opts.file);
+      mutt_buffer_free(&text);
+      return 1;
+    }
+    opts.count = count;
+  }
+  else
+  {
+    RandState = opts.seed;
+    bench_digest(opts.count, text);
+  }
+
+  /* The Buffer may have moved while it grew, so find the lines afterwards */
+  char **lines = mutt_mem_calloc(opts.count, sizeof(char *));
+  char *p = text->data;
+  for (unsigned int i = 0; i < opts.count; i++)
+  {
+    lines[i] = p;
+    p += strlen(p) + 1;
+  }
+
+  int colors[] = { 1, 2, 3, 4, 5, 6 };
+  ColorQuote = colors;
+  ColorQuoteUsed = mutt_array_size(colors);
+
+  struct BenchResult scan = { 0 };
+  struct BenchResult regex = { 0 };
+
+  set_regex(&C_QuoteRegex, QUOTE_REGEX_DEFAULT);
+  set_regex(&C_Smileys, SMILEYS_DEFAULT);
+  bench_run(lines, opts.count, opts.rounds, &scan);
+
+  set_regex(&C_QuoteRegex, QUOTE_REGEX);
+  set_regex(&C_Smileys, SMILEYS_REGEX);
+  bench_run(lines, opts.count, opts.rounds, &regex);
+
+  printf("%u lines, %u quoted, %d classes, best of %u rounds\n\n", opts.count,
+         scan.num_quoted, scan.num_classes, opts.rounds);
+  printf("%-8s %-10s %10s %10s %10s\n", "matcher", "step", "ms", "ns/line", "lines/sec");
+  report("scan", &scan, opts.count);
+  report("regex", &regex, opts.count);
+
+  /* Both matchers must agree on every line */
+  int rc = 0;
+  for (unsigned int i = 0; i < opts.count; i++)
+  {
+    const char *pscan = scan.classes[i] ? scan.classes[i]->prefix : NULL;
+    const char *pregex = regex.classes[i] ? regex.classes[i]->prefix : NULL;
+    if ((scan.length[i] != regex.length[i]) || (mutt_str_strcmp(pscan, pregex) != 0))
+    {
+      fprintf(stderr, "line %u differs: scan %d, regex %d: %s\n", i + 1,
+              (int) scan.length[i], (int) regex.length[i], lines[i]);
+      rc = 1;
+    }
+  }
+  if (scan.num_classes != regex.num_classes)
+  {
+    fprintf(stderr, "classes differ: scan %d, regex %d\n", scan.num_classes,
+            regex.num_classes);
+    rc = 1;
+  }
+
+  bench_free(&scan);
+  bench_free(&regex);
+  FREE(&lines);
+  mutt_buffer_free(&text);
+  mutt_regex_free(&C_QuoteRegex);
+  mutt_regex_free(&C_Smileys);
+  return rc;
+}
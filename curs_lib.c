@@ -103,7 +103,7 @@ void mutt_refresh(void)
     return;
 
   /* don't refresh in the middle of macros unless necessary */
-  if (MacroBufferCount && !OptForceRefresh && !OptIgnoreMacroEvents)
+  if (mutt_macro_pending())
     return;
 
   /* else */
@@ -766,6 +766,18 @@ void mutt_flush_macro_to_endcond(void)
   }
 }
 
+/**
+ * mutt_macro_pending - Are there keys from a macro waiting to be read?
+ * @retval true Macro keys are queued
+ *
+ * While this is true, the screen won't be refreshed, so callers may put off
+ * redraws and mailbox checks until the macro has finished.
+ */
+bool mutt_macro_pending(void)
+{
+  return (MacroBufferCount > 0) && !OptForceRefresh && !OptIgnoreMacroEvents;
+}
+
 /**
  * mutt_flush_unget_to_endcond - Clear entries from UngetKeyEvents
  *
@@ -57,6 +57,7 @@ struct Email
   bool display_subject : 1; /**< used for threading */
   bool recip_valid     : 1; /**< is_recipient is valid */
   bool active          : 1; /**< message is not to be removed */
+  bool hcache_pending  : 1; /**< waiting to be saved to the header cache */
   bool trash           : 1; /**< message is marked as trashed on disk.
                              * This flag is used by the maildir_trash option. */
 
@@ -98,6 +99,7 @@ struct Email
 
   /* Number of qualifying attachments in message, if attach_valid */
   short attach_total;
+  unsigned int attach_id; /**< attachment config attach_total was counted with */
 
 #ifdef MIXMASTER
   struct ListHead chain;
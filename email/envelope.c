@@ -95,9 +95,29 @@ void mutt_env_free(struct Envelope **p)
   mutt_list_free(&(*p)->references);
   mutt_list_free(&(*p)->in_reply_to);
   mutt_list_free(&(*p)->userhdrs);
+  FREE(&(*p)->cold);
   FREE(p);
 }
 
+/**
+ * mutt_env_thaw - Restore the fields of an Envelope that were left serialised
+ * @param env Envelope to restore
+ *
+ * The To, Cc, Bcc, Reply-To, In-Reply-To, X-Label, spam and user-defined
+ * headers of an Envelope restored from the header cache aren't decoded until
+ * they're needed.  Call this before using them.
+ */
+void mutt_env_thaw(struct Envelope *env)
+{
+  if (!env || !env->cold)
+    return;
+
+  struct EnvelopeCold *cold = env->cold;
+  env->cold = NULL;
+  cold->thaw(env, cold->data, cold->len);
+  FREE(&cold);
+}
+
 /**
  * mutt_env_merge - Merge the headers of two Envelopes
  * @param[in]  base  Envelope destination for all the headers
@@ -111,6 +131,9 @@ void mutt_env_merge(struct Envelope *base, struct Envelope **extra)
   if (!base || !extra || !*extra)
     return;
 
+  mutt_env_thaw(base);
+  mutt_env_thaw(*extra);
+
 /* copies each existing element if necessary, and sets the element
  * to NULL in the source so that mutt_env_free doesn't leave us
  * with dangling pointers. */
@@ -190,6 +213,10 @@ bool mutt_env_cmp_strict(const struct Envelope *e1, const struct Envelope *e2)
 {
   if (e1 && e2)
   {
+    /* Comparing two Envelopes means restoring them */
+    mutt_env_thaw((struct Envelope *) e1);
+    mutt_env_thaw((struct Envelope *) e2);
+
     if ((mutt_str_strcmp(e1->message_id, e2->message_id) != 0) ||
         (mutt_str_strcmp(e1->subject, e2->subject) != 0) ||
         !mutt_list_compare(&e1->references, &e2->references) ||
@@ -224,6 +251,7 @@ void mutt_env_to_local(struct Envelope *env)
   if (!env)
     return;
 
+  mutt_env_thaw(env);
   mutt_addrlist_to_local(&env->return_path);
   mutt_addrlist_to_local(&env->from);
   mutt_addrlist_to_local(&env->to);
@@ -262,6 +290,8 @@ int mutt_env_to_intl(struct Envelope *env, const char **tag, char **err)
   if (!env)
     return 1;
 
+  mutt_env_thaw(env);
+
   int e = 0;
   H_TO_INTL(return_path);
   H_TO_INTL(from);
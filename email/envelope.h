@@ -34,6 +34,21 @@
 #define MUTT_ENV_CHANGED_XLABEL  (1<<2)  ///< X-Label edited
 #define MUTT_ENV_CHANGED_SUBJECT (1<<3)  ///< Protected header update
 
+struct Envelope;
+
+/**
+ * struct EnvelopeCold - Envelope fields that haven't been restored yet
+ *
+ * The header cache restores the fields needed to open a mailbox straight
+ * away.  The rest are kept in serialised form until mutt_env_thaw() is called.
+ */
+struct EnvelopeCold
+{
+  void (*thaw)(struct Envelope *env, const unsigned char *data, size_t len); ///< Function to restore the fields
+  size_t len;                                                               ///< Length of the data
+  unsigned char data[];                                                     ///< Serialised fields
+};
+
 /**
  * struct Envelope - The header of an email
  */
@@ -67,6 +82,7 @@ struct Envelope
   struct ListHead references;  /**< message references (in reverse order) */
   struct ListHead in_reply_to; /**< in-reply-to header content */
   struct ListHead userhdrs;    /**< user defined headers */
+  struct EnvelopeCold *cold;   /**< fields not restored yet, see mutt_env_thaw() */
 
   unsigned char changed;       /* The MUTT_ENV_CHANGED_* flags specify which
                                 * fields are modified */
@@ -76,6 +92,7 @@ bool             mutt_env_cmp_strict(const struct Envelope *e1, const struct Env
 void             mutt_env_free(struct Envelope **p);
 void             mutt_env_merge(struct Envelope *base, struct Envelope **extra);
 struct Envelope *mutt_env_new(void);
+void             mutt_env_thaw(struct Envelope *env);
 int              mutt_env_to_intl(struct Envelope *env, const char **tag, char **err);
 void             mutt_env_to_local(struct Envelope *e);
 
@@ -30,8 +30,12 @@
 #include "config.h"
 #include <ctype.h>
 #include <regex.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <time.h>
+#include <unistd.h>
 #include "mutt/mutt.h"
 #include "address/lib.h"
 #include "mutt.h"
@@ -1329,6 +1333,142 @@ void mutt_parse_part(FILE *fp, struct Body *b)
   }
 }
 
+#define MIME_MAP_SLACK 1024 ///< Bytes mapped past the end of a multipart body
+
+/**
+ * struct MimeMap - A read-only view of part of a message file
+ *
+ * The whole multipart body is available, so that boundaries can be found
+ * without reading the message line by line.
+ */
+struct MimeMap
+{
+  const char *data; ///< Contents of the file, starting at offset base
+  LOFF_T base;      ///< Offset in the file of the first byte of data
+  size_t size;      ///< Length of the data
+  void *addr;       ///< Start of the mapping, if the file was mmap()ed
+  size_t len;       ///< Length of the mapping
+};
+
+/**
+ * mime_map_open - Get a read-only view of part of a file
+ * @param[in]  fp    File to read
+ * @param[in]  start Offset of the first byte needed
+ * @param[in]  end   Offset of the end of the range
+ * @param[out] map   View of the file
+ * @retval true Success
+ *
+ * Only the range [start, end) is made available, so nested multiparts don't
+ * map or read the whole file again.  Regular files are memory-mapped, from the
+ * page containing @a start.  Anything else, e.g. an in-memory stream, is read
+ * into a buffer.
+ */
+static bool mime_map_open(FILE *fp, LOFF_T start, LOFF_T end, struct MimeMap *map)
+{
+  memset(map, 0, sizeof(*map));
+  map->data = "";
+  map->base = start;
+
+  /* Make sure that anything written via stdio is visible in the file */
+  fflush(fp);
+
+  struct stat st;
+  int fd = fileno(fp);
+  if ((fd >= 0) && (fstat(fd, &st) == 0) && S_ISREG(st.st_mode))
+  {
+    if (end > st.st_size)
+      end = st.st_size;
+    if (start >= end)
+      return true;
+
+    const LOFF_T page = sysconf(_SC_PAGESIZE);
+    const LOFF_T aligned = start - (start % page);
+    const size_t len = end - aligned;
+
+    void *addr = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, aligned);
+    if (addr != MAP_FAILED)
+    {
+#ifdef MADV_SEQUENTIAL
+      madvise(addr, len, MADV_SEQUENTIAL);
+#endif
+      map->addr = addr;
+      map->len = len;
+      map->data = (const char *) addr + (start - aligned);
+      map->size = end - start;
+      return true;
+    }
+  }
+
+  if ((start >= end) || (fseeko(fp, start, SEEK_SET) != 0))
+    return start >= end;
+
+  size_t want = end - start;
+  size_t alloc = 0;
+  char *data = NULL;
+  size_t n;
+  do
+  {
+    if (alloc == map->size)
+    {
+      alloc += MIN(want - alloc, 262144);
+      mutt_mem_realloc(&data, alloc);
+    }
+    n = fread(data + map->size, 1, alloc - map->size, fp);
+    map->size += n;
+  } while ((n > 0) && (map->size < want));
+
+  if (map->size == 0)
+  {
+    FREE(&data);
+    return true;
+  }
+
+  map->data = data;
+  return true;
+}
+
+/**
+ * mime_map_close - Release a view of a file
+ * @param map View of the file
+ */
+static void mime_map_close(struct MimeMap *map)
+{
+  if (map->addr)
+    munmap(map->addr, map->len);
+  else if (map->size != 0)
+    FREE(&map->data);
+
+  memset(map, 0, sizeof(*map));
+}
+
+/**
+ * mime_memmem - Find a byte string inside a block of memory
+ * @param hay    Memory to search
+ * @param hlen   Length of hay
+ * @param needle String to find
+ * @param nlen   Length of needle
+ * @retval ptr  First match
+ * @retval NULL No match
+ */
+static const char *mime_memmem(const char *hay, size_t hlen, const char *needle, size_t nlen)
+{
+#ifdef HAVE_MEMMEM
+  return memmem(hay, hlen, needle, nlen);
+#else
+  while (hlen >= nlen)
+  {
+    const char *p = memchr(hay, needle[0], hlen - nlen + 1);
+    if (!p)
+      return NULL;
+    if (memcmp(p, needle, nlen) == 0)
+      return p;
+    hlen -= (p + 1 - hay);
+    hay = p + 1;
+  }
+  return NULL;
+#endif
+}
+
 /**
  * mutt_parse_multipart - parse a multipart structure
  * @param fp       stream to read from
@@ -1337,6 +1477,9 @@ void mutt_parse_part(FILE *fp, struct Body *b)
  *                 boundary is missing to avoid reading too far)
  * @param digest   true if reading a multipart/digest
  * @retval ptr New Body containing parsed structure
+ *
+ * The boundaries are found by searching a memory-mapped view of the body.
+ * Only the MIME headers of each part are read through the stream.
  */
 struct Body *mutt_parse_multipart(FILE *fp, const char *boundary, LOFF_T end_off, bool digest)
 {
@@ -1349,77 +1492,114 @@ struct Body *mutt_parse_multipart(FILE *fp, const char *boundary, LOFF_T end_off
     return NULL;
   }
 
-  char buf[1024];
   struct Body *head = NULL, *last = NULL, *new = NULL;
   bool final = false; /* did we see the ending boundary? */
 
+  LOFF_T pos = ftello(fp);
+  struct MimeMap map;
+  /* The final boundary line may run past the end of the body */
+  if ((pos < 0) || !mime_map_open(fp, pos, end_off + MIME_MAP_SLACK, &map))
+    return NULL;
+
   const size_t blen = mutt_str_strlen(boundary);
-  while ((ftello(fp) < end_off) && fgets(buf, sizeof(buf), fp))
+  char *delim = mutt_mem_malloc(blen + 3);
+  delim[0] = '-';
+  delim[1] = '-';
+  memcpy(delim + 2, boundary, blen + 1);
+
+  /* Offsets in the file; data[i] is the byte at offset (base + i) */
+  const char *data = map.data;
+  const LOFF_T base = map.base;
+  const LOFF_T size = base + map.size;
+  LOFF_T line_start = pos; /* start of the line the search began on */
+
+  while ((pos < end_off) && (pos < size))
   {
-    const size_t len = mutt_str_strlen(buf);
+    const char *match = mime_memmem(data + (pos - base), size - pos, delim, blen + 2);
+    if (!match || ((base + (match - data)) >= end_off))
+      break;
 
-    const size_t crlf = ((len > 1) && (buf[len - 2] == '\r')) ? 1 : 0;
+    /* A boundary must be at the start of a line */
+    const LOFF_T bpos = base + (match - data);
+    if ((bpos != line_start) && (data[bpos - base - 1] != '\n'))
+    {
+      pos = bpos + 1;
+      continue;
+    }
+
+    const char *nl = memchr(match, '\n', size - bpos);
+    const LOFF_T eol = nl ? (base + (nl + 1 - data)) : size;
+    const size_t len = eol - bpos;
+    const size_t crlf = ((len > 1) && (data[eol - base - 2] == '\r')) ? 1 : 0;
+
+    if (last)
+    {
+      last->length = eol - last->offset - len - 1 - crlf;
+      if (last->parts && (last->parts->length == 0))
+        last->parts->length = eol - last->parts->offset - len - 1 - crlf;
+      /* if the body is empty, we can end up with a -1 length */
+      if (last->length < 0)
+        last->length = 0;
+    }
+
+    /* Ignore any trailing whitespace after the boundary */
+    const char *rest = match + blen + 2;
+    const char *rest_end = data + (eol - base);
+    while ((rest_end > rest) && IS_SPACE(rest_end[-1]))
+      rest_end--;
+
+    pos = eol;
+    line_start = eol;
 
-    if ((buf[0] == '-') && (buf[1] == '-') && mutt_str_startswith(buf + 2, boundary, CASE_MATCH))
+    /* Check for the end boundary */
+    if (((rest_end - rest) == 2) && (rest[0] == '-') && (rest[1] == '-'))
+    {
+      final = true;
+      break; /* done parsing */
+    }
+    else if (rest_end == rest)
     {
-      if (last)
+      fseeko(fp, eol, SEEK_SET);
+      new = mutt_read_mime_header(fp, digest);
+      pos = ftello(fp);
+
+#ifdef SUN_ATTACHMENT
+      if (mutt_param_get(&new->parameter, "content-lines"))
       {
-        last->length = ftello(fp) - last->offset - len - 1 - crlf;
-        if (last->parts && (last->parts->length == 0))
-          last->parts->length = ftello(fp) - last->parts->offset - len - 1 - crlf;
-        /* if the body is empty, we can end up with a -1 length */
-        if (last->length < 0)
-          last->length = 0;
+        int lines = 0;
+        if (mutt_str_atoi(mutt_param_get(&new->parameter, "content-lines"), &lines) < 0)
+          lines = 0;
+        for (; (lines > 0) && (pos < end_off) && (pos < size); lines--)
+        {
+          nl = memchr(data + (pos - base), '\n', size - pos);
+          pos = nl ? (base + (nl + 1 - data)) : size;
+        }
       }
+#endif
+      line_start = pos;
 
-      if (len > 0)
+      /* Consistency checking - catch bad attachment end boundaries */
+      if (new->offset > end_off)
       {
-        /* Remove any trailing whitespace, up to the length of the boundary */
-        for (size_t i = len - 1; IS_SPACE(buf[i]) && (i >= (blen + 2)); i--)
-          buf[i] = '\0';
+        mutt_body_free(&new);
+        break;
       }
-
-      /* Check for the end boundary */
-      if (mutt_str_strcmp(buf + blen + 2, "--") == 0)
+      if (head)
       {
-        final = true;
-        break; /* done parsing */
+        last->next = new;
+        last = new;
       }
-      else if (buf[2 + blen] == '\0')
+      else
       {
-        new = mutt_read_mime_header(fp, digest);
-
-#ifdef SUN_ATTACHMENT
-        if (mutt_param_get(&new->parameter, "content-lines"))
-        {
-          int lines = 0;
-          if (mutt_str_atoi(mutt_param_get(&new->parameter, "content-lines"), &lines) < 0)
-            lines = 0;
-          for (; lines > 0; lines--)
-            if ((ftello(fp) >= end_off) || !fgets(buf, sizeof(buf), fp))
-              break;
-        }
-#endif
-        /* Consistency checking - catch bad attachment end boundaries */
-        if (new->offset > end_off)
-        {
-          mutt_body_free(&new);
-          break;
-        }
-        if (head)
-        {
-          last->next = new;
-          last = new;
-        }
-        else
-        {
-          last = new;
-          head = new;
-        }
+        last = new;
+        head = new;
       }
     }
   }
 
+  FREE(&delim);
+  mime_map_close(&map);
+
   /* in case of missing end boundary, set the length to something reasonable */
   if (last && (last->length == 0) && !final)
     last->length = end_off - last->offset;
@@ -790,6 +790,7 @@ void rfc2047_decode_envelope(struct Envelope *env)
 {
   if (!env)
     return;
+  mutt_env_thaw(env);
   rfc2047_decode_addrlist(&env->from);
   rfc2047_decode_addrlist(&env->to);
   rfc2047_decode_addrlist(&env->cc);
@@ -810,6 +811,7 @@ void rfc2047_encode_envelope(struct Envelope *env)
 {
   if (!env)
     return;
+  mutt_env_thaw(env);
   rfc2047_encode_addrlist(&env->from, "From");
   rfc2047_encode_addrlist(&env->to, "To");
   rfc2047_encode_addrlist(&env->cc, "Cc");
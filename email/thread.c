@@ -228,6 +228,7 @@ void mutt_break_thread(struct Email *e)
   if (!e)
     return;
 
+  mutt_env_thaw(e->env);
   mutt_list_free(&e->env->in_reply_to);
   mutt_list_free(&e->env->references);
   e->changed = true;
@@ -24,10 +24,27 @@
  * @page filter Pass files through external commands (filters)
  *
  * Pass files through external commands (filters)
+ *
+ * ## Spawn helper
+ *
+ * Forking NeoMutt gets slower as its address space grows (large mailboxes,
+ * header caches).  Commands that are run over and over, e.g. one `gpg` per
+ * message, can instead be started by a small helper process that is forked
+ * early, while NeoMutt is still small.  mutt_create_filter_helper() sends it
+ * the command and the child's stdin/stdout/stderr over a socket; the helper
+ * forks and execs it and mutt_wait_filter() asks the helper for the exit
+ * status.  If the helper isn't running, the command is forked directly.
  */
 
 #include "config.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
 #include <sys/wait.h>
 #include <unistd.h>
 #include "mutt/mutt.h"
@@ -218,6 +235,511 @@ pid_t mutt_create_filter(const char *s, FILE **fp_in, FILE **fp_out, FILE **fp_e
   return mutt_create_filter_fd(s, fp_in, fp_out, fp_err, -1, -1, -1);
 }
 
+/**
+ * enum HelperOp - Request sent to the spawn helper
+ */
+enum HelperOp
+{
+  HELPER_SPAWN = 1, ///< Run a command, reply with its pid
+  HELPER_WAIT,      ///< Wait for a command, reply with its wait() status
+};
+
+/**
+ * struct HelperRequest - Header of a request to the spawn helper
+ *
+ * A #HELPER_SPAWN request is followed by `len` bytes: the command, the working
+ * directory and then the environment, each one nul-terminated.
+ */
+struct HelperRequest
+{
+  int op;      ///< Request, e.g. #HELPER_SPAWN
+  pid_t pid;   ///< Process to wait for (#HELPER_WAIT)
+  int fds;     ///< Which of stdin, stdout, stderr are passed (bits 0-2)
+  size_t len;  ///< Length of the strings that follow
+};
+
+/**
+ * struct HelperReply - Reply from the spawn helper
+ */
+struct HelperReply
+{
+  pid_t pid;  ///< Pid of the new process (-1 on error)
+  int status; ///< wait() status (#HELPER_WAIT)
+};
+
+static int HelperSocket = -1;      ///< Connection to the spawn helper
+static pid_t HelperPid = -1;       ///< Process id of the spawn helper
+static pid_t *HelperChildren;      ///< Processes started by the helper
+static size_t HelperChildrenCount; ///< Number of entries in #HelperChildren
+static size_t HelperChildrenMax;   ///< Size of #HelperChildren
+
+/**
+ * write_all - Write a buffer, retrying after short writes
+ * @param fd  File descriptor
+ * @param buf Data to write
+ * @param len Length of data
+ * @retval true Success
+ */
+static bool write_all(int fd, const void *buf, size_t len)
+{
+  const char *p = buf;
+  while (len > 0)
+  {
+    ssize_t rc = write(fd, p, len);
+    if ((rc < 0) && (errno == EINTR))
+      continue;
+    if (rc <= 0)
+      return false;
+    p += rc;
+    len -= rc;
+  }
+  return true;
+}
+
+/**
+ * read_all - Read a buffer, retrying after short reads
+ * @param fd  File descriptor
+ * @param buf Buffer for the data
+ * @param len Length of data
+ * @retval true Success
+ */
+static bool read_all(int fd, void *buf, size_t len)
+{
+  char *p = buf;
+  while (len > 0)
+  {
+    ssize_t rc = read(fd, p, len);
+    if ((rc < 0) && (errno == EINTR))
+      continue;
+    if (rc <= 0)
+      return false;
+    p += rc;
+    len -= rc;
+  }
+  return true;
+}
+
+/**
+ * helper_recv - Read a request and any file descriptors attached to it
+ * @param[in]  sock Socket
+ * @param[out] req  Request header
+ * @param[out] fds  File descriptors for stdin, stdout, stderr (-1 if not passed)
+ * @retval true Success
+ */
+static bool helper_recv(int sock, struct HelperRequest *req, int fds[3])
+{
+  union {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE(3 * sizeof(int))];
+  } control;
+  struct iovec iov = { req, sizeof(*req) };
+  struct msghdr msg = { 0 };
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+
+  fds[0] = fds[1] = fds[2] = -1;
+
+  ssize_t rc;
+  do
+  {
+    rc = recvmsg(sock, &msg, 0);
+  } while ((rc < 0) && (errno == EINTR));
+  if (rc <= 0)
+    return false;
+
+  int passed[3];
+  int num = 0;
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  if (cmsg && (cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_RIGHTS))
+  {
+    num = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    if (num > 3)
+      num = 3;
+    memcpy(passed, CMSG_DATA(cmsg), num * sizeof(int));
+  }
+
+  if (((size_t) rc < sizeof(*req)) && !read_all(sock, (char *) req + rc, sizeof(*req) - rc))
+    return false;
+
+  for (int i = 0, j = 0; (i < 3) && (j < num); i++)
+    if (req->fds & (1 << i))
+      fds[i] = passed[j++];
+
+  return true;
+}
+
+/**
+ * helper_spawn - Run a command for the client (in the helper)
+ * @param sock Socket
+ * @param req  Request
+ * @param fds  File descriptors for stdin, stdout, stderr
+ * @retval num Pid of the command
+ * @retval -1  Error
+ */
+static pid_t helper_spawn(int sock, struct HelperRequest *req, int fds[3])
+{
+  char *data = mutt_mem_malloc(req->len + 1);
+  if (!read_all(sock, data, req->len))
+    _exit(0);
+  data[req->len] = '\0';
+
+  /* cmd \0 cwd \0 env1 \0 env2 \0 ... */
+  const char *cmd = data;
+  const char *cwd = cmd + strlen(cmd) + 1;
+  size_t num_env = 0;
+  for (const char *p = cwd + strlen(cwd) + 1; p < data + req->len; p += strlen(p) + 1)
+    num_env++;
+
+  char **env = mutt_mem_calloc(num_env + 1, sizeof(char *));
+  size_t i = 0;
+  for (char *p = (char *) cwd + strlen(cwd) + 1; p < data + req->len; p += strlen(p) + 1)
+    env[i++] = p;
+
+  pid_t pid = fork();
+  if (pid == 0)
+  {
+    for (int j = 0; j < 3; j++)
+    {
+      if (fds[j] == -1)
+        continue;
+      dup2(fds[j], j);
+      if (fds[j] > 2)
+        close(fds[j]);
+    }
+    close(sock);
+
+    signal(SIGINT, SIG_DFL);
+    signal(SIGQUIT, SIG_DFL);
+    signal(SIGPIPE, SIG_DFL);
+
+    if ((cwd[0] != '\0') && (chdir(cwd) != 0))
+      _exit(127);
+
+    execle(EXEC_SHELL, "sh", "-c", cmd, NULL, env);
+    _exit(127);
+  }
+
+  FREE(&env);
+  FREE(&data);
+  return pid;
+}
+
+/**
+ * helper_main - Serve requests until NeoMutt closes the socket
+ * @param sock Socket
+ */
+static void helper_main(int sock)
+{
+  /* Don't run any of NeoMutt's signal handlers */
+  sigset_t set;
+  sigemptyset(&set);
+  sigprocmask(SIG_SETMASK, &set, NULL);
+  static const int def_sigs[] = { SIGTERM, SIGHUP,  SIGTSTP, SIGCONT, SIGWINCH,
+                                  SIGALRM, SIGUSR1, SIGUSR2, SIGCHLD, SIGSEGV };
+  for (size_t i = 0; i < mutt_array_size(def_sigs); i++)
+    signal(def_sigs[i], SIG_DFL);
+  /* Ctrl-C is for the command, not for the helper */
+  signal(SIGINT, SIG_IGN);
+  signal(SIGQUIT, SIG_IGN);
+  signal(SIGPIPE, SIG_IGN);
+
+  /* Only low-numbered descriptors exist this early in startup */
+  for (int fd = 3; fd < 1024; fd++)
+    if (fd != sock)
+      close(fd);
+
+  struct HelperRequest req;
+  int fds[3];
+  while (helper_recv(sock, &req, fds))
+  {
+    struct HelperReply reply = { -1, 0 };
+    if (req.op == HELPER_SPAWN)
+    {
+      reply.pid = helper_spawn(sock, &req, fds);
+      for (int i = 0; i < 3; i++)
+        if (fds[i] != -1)
+          close(fds[i]);
+    }
+    else if (req.op == HELPER_WAIT)
+    {
+      pid_t rc;
+      do
+      {
+        rc = waitpid(req.pid, &reply.status, 0);
+      } while ((rc < 0) && (errno == EINTR));
+      reply.pid = rc;
+    }
+
+    if (!write_all(sock, &reply, sizeof(reply)))
+      break;
+  }
+
+  _exit(0);
+}
+
+/**
+ * mutt_filter_helper_start - Start the spawn helper
+ * @retval  0 Success
+ * @retval -1 Error
+ *
+ * This should be called early, before NeoMutt has grown.
+ * The helper exits when NeoMutt closes its end of the socket.
+ */
+int mutt_filter_helper_start(void)
+{
+  if (HelperSocket != -1)
+    return 0;
+
+  int sv[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+    return -1;
+
+  pid_t pid = fork();
+  if (pid == 0)
+  {
+    close(sv[0]);
+    helper_main(sv[1]);
+  }
+
+  close(sv[1]);
+  if (pid == -1)
+  {
+    close(sv[0]);
+    return -1;
+  }
+
+  fcntl(sv[0], F_SETFD, FD_CLOEXEC);
+  HelperSocket = sv[0];
+  HelperPid = pid;
+  mutt_debug(LL_DEBUG1, "spawn helper started, pid %d\n", pid);
+  return 0;
+}
+
+/**
+ * mutt_filter_helper_stop - Stop the spawn helper
+ */
+void mutt_filter_helper_stop(void)
+{
+  if (HelperSocket == -1)
+    return;
+
+  close(HelperSocket);
+  HelperSocket = -1;
+  waitpid(HelperPid, NULL, 0);
+  HelperPid = -1;
+  FREE(&HelperChildren);
+  HelperChildrenCount = 0;
+  HelperChildrenMax = 0;
+}
+
+/**
+ * helper_failed - Give up on the spawn helper after a communication error
+ */
+static void helper_failed(void)
+{
+  mutt_debug(LL_DEBUG1, "spawn helper failed: %s\n", strerror(errno));
+  mutt_filter_helper_stop();
+}
+
+/**
+ * helper_forget - Remove a process from the list of the helper's children
+ * @param pid Process id
+ * @retval true The process was started by the helper
+ */
+static bool helper_forget(pid_t pid)
+{
+  for (size_t i = 0; i < HelperChildrenCount; i++)
+  {
+    if (HelperChildren[i] == pid)
+    {
+      HelperChildren[i] = HelperChildren[--HelperChildrenCount];
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * helper_wait - Ask the spawn helper to wait for a process
+ * @param[in]  pid    Process id
+ * @param[out] status wait() status
+ * @retval true Success
+ */
+static bool helper_wait(pid_t pid, int *status)
+{
+  struct HelperRequest req = { HELPER_WAIT, pid, 0, 0 };
+  struct HelperReply reply = { -1, 0 };
+
+  if ((HelperSocket == -1) || !write_all(HelperSocket, &req, sizeof(req)) ||
+      !read_all(HelperSocket, &reply, sizeof(reply)))
+  {
+    helper_failed();
+    return false;
+  }
+
+  if (reply.pid != pid)
+    return false;
+
+  *status = reply.status;
+  return true;
+}
+
+/**
+ * helper_send - Send a spawn request to the helper
+ * @param cmd Command line to invoke using `sh -c`
+ * @param fds File descriptors for stdin, stdout, stderr (-1: inherit the helper's)
+ * @retval num PID of the created process
+ * @retval -1  Error
+ */
+static pid_t helper_send(const char *cmd, int fds[3])
+{
+  struct Buffer *data = mutt_buffer_pool_get();
+  char cwd[PATH_MAX];
+
+  mutt_buffer_addstr(data, cmd);
+  mutt_buffer_addch(data, '\0');
+  if (getcwd(cwd, sizeof(cwd)))
+    mutt_buffer_addstr(data, cwd);
+  mutt_buffer_addch(data, '\0');
+  for (char **env = mutt_envlist_getlist(); env && *env; env++)
+  {
+    if (mutt_str_startswith(*env, "COLUMNS=", CASE_MATCH))
+      continue;
+    mutt_buffer_addstr(data, *env);
+    mutt_buffer_addch(data, '\0');
+  }
+  if (MuttIndexWindow && (MuttIndexWindow->cols > 0))
+  {
+    mutt_buffer_add_printf(data, "COLUMNS=%d", MuttIndexWindow->cols);
+    mutt_buffer_addch(data, '\0');
+  }
+
+  struct HelperRequest req = { HELPER_SPAWN, 0, 0, mutt_buffer_len(data) };
+  int passed[3];
+  int num = 0;
+  for (int i = 0; i < 3; i++)
+  {
+    if (fds[i] == -1)
+      continue;
+    req.fds |= (1 << i);
+    passed[num++] = fds[i];
+  }
+
+  union {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE(3 * sizeof(int))];
+  } control;
+  struct iovec iov = { &req, sizeof(req) };
+  struct msghdr msg = { 0 };
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  if (num > 0)
+  {
+    memset(&control, 0, sizeof(control));
+    msg.msg_control = control.buf;
+    msg.msg_controllen = CMSG_SPACE(num * sizeof(int));
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(num * sizeof(int));
+    memcpy(CMSG_DATA(cmsg), passed, num * sizeof(int));
+  }
+
+  struct HelperReply reply = { -1, 0 };
+  ssize_t rc;
+  do
+  {
+    rc = sendmsg(HelperSocket, &msg, 0);
+  } while ((rc < 0) && (errno == EINTR));
+
+  if ((rc < 0) || (((size_t) rc < sizeof(req)) && !write_all(HelperSocket, (char *) &req + rc, sizeof(req) - rc)) ||
+      !write_all(HelperSocket, data->data, mutt_buffer_len(data)) ||
+      !read_all(HelperSocket, &reply, sizeof(reply)))
+  {
+    helper_failed();
+    reply.pid = -1;
+  }
+
+  mutt_buffer_pool_release(&data);
+  return reply.pid;
+}
+
+/**
+ * mutt_create_filter_helper - Run a command on a pipe using the spawn helper
+ * @param[in]  cmd    Command line to invoke using `sh -c`
+ * @param[out] fp_in  File stream pointing to stdin for the command process, can be NULL
+ * @param[out] fp_out File stream pointing to stdout for the command process, can be NULL
+ * @param[out] fp_err File stream pointing to stderr for the command process, can be NULL
+ * @param[in]  fdin   If `in` is NULL and fdin is not -1 then fdin will be used as stdin for the command process
+ * @param[in]  fdout  If `out` is NULL and fdout is not -1 then fdout will be used as stdout for the command process
+ * @param[in]  fderr  If `error` is NULL and fderr is not -1 then fderr will be used as stderr for the command process
+ * @retval num PID of the created process
+ * @retval -1  Error creating pipes or forking
+ *
+ * This behaves like mutt_create_filter_fd().  If the spawn helper isn't
+ * running, it falls back to mutt_create_filter_fd().
+ */
+pid_t mutt_create_filter_helper(const char *cmd, FILE **fp_in, FILE **fp_out,
+                                FILE **fp_err, int fdin, int fdout, int fderr)
+{
+  if (HelperSocket == -1)
+    return mutt_create_filter_fd(cmd, fp_in, fp_out, fp_err, fdin, fdout, fderr);
+
+  /* pipes[i][child] is the child's end of stdin, stdout, stderr */
+  int pipes[3][2] = { { -1, -1 }, { -1, -1 }, { -1, -1 } };
+  FILE **fps[3] = { fp_in, fp_out, fp_err };
+  int fds[3] = { fdin, fdout, fderr };
+  const int child[3] = { 0, 1, 1 };
+  pid_t pid = -1;
+
+  for (int i = 0; i < 3; i++)
+  {
+    if (!fps[i])
+      continue;
+    *fps[i] = NULL;
+    if (pipe(pipes[i]) == -1)
+      goto cleanup;
+    fds[i] = pipes[i][child[i]];
+  }
+
+  pid = helper_send(cmd, fds);
+
+cleanup:
+  for (int i = 0; i < 3; i++)
+  {
+    if (pipes[i][0] == -1)
+      continue;
+    close(pipes[i][child[i]]);
+    if (pid == -1)
+    {
+      close(pipes[i][!child[i]]);
+      continue;
+    }
+    *fps[i] = fdopen(pipes[i][!child[i]], (i == 0) ? "w" : "r");
+  }
+
+  if (pid == -1)
+  {
+    /* The helper has gone, run the command ourselves */
+    if (HelperSocket == -1)
+      return mutt_create_filter_fd(cmd, fp_in, fp_out, fp_err, fdin, fdout, fderr);
+    return -1;
+  }
+
+  if (HelperChildrenCount == HelperChildrenMax)
+  {
+    HelperChildrenMax += 8;
+    mutt_mem_realloc(&HelperChildren, HelperChildrenMax * sizeof(pid_t));
+  }
+  HelperChildren[HelperChildrenCount++] = pid;
+
+  /* Pair with mutt_sig_unblock_system() in mutt_wait_filter() */
+  mutt_sig_block_system();
+  return pid;
+}
+
 /**
  * mutt_wait_filter - Wait for the exit of a process and return its status
  * @param pid Process id of the process to wait for
@@ -226,9 +748,12 @@ pid_t mutt_create_filter(const char *s, FILE **fp_in, FILE **fp_out, FILE **fp_e
  */
 int mutt_wait_filter(pid_t pid)
 {
-  int rc;
+  int rc = -1;
 
-  waitpid(pid, &rc, 0);
+  if (helper_forget(pid))
+    helper_wait(pid, &rc);
+  else
+    waitpid(pid, &rc, 0);
   mutt_sig_unblock_system(true);
   rc = WIFEXITED(rc) ? WEXITSTATUS(rc) : -1;
 
@@ -250,13 +775,18 @@ int mutt_wait_filter(pid_t pid)
  */
 int mutt_wait_interactive_filter(pid_t pid)
 {
-  int rc;
+  int rc = -1;
 
+  if (helper_forget(pid))
+    helper_wait(pid, &rc);
+  else
+  {
 #ifdef USE_IMAP
-  rc = imap_wait_keepalive(pid);
+    rc = imap_wait_keepalive(pid);
 #else
-  waitpid(pid, &rc, 0);
+    waitpid(pid, &rc, 0);
 #endif
+  }
   mutt_sig_unblock_system(true);
   rc = WIFEXITED(rc) ? WEXITSTATUS(rc) : -1;
 
@@ -28,5 +28,8 @@ pid_t mutt_create_filter_fd(const char *cmd, FILE **fp_in, FILE **fp_out, FILE *
 pid_t mutt_create_filter(const char *s, FILE **fp_in, FILE **fp_out, FILE **fp_err);
 int mutt_wait_filter(pid_t pid);
 int mutt_wait_interactive_filter (pid_t pid);
+pid_t mutt_create_filter_helper(const char *cmd, FILE **fp_in, FILE **fp_out, FILE **fp_err, int fdin, int fdout, int fderr);
+int mutt_filter_helper_start(void);
+void mutt_filter_helper_stop(void);
 
 #endif /* MUTT_FILTER_H */
@@ -522,8 +522,82 @@ static bool is_autoview(struct Body *b)
   return false;
 }
 
+/**
+ * autoview_decode - Decode an attachment for an autoview command
+ * @param a      Attachment to decode
+ * @param s      State containing the input stream and flags
+ * @param fp_out File to write the decoded attachment to
+ */
+static void autoview_decode(struct Body *a, struct State *s, FILE *fp_out)
+{
+  struct State st = { 0 };
+
+  st.fp_in = s->fp_in;
+  st.fp_out = fp_out;
+  st.flags = s->flags;
+
+  /* text subtypes may require character set conversion even with 8bit encoding */
+  if ((a->encoding == ENC_BASE64) || (a->encoding == ENC_QUOTED_PRINTABLE) ||
+      (a->encoding == ENC_UUENCODED) || mutt_is_text_part(a))
+  {
+    mutt_decode_attachment(a, &st);
+  }
+  else
+  {
+    fseeko(s->fp_in, a->offset, SEEK_SET);
+    mutt_file_copy_bytes(s->fp_in, fp_out, a->length);
+  }
+}
+
+/**
+ * autoview_feed - Decode an attachment into a pipe
+ * @param a   Attachment to decode
+ * @param s   State containing the input stream and flags
+ * @param fds Pipe to write to; the write end is closed before returning
+ * @retval num PID of the process writing to the pipe
+ * @retval -1  Error
+ *
+ * The attachment is decoded by a child process, so that the autoview command
+ * can read it while we read the command's output.
+ *
+ * The child shares the file offset of the input stream, so the caller must
+ * restore it once the child has finished.
+ */
+static pid_t autoview_feed(struct Body *a, struct State *s, int fds[2])
+{
+  mutt_sig_block_system();
+
+  pid_t pid = fork();
+  if (pid == 0)
+  {
+    mutt_sig_unblock_system(false);
+
+    /* don't keep the pipe alive if the command exits early */
+    close(fds[0]);
+
+    FILE *fp = fdopen(fds[1], "w");
+    if (fp)
+    {
+      autoview_decode(a, s, fp);
+      fclose(fp);
+    }
+    _exit(0);
+  }
+
+  close(fds[1]);
+  if (pid == -1)
+    mutt_sig_unblock_system(true);
+
+  return pid;
+}
+
 /**
  * autoview_handler - Handler for autoviewable attachments - Implements ::handler_t
+ *
+ * Unlike the other handlers, this is passed the encoded attachment.  If the
+ * mailcap command reads its input from a pipe, the attachment is decoded
+ * straight into the pipe.  Only commands that need a file (%s) cause the
+ * attachment to be written to disk.
  */
 static int autoview_handler(struct Body *a, struct State *s)
 {
@@ -537,6 +611,8 @@ static int autoview_handler(struct Body *a, struct State *s)
   FILE *fp_out = NULL;
   FILE *fp_err = NULL;
   pid_t pid;
+  pid_t pid_feed = -1;
+  LOFF_T in_pos = -1;
   int rc = 0;
 
   snprintf(type, sizeof(type), "%s/%s", TYPE(a), a->subtype);
@@ -564,29 +640,41 @@ static int autoview_handler(struct Body *a, struct State *s)
       mutt_message(_("Invoking autoview command: %s"), mutt_b2s(cmd));
     }
 
-    fp_in = mutt_file_fopen(mutt_b2s(tempfile), "w+");
-    if (!fp_in)
-    {
-      mutt_perror("fopen");
-      rfc1524_free_entry(&entry);
-      rc = -1;
-      goto cleanup;
-    }
-
-    mutt_file_copy_bytes(s->fp_in, fp_in, a->length);
-
     if (!piped)
     {
+      fp_in = mutt_file_fopen(mutt_b2s(tempfile), "w");
+      if (!fp_in)
+      {
+        mutt_perror("fopen");
+        rfc1524_free_entry(&entry);
+        rc = -1;
+        goto cleanup;
+      }
+
+      autoview_decode(a, s, fp_in);
       mutt_file_fclose(&fp_in);
       pid = mutt_create_filter(mutt_b2s(cmd), NULL, &fp_out, &fp_err);
     }
     else
     {
-      unlink(mutt_b2s(tempfile));
-      fflush(fp_in);
-      rewind(fp_in);
-      pid = mutt_create_filter_fd(mutt_b2s(cmd), NULL, &fp_out, &fp_err,
-                                  fileno(fp_in), -1, -1);
+      int fds[2];
+      if (pipe(fds) == -1)
+      {
+        mutt_perror("pipe");
+        rc = -1;
+        goto cleanup;
+      }
+
+      const int fd_in = fileno(s->fp_in);
+      if (fd_in >= 0)
+        in_pos = lseek(fd_in, 0, SEEK_CUR);
+
+      pid_feed = autoview_feed(a, s, fds);
+      if (pid_feed < 0)
+        pid = -1;
+      else
+        pid = mutt_create_filter_fd(mutt_b2s(cmd), NULL, &fp_out, &fp_err, fds[0], -1, -1);
+      close(fds[0]);
     }
 
     if (pid < 0)
@@ -647,10 +735,13 @@ static int autoview_handler(struct Body *a, struct State *s)
     mutt_file_fclose(&fp_out);
     mutt_file_fclose(&fp_err);
 
-    mutt_wait_filter(pid);
-    if (piped)
-      mutt_file_fclose(&fp_in);
-    else
+    if (pid >= 0)
+      mutt_wait_filter(pid);
+    if (pid_feed >= 0)
+      mutt_wait_filter(pid_feed);
+    if (in_pos >= 0)
+      lseek(fileno(s->fp_in), in_pos, SEEK_SET);
+    if (!piped)
       mutt_file_unlink(mutt_b2s(tempfile));
 
     if (s->flags & MUTT_DISPLAY)
@@ -1668,7 +1759,14 @@ int mutt_body_handler(struct Body *b, struct State *s)
       goto cleanup;
     }
 
-    rc = run_decode_and_handler(b, s, handler, plaintext);
+    /* autoview decodes the part itself, straight into the viewer */
+    if (handler == autoview_handler)
+    {
+      rc = autoview_handler(b, s);
+      s->flags |= MUTT_FIRSTDONE;
+    }
+    else
+      rc = run_decode_and_handler(b, s, handler, plaintext);
   }
   /* print hint to use attachment menu for disposition == attachment
    * if we're not already being called from there */
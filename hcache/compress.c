@@ -0,0 +1,414 @@
+/**
+ * @file
+ * Header cache compression
+ *
+ * @authors
+ * Copyright (C) 2019 NeoMutt developers <neomutt-devel@neomutt.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @page hc_compress Header cache compression
+ *
+ * Compress the entries of the header cache using Zstandard.
+ *
+ * Serialised headers are small and very similar to each other, so they
+ * compress poorly on their own.  The first entries stored in a new cache are
+ * used to train a dictionary, which is saved in the cache and shared by all
+ * the later entries.  Entries stored before the dictionary existed are
+ * compressed without it.
+ *
+ * A compressed entry looks like:
+ *
+ * | Item            | Description                              |
+ * | :-------------- | :--------------------------------------- |
+ * | union Validate  | Uncompressed                             |
+ * | unsigned int    | CRC, uncompressed                        |
+ * | uint32_t        | Length of the compressed frame           |
+ * | Zstandard frame | The rest of the serialised Email         |
+ */
+
+#include "config.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <zdict.h>
+#include <zstd.h>
+#include "mutt/mutt.h"
+#include "compress.h"
+#include "hcache.h"
+
+/* These Config Variables are only used in hcache/compress.c */
+short C_HeaderCacheCompressLevel; ///< Config: (hcache) Level of compression for method
+char *C_HeaderCacheCompressMethod; ///< Config: (hcache) Enable generic hcache database compression
+
+#define HC_COMPRESS_CRC 0x7a737464 ///< Mixed into the CRC of compressed caches ("zstd")
+
+#define HC_DICT_KEY "/.zstd-dictionary" ///< Key of the dictionary in the cache
+#define HC_DICT_SIZE (16 * 1024)        ///< Maximum size of the dictionary
+#define HC_DICT_SAMPLES 1000            ///< Train the dictionary after this many stores
+#define HC_DICT_MIN_SAMPLES 100         ///< Smallest number of samples worth training on
+#define HC_MAX_ENTRY (16 * 1024 * 1024) ///< Largest serialised Email that will be decompressed
+
+/* Size of the uncompressed part at the start of an entry */
+#define HC_HEADER_LEN (sizeof(union Validate) + sizeof(unsigned int))
+
+/**
+ * struct HcacheCompress - Compression state of a header cache
+ */
+struct HcacheCompress
+{
+  ZSTD_CCtx *cctx;        ///< Compression context
+  ZSTD_DCtx *dctx;        ///< Decompression context
+  ZSTD_CDict *cdict;      ///< Digested dictionary for compression
+  ZSTD_DDict *ddict;      ///< Digested dictionary for decompression
+  unsigned int dict_id;   ///< ID of the dictionary
+  bool trained;           ///< Training has been attempted
+
+  unsigned char *cbuf;    ///< Buffer for compressed entries
+  size_t cbuflen;         ///< Size of cbuf
+  unsigned char *dbuf;    ///< Buffer for decompressed entries
+  size_t dbuflen;         ///< Size of dbuf
+
+  char *samples;          ///< Concatenated samples for training
+  size_t samples_len;     ///< Length of the samples
+  size_t *sample_sizes;   ///< Size of each sample
+  unsigned int num_samples; ///< Number of samples
+};
+
+/**
+ * grow_buffer - Make sure a buffer is large enough
+ * @param buf    Buffer
+ * @param buflen Size of buffer
+ * @param need   Size required
+ */
+static void grow_buffer(unsigned char **buf, size_t *buflen, size_t need)
+{
+  if (need <= *buflen)
+    return;
+
+  mutt_mem_realloc(buf, need);
+  *buflen = need;
+}
+
+/**
+ * free_samples - Free the training samples
+ * @param hz Compression state
+ */
+static void free_samples(struct HcacheCompress *hz)
+{
+  FREE(&hz->samples);
+  FREE(&hz->sample_sizes);
+  hz->samples_len = 0;
+  hz->num_samples = 0;
+}
+
+/**
+ * load_dict - Use a dictionary
+ * @param hz   Compression state
+ * @param dict Dictionary
+ * @param len  Length of dictionary
+ * @retval true Success
+ */
+static bool load_dict(struct HcacheCompress *hz, const void *dict, size_t len)
+{
+  hz->cdict = ZSTD_createCDict(dict, len, C_HeaderCacheCompressLevel);
+  hz->ddict = ZSTD_createDDict(dict, len);
+  if (!hz->cdict || !hz->ddict)
+  {
+    ZSTD_freeCDict(hz->cdict);
+    ZSTD_freeDDict(hz->ddict);
+    hz->cdict = NULL;
+    hz->ddict = NULL;
+    return false;
+  }
+
+  hz->dict_id = ZSTD_getDictID_fromDict(dict, len);
+  return true;
+}
+
+/**
+ * fetch_dict - Read the dictionary from the header cache
+ * @param hc Header cache handle
+ * @retval true The dictionary was found
+ *
+ * The dictionary is stored as: CRC, length, data.
+ */
+static bool fetch_dict(header_cache_t *hc)
+{
+  struct HcacheCompress *hz = hc->compress;
+
+  size_t dlen = 0;
+  unsigned char *d = mutt_hcache_fetch_raw_len(hc, HC_DICT_KEY, sizeof(HC_DICT_KEY) - 1, &dlen);
+  if (!d)
+    return false;
+
+  bool rc = false;
+  unsigned int crc;
+  uint32_t len;
+  if (dlen >= sizeof(crc) + sizeof(len))
+  {
+    memcpy(&crc, d, sizeof(crc));
+    memcpy(&len, d + sizeof(crc), sizeof(len));
+    if ((crc == hc->crc) && (len > 0) && (len <= HC_DICT_SIZE) &&
+        (len <= dlen - sizeof(crc) - sizeof(len)))
+    {
+      rc = load_dict(hz, d + sizeof(crc) + sizeof(len), len);
+    }
+  }
+
+  mutt_hcache_free(hc, (void **) &d);
+  return rc;
+}
+
+/**
+ * train_dict - Create a dictionary from the samples and save it
+ * @param hc Header cache handle
+ */
+static void train_dict(header_cache_t *hc)
+{
+  struct HcacheCompress *hz = hc->compress;
+  hz->trained = true;
+
+  /* Another process may have beaten us to it */
+  if (fetch_dict(hc))
+  {
+    free_samples(hz);
+    return;
+  }
+
+  size_t blen = sizeof(unsigned int) + sizeof(uint32_t) + HC_DICT_SIZE;
+  unsigned char *blob = mutt_mem_malloc(blen);
+  unsigned char *dict = blob + sizeof(unsigned int) + sizeof(uint32_t);
+
+  size_t len = ZDICT_trainFromBuffer(dict, HC_DICT_SIZE, hz->samples,
+                                     hz->sample_sizes, hz->num_samples);
+  if (ZDICT_isError(len))
+  {
+    mutt_debug(LL_DEBUG1, "ZDICT_trainFromBuffer: %s\n", ZDICT_getErrorName(len));
+  }
+  else if (load_dict(hz, dict, len))
+  {
+    uint32_t len32 = len;
+    memcpy(blob, &hc->crc, sizeof(hc->crc));
+    memcpy(blob + sizeof(hc->crc), &len32, sizeof(len32));
+    mutt_hcache_store_raw(hc, HC_DICT_KEY, sizeof(HC_DICT_KEY) - 1, blob,
+                          sizeof(unsigned int) + sizeof(uint32_t) + len);
+    mutt_debug(LL_DEBUG2, "trained a %zu byte dictionary from %u samples\n",
+               len, hz->num_samples);
+  }
+
+  FREE(&blob);
+  free_samples(hz);
+}
+
+/**
+ * add_sample - Keep an entry for training the dictionary
+ * @param hc   Header cache handle
+ * @param data Serialised Email, without the header
+ * @param dlen Length of data
+ */
+static void add_sample(header_cache_t *hc, const void *data, size_t dlen)
+{
+  struct HcacheCompress *hz = hc->compress;
+
+  if (!hz->sample_sizes)
+    hz->sample_sizes = mutt_mem_calloc(HC_DICT_SAMPLES, sizeof(size_t));
+
+  mutt_mem_realloc(&hz->samples, hz->samples_len + dlen);
+  memcpy(hz->samples + hz->samples_len, data, dlen);
+  hz->samples_len += dlen;
+  hz->sample_sizes[hz->num_samples++] = dlen;
+
+  if (hz->num_samples == HC_DICT_SAMPLES)
+    train_dict(hc);
+}
+
+/**
+ * hcache_compress_is_valid_method - Is the string a valid compression method
+ * @param method Name of the method, e.g. "zstd"
+ * @retval true  Method is supported
+ */
+bool hcache_compress_is_valid_method(const char *method)
+{
+  return (mutt_str_strcmp(method, "zstd") == 0);
+}
+
+/**
+ * hcache_compress_open - Set up compression for a header cache
+ * @param hc Header cache handle
+ *
+ * If $header_cache_compress_method is set, the CRC of the cache is changed, so
+ * that compressed and uncompressed entries are never confused.
+ */
+void hcache_compress_open(header_cache_t *hc)
+{
+  if (!hc || !hcache_compress_is_valid_method(C_HeaderCacheCompressMethod))
+    return;
+
+  struct HcacheCompress *hz = mutt_mem_calloc(1, sizeof(struct HcacheCompress));
+  hz->cctx = ZSTD_createCCtx();
+  hz->dctx = ZSTD_createDCtx();
+  if (!hz->cctx || !hz->dctx)
+  {
+    ZSTD_freeCCtx(hz->cctx);
+    ZSTD_freeDCtx(hz->dctx);
+    FREE(&hz);
+    return;
+  }
+
+  hc->crc ^= HC_COMPRESS_CRC;
+  hc->compress = hz;
+  hz->trained = fetch_dict(hc);
+}
+
+/**
+ * hcache_compress_close - Free the compression state of a header cache
+ * @param hc Header cache handle
+ *
+ * If enough entries have been stored, a dictionary is trained first.
+ */
+void hcache_compress_close(header_cache_t *hc)
+{
+  if (!hc || !hc->compress)
+    return;
+
+  struct HcacheCompress *hz = hc->compress;
+
+  if (!hz->trained && (hz->num_samples >= HC_DICT_MIN_SAMPLES))
+    train_dict(hc);
+
+  free_samples(hz);
+  ZSTD_freeCDict(hz->cdict);
+  ZSTD_freeDDict(hz->ddict);
+  ZSTD_freeCCtx(hz->cctx);
+  ZSTD_freeDCtx(hz->dctx);
+  FREE(&hz->cbuf);
+  FREE(&hz->dbuf);
+  FREE(&hc->compress);
+}
+
+/**
+ * hcache_compress_store - Compress a serialised Email
+ * @param[in]  hc   Header cache handle
+ * @param[in]  data Serialised Email, see mutt_hcache_dump()
+ * @param[in]  dlen Length of data
+ * @param[out] clen Length of compressed entry
+ * @retval ptr  Compressed entry
+ * @retval NULL Error
+ *
+ * @note The returned data is owned by the header cache.
+ *       It is only valid until the next call.
+ */
+void *hcache_compress_store(header_cache_t *hc, const void *data, size_t dlen, size_t *clen)
+{
+  struct HcacheCompress *hz = hc->compress;
+  if (!hz || (dlen < HC_HEADER_LEN))
+    return NULL;
+
+  const char *payload = (const char *) data + HC_HEADER_LEN;
+  size_t plen = dlen - HC_HEADER_LEN;
+
+  if (!hz->trained)
+    add_sample(hc, payload, plen);
+
+  size_t bound = ZSTD_compressBound(plen);
+  grow_buffer(&hz->cbuf, &hz->cbuflen, HC_HEADER_LEN + sizeof(uint32_t) + bound);
+  unsigned char *frame = hz->cbuf + HC_HEADER_LEN + sizeof(uint32_t);
+
+  size_t rc;
+  if (hz->cdict)
+    rc = ZSTD_compress_usingCDict(hz->cctx, frame, bound, payload, plen, hz->cdict);
+  else
+    rc = ZSTD_compressCCtx(hz->cctx, frame, bound, payload, plen, C_HeaderCacheCompressLevel);
+
+  if (ZSTD_isError(rc))
+  {
+    mutt_debug(LL_DEBUG1, "ZSTD_compress: %s\n", ZSTD_getErrorName(rc));
+    return NULL;
+  }
+
+  uint32_t framelen = rc;
+  memcpy(hz->cbuf, data, HC_HEADER_LEN);
+  memcpy(hz->cbuf + HC_HEADER_LEN, &framelen, sizeof(framelen));
+
+  *clen = HC_HEADER_LEN + sizeof(uint32_t) + framelen;
+  return hz->cbuf;
+}
+
+/**
+ * hcache_compress_fetch - Decompress an entry from the header cache
+ * @param hc   Header cache handle
+ * @param data Compressed entry, see hcache_compress_store()
+ * @param dlen Length of the compressed entry
+ * @retval ptr  Serialised Email
+ * @retval NULL Error, e.g. the entry used a different dictionary or is corrupt
+ *
+ * @note The returned data is owned by the header cache.
+ *       It is only valid until the next call.
+ */
+void *hcache_compress_fetch(header_cache_t *hc, const void *data, size_t dlen)
+{
+  struct HcacheCompress *hz = hc->compress;
+  if (!hz || (dlen < HC_HEADER_LEN + sizeof(uint32_t)))
+    return NULL;
+
+  uint32_t framelen;
+  memcpy(&framelen, (const char *) data + HC_HEADER_LEN, sizeof(framelen));
+  const char *frame = (const char *) data + HC_HEADER_LEN + sizeof(uint32_t);
+
+  if (framelen > (dlen - HC_HEADER_LEN - sizeof(uint32_t)))
+  {
+    mutt_debug(LL_DEBUG1, "corrupt entry: frame of %u bytes in %zu\n", framelen, dlen);
+    return NULL;
+  }
+
+  unsigned long long plen = ZSTD_getFrameContentSize(frame, framelen);
+  if ((plen == ZSTD_CONTENTSIZE_UNKNOWN) || (plen == ZSTD_CONTENTSIZE_ERROR) ||
+      (plen > HC_MAX_ENTRY))
+  {
+    return NULL;
+  }
+
+  grow_buffer(&hz->dbuf, &hz->dbuflen, HC_HEADER_LEN + plen);
+
+  size_t rc;
+  unsigned int dict_id = ZSTD_getDictID_fromFrame(frame, framelen);
+  if (dict_id == 0)
+    rc = ZSTD_decompressDCtx(hz->dctx, hz->dbuf + HC_HEADER_LEN, plen, frame, framelen);
+  else if (hz->ddict && (dict_id == hz->dict_id))
+    rc = ZSTD_decompress_usingDDict(hz->dctx, hz->dbuf + HC_HEADER_LEN, plen,
+                                    frame, framelen, hz->ddict);
+  else
+    return NULL;
+
+  if (ZSTD_isError(rc) || (rc != plen))
+    return NULL;
+
+  memcpy(hz->dbuf, data, HC_HEADER_LEN);
+  return hz->dbuf;
+}
+
+/**
+ * hcache_compress_owns - Was this data returned by hcache_compress_fetch()?
+ * @param hc   Header cache handle
+ * @param data Data returned by mutt_hcache_fetch()
+ * @retval true The data belongs to the compression layer
+ */
+bool hcache_compress_owns(header_cache_t *hc, const void *data)
+{
+  return hc && hc->compress && data && (data == hc->compress->dbuf);
+}
@@ -0,0 +1,39 @@
+/**
+ * @file
+ * Header cache compression
+ *
+ * @authors
+ * Copyright (C) 2019 NeoMutt developers <neomutt-devel@neomutt.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MUTT_HCACHE_COMPRESS_H
+#define MUTT_HCACHE_COMPRESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "hcache.h"
+
+struct HcacheCompress;
+
+void  hcache_compress_close(header_cache_t *hc);
+void *hcache_compress_fetch(header_cache_t *hc, const void *data, size_t dlen);
+bool  hcache_compress_is_valid_method(const char *method);
+void  hcache_compress_open(header_cache_t *hc);
+bool  hcache_compress_owns(header_cache_t *hc, const void *data);
+void *hcache_compress_store(header_cache_t *hc, const void *data, size_t dlen, size_t *clen);
+
+#endif /* MUTT_HCACHE_COMPRESS_H */
@@ -29,6 +29,21 @@
  * This module implements the gateway between the user visible part of the
  * header cache API and the backend specific API. Also, this module implements
  * the serialization/deserialization routines for the Header structure.
+ *
+ * Open header caches are shared, keyed by the path of the database file and
+ * the folder.  Opening the same cache again, while it's still in use, returns
+ * the same handle, without reopening the database.  Caches of different
+ * folders that live in the same file share the backend's database handle, so
+ * the file is never opened twice.  The database is closed when its last user
+ * closes it.
+ *
+ * A cache keeps the backend and compression it was opened with until it is
+ * closed, even if the config changes in the meantime.
+ *
+ * Maildir, MH, notmuch and IMAP Mailboxes hold a reference to their cache
+ * from mbox_open() until mbox_close(), so the database stays open for the
+ * Mailbox's lifetime.  Their users take extra references with
+ * mutt_hcache_ref().
  */
 
 #include "config.h"
@@ -36,7 +51,8 @@
 #include "serialize.h"
 
 #if !(defined(HAVE_BDB) || defined(HAVE_GDBM) || defined(HAVE_KC) ||           \
-      defined(HAVE_LMDB) || defined(HAVE_QDBM) || defined(HAVE_TC))
+      defined(HAVE_LMDB) || defined(HAVE_MMAPDB) || defined(HAVE_QDBM) ||      \
+      defined(HAVE_TC))
 #error "No hcache backend defined"
 #endif
 
@@ -53,17 +69,35 @@
 #include "backend.h"
 #include "hcache.h"
 #include "hcache/hcversion.h"
+#ifdef HAVE_ZSTD
+#include "compress.h"
+#endif
 
 /* These Config Variables are only used in hcache/hcache.c */
 char *C_HeaderCacheBackend; ///< Config: (hcache) Header cache backend to use
 
 static unsigned int hcachever = 0x0;
 
+/**
+ * struct HcacheHandle - A shared header cache handle
+ */
+struct HcacheHandle
+{
+  char *dbpath;                       ///< Path of the database file
+  header_cache_t *hc;                 ///< Open header cache
+  int refcount;                       ///< Number of users of the handle
+  STAILQ_ENTRY(HcacheHandle) entries; ///< Linked list
+};
+STAILQ_HEAD(HcacheHandleList, HcacheHandle);
+
+static struct HcacheHandleList HcacheHandles = STAILQ_HEAD_INITIALIZER(HcacheHandles);
+
 #define HCACHE_BACKEND(name) extern const struct HcacheOps hcache_##name##_ops;
 HCACHE_BACKEND(bdb)
 HCACHE_BACKEND(gdbm)
 HCACHE_BACKEND(kyotocabinet)
 HCACHE_BACKEND(lmdb)
+HCACHE_BACKEND(mmapdb)
 HCACHE_BACKEND(qdbm)
 HCACHE_BACKEND(tokyocabinet)
 #undef HCACHE_BACKEND
@@ -94,6 +128,9 @@ const struct HcacheOps *hcache_ops[] = {
 #endif
 #ifdef HAVE_LMDB
   &hcache_lmdb_ops,
+#endif
+#ifdef HAVE_MMAPDB
+  &hcache_mmapdb_ops,
 #endif
   NULL,
 };
@@ -166,6 +203,7 @@ static bool create_hcache_dir(const char *path)
  * @param path   Base directory, from $header_cache
  * @param folder Mailbox name (including protocol)
  * @param namer  Callback to generate database filename - Implements ::hcache_namer_t
+ * @param create Create any parent directories needed
  * @retval ptr Full pathname to the database (to be generated)
  *             (path must be freed by the caller)
  *
@@ -177,15 +215,16 @@ static bool create_hcache_dir(const char *path)
  * * NAME:   Create by @a namer, or md5sum of @a folder
  * * SUFFIX: Character set (if ICONV isn't being used)
  *
- * This function will create any parent directories needed, so the caller just
- * needs to create the database file.
+ * If @a create is set, this function will create any parent directories needed,
+ * so the caller just needs to create the database file.
  *
  * If @a path exists and is a directory, it is used.
  * If @a path has a trailing '/' it is assumed to be a directory.
  * If ICONV isn't being used, then a suffix is added to the path, e.g. '-utf-8'.
  * Otherwise @a path is assumed to be a file.
  */
-static const char *hcache_per_folder(const char *path, const char *folder, hcache_namer_t namer)
+static const char *hcache_per_folder(const char *path, const char *folder,
+                                     hcache_namer_t namer, bool create)
 {
   static char hcpath[PATH_MAX + 64];
   char suffix[32] = { 0 };
@@ -229,7 +268,8 @@ static const char *hcache_per_folder(const char *path, const char *folder, hcach
   if (rc < 0) /* namer or fprintf failed.. should not happen */
     return path;
 
-  create_hcache_dir(hcpath);
+  if (create)
+    create_hcache_dir(hcpath);
   return hcpath;
 }
 
@@ -250,16 +290,35 @@ static char *get_foldername(const char *folder)
 }
 
 /**
- * mutt_hcache_open - Multiplexor for HcacheOps::open
+ * handle_find - Find a shared header cache handle
+ * @param dbpath Path of the database file
+ * @param folder Name of the folder, as returned by get_foldername()
+ * @retval ptr  Matching handle
+ * @retval NULL None open
+ *
+ * If @a folder is NULL, a handle of any folder in the file will match.
  */
-header_cache_t *mutt_hcache_open(const char *path, const char *folder, hcache_namer_t namer)
+static struct HcacheHandle *handle_find(const char *dbpath, const char *folder)
 {
-  const struct HcacheOps *ops = hcache_get_ops();
-  if (!ops)
-    return NULL;
+  struct HcacheHandle *hh = NULL;
+  STAILQ_FOREACH(hh, &HcacheHandles, entries)
+  {
+    if ((mutt_str_strcmp(hh->dbpath, dbpath) == 0) &&
+        (!folder || (mutt_str_strcmp(hh->hc->folder, folder) == 0)))
+    {
+      return hh;
+    }
+  }
 
-  header_cache_t *hc = mutt_mem_calloc(1, sizeof(header_cache_t));
+  return NULL;
+}
 
+/**
+ * hcache_version - Get the header cache version
+ * @retval num Version, mixing the structure layout with the user's config
+ */
+static unsigned int hcache_version(void)
+{
   /* Calculate the current hcache version from dynamic configuration */
   if (hcachever == 0x0)
   {
@@ -296,35 +355,116 @@ header_cache_t *mutt_hcache_open(const char *path, const char *folder, hcache_na
     hcachever = digest.intval;
   }
 
-  hc->folder = get_foldername(folder);
-  hc->crc = hcachever;
+  return hcachever;
+}
+
+/**
+ * hcache_open - Open a header cache
+ * @param dbpath Path of the database file
+ * @param folder Name of the folder, as returned by get_foldername()
+ * @param ops    Backend
+ * @retval ptr  Success, header_cache_t struct
+ * @retval NULL Otherwise
+ *
+ * If another folder's cache in the same file is open, its database is shared.
+ * On success, the header cache takes ownership of @a folder.
+ */
+static header_cache_t *hcache_open(const char *dbpath, char *folder,
+                                   const struct HcacheOps *ops)
+{
+  header_cache_t *hc = mutt_mem_calloc(1, sizeof(header_cache_t));
+  hc->folder = folder;
+  hc->crc = hcache_version();
 
-  if (!path || (path[0] == '\0'))
+  struct HcacheHandle *shared = handle_find(dbpath, NULL);
+  if (shared)
   {
-    FREE(&hc->folder);
-    FREE(&hc);
-    return NULL;
+    hc->ops = shared->hc->ops;
+    hc->ctx = shared->hc->ctx;
   }
-
-  path = hcache_per_folder(path, hc->folder, namer);
-
-  hc->ctx = ops->open(path);
-  if (hc->ctx)
-    return hc;
   else
   {
-    /* remove a possibly incompatible version */
-    if (unlink(path) == 0)
+    hc->ops = ops;
+    hc->ctx = ops->open(dbpath);
+    if (!hc->ctx)
     {
-      hc->ctx = ops->open(path);
-      if (hc->ctx)
-        return hc;
+      /* remove a possibly incompatible version */
+      if (unlink(dbpath) == 0)
+        hc->ctx = ops->open(dbpath);
     }
-    FREE(&hc->folder);
-    FREE(&hc);
+  }
+
+  if (hc->ctx)
+  {
+#ifdef HAVE_ZSTD
+    hcache_compress_open(hc);
+#endif
+    return hc;
+  }
+
+  FREE(&hc);
+  return NULL;
+}
+
+/**
+ * mutt_hcache_open - Multiplexor for HcacheOps::open
+ */
+header_cache_t *mutt_hcache_open(const char *path, const char *folder, hcache_namer_t namer)
+{
+  const struct HcacheOps *ops = hcache_get_ops();
+  if (!ops || !path || (path[0] == '\0'))
+    return NULL;
+
+  char *foldername = get_foldername(folder);
+  const char *dbpath = hcache_per_folder(path, foldername, namer, false);
+
+  struct HcacheHandle *hh = handle_find(dbpath, foldername);
+  if (hh)
+  {
+    FREE(&foldername);
+    hh->refcount++;
+    return hh->hc;
+  }
+
+  /* A new database file may need its directories */
+  if (!handle_find(dbpath, NULL))
+    dbpath = hcache_per_folder(path, foldername, namer, true);
+
+  hh = mutt_mem_calloc(1, sizeof(struct HcacheHandle));
+  hh->dbpath = mutt_str_strdup(dbpath);
+  hh->hc = hcache_open(hh->dbpath, foldername, ops);
+  if (!hh->hc)
+  {
+    FREE(&foldername);
+    FREE(&hh->dbpath);
+    FREE(&hh);
+    return NULL;
+  }
 
+  hh->refcount = 1;
+  STAILQ_INSERT_HEAD(&HcacheHandles, hh, entries);
+  return hh->hc;
+}
+
+/**
+ * mutt_hcache_ref - Take another reference to an open header cache
+ */
+header_cache_t *mutt_hcache_ref(header_cache_t *hc)
+{
+  if (!hc)
     return NULL;
+
+  struct HcacheHandle *hh = NULL;
+  STAILQ_FOREACH(hh, &HcacheHandles, entries)
+  {
+    if (hh->hc == hc)
+    {
+      hh->refcount++;
+      return hc;
+    }
   }
+
+  return NULL;
 }
 
 /**
@@ -332,32 +472,118 @@ header_cache_t *mutt_hcache_open(const char *path, const char *folder, hcache_na
  */
 void mutt_hcache_close(header_cache_t *hc)
 {
-  const struct HcacheOps *ops = hcache_get_ops();
-  if (!hc || !ops)
+  if (!hc)
     return;
 
-  ops->close(&hc->ctx);
+  struct HcacheHandle *hh = NULL;
+  STAILQ_FOREACH(hh, &HcacheHandles, entries)
+  {
+    if (hh->hc == hc)
+      break;
+  }
+
+  if (hh)
+  {
+    if (--hh->refcount > 0)
+      return;
+
+    STAILQ_REMOVE(&HcacheHandles, hh, HcacheHandle, entries);
+    FREE(&hh->dbpath);
+    FREE(&hh);
+  }
+
+#ifdef HAVE_ZSTD
+  hcache_compress_close(hc);
+#endif
+
+  /* Another folder's cache may still be using the database */
+  bool shared = false;
+  STAILQ_FOREACH(hh, &HcacheHandles, entries)
+  {
+    if (hh->hc->ctx == hc->ctx)
+    {
+      shared = true;
+      break;
+    }
+  }
+  if (!shared)
+    hc->ops->close(&hc->ctx);
+
   FREE(&hc->folder);
   FREE(&hc);
 }
 
+/**
+ * mutt_hcache_prefetch - Start reading a header cache from disk
+ */
+void mutt_hcache_prefetch(const char *path, const char *folder, hcache_namer_t namer)
+{
+  const struct HcacheOps *ops = hcache_get_ops();
+  if (!ops || !path || (path[0] == '\0'))
+    return;
+
+  char *foldername = get_foldername(folder);
+  const char *dbpath = hcache_per_folder(path, foldername, namer, false);
+  FREE(&foldername);
+
+  /* An open cache is already in memory */
+  if (handle_find(dbpath, NULL))
+    return;
+
+  mutt_debug(LL_DEBUG2, "prefetching %s\n", dbpath);
+  mutt_file_willneed(dbpath);
+}
+
+/**
+ * mutt_hcache_fetch_raw_len - Fetch a message's header from the cache, with its length
+ * @param[in]  hc     Header cache handle
+ * @param[in]  key    Message identification string
+ * @param[in]  keylen Length of the string pointed to by key
+ * @param[out] dlen   Length of the data
+ * @retval ptr  Success, the data if found
+ * @retval NULL Otherwise
+ *
+ * @note Like mutt_hcache_fetch_raw(), this performs no checks on the data.
+ */
+void *mutt_hcache_fetch_raw_len(header_cache_t *hc, const char *key, size_t keylen, size_t *dlen)
+{
+  char path[PATH_MAX];
+
+  if (!hc)
+    return NULL;
+
+  keylen = snprintf(path, sizeof(path), "%s%.*s", hc->folder, (int) keylen, key);
+
+  return hc->ops->fetch(hc->ctx, path, keylen, dlen);
+}
+
 /**
  * mutt_hcache_fetch - Multiplexor for HcacheOps::fetch
  */
 void *mutt_hcache_fetch(header_cache_t *hc, const char *key, size_t keylen)
 {
-  void *data = mutt_hcache_fetch_raw(hc, key, keylen);
+  size_t dlen = 0;
+  void *data = mutt_hcache_fetch_raw_len(hc, key, keylen, &dlen);
   if (!data)
   {
     return NULL;
   }
 
-  if (!crc_matches(data, hc->crc))
+  if ((dlen < sizeof(union Validate) + sizeof(unsigned int)) || !crc_matches(data, hc->crc))
   {
     mutt_hcache_free(hc, &data);
     return NULL;
   }
 
+#ifdef HAVE_ZSTD
+  if (hc->compress)
+  {
+    void *blob = hcache_compress_fetch(hc, data, dlen);
+    mutt_hcache_free(hc, &data);
+    return blob;
+  }
+#endif
+
   return data;
 }
 
@@ -376,15 +602,8 @@ void *mutt_hcache_fetch(header_cache_t *hc, const char *key, size_t keylen)
  */
 void *mutt_hcache_fetch_raw(header_cache_t *hc, const char *key, size_t keylen)
 {
-  char path[PATH_MAX];
-  const struct HcacheOps *ops = hcache_get_ops();
-
-  if (!hc || !ops)
-    return NULL;
-
-  keylen = snprintf(path, sizeof(path), "%s%s", hc->folder, key);
-
-  return ops->fetch(hc->ctx, path, keylen);
+  size_t dlen = 0;
+  return mutt_hcache_fetch_raw_len(hc, key, keylen, &dlen);
 }
 
 /**
@@ -392,12 +611,18 @@ void *mutt_hcache_fetch_raw(header_cache_t *hc, const char *key, size_t keylen)
  */
 void mutt_hcache_free(header_cache_t *hc, void **data)
 {
-  const struct HcacheOps *ops = hcache_get_ops();
+  if (!hc)
+    return;
 
-  if (!hc || !ops)
+#ifdef HAVE_ZSTD
+  if (data && hcache_compress_owns(hc, *data))
+  {
+    *data = NULL;
     return;
+  }
+#endif
 
-  ops->free(hc->ctx, data);
+  hc->ops->free(hc->ctx, data);
 }
 
 /**
@@ -412,7 +637,20 @@ int mutt_hcache_store(header_cache_t *hc, const char *key, size_t keylen,
   int dlen = 0;
 
   char *data = mutt_hcache_dump(hc, e, &dlen, uidvalidity);
-  int rc = mutt_hcache_store_raw(hc, key, keylen, data, dlen);
+  int rc;
+
+#ifdef HAVE_ZSTD
+  if (hc->compress)
+  {
+    size_t clen = 0;
+    void *cdata = hcache_compress_store(hc, data, dlen, &clen);
+    rc = cdata ? mutt_hcache_store_raw(hc, key, keylen, cdata, clen) : -1;
+    FREE(&data);
+    return rc;
+  }
+#endif
+
+  rc = mutt_hcache_store_raw(hc, key, keylen, data, dlen);
 
   FREE(&data);
 
@@ -433,14 +671,13 @@ int mutt_hcache_store_raw(header_cache_t *hc, const char *key, size_t keylen,
                           void *data, size_t dlen)
 {
   char path[PATH_MAX];
-  const struct HcacheOps *ops = hcache_get_ops();
 
-  if (!hc || !ops)
+  if (!hc)
     return -1;
 
-  keylen = snprintf(path, sizeof(path), "%s%s", hc->folder, key);
+  keylen = snprintf(path, sizeof(path), "%s%.*s", hc->folder, (int) keylen, key);
 
-  return ops->store(hc->ctx, path, keylen, data, dlen);
+  return hc->ops->store(hc->ctx, path, keylen, data, dlen);
 }
 
 /**
@@ -449,14 +686,13 @@ int mutt_hcache_store_raw(header_cache_t *hc, const char *key, size_t keylen,
 int mutt_hcache_delete(header_cache_t *hc, const char *key, size_t keylen)
 {
   char path[PATH_MAX];
-  const struct HcacheOps *ops = hcache_get_ops();
 
   if (!hc)
     return -1;
 
-  keylen = snprintf(path, sizeof(path), "%s%s", hc->folder, key);
+  keylen = snprintf(path, sizeof(path), "%s%.*s", hc->folder, (int) keylen, key);
 
-  return ops->delete (hc->ctx, path, keylen);
+  return hc->ops->delete (hc->ctx, path, keylen);
 }
 
 /**
@@ -35,16 +35,19 @@
  *
  * @subpage hc_hcache
  *
+ * @subpage hc_compress
+ *
  * Backends:
  *
- * | File          | Description      |
- * | :------------ | :--------------- |
- * | hcache/bdb.c  | @subpage hc_bdb  |
- * | hcache/gdbm.c | @subpage hc_gdbm |
- * | hcache/kc.c   | @subpage hc_kc   |
- * | hcache/lmdb.c | @subpage hc_lmdb |
- * | hcache/qdbm.c | @subpage hc_qdbm |
- * | hcache/tc.c   | @subpage hc_tc   |
+ * | File            | Description        |
+ * | :-------------- | :----------------- |
+ * | hcache/bdb.c    | @subpage hc_bdb    |
+ * | hcache/gdbm.c   | @subpage hc_gdbm   |
+ * | hcache/kc.c     | @subpage hc_kc     |
+ * | hcache/lmdb.c   | @subpage hc_lmdb   |
+ * | hcache/mmapdb.c | @subpage hc_mmapdb |
+ * | hcache/qdbm.c   | @subpage hc_qdbm   |
+ * | hcache/tc.c     | @subpage hc_tc     |
  */
 
 #ifndef MUTT_HCACHE_HCACHE_H
@@ -55,6 +58,8 @@
 #include <sys/time.h>
 
 struct Email;
+struct HcacheCompress;
+struct HcacheOps;
 
 /**
  * struct EmailCache - header cache structure
@@ -69,6 +74,8 @@ struct EmailCache
   char *folder;
   unsigned int crc;
   void *ctx;
+  const struct HcacheOps *ops;     ///< Backend that opened the cache
+  struct HcacheCompress *compress; ///< Compression state, see hcache/compress.c
 };
 
 typedef struct EmailCache header_cache_t;
@@ -93,6 +100,10 @@ union Validate {
 /* These Config Variables are only used in hcache/hcache.c */
 extern char *C_HeaderCacheBackend;
 
+/* These Config Variables are only used in hcache/compress.c */
+extern short C_HeaderCacheCompressLevel;
+extern char *C_HeaderCacheCompressMethod;
+
 /**
  * mutt_hcache_open - open the connection to the header cache
  * @param path   Location of the header cache (often as specified by the user)
@@ -110,6 +121,28 @@ header_cache_t *mutt_hcache_open(const char *path, const char *folder, hcache_na
  */
 void mutt_hcache_close(header_cache_t *hc);
 
+/**
+ * mutt_hcache_ref - Take another reference to an open header cache
+ * @param hc Header cache, got by mutt_hcache_open
+ * @retval ptr The same header cache, to be closed with mutt_hcache_close
+ *
+ * This is cheaper than opening the cache again: the path of the database
+ * isn't looked up.  Mailboxes hold their cache while they're open, so their
+ * users can share it this way.
+ */
+header_cache_t *mutt_hcache_ref(header_cache_t *hc);
+
+/**
+ * mutt_hcache_prefetch - Ask for a header cache to be read in the background
+ * @param path   Location of the header cache
+ * @param folder Name of the folder containing the messages
+ * @param namer  Optional function to form the name of the database file
+ *
+ * The database isn't opened, so this is cheap enough to call for a mailbox
+ * that might be opened soon.
+ */
+void mutt_hcache_prefetch(const char *path, const char *folder, hcache_namer_t namer);
+
 /**
  * mutt_hcache_fetch - fetch and validate a  message's header from the cache
  * @param hc     Pointer to the header_cache_t structure got by mutt_hcache_open
@@ -127,6 +160,7 @@ void mutt_hcache_close(header_cache_t *hc);
 void *mutt_hcache_fetch(header_cache_t *hc, const char *key, size_t keylen);
 
 void *mutt_hcache_fetch_raw(header_cache_t *hc, const char *key, size_t keylen);
+void *mutt_hcache_fetch_raw_len(header_cache_t *hc, const char *key, size_t keylen, size_t *dlen);
 
 /**
  * mutt_hcache_free - free previously fetched data
@@ -0,0 +1,808 @@
+/**
+ * @file
+ * Memory-mapped backend for the header cache
+ *
+ * @authors
+ * Copyright (C) 2019 NeoMutt developers <neomutt-devel@neomutt.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @page hc_mmapdb Memory-mapped store
+ *
+ * Use a built-in, append-only, memory-mapped file as a header cache backend.
+ *
+ * The file is a log of records, followed by an open-addressed index of the
+ * keys.  The whole file is mmap(2)'d, so a fetch returns a pointer into the
+ * map, without copying the data.  This suits read-mostly mailboxes, e.g.
+ * archives, very well.
+ *
+ * File layout:
+ *
+ * | Item                 | Description                                  |
+ * | :------------------- | :------------------------------------------- |
+ * | struct MmapDbHeader  | Magic, version, sizes                        |
+ * | struct MmapDbRecord  | Lengths, followed by the key and the data    |
+ * | ...                  | More records                                 |
+ * | struct MmapDbSlot [] | Index of the keys (only valid if idx_offset) |
+ *
+ * Updates and deletes are appended to the log.  The first write invalidates
+ * the saved index; it is rewritten when the cache is closed.  If the file
+ * contains too many stale records, it's compacted on close.
+ *
+ * If the saved index is missing (e.g. NeoMutt crashed), it is rebuilt by
+ * scanning the log.
+ *
+ * Only one process can write to the file at once.  Other processes can read
+ * from it while nobody is writing, otherwise they won't use the cache.
+ */
+
+#include "config.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "mutt/mutt.h"
+#include "backend.h"
+
+#define MMAPDB_MAGIC "NMHCMMAP"
+#define MMAPDB_VERSION 1
+#define MMAPDB_VERSION_STRING "1"
+
+#define MMAPDB_SLOT_EMPTY 0   ///< Slot has never been used
+#define MMAPDB_SLOT_DELETED 1 ///< Slot's key has been deleted
+
+#define MMAPDB_TOMBSTONE UINT32_MAX ///< Record marks a deleted key
+
+#define MMAPDB_MIN_SLOTS 1024       ///< Smallest index
+#define MMAPDB_MAP_CHUNK (1 << 20)  ///< Grow the map in steps of 1MiB
+#define MMAPDB_COMPACT_MIN (1 << 20) ///< Don't compact less than 1MiB of stale records
+
+#define MMAPDB_ALIGN(x) (((x) + 7) & ~((size_t) 7))
+
+/**
+ * struct MmapDbHeader - Header of the database file
+ */
+struct MmapDbHeader
+{
+  char magic[8];       ///< MMAPDB_MAGIC
+  uint32_t version;    ///< MMAPDB_VERSION
+  uint32_t reserved;
+  uint64_t data_end;   ///< Offset of the end of the records
+  uint64_t idx_offset; ///< Offset of the saved index, 0 if it's out of date
+  uint64_t idx_slots;  ///< Number of slots in the index
+  uint64_t idx_used;   ///< Number of slots in use (live or deleted)
+  uint64_t dead_bytes; ///< Size of records which have been replaced or deleted
+  uint64_t reserved2;
+};
+
+/**
+ * struct MmapDbRecord - A key/data pair in the database file
+ *
+ * The record is followed by the key and then the data, each padded to a
+ * multiple of 8 bytes.
+ */
+struct MmapDbRecord
+{
+  uint32_t keylen;  ///< Length of the key
+  uint32_t datalen; ///< Length of the data, or MMAPDB_TOMBSTONE
+};
+
+/**
+ * struct MmapDbSlot - An entry in the index
+ */
+struct MmapDbSlot
+{
+  uint64_t hash;   ///< Hash of the key
+  uint64_t offset; ///< Offset of the record, or MMAPDB_SLOT_EMPTY/DELETED
+};
+
+/**
+ * struct MmapDbMap - A region of memory mapped from the database file
+ */
+struct MmapDbMap
+{
+  char *addr; ///< Start of the mapping
+  size_t len; ///< Length of the mapping
+};
+
+/**
+ * struct HcacheMmapDbCtx - Memory-mapped store context
+ */
+struct HcacheMmapDbCtx
+{
+  char *path;                 ///< Path to the database file
+  int fd;                     ///< File descriptor of the database
+  bool readonly;              ///< Another process is writing to the database
+  bool dirty;                 ///< The database has been changed
+  struct MmapDbHeader hdr;    ///< Copy of the file's header
+  struct MmapDbMap map;       ///< Current mapping of the file
+  struct MmapDbMap *old_maps; ///< Retired mappings, still referenced by callers
+  size_t num_old_maps;        ///< Number of retired mappings
+  struct MmapDbSlot *slots;   ///< Index of the keys
+  bool own_slots;             ///< The index has been allocated (not mapped)
+};
+
+/**
+ * mmapdb_hash - Hash a key
+ * @param key    Key
+ * @param keylen Length of key
+ * @retval num Hash (never zero)
+ *
+ * This is the 64-bit FNV-1a hash.
+ */
+static uint64_t mmapdb_hash(const char *key, size_t keylen)
+{
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < keylen; i++)
+  {
+    h ^= (unsigned char) key[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h ? h : 1;
+}
+
+/**
+ * mmapdb_record_len - Get the total size of a record
+ * @param keylen  Length of the key
+ * @param datalen Length of the data, or MMAPDB_TOMBSTONE
+ * @retval num Size of record, including padding
+ */
+static size_t mmapdb_record_len(uint32_t keylen, uint32_t datalen)
+{
+  size_t len = sizeof(struct MmapDbRecord) + MMAPDB_ALIGN(keylen);
+  if (datalen != MMAPDB_TOMBSTONE)
+    len += MMAPDB_ALIGN(datalen);
+  return len;
+}
+
+/**
+ * mmapdb_map - Make sure the mapping covers part of the file
+ * @param ctx  Context
+ * @param need Offset that must be mapped
+ * @retval true  Success
+ * @retval false Error
+ *
+ * A new mapping is created if necessary.  The old mapping is kept until the
+ * database is closed, because the callers may still hold pointers into it.
+ */
+static bool mmapdb_map(struct HcacheMmapDbCtx *ctx, size_t need)
+{
+  if (ctx->map.addr && (need <= ctx->map.len))
+    return true;
+
+  /* Leave room to grow, so we don't remap after every store */
+  size_t len = need;
+  if (!ctx->readonly)
+    len = ((need + need / 2) / MMAPDB_MAP_CHUNK + 1) * MMAPDB_MAP_CHUNK;
+
+  void *addr = mmap(NULL, len, PROT_READ, MAP_SHARED, ctx->fd, 0);
+  if (addr == MAP_FAILED)
+  {
+    mutt_debug(LL_DEBUG1, "mmap %s: %s\n", ctx->path, strerror(errno));
+    return false;
+  }
+
+  if (ctx->map.addr)
+  {
+    mutt_mem_realloc(&ctx->old_maps, (ctx->num_old_maps + 1) * sizeof(struct MmapDbMap));
+    ctx->old_maps[ctx->num_old_maps++] = ctx->map;
+  }
+
+  ctx->map.addr = addr;
+  ctx->map.len = len;
+  return true;
+}
+
+/**
+ * mmapdb_record - Get a record from the map
+ * @param ctx    Context
+ * @param offset Offset of the record
+ * @retval ptr  Record
+ * @retval NULL The offset is invalid
+ */
+static struct MmapDbRecord *mmapdb_record(struct HcacheMmapDbCtx *ctx, uint64_t offset)
+{
+  if ((offset < sizeof(struct MmapDbHeader)) ||
+      (offset + sizeof(struct MmapDbRecord) > ctx->hdr.data_end))
+  {
+    return NULL;
+  }
+
+  struct MmapDbRecord *rec = (struct MmapDbRecord *) (ctx->map.addr + offset);
+  if ((offset + mmapdb_record_len(rec->keylen, rec->datalen)) > ctx->hdr.data_end)
+    return NULL;
+
+  return rec;
+}
+
+/**
+ * mmapdb_find - Find a key in the index
+ * @param ctx    Context
+ * @param key    Key to look for
+ * @param keylen Length of key
+ * @param hash   Hash of the key
+ * @param insert If the key isn't found, return the slot where it belongs
+ * @retval ptr  Slot containing the key (or a free slot if @a insert is set)
+ * @retval NULL The key wasn't found
+ */
+static struct MmapDbSlot *mmapdb_find(struct HcacheMmapDbCtx *ctx, const char *key,
+                                      size_t keylen, uint64_t hash, bool insert)
+{
+  const uint64_t mask = ctx->hdr.idx_slots - 1;
+  struct MmapDbSlot *free_slot = NULL;
+
+  for (uint64_t i = 0, pos = hash & mask; i < ctx->hdr.idx_slots; i++, pos = (pos + 1) & mask)
+  {
+    struct MmapDbSlot *slot = &ctx->slots[pos];
+
+    if (slot->offset == MMAPDB_SLOT_EMPTY)
+      return insert ? (free_slot ? free_slot : slot) : NULL;
+
+    if (slot->offset == MMAPDB_SLOT_DELETED)
+    {
+      if (!free_slot)
+        free_slot = slot;
+      continue;
+    }
+
+    if (slot->hash != hash)
+      continue;
+
+    struct MmapDbRecord *rec = mmapdb_record(ctx, slot->offset);
+    if (rec && (rec->keylen == keylen) && (memcmp(rec + 1, key, keylen) == 0))
+      return slot;
+  }
+
+  return insert ? free_slot : NULL;
+}
+
+/**
+ * mmapdb_insert - Add a record to an index
+ * @param slots  Index
+ * @param nslots Number of slots in the index
+ * @param hash   Hash of the record's key
+ * @param offset Offset of the record
+ *
+ * The key must not already be in the index.
+ */
+static void mmapdb_insert(struct MmapDbSlot *slots, uint64_t nslots, uint64_t hash, uint64_t offset)
+{
+  uint64_t pos = hash & (nslots - 1);
+  while (slots[pos].offset != MMAPDB_SLOT_EMPTY)
+    pos = (pos + 1) & (nslots - 1);
+
+  slots[pos].hash = hash;
+  slots[pos].offset = offset;
+}
+
+/**
+ * mmapdb_own_slots - Take a private copy of the index
+ * @param ctx Context
+ *
+ * A saved index lives at the end of the file, where new records will be
+ * written, so it must be copied before the database is changed.
+ */
+static void mmapdb_own_slots(struct HcacheMmapDbCtx *ctx)
+{
+  if (ctx->own_slots)
+    return;
+
+  size_t size = ctx->hdr.idx_slots * sizeof(struct MmapDbSlot);
+  struct MmapDbSlot *slots = mutt_mem_malloc(size);
+  memcpy(slots, ctx->slots, size);
+  ctx->slots = slots;
+  ctx->own_slots = true;
+}
+
+/**
+ * mmapdb_grow - Enlarge the index, if it's getting full
+ * @param ctx Context
+ *
+ * Deleted slots are dropped while rehashing.
+ */
+static void mmapdb_grow(struct HcacheMmapDbCtx *ctx)
+{
+  if ((ctx->hdr.idx_used + 1) * 4 < ctx->hdr.idx_slots * 3)
+    return;
+
+  uint64_t nslots = ctx->hdr.idx_slots * 2;
+  struct MmapDbSlot *slots = mutt_mem_calloc(nslots, sizeof(struct MmapDbSlot));
+  uint64_t used = 0;
+
+  for (uint64_t i = 0; i < ctx->hdr.idx_slots; i++)
+  {
+    if (ctx->slots[i].offset <= MMAPDB_SLOT_DELETED)
+      continue;
+    mmapdb_insert(slots, nslots, ctx->slots[i].hash, ctx->slots[i].offset);
+    used++;
+  }
+
+  if (ctx->own_slots)
+    FREE(&ctx->slots);
+  ctx->slots = slots;
+  ctx->own_slots = true;
+  ctx->hdr.idx_slots = nslots;
+  ctx->hdr.idx_used = used;
+}
+
+/**
+ * mmapdb_scan - Rebuild the index by reading all the records
+ * @param ctx  Context
+ * @param size Size of the file
+ *
+ * The scan stops at the first incomplete record, e.g. if NeoMutt was killed
+ * while writing.  Anything after it is discarded.
+ */
+static void mmapdb_scan(struct HcacheMmapDbCtx *ctx, size_t size)
+{
+  ctx->hdr.idx_slots = MMAPDB_MIN_SLOTS;
+  ctx->hdr.idx_used = 0;
+  ctx->hdr.dead_bytes = 0;
+  ctx->slots = mutt_mem_calloc(ctx->hdr.idx_slots, sizeof(struct MmapDbSlot));
+  ctx->own_slots = true;
+
+  uint64_t offset = sizeof(struct MmapDbHeader);
+  while ((offset + sizeof(struct MmapDbRecord)) <= size)
+  {
+    struct MmapDbRecord *rec = (struct MmapDbRecord *) (ctx->map.addr + offset);
+    size_t reclen = mmapdb_record_len(rec->keylen, rec->datalen);
+    if ((rec->keylen == 0) || ((offset + reclen) > size))
+      break;
+
+    const char *key = (const char *) (rec + 1);
+    uint64_t hash = mmapdb_hash(key, rec->keylen);
+
+    ctx->hdr.data_end = offset + reclen;
+    struct MmapDbSlot *slot = mmapdb_find(ctx, key, rec->keylen, hash, true);
+    if (slot->offset > MMAPDB_SLOT_DELETED)
+    {
+      struct MmapDbRecord *old = mmapdb_record(ctx, slot->offset);
+      ctx->hdr.dead_bytes += mmapdb_record_len(old->keylen, old->datalen);
+    }
+    else if (rec->datalen != MMAPDB_TOMBSTONE)
+    {
+      if (slot->offset == MMAPDB_SLOT_EMPTY)
+        ctx->hdr.idx_used++;
+    }
+
+    if (rec->datalen == MMAPDB_TOMBSTONE)
+    {
+      ctx->hdr.dead_bytes += reclen;
+      if (slot->offset > MMAPDB_SLOT_DELETED)
+        slot->offset = MMAPDB_SLOT_DELETED;
+    }
+    else
+    {
+      slot->hash = hash;
+      slot->offset = offset;
+      mmapdb_grow(ctx);
+    }
+
+    offset += reclen;
+  }
+
+  ctx->hdr.data_end = offset;
+  ctx->hdr.idx_offset = 0;
+  ctx->dirty = true;
+}
+
+/**
+ * mmapdb_write_header - Write the header to the file
+ * @param ctx Context
+ * @retval true Success
+ */
+static bool mmapdb_write_header(struct HcacheMmapDbCtx *ctx)
+{
+  if (pwrite(ctx->fd, &ctx->hdr, sizeof(ctx->hdr), 0) != sizeof(ctx->hdr))
+  {
+    mutt_debug(LL_DEBUG1, "write %s: %s\n", ctx->path, strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+/**
+ * mmapdb_begin_write - Prepare the database for a change
+ * @param ctx Context
+ * @retval true Success
+ */
+static bool mmapdb_begin_write(struct HcacheMmapDbCtx *ctx)
+{
+  if (ctx->readonly)
+    return false;
+
+  if (ctx->hdr.idx_offset == 0)
+    return true;
+
+  /* The saved index is about to be overwritten */
+  mmapdb_own_slots(ctx);
+  ctx->hdr.idx_offset = 0;
+  ctx->dirty = true;
+  return mmapdb_write_header(ctx);
+}
+
+/**
+ * mmapdb_append - Append a record to the log
+ * @param ctx     Context
+ * @param key     Key
+ * @param keylen  Length of key
+ * @param data    Data (OPTIONAL)
+ * @param datalen Length of data, or MMAPDB_TOMBSTONE
+ * @retval num Offset of the new record
+ * @retval 0   Error
+ */
+static uint64_t mmapdb_append(struct HcacheMmapDbCtx *ctx, const char *key,
+                              size_t keylen, const void *data, uint32_t datalen)
+{
+  size_t reclen = mmapdb_record_len(keylen, datalen);
+  char *buf = mutt_mem_calloc(1, reclen);
+
+  struct MmapDbRecord *rec = (struct MmapDbRecord *) buf;
+  rec->keylen = keylen;
+  rec->datalen = datalen;
+  memcpy(buf + sizeof(*rec), key, keylen);
+  if (datalen != MMAPDB_TOMBSTONE)
+    memcpy(buf + sizeof(*rec) + MMAPDB_ALIGN(keylen), data, datalen);
+
+  uint64_t offset = ctx->hdr.data_end;
+  ssize_t rc = pwrite(ctx->fd, buf, reclen, offset);
+  FREE(&buf);
+
+  if (rc != (ssize_t) reclen)
+  {
+    mutt_debug(LL_DEBUG1, "write %s: %s\n", ctx->path, strerror(errno));
+    return 0;
+  }
+
+  if (!mmapdb_map(ctx, offset + reclen))
+    return 0;
+
+  ctx->hdr.data_end = offset + reclen;
+  ctx->dirty = true;
+  return offset;
+}
+
+/**
+ * mmapdb_save_index - Write the index to the end of a file
+ * @param fd     File descriptor
+ * @param hdr    Header to update
+ * @param slots  Index
+ * @retval true Success
+ */
+static bool mmapdb_save_index(int fd, struct MmapDbHeader *hdr, struct MmapDbSlot *slots)
+{
+  size_t size = hdr->idx_slots * sizeof(struct MmapDbSlot);
+
+  if ((pwrite(fd, slots, size, hdr->data_end) != (ssize_t) size) ||
+      (ftruncate(fd, hdr->data_end + size) != 0))
+  {
+    return false;
+  }
+
+  hdr->idx_offset = hdr->data_end;
+  return pwrite(fd, hdr, sizeof(*hdr), 0) == sizeof(*hdr);
+}
+
+/**
+ * mmapdb_compact - Rewrite the database without the stale records
+ * @param ctx Context
+ * @retval true Success
+ *
+ * The live records are copied to a new file, which then replaces the old one.
+ */
+static bool mmapdb_compact(struct HcacheMmapDbCtx *ctx)
+{
+  char tmp[PATH_MAX];
+  snprintf(tmp, sizeof(tmp), "%s.compact", ctx->path);
+
+  int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+  if (fd < 0)
+    return false;
+
+  FILE *fp = fdopen(fd, "w");
+  if (!fp)
+  {
+    close(fd);
+    unlink(tmp);
+    return false;
+  }
+
+  struct MmapDbHeader hdr = ctx->hdr;
+  hdr.idx_slots = MMAPDB_MIN_SLOTS;
+  while (ctx->hdr.idx_used * 2 > hdr.idx_slots)
+    hdr.idx_slots *= 2;
+  hdr.idx_used = 0;
+  hdr.idx_offset = 0;
+  hdr.dead_bytes = 0;
+  hdr.data_end = sizeof(hdr);
+
+  struct MmapDbSlot *slots = mutt_mem_calloc(hdr.idx_slots, sizeof(struct MmapDbSlot));
+  bool ok = (fwrite(&hdr, sizeof(hdr), 1, fp) == 1);
+
+  for (uint64_t i = 0; ok && (i < ctx->hdr.idx_slots); i++)
+  {
+    struct MmapDbRecord *rec = mmapdb_record(ctx, ctx->slots[i].offset);
+    if (!rec)
+      continue;
+
+    size_t reclen = mmapdb_record_len(rec->keylen, rec->datalen);
+    ok = (fwrite(rec, reclen, 1, fp) == 1);
+    mmapdb_insert(slots, hdr.idx_slots, ctx->slots[i].hash, hdr.data_end);
+    hdr.data_end += reclen;
+    hdr.idx_used++;
+  }
+
+  ok = ok && (fflush(fp) == 0) && mmapdb_save_index(fd, &hdr, slots);
+  ok = (fclose(fp) == 0) && ok;
+  FREE(&slots);
+
+  if (ok && (rename(tmp, ctx->path) == 0))
+  {
+    mutt_debug(LL_DEBUG2, "compacted %s: %llu bytes\n", ctx->path,
+               (unsigned long long) hdr.data_end);
+    return true;
+  }
+
+  unlink(tmp);
+  return false;
+}
+
+/**
+ * hcache_mmapdb_open - Implements HcacheOps::open()
+ */
+static void *hcache_mmapdb_open(const char *path)
+{
+  struct HcacheMmapDbCtx *ctx = mutt_mem_calloc(1, sizeof(struct HcacheMmapDbCtx));
+  ctx->path = mutt_str_strdup(path);
+
+  ctx->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+  if (ctx->fd < 0)
+  {
+    ctx->fd = open(path, O_RDONLY | O_CLOEXEC);
+    ctx->readonly = true;
+  }
+  if (ctx->fd < 0)
+    goto fail;
+
+  if (ctx->readonly || (flock(ctx->fd, LOCK_EX | LOCK_NB) != 0))
+  {
+    ctx->readonly = true;
+    if (flock(ctx->fd, LOCK_SH | LOCK_NB) != 0)
+    {
+      /* Someone else is writing to the database.  Rather than fail (and have
+       * the file deleted), return a context that will never find anything. */
+      mutt_debug(LL_DEBUG2, "%s is busy, not using it\n", path);
+      close(ctx->fd);
+      ctx->fd = -1;
+      return ctx;
+    }
+  }
+
+  struct stat st;
+  if (fstat(ctx->fd, &st) != 0)
+    goto fail;
+
+  if ((size_t) st.st_size < sizeof(struct MmapDbHeader))
+  {
+    /* A new, or truncated, database */
+    if (ctx->readonly)
+    {
+      close(ctx->fd);
+      ctx->fd = -1;
+      return ctx;
+    }
+
+    if (ftruncate(ctx->fd, 0) != 0)
+      goto fail;
+
+    memcpy(ctx->hdr.magic, MMAPDB_MAGIC, sizeof(ctx->hdr.magic));
+    ctx->hdr.version = MMAPDB_VERSION;
+    ctx->hdr.data_end = sizeof(struct MmapDbHeader);
+    ctx->hdr.idx_slots = MMAPDB_MIN_SLOTS;
+    ctx->slots = mutt_mem_calloc(ctx->hdr.idx_slots, sizeof(struct MmapDbSlot));
+    ctx->own_slots = true;
+    ctx->dirty = true;
+    if (!mmapdb_write_header(ctx) || !mmapdb_map(ctx, ctx->hdr.data_end))
+      goto fail;
+    return ctx;
+  }
+
+  if (!mmapdb_map(ctx, st.st_size))
+    goto fail;
+
+  memcpy(&ctx->hdr, ctx->map.addr, sizeof(ctx->hdr));
+  if ((memcmp(ctx->hdr.magic, MMAPDB_MAGIC, sizeof(ctx->hdr.magic)) != 0) ||
+      (ctx->hdr.version != MMAPDB_VERSION))
+  {
+    mutt_debug(LL_DEBUG1, "%s: incompatible database\n", path);
+    goto fail;
+  }
+
+  uint64_t slots = ctx->hdr.idx_slots;
+  if ((ctx->hdr.idx_offset != 0) && (ctx->hdr.idx_offset == ctx->hdr.data_end) &&
+      (slots >= MMAPDB_MIN_SLOTS) && ((slots & (slots - 1)) == 0) &&
+      ((ctx->hdr.idx_offset + slots * sizeof(struct MmapDbSlot)) <= (uint64_t) st.st_size))
+  {
+    /* Use the saved index in place */
+    ctx->slots = (struct MmapDbSlot *) (ctx->map.addr + ctx->hdr.idx_offset);
+    ctx->own_slots = false;
+  }
+  else
+  {
+    mutt_debug(LL_DEBUG2, "%s: rebuilding index\n", path);
+    mmapdb_scan(ctx, st.st_size);
+  }
+
+  return ctx;
+
+fail:
+  if (ctx->map.addr)
+    munmap(ctx->map.addr, ctx->map.len);
+  if (ctx->fd >= 0)
+    close(ctx->fd);
+  FREE(&ctx->path);
+  FREE(&ctx);
+  return NULL;
+}
+
+/**
+ * hcache_mmapdb_fetch - Implements HcacheOps::fetch()
+ */
+static void *hcache_mmapdb_fetch(void *vctx, const char *key, size_t keylen, size_t *dlen)
+{
+  struct HcacheMmapDbCtx *ctx = vctx;
+  if (!ctx || (ctx->fd < 0))
+    return NULL;
+
+  struct MmapDbSlot *slot = mmapdb_find(ctx, key, keylen, mmapdb_hash(key, keylen), false);
+  if (!slot)
+    return NULL;
+
+  struct MmapDbRecord *rec = mmapdb_record(ctx, slot->offset);
+  if (!rec || (rec->datalen == MMAPDB_TOMBSTONE))
+    return NULL;
+
+  *dlen = rec->datalen;
+  return (char *) (rec + 1) + MMAPDB_ALIGN(rec->keylen);
+}
+
+/**
+ * hcache_mmapdb_free - Implements HcacheOps::free()
+ */
+static void hcache_mmapdb_free(void *vctx, void **data)
+{
+  /* The data is part of the map */
+}
+
+/**
+ * hcache_mmapdb_store - Implements HcacheOps::store()
+ */
+static int hcache_mmapdb_store(void *vctx, const char *key, size_t keylen,
+                               void *data, size_t dlen)
+{
+  struct HcacheMmapDbCtx *ctx = vctx;
+  if (!ctx || (ctx->fd < 0) || (keylen == 0) || (keylen >= UINT32_MAX) ||
+      (dlen >= UINT32_MAX) || !mmapdb_begin_write(ctx))
+  {
+    return -1;
+  }
+
+  uint64_t hash = mmapdb_hash(key, keylen);
+  struct MmapDbSlot *slot = mmapdb_find(ctx, key, keylen, hash, true);
+  if (!slot)
+    return -1;
+
+  uint64_t old = slot->offset;
+  uint64_t offset = mmapdb_append(ctx, key, keylen, data, dlen);
+  if (offset == 0)
+    return -1;
+
+  /* The append may have moved the map */
+  struct MmapDbRecord *rec = mmapdb_record(ctx, old);
+  if (rec)
+    ctx->hdr.dead_bytes += mmapdb_record_len(rec->keylen, rec->datalen);
+  if (old == MMAPDB_SLOT_EMPTY)
+    ctx->hdr.idx_used++;
+
+  slot->hash = hash;
+  slot->offset = offset;
+  mmapdb_grow(ctx);
+  return 0;
+}
+
+/**
+ * hcache_mmapdb_delete - Implements HcacheOps::delete()
+ */
+static int hcache_mmapdb_delete(void *vctx, const char *key, size_t keylen)
+{
+  struct HcacheMmapDbCtx *ctx = vctx;
+  if (!ctx || (ctx->fd < 0) || !mmapdb_begin_write(ctx))
+    return -1;
+
+  struct MmapDbSlot *slot = mmapdb_find(ctx, key, keylen, mmapdb_hash(key, keylen), false);
+  if (!slot)
+    return -1;
+
+  /* The tombstone keeps the key deleted, if the index has to be rebuilt */
+  uint64_t old = slot->offset;
+  uint64_t offset = mmapdb_append(ctx, key, keylen, NULL, MMAPDB_TOMBSTONE);
+  if (offset == 0)
+    return -1;
+
+  struct MmapDbRecord *rec = mmapdb_record(ctx, old);
+  if (rec)
+    ctx->hdr.dead_bytes += mmapdb_record_len(rec->keylen, rec->datalen);
+  ctx->hdr.dead_bytes += mmapdb_record_len(keylen, MMAPDB_TOMBSTONE);
+
+  slot->offset = MMAPDB_SLOT_DELETED;
+  return 0;
+}
+
+/**
+ * hcache_mmapdb_close - Implements HcacheOps::close()
+ */
+static void hcache_mmapdb_close(void **vctx)
+{
+  if (!vctx || !*vctx)
+    return;
+
+  struct HcacheMmapDbCtx *ctx = *vctx;
+
+  if ((ctx->fd >= 0) && !ctx->readonly && ctx->dirty)
+  {
+    uint64_t live = ctx->hdr.data_end - sizeof(struct MmapDbHeader) - ctx->hdr.dead_bytes;
+    if ((ctx->hdr.dead_bytes < MMAPDB_COMPACT_MIN) ||
+        (ctx->hdr.dead_bytes < live) || !mmapdb_compact(ctx))
+    {
+      if (!mmapdb_save_index(ctx->fd, &ctx->hdr, ctx->slots))
+        mutt_debug(LL_DEBUG1, "write %s: %s\n", ctx->path, strerror(errno));
+    }
+  }
+
+  if (ctx->own_slots)
+    FREE(&ctx->slots);
+  for (size_t i = 0; i < ctx->num_old_maps; i++)
+    munmap(ctx->old_maps[i].addr, ctx->old_maps[i].len);
+  FREE(&ctx->old_maps);
+  if (ctx->map.addr)
+    munmap(ctx->map.addr, ctx->map.len);
+  if (ctx->fd >= 0)
+  {
+    /* A child process may share the fd, don't let it keep the lock */
+    flock(ctx->fd, LOCK_UN);
+    close(ctx->fd);
+  }
+  FREE(&ctx->path);
+  FREE(vctx);
+}
+
+/**
+ * hcache_mmapdb_backend - Implements HcacheOps::backend()
+ */
+static const char *hcache_mmapdb_backend(void)
+{
+  return "mmapdb " MMAPDB_VERSION_STRING;
+}
+
+HCACHE_BACKEND_OPS(mmapdb)
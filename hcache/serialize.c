@@ -471,6 +471,203 @@ void serial_restore_body(struct Body *c, const unsigned char *d, int *off, bool
   serial_restore_char(&c->d_filename, d, off, convert);
 }
 
+/**
+ * check_int - Check that an int fits in a binary blob
+ * @param[in]  d   Binary blob to check
+ * @param[in]  len Length of the blob
+ * @param[out] off Offset into the blob
+ * @param[out] i   Store the int here
+ * @retval true The int fits
+ */
+static bool check_int(const unsigned char *d, size_t len, size_t *off, unsigned int *i)
+{
+  if ((len - *off) < sizeof(int))
+    return false;
+
+  memcpy(i, d + *off, sizeof(int));
+  *off += sizeof(int);
+  return true;
+}
+
+/**
+ * check_char - Check that a string fits in a binary blob
+ * @param[in]  d    Binary blob to check
+ * @param[in]  len  Length of the blob
+ * @param[out] off  Offset into the blob
+ * @param[out] size Store the size of the string here
+ * @retval true The string fits and is terminated
+ */
+static bool check_char(const unsigned char *d, size_t len, size_t *off, unsigned int *size)
+{
+  if (!check_int(d, len, off, size))
+    return false;
+  if (*size == 0)
+    return true;
+  if ((*size > (len - *off)) || !memchr(d + *off, '\0', *size))
+    return false;
+
+  *off += *size;
+  return true;
+}
+
+/**
+ * check_address - Check that an AddressList fits in a binary blob
+ * @param[in]  d   Binary blob to check
+ * @param[in]  len Length of the blob
+ * @param[out] off Offset into the blob
+ * @retval true The AddressList fits
+ */
+static bool check_address(const unsigned char *d, size_t len, size_t *off)
+{
+  unsigned int counter = 0;
+  unsigned int i = 0;
+
+  if (!check_int(d, len, off, &counter))
+    return false;
+
+  for (; counter > 0; counter--)
+  {
+    if (!check_char(d, len, off, &i) || !check_char(d, len, off, &i) ||
+        !check_int(d, len, off, &i))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * check_stailq - Check that a STAILQ fits in a binary blob
+ * @param[in]  d   Binary blob to check
+ * @param[in]  len Length of the blob
+ * @param[out] off Offset into the blob
+ * @retval true The STAILQ fits
+ */
+static bool check_stailq(const unsigned char *d, size_t len, size_t *off)
+{
+  unsigned int counter = 0;
+  unsigned int i = 0;
+
+  if (!check_int(d, len, off, &counter))
+    return false;
+
+  for (; counter > 0; counter--)
+    if (!check_char(d, len, off, &i))
+      return false;
+
+  return true;
+}
+
+/**
+ * check_buffer - Check that a Buffer fits in a binary blob
+ * @param[in]  d   Binary blob to check
+ * @param[in]  len Length of the blob
+ * @param[out] off Offset into the blob
+ * @retval true The Buffer fits
+ */
+static bool check_buffer(const unsigned char *d, size_t len, size_t *off)
+{
+  unsigned int used = 0;
+  unsigned int size = 0;
+  unsigned int offset = 0;
+  unsigned int dsize = 0;
+
+  if (!check_int(d, len, off, &used))
+    return false;
+  if (!used)
+    return true;
+
+  /* The Buffer's offset and size must lie within its data */
+  return check_char(d, len, off, &size) && check_int(d, len, off, &offset) &&
+         check_int(d, len, off, &dsize) && check_int(d, len, off, &used) &&
+         (offset < size) && (dsize < size);
+}
+
+/**
+ * serial_thaw_envelope - Unpack the cold fields of an Envelope
+ * @param env  Envelope to fill
+ * @param data Binary blob, see serial_dump_envelope_cold()
+ * @param len  Length of the blob
+ *
+ * The blob is checked before anything is unpacked.
+ * If it's damaged, the fields are left empty.
+ */
+static void serial_thaw_envelope(struct Envelope *env, const unsigned char *data, size_t len)
+{
+  size_t check = 0;
+  unsigned int size = 0;
+  if (!check_address(data, len, &check) || !check_address(data, len, &check) ||
+      !check_address(data, len, &check) || !check_address(data, len, &check) ||
+      !check_char(data, len, &check, &size) ||
+      !check_buffer(data, len, &check) || !check_stailq(data, len, &check) ||
+      !check_stailq(data, len, &check) || (check != len))
+  {
+    mutt_debug(LL_DEBUG1, "damaged Envelope in the header cache\n");
+    return;
+  }
+
+  int off = 0;
+  bool convert = !CharsetIsUtf8;
+
+  serial_restore_address(&env->to, data, &off, convert);
+  serial_restore_address(&env->cc, data, &off, convert);
+  serial_restore_address(&env->bcc, data, &off, convert);
+  serial_restore_address(&env->reply_to, data, &off, convert);
+  serial_restore_char(&env->x_label, data, &off, convert);
+  serial_restore_buffer(&env->spam, data, &off, convert);
+  serial_restore_stailq(&env->in_reply_to, data, &off, false);
+  serial_restore_stailq(&env->userhdrs, data, &off, convert);
+}
+
+/**
+ * serial_dump_envelope_cold - Pack the cold fields of an Envelope
+ * @param env     Envelope to pack
+ * @param d       Binary blob to add to
+ * @param off     Offset into the blob
+ * @param convert If true, the strings will be converted to utf-8
+ * @retval ptr End of the newly packed binary
+ *
+ * The To, Cc, Bcc, Reply-To, X-Label, spam, In-Reply-To and user headers
+ * aren't needed to open a mailbox.  They're packed after their length, so
+ * serial_restore_envelope() can keep them aside until mutt_env_thaw().
+ * If they're all empty, only a zero length is packed.
+ */
+static unsigned char *serial_dump_envelope_cold(struct Envelope *env, unsigned char *d,
+                                                int *off, bool convert)
+{
+  unsigned int start_off = *off;
+
+  d = serial_dump_int(0, d, off);
+
+  if (env->cold)
+  {
+    /* Not restored yet, so it's unchanged */
+    lazy_realloc(&d, *off + env->cold->len);
+    memcpy(d + *off, env->cold->data, env->cold->len);
+    *off += env->cold->len;
+  }
+  else if (!TAILQ_EMPTY(&env->to) || !TAILQ_EMPTY(&env->cc) ||
+           !TAILQ_EMPTY(&env->bcc) || !TAILQ_EMPTY(&env->reply_to) ||
+           env->x_label || env->spam || !STAILQ_EMPTY(&env->in_reply_to) ||
+           !STAILQ_EMPTY(&env->userhdrs))
+  {
+    d = serial_dump_address(&env->to, d, off, convert);
+    d = serial_dump_address(&env->cc, d, off, convert);
+    d = serial_dump_address(&env->bcc, d, off, convert);
+    d = serial_dump_address(&env->reply_to, d, off, convert);
+    d = serial_dump_char(env->x_label, d, off, convert);
+    d = serial_dump_buffer(env->spam, d, off, convert);
+    d = serial_dump_stailq(&env->in_reply_to, d, off, false);
+    d = serial_dump_stailq(&env->userhdrs, d, off, convert);
+  }
+
+  unsigned int len = *off - start_off - sizeof(int);
+  memcpy(d + start_off, &len, sizeof(int));
+
+  return d;
+}
+
 /**
  * serial_dump_envelope - Pack an Envelope into a binary blob
  * @param env     Envelope to pack
@@ -484,11 +681,7 @@ unsigned char *serial_dump_envelope(struct Envelope *env, unsigned char *d,
 {
   d = serial_dump_address(&env->return_path, d, off, convert);
   d = serial_dump_address(&env->from, d, off, convert);
-  d = serial_dump_address(&env->to, d, off, convert);
-  d = serial_dump_address(&env->cc, d, off, convert);
-  d = serial_dump_address(&env->bcc, d, off, convert);
   d = serial_dump_address(&env->sender, d, off, convert);
-  d = serial_dump_address(&env->reply_to, d, off, convert);
   d = serial_dump_address(&env->mail_followup_to, d, off, convert);
 
   d = serial_dump_char(env->list_post, d, off, convert);
@@ -502,13 +695,8 @@ unsigned char *serial_dump_envelope(struct Envelope *env, unsigned char *d,
   d = serial_dump_char(env->message_id, d, off, false);
   d = serial_dump_char(env->supersedes, d, off, false);
   d = serial_dump_char(env->date, d, off, false);
-  d = serial_dump_char(env->x_label, d, off, convert);
-
-  d = serial_dump_buffer(env->spam, d, off, convert);
 
   d = serial_dump_stailq(&env->references, d, off, false);
-  d = serial_dump_stailq(&env->in_reply_to, d, off, false);
-  d = serial_dump_stailq(&env->userhdrs, d, off, convert);
 
 #ifdef USE_NNTP
   d = serial_dump_char(env->xref, d, off, false);
@@ -516,6 +704,8 @@ unsigned char *serial_dump_envelope(struct Envelope *env, unsigned char *d,
   d = serial_dump_char(env->x_comment_to, d, off, convert);
 #endif
 
+  d = serial_dump_envelope_cold(env, d, off, convert);
+
   return d;
 }
 
@@ -532,11 +722,7 @@ void serial_restore_envelope(struct Envelope *env, const unsigned char *d, int *
 
   serial_restore_address(&env->return_path, d, off, convert);
   serial_restore_address(&env->from, d, off, convert);
-  serial_restore_address(&env->to, d, off, convert);
-  serial_restore_address(&env->cc, d, off, convert);
-  serial_restore_address(&env->bcc, d, off, convert);
   serial_restore_address(&env->sender, d, off, convert);
-  serial_restore_address(&env->reply_to, d, off, convert);
   serial_restore_address(&env->mail_followup_to, d, off, convert);
 
   serial_restore_char(&env->list_post, d, off, convert);
@@ -555,19 +741,26 @@ void serial_restore_envelope(struct Envelope *env, const unsigned char *d, int *
   serial_restore_char(&env->message_id, d, off, false);
   serial_restore_char(&env->supersedes, d, off, false);
   serial_restore_char(&env->date, d, off, false);
-  serial_restore_char(&env->x_label, d, off, convert);
-
-  serial_restore_buffer(&env->spam, d, off, convert);
 
   serial_restore_stailq(&env->references, d, off, false);
-  serial_restore_stailq(&env->in_reply_to, d, off, false);
-  serial_restore_stailq(&env->userhdrs, d, off, convert);
 
 #ifdef USE_NNTP
   serial_restore_char(&env->xref, d, off, false);
   serial_restore_char(&env->followup_to, d, off, false);
   serial_restore_char(&env->x_comment_to, d, off, convert);
 #endif
+
+  /* The cold fields are restored by mutt_env_thaw() */
+  unsigned int len = 0;
+  serial_restore_int(&len, d, off);
+  if (len > 0)
+  {
+    env->cold = mutt_mem_malloc(sizeof(struct EnvelopeCold) + len);
+    env->cold->thaw = serial_thaw_envelope;
+    env->cold->len = len;
+    memcpy(env->cold->data, d + *off, len);
+    *off += len;
+  }
 }
 
 /**
@@ -616,6 +809,8 @@ void *mutt_hcache_dump(header_cache_t *hc, const struct Email *e, int *off, unsi
   nh.num_hidden = 0;
   nh.recipient = 0;
   nh.pair = 0;
+  /* The count is kept, tagged with its config, see mutt_attach_count_valid() */
+  nh.attach_id = e->attach_valid ? e->attach_id : 0;
   nh.attach_valid = false;
   nh.path = NULL;
   nh.tree = NULL;
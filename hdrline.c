@@ -573,6 +573,7 @@ static const char *index_format_str(char *buf, size_t buflen, size_t col, int co
   if (!e || !e->env)
     return src;
 
+  mutt_env_thaw(e->env);
   const struct Address *reply_to = TAILQ_FIRST(&e->env->reply_to);
   const struct Address *from = TAILQ_FIRST(&e->env->from);
   const struct Address *to = TAILQ_FIRST(&e->env->to);
@@ -1291,6 +1292,10 @@ static const char *index_format_str(char *buf, size_t buflen, size_t col, int co
       if (e->env->x_label)
       {
         struct Email *etmp = NULL;
+        if (e->thread && e->thread->prev && e->thread->prev->message)
+          mutt_env_thaw(e->thread->prev->message->env);
+        if (e->thread && e->thread->parent && e->thread->parent->message)
+          mutt_env_thaw(e->thread->parent->message->env);
         if (flags & MUTT_FORMAT_TREE && (e->thread->prev && e->thread->prev->message &&
                                          e->thread->prev->message->env->x_label))
         {
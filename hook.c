@@ -666,6 +666,7 @@ void mutt_default_save(char *path, size_t pathlen, struct Email *e)
     return;
 
   struct Envelope *env = e->env;
+  mutt_env_thaw(env);
   const struct Address *from = TAILQ_FIRST(&env->from);
   const struct Address *reply_to = TAILQ_FIRST(&env->reply_to);
   const struct Address *to = TAILQ_FIRST(&env->to);
@@ -1966,6 +1966,11 @@ static int imap_mbox_open(struct Mailbox *m)
   m->rights = 0;
   mdata->new_mail_count = 0;
 
+#ifdef USE_HCACHE
+  if (!mdata->hcache_held)
+    mdata->hcache_held = imap_hcache_open(adata, mdata);
+#endif
+
   mutt_message(_("Selecting %s..."), mdata->name);
 
   /* pipeline ACL test */
@@ -2513,6 +2518,7 @@ struct MxOps MxImapOps = {
   .ac_find          = imap_ac_find,
   .ac_add           = imap_ac_add,
   .mbox_open        = imap_mbox_open,
+  .mbox_open_more   = NULL,
   .mbox_open_append = imap_mbox_open_append,
   .mbox_check       = imap_mbox_check,
   .mbox_check_stats = imap_mbox_check_stats,
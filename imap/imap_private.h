@@ -235,6 +235,7 @@ struct ImapMboxData
   size_t msn_index_size;       /**< allocation size */
   unsigned int max_msn;        /**< the largest MSN fetched so far */
   struct BodyCache *bcache;
+  header_cache_t *hcache_held; ///< Header cache, held from mbox_open() until mbox_close()
 
   header_cache_t *hcache;
 };
@@ -51,6 +51,7 @@
 #include "mutt_account.h"
 #include "mutt_curses.h"
 #include "mutt_logging.h"
+#include "mutt_parse.h"
 #include "mutt_socket.h"
 #include "muttlib.h"
 #include "mx.h"
@@ -314,6 +315,168 @@ static char *msg_parse_flags(struct ImapHeader *h, char *s)
   return s;
 }
 
+/**
+ * bs_value_end - Find the end of a value in a BODYSTRUCTURE
+ * @param s String to parse
+ * @retval ptr  First character after the value
+ * @retval NULL The value is malformed
+ *
+ * The value may be an atom, a number, NIL, a quoted string or a
+ * parenthesised list of values.
+ */
+static char *bs_value_end(char *s)
+{
+  if (*s == '"')
+  {
+    for (s++; *s && (*s != '"'); s++)
+      if ((*s == '\\') && s[1])
+        s++;
+    return (*s == '"') ? s + 1 : NULL;
+  }
+
+  if (*s == '(')
+  {
+    s++;
+    SKIPWS(s);
+    while (*s && (*s != ')'))
+    {
+      s = bs_value_end(s);
+      if (!s)
+        return NULL;
+      SKIPWS(s);
+    }
+    return (*s == ')') ? s + 1 : NULL;
+  }
+
+  char *start = s;
+  while (*s && !IS_SPACE(*s) && (*s != '(') && (*s != ')'))
+    s++;
+  return (s == start) ? NULL : s;
+}
+
+/**
+ * bs_string - Copy a string out of a BODYSTRUCTURE
+ * @param s   Start of the string
+ * @param end End of the string, see bs_value_end()
+ * @retval ptr  Unquoted string
+ * @retval NULL The value is NIL
+ *
+ * The caller must free the string.
+ */
+static char *bs_string(const char *s, const char *end)
+{
+  char *str = mutt_str_substr_dup(s, end);
+  if (mutt_str_strcasecmp(str, "NIL") == 0)
+    FREE(&str);
+  else
+    imap_unquote_string(str);
+  return str;
+}
+
+/**
+ * bs_parse_body - Parse a BODYSTRUCTURE
+ * @param[in]  s String to parse
+ * @param[out] b Body tree
+ * @retval ptr  First character after the body
+ * @retval NULL The body is malformed
+ *
+ * Only the fields needed to count attachments are filled in: the type,
+ * subtype, disposition and nested parts.  The caller must free the Body tree.
+ *
+ * @sa RFC3501, section 7.4.2
+ */
+static char *bs_parse_body(char *s, struct Body **b)
+{
+  if (*s != '(')
+    return NULL;
+  s++;
+  SKIPWS(s);
+
+  struct Body *bp = mutt_body_new();
+  bp->disposition = DISP_INLINE;
+  *b = bp;
+
+  /* Position of the next field, see the body-type-* rules of the RFC */
+  int field = 0;
+  int disp_field = 8;
+
+  if (*s == '(')
+  {
+    /* multipart: 1*body SP subtype [SP params [SP disposition ...]] */
+    bp->type = TYPE_MULTIPART;
+    for (struct Body **last = &bp->parts; *s == '('; last = &(*last)->next)
+    {
+      s = bs_parse_body(s, last);
+      if (!s)
+        return NULL;
+    }
+    field = 1;
+    disp_field = 3;
+  }
+
+  while (*s && (*s != ')'))
+  {
+    /* message/rfc822: ... SP envelope SP body SP lines */
+    if ((field == 8) && (disp_field == 11))
+    {
+      s = bs_parse_body(s, &bp->parts);
+      if (!s)
+        return NULL;
+      field++;
+      continue;
+    }
+
+    char *end = bs_value_end(s);
+    if (!end)
+      return NULL;
+
+    if (field == 0)
+    {
+      char *type = bs_string(s, end);
+      bp->type = mutt_check_mime_type(type);
+      FREE(&type);
+    }
+    else if ((field == 1) && (bp->type != TYPE_MULTIPART))
+    {
+      bp->subtype = bs_string(s, end);
+      if (bp->type == TYPE_TEXT)
+        disp_field = 9; /* ... SP lines */
+      else if ((bp->type == TYPE_MESSAGE) &&
+               (mutt_str_strcasecmp(bp->subtype, "rfc822") == 0))
+        disp_field = 11;
+    }
+    else if (field == 1)
+    {
+      bp->subtype = bs_string(s, end);
+    }
+    else if ((field == disp_field) && (*s == '('))
+    {
+      /* "(" string SP params ")" */
+      char *d = s + 1;
+      SKIPWS(d);
+      char *dend = bs_value_end(d);
+      char *disp = dend ? bs_string(d, dend) : NULL;
+      if (mutt_str_strcasecmp(disp, "inline") == 0)
+        bp->disposition = DISP_INLINE;
+      else if (mutt_str_strcasecmp(disp, "form-data") == 0)
+        bp->disposition = DISP_FORM_DATA;
+      else
+        bp->disposition = DISP_ATTACH;
+      FREE(&disp);
+    }
+
+    s = end;
+    SKIPWS(s);
+    field++;
+  }
+
+  if (*s != ')')
+    return NULL;
+  s++;
+  SKIPWS(s);
+  return s;
+}
+
 /**
  * msg_parse_fetch - handle headers returned from header fetch
  * @param h IMAP Header
@@ -380,6 +543,28 @@ static int msg_parse_fetch(struct ImapHeader *h, char *s)
       if (mutt_str_atol(tmp, &h->content_length) < 0)
         return -1;
     }
+    else if ((plen = mutt_str_startswith(s, "BODYSTRUCTURE", CASE_IGNORE)))
+    {
+      s += plen;
+      SKIPWS(s);
+      struct Body *b = NULL;
+      char *end = bs_parse_body(s, &b);
+      if (end)
+      {
+        h->attach_total = mutt_count_body_tree(b);
+        h->attach_valid = true;
+      }
+      else
+      {
+        /* It's counted when it's needed, as before */
+        mutt_debug(LL_DEBUG1, "bogus BODYSTRUCTURE: %s\n", s);
+        end = bs_value_end(s);
+      }
+      mutt_body_free(&b);
+      if (!end)
+        return -1;
+      s = end;
+    }
     else if (mutt_str_startswith(s, "BODY", CASE_IGNORE) ||
              mutt_str_startswith(s, "RFC822.HEADER", CASE_IGNORE))
     {
@@ -464,8 +649,9 @@ static int msg_fetch_header(struct Mailbox *m, struct ImapHeader *ih, char *buf,
   if ((parse_rc != -2) || !fp)
     return rc;
 
+  /* The headers are the last item on the line */
   unsigned int bytes = 0;
-  if (imap_get_literal_count(buf, &bytes) == 0)
+  if (imap_get_literal_count(strrchr(buf, '{'), &bytes) == 0)
   {
     imap_read_literal(fp, adata, bytes, NULL);
 
@@ -1014,6 +1200,92 @@ static int read_headers_condstore_qresync_updates(struct ImapAccountData *adata,
 }
 #endif /* USE_HCACHE */
 
+/**
+ * index_shows_attachments - Does $index_format show the attachment count?
+ * @retval true It uses `%X`
+ */
+static bool index_shows_attachments(void)
+{
+  for (const char *p = strchr(NONULL(C_IndexFormat), '%'); p; p = strchr(p, '%'))
+  {
+    p++;
+    if (*p == '%')
+    {
+      p++;
+      continue;
+    }
+
+    /* Padding, the next character is the fill, e.g. "%>X" */
+    if ((*p == '>') || (*p == '|') || (*p == '*'))
+    {
+      if (*++p)
+        p++;
+      continue;
+    }
+
+    /* Justification, width and conditionals, e.g. "%-3X" or "%?X?" */
+    p += strspn(p, "-=0123456789.?<");
+    if (*p == 'X')
+      return true;
+  }
+
+  return false;
+}
+
+/**
+ * read_fetch_response - Gather a FETCH response that includes a BODYSTRUCTURE
+ * @param adata Imap Account data
+ * @param buf   Buffer for the result
+ * @param fp    File to discard literals into
+ * @retval  0 Success
+ * @retval -1 Failure
+ *
+ * A server may send a string in the BODYSTRUCTURE, e.g. a file name, as a
+ * literal.  None of those are needed to count attachments, so each literal is
+ * read and replaced by NIL.  The literal holding the headers is left for
+ * msg_fetch_header() to read.
+ */
+static int read_fetch_response(struct ImapAccountData *adata, struct Buffer *buf, FILE *fp)
+{
+  mutt_buffer_reset(buf);
+
+  while (true)
+  {
+    size_t len = mutt_str_strlen(adata->buf);
+    char *brace = strrchr(adata->buf, '{');
+    unsigned int bytes = 0;
+
+    /* The headers follow "BODY[...]" or "RFC822.HEADER" */
+    bool headers = false;
+    if (brace)
+    {
+      char *item = brace;
+      while ((item > adata->buf) && IS_SPACE(item[-1]))
+        item--;
+      headers = ((item > adata->buf) && (item[-1] == ']')) ||
+                ((item - adata->buf >= 13) &&
+                 (mutt_str_strncasecmp(item - 13, "RFC822.HEADER", 13) == 0));
+    }
+
+    if (!brace || headers || (adata->buf[len - 1] != '}') ||
+        (imap_get_literal_count(brace, &bytes) < 0))
+    {
+      mutt_buffer_addstr(buf, adata->buf);
+      return 0;
+    }
+
+    *brace = '\0';
+    mutt_buffer_addstr(buf, adata->buf);
+    mutt_buffer_addstr(buf, "NIL");
+
+    if ((imap_read_literal(fp, adata, bytes, NULL) < 0) ||
+        (imap_cmd_step(adata) != IMAP_CMD_CONTINUE))
+    {
+      return -1;
+    }
+  }
+}
+
 /**
  * read_headers_fetch_new - Retrieve new messages from the server
  * @param[in]  m                Imap Selected Mailbox
@@ -1035,8 +1307,10 @@ static int read_headers_fetch_new(struct Mailbox *m, unsigned int msn_begin,
   char *hdrreq = NULL;
   char tempfile[_POSIX_PATH_MAX];
   FILE *fp = NULL;
+  FILE *fp_null = NULL;
   struct ImapHeader h;
   struct Buffer *b = NULL;
+  struct Buffer *resp = NULL;
   static const char *const want_headers =
       "DATE FROM SENDER SUBJECT TO CC MESSAGE-ID REFERENCES CONTENT-TYPE "
       "CONTENT-DESCRIPTION IN-REPLY-TO REPLY-TO LINES LIST-POST X-LABEL "
@@ -1065,6 +1339,18 @@ static int read_headers_fetch_new(struct Mailbox *m, unsigned int msn_begin,
     goto bail;
   }
 
+  /* Only ask for the structure if the index will show the count.
+   * It's before the headers, so any literals in it are read first. */
+  const bool structure = (adata->capabilities & IMAP_CAP_IMAP4REV1) &&
+                         !mutt_attach_config_empty() && index_shows_attachments();
+  if (structure)
+  {
+    fp_null = mutt_file_fopen("/dev/null", "w");
+    if (!fp_null)
+      goto bail;
+    resp = mutt_buffer_pool_get();
+  }
+
   /* instead of downloading all headers and then parsing them, we parse them
    * as they come in. */
   mutt_mktemp(tempfile, sizeof(tempfile));
@@ -1095,8 +1381,8 @@ static int read_headers_fetch_new(struct Mailbox *m, unsigned int msn_begin,
          imap_fetch_msn_seqset(b, adata, evalhc, msn_begin, msn_end, &fetch_msn_end))
   {
     char *cmd = NULL;
-    mutt_str_asprintf(&cmd, "FETCH %s (UID FLAGS INTERNALDATE RFC822.SIZE %s)",
-                      mutt_b2s(b), hdrreq);
+    mutt_str_asprintf(&cmd, "FETCH %s (UID FLAGS INTERNALDATE RFC822.SIZE %s%s)",
+                      mutt_b2s(b), structure ? "BODYSTRUCTURE " : "", hdrreq);
     imap_cmd_start(adata, cmd);
     FREE(&cmd);
 
@@ -1121,7 +1407,16 @@ static int read_headers_fetch_new(struct Mailbox *m, unsigned int msn_begin,
         if (rc != IMAP_CMD_CONTINUE)
           break;
 
-        mfhrc = msg_fetch_header(m, &h, adata->buf, fp);
+        char *fetch_buf = adata->buf;
+        if (structure)
+        {
+          if (read_fetch_response(adata, resp, fp_null) < 0)
+            goto bail;
+          fetch_buf = resp->data;
+        }
+
+        h.attach_valid = false;
+        mfhrc = msg_fetch_header(m, &h, fetch_buf, fp);
         if (mfhrc < 0)
           continue;
 
@@ -1186,6 +1481,13 @@ static int read_headers_fetch_new(struct Mailbox *m, unsigned int msn_begin,
         m->emails[idx]->content->length = h.content_length;
         mutt_mailbox_size_add(m, m->emails[idx]);
 
+        if (h.attach_valid)
+        {
+          m->emails[idx]->attach_total = h.attach_total;
+          m->emails[idx]->attach_id = mutt_attach_config_id();
+          m->emails[idx]->attach_valid = true;
+        }
+
 #ifdef USE_HCACHE
         imap_hcache_put(mdata, m->emails[idx]);
 #endif /* USE_HCACHE */
@@ -1230,7 +1532,9 @@ static int read_headers_fetch_new(struct Mailbox *m, unsigned int msn_begin,
 
 bail:
   mutt_buffer_pool_release(&b);
+  mutt_buffer_pool_release(&resp);
   mutt_file_fclose(&fp);
+  mutt_file_fclose(&fp_null);
   FREE(&hdrreq);
 
   return retval;
@@ -57,6 +57,9 @@ struct ImapHeader
 
   time_t received;
   long content_length;
+
+  short attach_total; ///< Attachments in the BODYSTRUCTURE, if attach_valid
+  bool attach_valid;  ///< The BODYSTRUCTURE was fetched and counted
 };
 
 #endif /* MUTT_IMAP_MESSAGE_H */
@@ -217,6 +217,10 @@ void imap_mdata_cache_reset(struct ImapMboxData *mdata)
   mdata->msn_index_size = 0;
   mdata->max_msn = 0;
   mutt_bcache_close(&mdata->bcache);
+#ifdef USE_HCACHE
+  mutt_hcache_close(mdata->hcache_held);
+  mdata->hcache_held = NULL;
+#endif
 }
 
 /**
@@ -413,12 +417,17 @@ static int imap_hcache_namer(const char *path, char *dest, size_t dlen)
  * @param mdata Imap Mailbox data
  * @retval ptr HeaderCache
  * @retval NULL Failure
+ *
+ * If the Mailbox is open, this takes another reference to its cache.
  */
 header_cache_t *imap_hcache_open(struct ImapAccountData *adata, struct ImapMboxData *mdata)
 {
   if (!adata || !mdata)
     return NULL;
 
+  if (mdata->hcache_held)
+    return mutt_hcache_ref(mdata->hcache_held);
+
   struct Url url;
   char cachepath[PATH_MAX];
   char mbox[PATH_MAX];
@@ -464,14 +464,29 @@ static void update_index_threaded(struct Context *ctx, int check, int oldcount)
       if (mutt_pattern_exec(SLIST_FIRST(ctx->limit_pattern),
                             MUTT_MATCH_FULL_ADDRESS, ctx->mailbox, e, NULL))
       {
-        /* virtual will get properly set by mutt_set_virtual(), which
-         * is called by mutt_sort_headers() just below. */
+        /* virtual will get properly set by mutt_set_virtual() below */
         e->virtual = 1;
         e->limited = true;
+
+        /* A message joining a collapsed thread stays hidden */
+        if (check != MUTT_REOPENED)
+          mutt_thread_collapse_new(ctx, e);
       }
     }
-    /* Need a second sort to set virtual numbers and redraw the tree */
-    mutt_sort_headers(ctx, false);
+
+    if (check == MUTT_REOPENED)
+    {
+      /* Need a second sort to set virtual numbers and redraw the tree */
+      mutt_sort_headers(ctx, false);
+    }
+    else
+    {
+      /* The new messages are already threaded and in order, so only the
+       * virtual numbers and the tree need updating */
+      mutt_set_virtual(ctx);
+      if (ctx->tree)
+        mutt_draw_tree(ctx);
+    }
   }
 
   /* uncollapse threads with new mail */
@@ -591,6 +606,96 @@ void update_index(struct Menu *menu, struct Context *ctx, int check, int oldcoun
     menu->current = ci_first_message();
 }
 
+/**
+ * index_key_waiting - Has a key been pressed?
+ * @retval true A key is waiting
+ *
+ * The key is put back, to be read by km_dokey().
+ */
+static bool index_key_waiting(void)
+{
+  mutt_getch_timeout(0);
+  struct KeyEvent ch = mutt_getch();
+  mutt_getch_timeout(-1);
+
+  if (ch.ch == -2)
+    return false;
+
+  mutt_unget_event(ch.ch, ch.op);
+  return true;
+}
+
+/**
+ * index_op_needs_all - Does a function need the whole mailbox?
+ * @param op Operation, e.g. OP_DELETE
+ * @retval true The rest of a partially opened mailbox must be read first
+ *
+ * Moving around the index and leaving the mailbox can be done while it's
+ * still being read.
+ */
+static bool index_op_needs_all(int op)
+{
+  switch (op)
+  {
+    case OP_BOTTOM_PAGE:
+    case OP_CURRENT_BOTTOM:
+    case OP_CURRENT_MIDDLE:
+    case OP_CURRENT_TOP:
+    case OP_EXIT:
+    case OP_FIRST_ENTRY:
+    case OP_HALF_DOWN:
+    case OP_HALF_UP:
+    case OP_LAST_ENTRY:
+    case OP_MAIN_CHANGE_FOLDER:
+    case OP_MAIN_CHANGE_FOLDER_READONLY:
+    case OP_MAIN_NEXT_UNDELETED:
+    case OP_MAIN_NEXT_UNREAD_MAILBOX:
+    case OP_MAIN_PREV_UNDELETED:
+    case OP_MIDDLE_PAGE:
+    case OP_NEXT_ENTRY:
+    case OP_NEXT_LINE:
+    case OP_NEXT_PAGE:
+    case OP_PREV_ENTRY:
+    case OP_PREV_LINE:
+    case OP_PREV_PAGE:
+    case OP_QUIT:
+    case OP_REDRAW:
+    case OP_TOP_PAGE:
+      return false;
+    default:
+      return true;
+  }
+}
+
+/**
+ * index_open_more - Read more of a partially opened mailbox
+ * @param menu Current Menu
+ * @param all  If true, read the rest of the mailbox
+ */
+static void index_open_more(struct Menu *menu, bool all)
+{
+  struct Mailbox *m = Context->mailbox;
+  int oldcount = m->msg_count;
+  int index_hint = ((m->vcount != 0) && (menu->current >= 0) && (menu->current < m->vcount)) ?
+                       CUR_EMAIL->index :
+                       0;
+
+  if (mx_mbox_open_more(m, all) <= 0)
+    return;
+
+  bool q = m->quiet;
+  m->quiet = true;
+  update_index(menu, Context, MUTT_NEW_MAIL, oldcount, index_hint);
+  m->quiet = q;
+
+  menu->max = m->vcount;
+  menu->redraw = REDRAW_FULL;
+  OptSearchInvalid = true;
+
+  if (all)
+    mutt_clear_error();
+}
+
 /**
  * main_change_folder - Change to a different mailbox
  * @param menu       Current Menu
@@ -700,7 +805,7 @@ static int main_change_folder(struct Menu *menu, int op, struct Mailbox *m,
     m = mx_path_resolve(buf);
     free_m = true;
   }
-  Context = mx_mbox_open(m, flags);
+  Context = mx_mbox_open(m, flags | MUTT_PARTIAL);
   if (Context)
   {
     menu->current = ci_first_message();
@@ -1087,7 +1192,8 @@ int mutt_index_menu(void)
     if (Context)
       Context->menu = menu;
 
-    if (Context && !attach_msg)
+    /* Checks are put off until any macro has finished */
+    if (Context && !attach_msg && !mutt_macro_pending())
     {
       int check;
       /* check for new mail in the mailbox.  If nonzero, then something has
@@ -1157,7 +1263,7 @@ int mutt_index_menu(void)
       }
     }
 
-    if (!attach_msg)
+    if (!attach_msg && !mutt_macro_pending())
     {
       /* check for new mail in the incoming folders */
       oldcount = newcount;
@@ -1189,7 +1295,8 @@ int mutt_index_menu(void)
 
     if (menu->menu == MENU_MAIN)
     {
-      index_custom_redraw(menu);
+      if (!menu_redraw_defer(menu))
+        index_custom_redraw(menu);
 
       /* give visual indication that the next command is a tag- command */
       if (tag)
@@ -1226,6 +1333,18 @@ int mutt_index_menu(void)
         continue;
       }
 
+      /* Keep reading a partially opened mailbox until a key is pressed */
+      if (Context && Context->mailbox->partial && !mutt_macro_pending() &&
+          !index_key_waiting())
+      {
+        index_open_more(menu, false);
+        continue;
+      }
+
+      /* While the user reads, start loading the next mailbox with new mail */
+      if (!attach_msg && !mutt_macro_pending())
+        mutt_mailbox_prefetch_next(Context ? Context->mailbox : NULL);
+
       op = km_dokey(MENU_MAIN);
 
       mutt_debug(LL_DEBUG3, "[%d]: Got op %d\n", __LINE__, op);
@@ -1241,6 +1360,9 @@ int mutt_index_menu(void)
 
       mutt_curs_set(1);
 
+      if (Context && Context->mailbox->partial && index_op_needs_all(op))
+        index_open_more(menu, true);
+
       /* special handling for the tag-prefix function */
       if ((op == OP_TAG_PREFIX) || (op == OP_TAG_PREFIX_COND))
       {
@@ -2394,6 +2516,7 @@ int mutt_index_menu(void)
         if (!check_acl(Context, MUTT_ACL_WRITE, _("Can't break thread")))
           break;
 
+        mutt_env_thaw(CUR_EMAIL->env);
         if ((C_Sort & SORT_MASK) != SORT_THREADS)
           mutt_error(_("Threading is not enabled"));
         else if (!STAILQ_EMPTY(&CUR_EMAIL->env->in_reply_to) ||
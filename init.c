@@ -52,10 +52,15 @@
 #include "context.h"
 #include "filter.h"
 #include "hcache/hcache.h"
+#ifdef HAVE_ZSTD
+#include "hcache/compress.h"
+#endif
 #include "keymap.h"
 #include "monitor.h"
 #include "mutt_curses.h"
+#include "mutt_header.h"
 #include "mutt_menu.h"
+#include "mutt_parse.h"
 #include "mutt_window.h"
 #include "mx.h"
 #include "myvar.h"
@@ -150,6 +155,8 @@ static void alternates_clean(void)
  */
 static void attachments_clean(void)
 {
+  mutt_attach_config_reset();
+
   if (!Context)
     return;
 
@@ -3548,6 +3555,7 @@ int mutt_label_complete(char *buf, size_t buflen, int numtabs)
     mutt_str_strfcpy(UserTyped, buf, sizeof(UserTyped));
     memset(Matches, 0, MatchesListsize);
     memset(Completed, 0, sizeof(Completed));
+    mutt_label_hash_rebuild(Context->mailbox);
     while ((entry = mutt_hash_walk(Context->mailbox->label_hash, &state)))
       candidate(UserTyped, entry->key.strkey, Completed, sizeof(Completed));
     matches_ensure_morespace(NumMatched);
@@ -3834,6 +3842,32 @@ int charset_validator(const struct ConfigSet *cs, const struct ConfigDef *cdef,
   return rc;
 }
 
+#ifdef HAVE_ZSTD
+/**
+ * hcache_compress_validator - Validate the "header_cache_compress_*" config variables - Implements ::cs_validator()
+ */
+int hcache_compress_validator(const struct ConfigSet *cs, const struct ConfigDef *cdef,
+                              intptr_t value, struct Buffer *err)
+{
+  if (DTYPE(cdef->type) == DT_NUMBER)
+  {
+    if ((value < 1) || (value > 22))
+    {
+      mutt_buffer_printf(err, _("Invalid value for option %s: %ld"), cdef->name, value);
+      return CSR_ERR_INVALID;
+    }
+    return CSR_SUCCESS;
+  }
+
+  const char *str = (const char *) value;
+  if (!str || (str[0] == '\0') || hcache_compress_is_valid_method(str))
+    return CSR_SUCCESS;
+
+  mutt_buffer_printf(err, _("Invalid value for option %s: %s"), cdef->name, str);
+  return CSR_ERR_INVALID;
+}
+#endif
+
 #ifdef USE_HCACHE
 /**
  * hcache_validator - Validate the "header_cache_backend" config variable - Implements ::cs_validator()
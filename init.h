@@ -27,6 +27,7 @@
 #ifdef _MAKEDOC
 #include "config.h"
 #include "doc/makedoc_defs.h"
+#include "quoted.h"
 #else
 #include <stddef.h>
 #include <stdbool.h>
@@ -71,6 +72,7 @@
 #include "progress.h"
 #include "protos.h"
 #include "query.h"
+#include "quoted.h"
 #include "recvattach.h"
 #include "recvcmd.h"
 #include "rfc1524.h"
@@ -119,6 +121,7 @@ enum MuttSetCommand
 bool C_IgnoreLinearWhiteSpace = false;
 
 int charset_validator  (const struct ConfigSet *cs, const struct ConfigDef *cdef, intptr_t value, struct Buffer *err);
+int hcache_compress_validator(const struct ConfigSet *cs, const struct ConfigDef *cdef, intptr_t value, struct Buffer *err);
 int hcache_validator   (const struct ConfigSet *cs, const struct ConfigDef *cdef, intptr_t value, struct Buffer *err);
 int multipart_validator(const struct ConfigSet *cs, const struct ConfigDef *cdef, intptr_t value, struct Buffer *err);
 int pager_validator    (const struct ConfigSet *cs, const struct ConfigDef *cdef, intptr_t value, struct Buffer *err);
@@ -780,6 +783,20 @@ struct ConfigDef MuttVars[] = {
   ** to find out whether an encrypted message is also signed.
   ** (Crypto only)
   */
+  { "crypt_spawn_helper", DT_BOOL, &C_CryptSpawnHelper, false },
+  /*
+  ** .pp
+  ** If \fIset\fP, the classic PGP and S/MIME backends start their commands
+  ** (see $$pgp_decrypt_command, $$smime_decrypt_command, etc.) from a small
+  ** helper process instead of forking NeoMutt itself.  The helper is started
+  ** before any mailbox is opened, so running a command stays cheap however
+  ** much memory NeoMutt is using.  This matters when many messages are
+  ** decrypted or verified in a row.  If the helper can't be used, the
+  ** commands are run directly.
+  ** .pp
+  ** Note that you need to set this option in .neomuttrc; it won't have any
+  ** effect when used interactively.
+  */
   { "crypt_timestamp", DT_BOOL, &C_CryptTimestamp, true },
   /*
   ** .pp
@@ -1392,6 +1409,25 @@ struct ConfigDef MuttVars[] = {
   ** cached folders.
   */
 #endif /* HAVE_QDBM */
+#ifdef HAVE_ZSTD
+  { "header_cache_compress_level", DT_NUMBER, &C_HeaderCacheCompressLevel, 3, 0, hcache_compress_validator },
+  /*
+  ** .pp
+  ** When NeoMutt is compiled with Zstandard support, this option sets the
+  ** level of compression used by $$header_cache_compress_method.  It ranges
+  ** from 1, the fastest, to 22, the smallest.
+  */
+  { "header_cache_compress_method", DT_STRING, &C_HeaderCacheCompressMethod, 0, 0, hcache_compress_validator },
+  /*
+  ** .pp
+  ** When NeoMutt is compiled with Zstandard support, setting this option to
+  ** "zstd" compresses each message in the header cache, whichever backend
+  ** is used.  A dictionary is trained from the first messages stored in each
+  ** cache, which makes the small entries compress much better.
+  ** .pp
+  ** Changing this option invalidates the existing header cache entries.
+  */
+#endif /* HAVE_ZSTD */
 #if defined(HAVE_GDBM) || defined(HAVE_BDB)
   { "header_cache_pagesize", DT_STRING, &C_HeaderCachePagesize, IP "16384" },
   /*
@@ -1975,6 +2011,18 @@ struct ConfigDef MuttVars[] = {
   ** When $$mail_check_stats is \fIset\fP, this variable configures
   ** how often (in seconds) NeoMutt will update message counts.
   */
+  { "mail_check_timeout", DT_NUMBER|DT_NOT_NEGATIVE, &C_MailCheckTimeout, 0 },
+  /*
+  ** .pp
+  ** Some mailboxes, e.g. notmuch queries, can take a long time to check for
+  ** new mail.  When this variable is non-zero, NeoMutt checks them in a
+  ** background process while it checks the other mailboxes.  Their counts
+  ** are updated as each check finishes.
+  ** .pp
+  ** This variable configures how long (in seconds) a background check may
+  ** take.  If it takes longer, it's abandoned and the mailboxes keep their
+  ** old counts.  A value of zero checks every mailbox in turn.
+  */
   { "mailcap_path", DT_SLIST|SLIST_SEP_COLON, &C_MailcapPath, IP "~/.mailcap:" PKGDATADIR "/mailcap:" SYSCONFDIR "/mailcap:/etc/mailcap:/usr/etc/mailcap:/usr/local/etc/mailcap" },
   /*
   ** .pp
@@ -2014,8 +2062,27 @@ struct ConfigDef MuttVars[] = {
   ** files when the header cache is in use.  This incurs one \fCstat(2)\fP per
   ** message every time the folder is opened (which can be very slow for NFS
   ** folders).
+  ** .pp
+  ** A snapshot of each directory's listing is kept in the header cache.  If
+  ** the directory hasn't changed since the last check, the per-message
+  ** \fCstat(2)\fP calls are skipped.
   */
 #endif
+  { "maildir_open_batch", DT_NUMBER|DT_NOT_NEGATIVE, &C_MaildirOpenBatch, 0 },
+  /*
+  ** .pp
+  ** When a Maildir mailbox with more than this many messages is opened from
+  ** the index, only the headers of the newest $$maildir_open_batch messages
+  ** are read before the index is shown.  The older messages are read in
+  ** batches while NeoMutt is waiting for a key.  Each batch is as large as
+  ** the messages read so far.
+  ** .pp
+  ** Until the mailbox has been read completely, any command other than
+  ** moving around the index, changing folder or quitting will first read
+  ** the rest of the mailbox.
+  ** .pp
+  ** A value of 0 disables this.
+  */
   { "maildir_trash", DT_BOOL, &C_MaildirTrash, false },
   /*
   ** .pp
@@ -2631,6 +2698,22 @@ struct ConfigDef MuttVars[] = {
   ** .pp
   ** See also: https://github.com/neomutt/neomutt/issues/1014
   */
+  { "pgp_decrypt_jobs", DT_NUMBER|DT_NOT_NEGATIVE, &C_PgpDecryptJobs, 4 },
+  /*
+  ** .pp
+  ** When many PGP/MIME encrypted messages are processed in one go, e.g.
+  ** C<decrypt-save>P of tagged messages, printing them, or a pattern
+  ** containing ~b or ~B with $$thorough_search set, NeoMutt runs up to this
+  ** many $$pgp_decrypt_command processes at the same time.  The messages are
+  ** still handled in order.
+  ** .pp
+  ** Nothing is run in parallel until one message has been decrypted, so you
+  ** will only be asked for your passphrase once.  Remote mailboxes, e.g. IMAP,
+  ** are always decrypted one message at a time.
+  ** .pp
+  ** Set this to 0 or 1 to disable parallel decryption.
+  ** (PGP only)
+  */
   { "pgp_decryption_okay", DT_REGEX, &C_PgpDecryptionOkay, 0 },
   /*
   ** .pp
@@ -3221,7 +3304,7 @@ struct ConfigDef MuttVars[] = {
   ** have no effect, and if it is set to \fIask-yes\fP or \fIask-no\fP, you are
   ** prompted for confirmation when you try to quit.
   */
-  { "quote_regex", DT_REGEX|R_PAGER, &C_QuoteRegex, IP "^([ \t]*[|>:}#])+" },
+  { "quote_regex", DT_REGEX|R_PAGER, &C_QuoteRegex, IP QUOTE_REGEX_DEFAULT },
   /*
   ** .pp
   ** A regular expression used in the internal pager to determine quoted
@@ -3833,7 +3916,7 @@ struct ConfigDef MuttVars[] = {
   ** \fIunset\fP, lines are simply wrapped at the screen edge. Also see the
   ** $$markers variable.
   */
-  { "smileys", DT_REGEX|R_PAGER, &C_Smileys, IP "(>From )|(:[-^]?[][)(><}{|/DP])" },
+  { "smileys", DT_REGEX|R_PAGER, &C_Smileys, IP SMILEYS_DEFAULT },
   /*
   ** .pp
   ** The \fIpager\fP uses this variable to catch some common false
@@ -26,16 +26,40 @@
  * @page mailbox Representation of a mailbox
  *
  * Representation of a mailbox
+ *
+ * ## Checking for new mail
+ *
+ * mutt_mailbox_check() visits every Mailbox in #AllMailboxes.  Most checks are
+ * cheap: a stat() of a local mailbox, or an IMAP STATUS command that is queued
+ * and read back with the next response.  Others, such as notmuch's count
+ * queries, can block for a long time, which would hold up all the other
+ * checks.
+ *
+ * If `$mail_check_timeout` is set, the notmuch Mailboxes are checked by a
+ * single worker process, see check_in_worker().  The worker runs alongside
+ * the rest of the checks, and sends back the counts of each Mailbox as it's
+ * done.  Each call to mutt_mailbox_check() merges the counts that have
+ * arrived, and doesn't start another worker while one is still running.
+ *
+ * A worker that takes longer than `$mail_check_timeout` seconds is killed,
+ * and the Mailboxes it hadn't reported keep their old counts.  Without
+ * `$mail_check_timeout`, every Mailbox is checked in turn.
  */
 
 #include "config.h"
 #include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <poll.h>
+#include <signal.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include <utime.h>
 #include "mutt/mutt.h"
 #include "config/lib.h"
@@ -76,12 +100,44 @@
 short C_MailCheck; ///< Config: Number of seconds before NeoMutt checks for new mail
 bool C_MailCheckStats;          ///< Config: Periodically check for new mail
 short C_MailCheckStatsInterval; ///< Config: How often to check for new mail
+short C_MailCheckTimeout; ///< Config: Seconds to wait for a slow mailbox check
 bool C_MaildirCheckCur; ///< Config: Check both 'new' and 'cur' directories for new mail
 
 static time_t MailboxTime = 0; /**< last time we started checking for mail */
 static time_t MailboxStatsTime = 0; /**< last time we check performed mail_check_stats */
 static short MailboxCount = 0;  /**< how many boxes with new mail */
 static short MailboxNotify = 0; /**< # of unnotified new boxes */
+static unsigned int MailboxGen = 0; ///< Last generation number given to a Mailbox
+
+/**
+ * struct CheckResult - Counts sent back by the check worker
+ */
+struct CheckResult
+{
+  unsigned int gen;             ///< Generation number of the Mailbox that was checked
+  bool counted;                 ///< Mailbox counts towards #MailboxCount
+  bool has_new;                 ///< Mailbox has new mail
+  int msg_count;                ///< Total number of messages
+  int msg_unread;               ///< Number of unread messages
+  int msg_flagged;              ///< Number of flagged messages
+  int msg_new;                  ///< Number of new messages
+  unsigned long stats_revision; ///< Database revision the counts were taken at
+  unsigned int stats_hash;      ///< Hash of the query the counts were taken with
+};
+
+/**
+ * struct CheckWorker - A process checking the slow Mailboxes
+ */
+struct CheckWorker
+{
+  pid_t pid;                 ///< Process id of the worker (0: not running)
+  int fd;                    ///< Read end of the pipe carrying the results
+  time_t started;            ///< When the worker was started
+  struct CheckResult result; ///< Result being read
+  size_t got;                ///< Number of bytes of result read so far
+};
+
+static struct CheckWorker CheckWorker = { 0 }; ///< Worker checking the slow Mailboxes
 
 struct MailboxList AllMailboxes = STAILQ_HEAD_INITIALIZER(AllMailboxes);
 
@@ -94,6 +150,7 @@ struct Mailbox *mailbox_new(void)
   struct Mailbox *m = mutt_mem_calloc(1, sizeof(struct Mailbox));
 
   m->pathbuf = mutt_buffer_new();
+  m->gen = ++MailboxGen;
 
   return m;
 }
@@ -124,11 +181,13 @@ void mailbox_free(struct Mailbox **ptr)
  * @param m_check     Mailbox to check
  * @param ctx_sb      stat() info for the current Mailbox
  * @param check_stats If true, also count the total, new and flagged messages
+ * @retval true The Mailbox counts towards #MailboxCount
  */
-static void mailbox_check(struct Mailbox *m_cur, struct Mailbox *m_check,
+static bool mailbox_check(struct Mailbox *m_cur, struct Mailbox *m_check,
                           struct stat *ctx_sb, bool check_stats)
 {
   struct stat sb = { 0 };
+  bool counted = false;
 
 #ifdef USE_SIDEBAR
   short orig_new = m_check->has_new;
@@ -162,7 +221,7 @@ static void mailbox_check(struct Mailbox *m_cur, struct Mailbox *m_check,
         m_check->newly_created = true;
         m_check->magic = MUTT_UNKNOWN;
         m_check->size = 0;
-        return;
+        return false;
       }
       break; // kept for consistency.
   }
@@ -183,7 +242,7 @@ static void mailbox_check(struct Mailbox *m_cur, struct Mailbox *m_check,
       case MUTT_MH:
       case MUTT_NOTMUCH:
         if (mx_mbox_check_stats(m_check, 0) == 0)
-          MailboxCount++;
+          counted = true;
         break;
       default:; /* do nothing */
     }
@@ -203,6 +262,240 @@ static void mailbox_check(struct Mailbox *m_cur, struct Mailbox *m_check,
     m_check->notified = false;
   else if (!m_check->notified)
     MailboxNotify++;
+
+  return counted;
+}
+
+/**
+ * check_in_worker - Should a Mailbox be checked by the worker process?
+ * @param m Mailbox
+ * @retval true Check the Mailbox in the background
+ *
+ * Only the checks that can block for a long time are worth a process.
+ */
+static bool check_in_worker(struct Mailbox *m)
+{
+  return (C_MailCheckTimeout > 0) && (m->magic == MUTT_NOTMUCH);
+}
+
+/**
+ * check_worker_main - Check the slow Mailboxes
+ * @param m_cur       Current Mailbox
+ * @param ctx_sb      stat() info for the current Mailbox
+ * @param check_stats If true, also count the total, new and flagged messages
+ * @param fd          Pipe to write the results to
+ *
+ * This runs in the worker process.  It mustn't touch the screen, so nothing is
+ * logged.
+ */
+static void check_worker_main(struct Mailbox *m_cur, struct stat *ctx_sb,
+                              bool check_stats, int fd)
+{
+  MuttLogger = log_disp_null;
+  signal(SIGINT, SIG_IGN);
+  signal(SIGPIPE, SIG_DFL);
+
+#ifdef USE_NOTMUCH
+  nm_count_batch_fork();
+#endif
+
+  struct MailboxNode *np = NULL;
+  STAILQ_FOREACH(np, &AllMailboxes, entries)
+  {
+    struct Mailbox *m = np->mailbox;
+    if (!check_in_worker(m))
+      continue;
+
+    struct CheckResult res = { 0 };
+    res.gen = m->gen;
+    res.counted = mailbox_check(m_cur, m, ctx_sb, check_stats);
+    res.has_new = m->has_new;
+    res.msg_count = m->msg_count;
+    res.msg_unread = m->msg_unread;
+    res.msg_flagged = m->msg_flagged;
+    res.msg_new = m->msg_new;
+    res.stats_revision = m->stats_revision;
+    res.stats_hash = m->stats_hash;
+
+    /* Smaller than PIPE_BUF, so written in one go */
+    if (write(fd, &res, sizeof(res)) != sizeof(res))
+      _exit(1);
+  }
+
+#ifdef USE_NOTMUCH
+  nm_count_batch_end();
+#endif
+  _exit(0);
+}
+
+/**
+ * check_worker_start - Start a worker to check the slow Mailboxes
+ * @param m_cur       Current Mailbox
+ * @param ctx_sb      stat() info for the current Mailbox
+ * @param check_stats If true, also count the total, new and flagged messages
+ * @retval true Worker started
+ */
+static bool check_worker_start(struct Mailbox *m_cur, struct stat *ctx_sb, bool check_stats)
+{
+  int fds[2];
+  if (pipe(fds) != 0)
+    return false;
+
+  pid_t pid = fork();
+  if (pid == 0)
+  {
+    close(fds[0]);
+    check_worker_main(m_cur, ctx_sb, check_stats, fds[1]);
+  }
+
+  close(fds[1]);
+  if (pid < 0)
+  {
+    close(fds[0]);
+    return false;
+  }
+
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+  struct CheckWorker *w = &CheckWorker;
+  memset(w, 0, sizeof(*w));
+  w->pid = pid;
+  w->fd = fds[0];
+  w->started = time(NULL);
+
+  mutt_debug(LL_DEBUG2, "started check worker %d\n", pid);
+  return true;
+}
+
+/**
+ * check_result_apply - Merge the counts from the worker into a Mailbox
+ * @param res Counts from the worker
+ */
+static void check_result_apply(struct CheckResult *res)
+{
+  /* The Mailbox may have gone while the worker was running */
+  struct Mailbox *m = NULL;
+  struct MailboxNode *np = NULL;
+  STAILQ_FOREACH(np, &AllMailboxes, entries)
+  {
+    if (np->mailbox->gen == res->gen)
+    {
+      m = np->mailbox;
+      break;
+    }
+  }
+  if (!m)
+    return;
+
+#ifdef USE_SIDEBAR
+  if ((m->has_new != res->has_new) || (m->msg_count != res->msg_count) ||
+      (m->msg_unread != res->msg_unread) || (m->msg_flagged != res->msg_flagged))
+  {
+    mutt_menu_set_current_redraw(REDRAW_SIDEBAR);
+  }
+#endif
+
+  /* The old counts were included when this round of checks started */
+  if (m->check_counted && (MailboxCount > 0))
+    MailboxCount--;
+  if (m->has_new && !m->notified && (MailboxNotify > 0))
+    MailboxNotify--;
+
+  m->has_new = res->has_new;
+  m->msg_count = res->msg_count;
+  m->msg_unread = res->msg_unread;
+  m->msg_flagged = res->msg_flagged;
+  m->msg_new = res->msg_new;
+  m->stats_revision = res->stats_revision;
+  m->stats_hash = res->stats_hash;
+  m->check_counted = res->counted;
+
+  if (m->check_counted)
+    MailboxCount++;
+
+  if (!m->has_new)
+    m->notified = false;
+  else if (!m->notified)
+    MailboxNotify++;
+}
+
+/**
+ * check_worker_read - Read the results the worker has sent
+ * @param w Worker
+ * @retval true The worker has finished
+ */
+static bool check_worker_read(struct CheckWorker *w)
+{
+  while (true)
+  {
+    ssize_t n = read(w->fd, (char *) &w->result + w->got, sizeof(w->result) - w->got);
+    if (n > 0)
+    {
+      w->got += n;
+      if (w->got == sizeof(w->result))
+      {
+        check_result_apply(&w->result);
+        w->got = 0;
+      }
+      continue;
+    }
+
+    if ((n < 0) && (errno == EINTR))
+      continue;
+
+    return (n == 0) || (errno != EAGAIN);
+  }
+}
+
+/**
+ * check_worker_stop - Reap the worker
+ * @param kill_it If true, kill the worker first
+ */
+static void check_worker_stop(bool kill_it)
+{
+  struct CheckWorker *w = &CheckWorker;
+
+  if (kill_it)
+  {
+    mutt_debug(LL_DEBUG1, "check worker %d timed out\n", w->pid);
+    kill(w->pid, SIGKILL);
+  }
+
+  close(w->fd);
+  while ((waitpid(w->pid, NULL, 0) < 0) && (errno == EINTR))
+    ; // do nothing
+
+  w->pid = 0;
+}
+
+/**
+ * check_worker_collect - Merge the results of the check worker
+ * @param block If true, wait for the worker to finish or time out
+ */
+static void check_worker_collect(bool block)
+{
+  struct CheckWorker *w = &CheckWorker;
+
+  while (w->pid != 0)
+  {
+    int left = w->started + C_MailCheckTimeout - time(NULL);
+    if (left < 0)
+      left = 0;
+
+    /* A zero timeout still picks up the results that have arrived */
+    struct pollfd pfd = { w->fd, POLLIN, 0 };
+    if ((poll(&pfd, 1, block ? (left * 1000) : 0) < 0) && (errno != EINTR))
+      break;
+
+    if ((pfd.revents != 0) && check_worker_read(w))
+      check_worker_stop(false);
+    else if (time(NULL) - w->started >= C_MailCheckTimeout)
+      check_worker_stop(true);
+
+    if (!block)
+      break;
+  }
 }
 
 /**
@@ -337,6 +630,10 @@ void mutt_mailbox_update(struct Mailbox *m)
  * - MUTT_MAILBOX_CHECK_FORCE_STATS  ignore MailboxTime and calculate statistics
  *
  * Check all AllMailboxes for new mail and total/new/flagged messages
+ *
+ * The slow Mailboxes are checked by a worker process, see check_in_worker().
+ * Their counts are merged as they arrive, on this and later calls.  A forced
+ * check waits for them.
  */
 int mutt_mailbox_check(struct Mailbox *m_cur, int force)
 {
@@ -356,6 +653,8 @@ int mutt_mailbox_check(struct Mailbox *m_cur, int force)
   if (STAILQ_EMPTY(&AllMailboxes))
     return 0;
 
+  check_worker_collect(false);
+
   t = time(NULL);
   if (!force && (t - MailboxTime < C_MailCheck))
     return MailboxCount;
@@ -382,13 +681,50 @@ int mutt_mailbox_check(struct Mailbox *m_cur, int force)
     contex_sb.st_ino = 0;
   }
 
+  /* One worker checks all the slow Mailboxes, unless the last one is still busy */
+  bool slow = false;
   struct MailboxNode *np = NULL;
   STAILQ_FOREACH(np, &AllMailboxes, entries)
   {
-    mailbox_check(m_cur, np->mailbox, &contex_sb,
-                  check_stats || (!np->mailbox->first_check_stats_done && C_MailCheckStats));
-    np->mailbox->first_check_stats_done = true;
+    if (check_in_worker(np->mailbox))
+    {
+      slow = true;
+      break;
+    }
   }
+  bool in_worker = slow && ((CheckWorker.pid != 0) ||
+                            check_worker_start(m_cur, &contex_sb, check_stats));
+
+#ifdef USE_NOTMUCH
+  nm_count_batch_begin();
+#endif
+
+  STAILQ_FOREACH(np, &AllMailboxes, entries)
+  {
+    struct Mailbox *m = np->mailbox;
+    bool stats = check_stats || (!m->first_check_stats_done && C_MailCheckStats);
+    m->first_check_stats_done = true;
+
+    if (in_worker && check_in_worker(m))
+    {
+      /* Until the new counts arrive, use the last ones */
+      if (m->check_counted)
+        MailboxCount++;
+      if (m->has_new && !m->notified)
+        MailboxNotify++;
+      continue;
+    }
+
+    if (mailbox_check(m_cur, m, &contex_sb, stats))
+      MailboxCount++;
+  }
+
+#ifdef USE_NOTMUCH
+  nm_count_batch_end();
+#endif
+
+  if (force)
+    check_worker_collect(true);
 
   return MailboxCount;
 }
@@ -532,6 +868,53 @@ void mutt_mailbox_next_buffer(struct Mailbox *m_cur, struct Buffer *s)
   mutt_buffer_reset(s);
 }
 
+/**
+ * mutt_mailbox_prefetch_next - Warm the caches for the next Mailbox with new mail
+ * @param m_cur Current Mailbox
+ *
+ * The next Mailbox after @a m_cur (in the order they were defined) that has
+ * new mail is the one most likely to be opened next.  Start reading it from
+ * disk, so that opening it doesn't have to wait.
+ *
+ * This is only done once for each pair of current and next Mailbox.
+ */
+void mutt_mailbox_prefetch_next(struct Mailbox *m_cur)
+{
+  /* These are only compared, never dereferenced */
+  static struct Mailbox *last_cur = NULL;
+  static struct Mailbox *last_next = NULL;
+
+  struct Mailbox *m_next = NULL;
+  bool found = !m_cur;
+  for (int pass = 0; !m_next && (pass < 2); pass++)
+  {
+    struct MailboxNode *np = NULL;
+    STAILQ_FOREACH(np, &AllMailboxes, entries)
+    {
+      if (np->mailbox->magic == MUTT_NOTMUCH) /* only match real mailboxes */
+        continue;
+      if (np->mailbox == m_cur)
+      {
+        found = true;
+        continue;
+      }
+      if ((found || (pass > 0)) && np->mailbox->has_new)
+      {
+        m_next = np->mailbox;
+        break;
+      }
+    }
+  }
+
+  if (!m_next || ((m_cur == last_cur) && (m_next == last_next)))
+    return;
+
+  last_cur = m_cur;
+  last_next = m_next;
+  mutt_debug(LL_DEBUG2, "prefetching %s\n", mutt_b2s(m_next->pathbuf));
+  mx_mbox_prefetch(m_next);
+}
+
 /**
  * mutt_mailbox_next - incoming folders completion routine
  * @param m_cur Current Mailbox
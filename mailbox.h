@@ -41,6 +41,7 @@ struct stat;
 extern short C_MailCheck;
 extern bool  C_MailCheckStats;
 extern short C_MailCheckStatsInterval;
+extern short C_MailCheckTimeout;
 extern bool  C_MaildirCheckCur;
 
 #define MB_NORMAL 0
@@ -129,13 +130,17 @@ struct Mailbox
   struct timespec mtime;
   struct timespec last_visited;       /**< time of last exit from this mailbox */
   struct timespec stats_last_checked; /**< mtime of mailbox the last time stats where checked. */
+  unsigned long stats_revision;       /**< database revision the stats were counted at (notmuch) */
+  unsigned int stats_hash;            /**< hash of the query the stats were counted with (0: none) */
 
   const struct MxOps *mx_ops;
 
   bool append                 : 1; /**< mailbox is opened in append mode */
   bool changed                : 1; /**< mailbox has been modified */
+  bool check_counted          : 1; /**< last background check counted the mailbox */
   bool dontwrite              : 1; /**< don't write the mailbox on close */
   bool first_check_stats_done : 1; /**< true when the check have been done at least on time */
+  bool partial                : 1; /**< not all the emails have been read, see mx_mbox_open_more() */
   bool peekonly               : 1; /**< just taking a glance, revert atime */
   bool quiet                  : 1; /**< inhibit status messages? */
   bool readonly               : 1; /**< don't allow changes to the mailbox */
@@ -152,6 +157,7 @@ struct Mailbox
 
   struct Account *account;
   int opened;              /**< number of times mailbox is opened */
+  unsigned int gen;        ///< Generation number, identifies the Mailbox to the check worker
 
   int flags; /**< e.g. #MB_NORMAL */
 
@@ -184,6 +190,7 @@ struct Mailbox *mutt_mailbox_find_desc   (const char *desc);
 bool            mutt_mailbox_list        (void);
 void            mutt_mailbox_next_buffer (struct Mailbox *m_cur, struct Buffer *s);
 void            mutt_mailbox_next        (struct Mailbox *m_cur, char *s, size_t slen);
+void            mutt_mailbox_prefetch_next(struct Mailbox *m_cur);
 bool            mutt_mailbox_notify      (struct Mailbox *m_cur);
 void            mutt_mailbox_set_notified(struct Mailbox *m);
 void            mutt_mailbox_size_add    (struct Mailbox *m, const struct Email *e);
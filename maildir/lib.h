@@ -48,6 +48,7 @@ struct Email;
 /* These Config Variables are only used in maildir/mh.c */
 extern bool  C_CheckNew;
 extern bool  C_MaildirHeaderCacheVerify;
+extern short C_MaildirOpenBatch;
 extern bool  C_MhPurge;
 extern char *C_MhSeqFlagged;
 extern char *C_MhSeqReplied;
@@ -61,6 +62,7 @@ void          maildir_gen_flags        (char *dest, size_t destlen, struct Email
 int           maildir_msg_open_new     (struct Mailbox *m, struct Message *msg, struct Email *e);
 FILE *        maildir_open_find_message(const char *folder, const char *msg, char **newname);
 void          maildir_parse_flags      (struct Email *e, const char *path);
+void          maildir_prefetch         (struct Mailbox *m);
 struct Email *maildir_parse_message    (enum MailboxType magic, const char *fname, bool is_old, struct Email *e);
 struct Email *maildir_parse_stream     (enum MailboxType magic, FILE *fp, const char *fname, bool is_old, struct Email *e);
 bool          maildir_update_flags     (struct Mailbox *m, struct Email *o, struct Email *n);
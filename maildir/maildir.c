@@ -53,6 +53,7 @@
 #include "monitor.h"
 #include "muttlib.h"
 #include "mx.h"
+#include "progress.h"
 
 // Flags for maildir_mbox_check()
 #define MMC_NO_DIRS 0        ///< No directories changed
@@ -282,6 +283,10 @@ cleanup:
  */
 static int maildir_mbox_open(struct Mailbox *m)
 {
+  if (m->partial && (C_MaildirOpenBatch > 0))
+    return maildir_read_dir_partial(m);
+  m->partial = false;
+
   /* maildir looks sort of like MH, except that there are two subdirectories
    * of the main folder path from which to read messages */
   if ((mh_read_dir(m, "new") == -1) || (mh_read_dir(m, "cur") == -1))
@@ -290,6 +295,44 @@ static int maildir_mbox_open(struct Mailbox *m)
   return 0;
 }
 
+/**
+ * maildir_mbox_open_more - Implements MxOps::mbox_open_more()
+ */
+static int maildir_mbox_open_more(struct Mailbox *m, bool all)
+{
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+  if (!mdata)
+    return 0;
+
+  /* The index re-sorts the whole mailbox after each batch.  Doubling the
+   * number of messages each time means only O(log n) sorts, and they cost
+   * about as much as two sorts of the full mailbox. */
+  int max = MAX(C_MaildirOpenBatch, m->msg_count);
+
+  char msgbuf[256];
+  struct Progress progress;
+  struct Progress *pp = NULL;
+  if (all)
+  {
+    max = INT_MAX;
+    if (!m->quiet)
+    {
+      int count = 0;
+      for (struct Maildir *md = mdata->pending; md; md = md->next)
+        count++;
+      snprintf(msgbuf, sizeof(msgbuf), _("Reading %s..."), mutt_b2s(m->pathbuf));
+      mutt_progress_init(&progress, msgbuf, MUTT_PROGRESS_MSG, C_ReadInc, count);
+      pp = &progress;
+    }
+  }
+
+  int num = 0;
+  while ((num == 0) && mdata->pending)
+    num = maildir_read_pending(m, max, pp);
+
+  return num;
+}
+
 /**
  * maildir_mbox_open_append - Implements MxOps::mbox_open_append()
  */
@@ -376,6 +419,10 @@ int maildir_mbox_check(struct Mailbox *m, int *index_hint)
   if (!C_CheckNew)
     return 0;
 
+  /* Wait until the mailbox has been read completely, see mx_mbox_open_more() */
+  if (mdata && mdata->pending)
+    return 0;
+
   struct Buffer *buf = mutt_buffer_pool_get();
   mutt_buffer_printf(buf, "%s/new", mutt_b2s(m->pathbuf));
   if (stat(mutt_b2s(buf), &st_new) == -1)
@@ -505,7 +552,7 @@ int maildir_mbox_check(struct Mailbox *m, int *index_hint)
     mutt_mailbox_changed(m, MBN_RESORT);
 
   /* do any delayed parsing we need to do. */
-  maildir_delayed_parsing(m, &md, NULL);
+  maildir_delayed_parsing(m, &md, NULL, NULL);
 
   /* Incorporate new messages */
   num_new = maildir_move_to_mailbox(m, &md);
@@ -647,22 +694,6 @@ static int maildir_msg_commit(struct Mailbox *m, struct Message *msg)
   return md_commit_message(m, msg, NULL);
 }
 
-/**
- * maildir_msg_save_hcache - Save message to the header cache - Implements MxOps::msg_save_hcache()
- */
-static int maildir_msg_save_hcache(struct Mailbox *m, struct Email *e)
-{
-  int rc = 0;
-#ifdef USE_HCACHE
-  header_cache_t *hc = mutt_hcache_open(C_HeaderCache, mutt_b2s(m->pathbuf), NULL);
-  char *key = e->path + 3;
-  int keylen = maildir_hcache_keylen(key);
-  rc = mutt_hcache_store(hc, key, keylen, e, 0);
-  mutt_hcache_close(hc);
-#endif
-  return rc;
-}
-
 /**
  * maildir_path_probe - Is this a Maildir mailbox? - Implements MxOps::path_probe()
  */
@@ -694,6 +725,7 @@ struct MxOps MxMaildirOps = {
   .ac_find          = maildir_ac_find,
   .ac_add           = maildir_ac_add,
   .mbox_open        = maildir_mbox_open,
+  .mbox_open_more   = maildir_mbox_open_more,
   .mbox_open_append = maildir_mbox_open_append,
   .mbox_check       = maildir_mbox_check,
   .mbox_check_stats = maildir_mbox_check_stats,
@@ -704,7 +736,7 @@ struct MxOps MxMaildirOps = {
   .msg_commit       = maildir_msg_commit,
   .msg_close        = mh_msg_close,
   .msg_padding_size = NULL,
-  .msg_save_hcache  = maildir_msg_save_hcache,
+  .msg_save_hcache  = mh_msg_save_hcache,
   .tags_edit        = NULL,
   .tags_commit      = NULL,
   .path_probe       = maildir_path_probe,
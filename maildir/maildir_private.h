@@ -29,6 +29,7 @@
 #include <sys/types.h>
 #include <time.h>
 #include "config/lib.h"
+#include "hcache/hcache.h"
 #include "mailbox.h"
 
 struct Account;
@@ -46,6 +47,23 @@ struct MaildirMboxData
 {
   struct timespec mtime_cur;
   mode_t mh_umask;
+  struct Maildir *pending; ///< Messages that haven't been read yet, see maildir_read_pending()
+  int hcache_pending;      ///< Emails waiting to be saved to the header cache, see maildir_hcache_flush()
+  header_cache_t *hcache;  ///< Header cache, held from mbox_open() until mbox_close()
+};
+
+/**
+ * struct MaildirDirStamp - Snapshot of a Maildir/MH directory listing
+ *
+ * This is stored in the header cache.  If the directory still matches it, the
+ * cached headers are trusted without a stat() of every message.
+ */
+struct MaildirDirStamp
+{
+  char subdir[4];           ///< Subdirectory, e.g. "cur", or "" for MH
+  unsigned int count;       ///< Number of entries in the directory
+  struct timespec mtime;    ///< Modification time of the directory
+  unsigned char digest[16]; ///< XOR of the md5sums of the entries' names
 };
 
 /**
@@ -90,7 +108,9 @@ int             mh_msg_save_hcache (struct Mailbox *m, struct Email *e);
 
 /* Maildir/MH shared functions */
 void                    maildir_canon_filename (struct Buffer *dest, const char *src);
-void                    maildir_delayed_parsing(struct Mailbox *m, struct Maildir **md, struct Progress *progress);
+void                    maildir_delayed_parsing(struct Mailbox *m, struct Maildir **md, struct Progress *progress, const struct MaildirDirStamp *stamp);
+void                    maildir_hcache_flush   (struct Mailbox *m);
+header_cache_t *        maildir_hcache_open    (struct Mailbox *m);
 size_t                  maildir_hcache_keylen  (const char *fn);
 struct MaildirMboxData *maildir_mdata_get      (struct Mailbox *m);
 int                     maildir_mh_open_message(struct Mailbox *m, struct Message *msg, int msgno, bool is_maildir);
@@ -98,6 +118,8 @@ int                     maildir_move_to_mailbox(struct Mailbox *m, struct Maildi
 int                     maildir_parse_dir      (struct Mailbox *m, struct Maildir ***last, const char *subdir, int *count, struct Progress *progress);
 void                    maildir_parse_flags    (struct Email *e, const char *path);
 struct Email *          maildir_parse_message  (enum MailboxType magic, const char *fname, bool is_old, struct Email *e);
+int                     maildir_read_dir_partial(struct Mailbox *m);
+int                     maildir_read_pending   (struct Mailbox *m, int max, struct Progress *progress);
 void                    maildir_update_tables  (struct Context *ctx, int *index_hint);
 int                     md_commit_message      (struct Mailbox *m, struct Message *msg, struct Email *e);
 int                     mh_commit_msg          (struct Mailbox *m, struct Message *msg, struct Email *e, bool updseq);
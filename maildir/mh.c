@@ -661,7 +661,7 @@ int mh_mbox_check(struct Mailbox *m, int *index_hint)
   last = &md;
 
   maildir_parse_dir(m, &last, NULL, &count, NULL);
-  maildir_delayed_parsing(m, &md, NULL);
+  maildir_delayed_parsing(m, &md, NULL, NULL);
 
   if (mh_read_sequences(&mhs, mutt_b2s(m->pathbuf)) < 0)
     return -1;
@@ -808,6 +808,7 @@ struct MxOps MxMhOps = {
   .ac_find          = maildir_ac_find,
   .ac_add           = maildir_ac_add,
   .mbox_open        = mh_mbox_open,
+  .mbox_open_more   = NULL,
   .mbox_open_append = mh_mbox_open_append,
   .mbox_check       = mh_mbox_check,
   .mbox_check_stats = mh_mbox_check_stats,
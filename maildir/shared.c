@@ -36,11 +36,14 @@
 #include <fcntl.h>
 #include <inttypes.h>
 #include <limits.h>
+#include <spawn.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/wait.h>
 #include <time.h>
 #include <unistd.h>
 #include <utime.h>
@@ -70,12 +73,49 @@ struct Account;
 /* These Config Variables are only used in maildir/mh.c */
 bool C_CheckNew; ///< Config: (maildir,mh) Check for new mail while the mailbox is open
 bool C_MaildirHeaderCacheVerify; ///< Config: (hcache) Check for maildir changes when opening mailbox
+short C_MaildirOpenBatch; ///< Config: Number of messages to read before showing a Maildir mailbox
 bool C_MhPurge;       ///< Config: Really delete files in MH mailboxes
 char *C_MhSeqFlagged; ///< Config: MH sequence for flagged message
 char *C_MhSeqReplied; ///< Config: MH sequence to tag replied messages
 char *C_MhSeqUnseen;  ///< Config: MH sequence for unseen messages
 
 #define INS_SORT_THRESHOLD 6
+#define HCACHE_FLUSH_BATCH 64 ///< Save the marked Emails to the header cache after this many
+
+/**
+ * maildir_free_entry - Free a Maildir object
+ * @param[out] md Maildir to free
+ */
+static void maildir_free_entry(struct Maildir **md)
+{
+  if (!md || !*md)
+    return;
+
+  FREE(&(*md)->canon_fname);
+  if ((*md)->email)
+    mutt_email_free(&(*md)->email);
+
+  FREE(md);
+}
+
+/**
+ * maildir_free_maildir - Free a Maildir list
+ * @param[out] md Maildir list to free
+ */
+static void maildir_free_maildir(struct Maildir **md)
+{
+  if (!md || !*md)
+    return;
+
+  struct Maildir *p = NULL, *q = NULL;
+
+  for (p = *md; p; p = q)
+  {
+    q = p->next;
+    maildir_free_entry(&p);
+  }
+  *md = NULL;
+}
 
 /**
  * maildir_mdata_free - Free data attached to the Mailbox
@@ -86,7 +126,11 @@ void maildir_mdata_free(void **ptr)
   if (!ptr || !*ptr)
     return;
 
-  // struct MaildirMboxData *mdata = *ptr;
+  struct MaildirMboxData *mdata = *ptr;
+  maildir_free_maildir(&mdata->pending);
+#ifdef USE_HCACHE
+  mutt_hcache_close(mdata->hcache);
+#endif
   FREE(ptr);
 }
 
@@ -112,6 +156,30 @@ struct MaildirMboxData *maildir_mdata_get(struct Mailbox *m)
   return m->mdata;
 }
 
+/**
+ * maildir_mdata_init - Set up the private data of a Mailbox being opened
+ * @param m Mailbox
+ * @retval ptr MaildirMboxData
+ *
+ * The Mailbox holds its header cache until mh_mbox_close().
+ */
+static struct MaildirMboxData *maildir_mdata_init(struct Mailbox *m)
+{
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+  if (!mdata)
+  {
+    mdata = maildir_mdata_new();
+    m->mdata = mdata;
+    m->free_mdata = maildir_mdata_free;
+  }
+
+#ifdef USE_HCACHE
+  if (!mdata->hcache)
+    mdata->hcache = mutt_hcache_open(C_HeaderCache, mutt_b2s(m->pathbuf), NULL);
+#endif
+  return mdata;
+}
+
 /**
  * mh_umask - Create a umask from the mailbox directory
  * @param  m   Mailbox
@@ -258,40 +326,6 @@ static void mh_sequences_add_one(struct Mailbox *m, int n, bool unseen, bool fla
   FREE(&tmpfname);
 }
 
-/**
- * maildir_free_entry - Free a Maildir object
- * @param[out] md Maildir to free
- */
-static void maildir_free_entry(struct Maildir **md)
-{
-  if (!md || !*md)
-    return;
-
-  FREE(&(*md)->canon_fname);
-  if ((*md)->email)
-    mutt_email_free(&(*md)->email);
-
-  FREE(md);
-}
-
-/**
- * maildir_free_maildir - Free a Maildir list
- * @param[out] md Maildir list to free
- */
-static void maildir_free_maildir(struct Maildir **md)
-{
-  if (!md || !*md)
-    return;
-
-  struct Maildir *p = NULL, *q = NULL;
-
-  for (p = *md; p; p = q)
-  {
-    q = p->next;
-    maildir_free_entry(&p);
-  }
-}
-
 /**
  * maildir_update_mtime - Update our record of the Maildir modification time
  * @param m Mailbox
@@ -464,6 +498,74 @@ int maildir_move_to_mailbox(struct Mailbox *m, struct Maildir **ptr)
   return num;
 }
 
+/**
+ * maildir_hcache_open - Open the header cache of a Mailbox
+ * @param m Mailbox
+ * @retval ptr  Header cache, to be closed with mutt_hcache_close()
+ * @retval NULL The cache can't be opened
+ *
+ * While the Mailbox is open, this takes another reference to the cache it
+ * holds, see maildir_mdata_init().
+ */
+header_cache_t *maildir_hcache_open(struct Mailbox *m)
+{
+#ifdef USE_HCACHE
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+  if (mdata && mdata->hcache)
+    return mutt_hcache_ref(mdata->hcache);
+
+  return mutt_hcache_open(C_HeaderCache, mutt_b2s(m->pathbuf), NULL);
+#else
+  return NULL;
+#endif
+}
+
+/**
+ * maildir_hcache_flush - Save the marked Emails to the header cache
+ * @param m Mailbox
+ *
+ * Save the Emails marked by mh_msg_save_hcache(), using the Mailbox's cache.
+ */
+void maildir_hcache_flush(struct Mailbox *m)
+{
+#ifdef USE_HCACHE
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+  if (!mdata || (mdata->hcache_pending == 0))
+    return;
+
+  mdata->hcache_pending = 0;
+
+  header_cache_t *hc = maildir_hcache_open(m);
+
+  for (int i = 0; i < m->msg_count; i++)
+  {
+    struct Email *e = m->emails[i];
+    if (!e || !e->hcache_pending)
+      continue;
+
+    e->hcache_pending = false;
+    if (!hc)
+      continue;
+
+    const char *key = NULL;
+    size_t keylen;
+    if (m->magic == MUTT_MH)
+    {
+      key = e->path;
+      keylen = strlen(key);
+    }
+    else
+    {
+      key = e->path + 3;
+      keylen = maildir_hcache_keylen(key);
+    }
+    mutt_hcache_store(hc, key, keylen, e, 0);
+  }
+
+  mutt_hcache_close(hc);
+#endif
+}
+
 /**
  * maildir_hcache_keylen - Calculate the length of the Maildir path
  * @param fn File name
@@ -679,13 +781,91 @@ static struct Maildir *skip_duplicates(struct Maildir *p, struct Maildir **last)
   return p;
 }
 
+#ifdef USE_HCACHE
+/**
+ * maildir_stamp_key - Generate the header cache key for a directory stamp
+ * @param stamp  Directory stamp
+ * @param buf    Buffer for the key
+ * @param buflen Length of buffer
+ * @retval num Length of the key
+ *
+ * The key starts with a '.', so it can't clash with any message's key.
+ */
+static size_t maildir_stamp_key(const struct MaildirDirStamp *stamp, char *buf, size_t buflen)
+{
+  return snprintf(buf, buflen, "/.dirstamp-%s", stamp->subdir);
+}
+
+/**
+ * maildir_stamp_matches - Does a cached directory stamp match the directory?
+ * @param a First stamp
+ * @param b Second stamp
+ * @retval true The stamps are identical
+ */
+static bool maildir_stamp_matches(const struct MaildirDirStamp *a,
+                                  const struct MaildirDirStamp *b)
+{
+  if (!a || !b)
+    return false;
+
+  return (mutt_str_strcmp(a->subdir, b->subdir) == 0) && (a->count == b->count) &&
+         (mutt_file_timespec_compare((struct timespec *) &a->mtime,
+                                     (struct timespec *) &b->mtime) == 0) &&
+         (memcmp(a->digest, b->digest, sizeof(a->digest)) == 0);
+}
+
+/**
+ * maildir_dir_stamp - Take a snapshot of a directory listing
+ * @param[in]  m      Mailbox
+ * @param[in]  md     Maildir list, as read by maildir_parse_dir()
+ * @param[in]  subdir Subdirectory, e.g. 'cur', or NULL for MH
+ * @param[out] stamp  Directory stamp
+ *
+ * The mtime must have been recorded by maildir_update_mtime() before the
+ * directory was read, so a message delivered during the scan will invalidate
+ * the stamp.  The digest doesn't depend on the order of the entries.
+ */
+static void maildir_dir_stamp(struct Mailbox *m, struct Maildir *md,
+                              const char *subdir, struct MaildirDirStamp *stamp)
+{
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+
+  memset(stamp, 0, sizeof(*stamp));
+  mutt_str_strfcpy(stamp->subdir, subdir, sizeof(stamp->subdir));
+
+  if ((m->magic == MUTT_MAILDIR) && (mutt_str_strcmp(subdir, "cur") == 0))
+    stamp->mtime = mdata->mtime_cur;
+  else
+    stamp->mtime = m->mtime;
+
+  unsigned char md5[16];
+  for (; md; md = md->next)
+  {
+    if (!md->email)
+      continue;
+
+    mutt_md5(md->email->path, md5);
+    for (size_t i = 0; i < sizeof(stamp->digest); i++)
+      stamp->digest[i] ^= md5[i];
+    stamp->count++;
+  }
+}
+#endif
+
 /**
  * maildir_delayed_parsing - This function does the second parsing pass
- * @param[in]  m  Mailbox
- * @param[out] md Maildir to parse
+ * @param[in]  m        Mailbox
+ * @param[out] md       Maildir to parse
  * @param[in]  progress Progress bar
+ * @param[in]  stamp    Snapshot of the directory listing (OPTIONAL)
+ *
+ * If $maildir_header_cache_verify is set, each cached message is checked with
+ * a stat().  If @a stamp matches the one stored in the header cache, then the
+ * directory hasn't changed since the cache was last verified and the checks
+ * are skipped.
  */
-void maildir_delayed_parsing(struct Mailbox *m, struct Maildir **md, struct Progress *progress)
+void maildir_delayed_parsing(struct Mailbox *m, struct Maildir **md,
+                             struct Progress *progress, const struct MaildirDirStamp *stamp)
 {
   struct Maildir *p = NULL, *last = NULL;
   char fn[PATH_MAX];
@@ -693,7 +873,27 @@ void maildir_delayed_parsing(struct Mailbox *m, struct Maildir **md, struct Prog
   bool sort = false;
 
 #ifdef USE_HCACHE
-  header_cache_t *hc = mutt_hcache_open(C_HeaderCache, mutt_b2s(m->pathbuf), NULL);
+  header_cache_t *hc = maildir_hcache_open(m);
+
+  int hits = 0, misses = 0, stale = 0;
+  bool verify = C_MaildirHeaderCacheVerify;
+  bool stamp_valid = false;
+  char stamp_key[32] = { 0 };
+  size_t stamp_keylen = 0;
+
+  if (hc && stamp && verify)
+  {
+    stamp_keylen = maildir_stamp_key(stamp, stamp_key, sizeof(stamp_key));
+    void *cached = mutt_hcache_fetch_raw(hc, stamp_key, stamp_keylen);
+    if (maildir_stamp_matches(cached, stamp))
+    {
+      mutt_debug(LL_DEBUG2, "maildir: %s/%s unchanged, skipping verification\n",
+                 mutt_b2s(m->pathbuf), stamp->subdir);
+      stamp_valid = true;
+      verify = false;
+    }
+    mutt_hcache_free(hc, &cached);
+  }
 #endif
 
   for (p = *md, count = 0; p; p = p->next, count++)
@@ -723,13 +923,6 @@ void maildir_delayed_parsing(struct Mailbox *m, struct Maildir **md, struct Prog
     snprintf(fn, sizeof(fn), "%s/%s", mutt_b2s(m->pathbuf), p->email->path);
 
 #ifdef USE_HCACHE
-    struct stat lastchanged = { 0 };
-    int ret = 0;
-    if (C_MaildirHeaderCacheVerify)
-    {
-      ret = stat(fn, &lastchanged);
-    }
-
     const char *key = NULL;
     size_t keylen = 0;
     if (m->magic == MUTT_MH)
@@ -745,8 +938,16 @@ void maildir_delayed_parsing(struct Mailbox *m, struct Maildir **md, struct Prog
     void *data = mutt_hcache_fetch(hc, key, keylen);
     struct timeval *when = data;
 
+    struct stat lastchanged = { 0 };
+    int ret = 0;
+    if (data && verify)
+    {
+      ret = stat(fn, &lastchanged);
+    }
+
     if (data && !ret && (lastchanged.st_mtime <= when->tv_sec))
     {
+      hits++;
       struct Email *e = mutt_hcache_restore((unsigned char *) data);
       e->old = p->email->old;
       e->path = mutt_str_strdup(p->email->path);
@@ -757,6 +958,10 @@ void maildir_delayed_parsing(struct Mailbox *m, struct Maildir **md, struct Prog
     }
     else
     {
+      if (data)
+        stale++;
+      else
+        misses++;
 #endif
 
       if (maildir_parse_message(m->magic, fn, p->email->old, p->email))
@@ -785,12 +990,46 @@ void maildir_delayed_parsing(struct Mailbox *m, struct Maildir **md, struct Prog
     last = p;
   }
 #ifdef USE_HCACHE
+  /* Every cached message has now been verified, or replaced */
+  if (hc && stamp && !stamp_valid && C_MaildirHeaderCacheVerify && (SigInt != 1))
+  {
+    mutt_hcache_store_raw(hc, stamp_key, stamp_keylen, (void *) stamp, sizeof(*stamp));
+  }
+
+  if (hc)
+  {
+    mutt_debug(LL_DEBUG1, "maildir: hcache %s%s%s: %d hits, %d misses, %d stale%s\n",
+               mutt_b2s(m->pathbuf), stamp ? "/" : "", stamp ? stamp->subdir : "",
+               hits, misses, stale, stamp_valid ? " (verification skipped)" : "");
+  }
   mutt_hcache_close(hc);
 #endif
 
   mh_sort_natural(m, md);
 }
 
+/**
+ * maildir_parse_scanned - Read the headers of the messages in a subdirectory
+ * @param m        Mailbox
+ * @param md       Messages found by maildir_parse_dir()
+ * @param subdir   Subdirectory they were found in, NULL for MH
+ * @param progress Progress bar
+ */
+static void maildir_parse_scanned(struct Mailbox *m, struct Maildir **md,
+                                  const char *subdir, struct Progress *progress)
+{
+  struct MaildirDirStamp *stamp = NULL;
+#ifdef USE_HCACHE
+  struct MaildirDirStamp ds;
+  if (C_MaildirHeaderCacheVerify)
+  {
+    maildir_dir_stamp(m, *md, subdir, &ds);
+    stamp = &ds;
+  }
+#endif
+  maildir_delayed_parsing(m, md, progress, stamp);
+}
+
 /**
  * mh_read_dir - Read a MH/maildir style mailbox
  * @param m      Mailbox
@@ -816,13 +1055,7 @@ int mh_read_dir(struct Mailbox *m, const char *subdir)
     mutt_progress_init(&progress, msgbuf, MUTT_PROGRESS_MSG, C_ReadInc, 0);
   }
 
-  struct MaildirMboxData *mdata = maildir_mdata_get(m);
-  if (!mdata)
-  {
-    mdata = maildir_mdata_new();
-    m->mdata = mdata;
-    m->free_mdata = maildir_mdata_free;
-  }
+  struct MaildirMboxData *mdata = maildir_mdata_init(m);
 
   maildir_update_mtime(m);
 
@@ -837,7 +1070,7 @@ int mh_read_dir(struct Mailbox *m, const char *subdir)
     snprintf(msgbuf, sizeof(msgbuf), _("Reading %s..."), mutt_b2s(m->pathbuf));
     mutt_progress_init(&progress, msgbuf, MUTT_PROGRESS_MSG, C_ReadInc, count);
   }
-  maildir_delayed_parsing(m, &md, &progress);
+  maildir_parse_scanned(m, &md, subdir, &progress);
 
   if (m->magic == MUTT_MH)
   {
@@ -858,6 +1091,137 @@ int mh_read_dir(struct Mailbox *m, const char *subdir)
   return 0;
 }
 
+/**
+ * md_cmp_newest - Compare two Maildirs by delivery time, newest first
+ * @param a First  Maildir
+ * @param b Second Maildir
+ * @retval -1 a precedes b
+ * @retval  0 a and b are identical
+ * @retval  1 b precedes a
+ *
+ * Maildir filenames begin with the time of delivery, e.g. "1570000000.M1P2.host"
+ */
+static int md_cmp_newest(struct Maildir *a, struct Maildir *b)
+{
+  const char *na = strrchr(a->email->path, '/');
+  const char *nb = strrchr(b->email->path, '/');
+  na = na ? na + 1 : a->email->path;
+  nb = nb ? nb + 1 : b->email->path;
+
+  unsigned long ta = strtoul(na, NULL, 10);
+  unsigned long tb = strtoul(nb, NULL, 10);
+  if (ta != tb)
+    return (ta < tb) ? 1 : -1;
+
+  return strcmp(nb, na);
+}
+
+/**
+ * maildir_read_pending - Read the headers of some of the pending messages
+ * @param m        Mailbox
+ * @param max      Maximum number of messages to read
+ * @param progress Progress bar (OPTIONAL)
+ * @retval num Number of Emails added to the Mailbox
+ *
+ * Mailbox::partial is cleared once there are no more pending messages.
+ */
+int maildir_read_pending(struct Mailbox *m, int max, struct Progress *progress)
+{
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+  if (!mdata || !mdata->pending)
+  {
+    m->partial = false;
+    return 0;
+  }
+
+  struct Maildir *md = mdata->pending;
+  struct Maildir *p = md;
+  for (int i = 1; p->next && (i < max); i++)
+    p = p->next;
+  mdata->pending = p->next;
+  p->next = NULL;
+
+  maildir_delayed_parsing(m, &md, progress, NULL);
+  int num = maildir_move_to_mailbox(m, &md);
+
+  if (!mdata->pending)
+    m->partial = false;
+
+  return num;
+}
+
+/**
+ * maildir_read_dir_partial - Read the newest messages of a Maildir mailbox
+ * @param m Mailbox
+ * @retval  0 Success
+ * @retval -1 Failure
+ *
+ * Both subdirectories are scanned, but only the headers of the newest
+ * $maildir_open_batch messages are read.  The rest are kept, newest first,
+ * for maildir_read_pending().
+ */
+int maildir_read_dir_partial(struct Mailbox *m)
+{
+  if (!m)
+    return -1;
+
+  struct Maildir *md = NULL;
+  struct Maildir **last = &md;
+  char msgbuf[256];
+  struct Progress progress;
+
+  if (!m->quiet)
+  {
+    snprintf(msgbuf, sizeof(msgbuf), _("Scanning %s..."), mutt_b2s(m->pathbuf));
+    mutt_progress_init(&progress, msgbuf, MUTT_PROGRESS_MSG, C_ReadInc, 0);
+  }
+
+  struct MaildirMboxData *mdata = maildir_mdata_init(m);
+  maildir_free_maildir(&mdata->pending);
+
+  maildir_update_mtime(m);
+
+  int count = 0;
+  int rc = maildir_parse_dir(m, &last, "new", &count, &progress);
+  struct Maildir **new_end = last; /* where the messages from "cur" begin */
+  if ((rc < 0) || (maildir_parse_dir(m, &last, "cur", &count, &progress) < 0))
+  {
+    maildir_free_maildir(&md);
+    return -1;
+  }
+
+  if (!m->quiet)
+  {
+    snprintf(msgbuf, sizeof(msgbuf), _("Reading %s..."), mutt_b2s(m->pathbuf));
+    mutt_progress_init(&progress, msgbuf, MUTT_PROGRESS_MSG, C_ReadInc,
+                       MIN(count, C_MaildirOpenBatch));
+  }
+
+  /* A small mailbox is read all at once, like mh_read_dir() does */
+  if (count <= C_MaildirOpenBatch)
+  {
+    struct Maildir *md_cur = *new_end;
+    *new_end = NULL;
+    m->partial = false;
+
+    maildir_parse_scanned(m, &md, "new", &progress);
+    maildir_move_to_mailbox(m, &md);
+    maildir_parse_scanned(m, &md_cur, "cur", &progress);
+    maildir_move_to_mailbox(m, &md_cur);
+  }
+  else
+  {
+    mdata->pending = maildir_sort(md, count, md_cmp_newest);
+    m->partial = true;
+    maildir_read_pending(m, C_MaildirOpenBatch, &progress);
+  }
+
+  if (!mdata->mh_umask)
+    mdata->mh_umask = mh_umask(m);
+
+  return 0;
+}
+
 /**
  * maildir_mh_open_message - Open a Maildir or MH message
  * @param m          Mailbox
@@ -1650,6 +2014,60 @@ int mh_check_empty(const char *path)
   return rc;
 }
 
+/**
+ * maildir_prefetch - Warm the caches for a Maildir/MH mailbox
+ * @param m Mailbox
+ *
+ * Ask for the header cache to be read in.  For Maildir, the files of any new
+ * mail, which won't be in the cache yet, are read in too.  Listing and
+ * reading them can block on a slow disk, so that's done by a background shell
+ * job.  The page cache it fills is shared with NeoMutt.
+ *
+ * The job is started with posix_spawn(), so NeoMutt's memory isn't copied,
+ * and it doesn't keep NeoMutt's files, e.g. a locked header cache, open.
+ */
+void maildir_prefetch(struct Mailbox *m)
+{
+  if (!m)
+    return;
+
+#ifdef USE_HCACHE
+  mutt_hcache_prefetch(C_HeaderCache, mutt_b2s(m->pathbuf), NULL);
+#endif
+
+  if (m->magic != MUTT_MAILDIR)
+    return;
+
+  /* Don't flood the disk for a huge backlog */
+  static const char *job = "cd \"$1/new\" && ls -f | head -n 1000 | while read -r f; do "
+                           "case \"$f\" in .*) ;; *) cat -- \"$f\" ;; esac; done &";
+  char *argv[] = { "sh", "-c", (char *) job, "sh", (char *) mutt_b2s(m->pathbuf), NULL };
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  for (int fd = 0; fd < 3; fd++)
+    posix_spawn_file_actions_addopen(&actions, fd, "/dev/null", fd ? O_WRONLY : O_RDONLY, 0);
+#ifdef HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP
+  posix_spawn_file_actions_addclosefrom_np(&actions, 3);
+#endif
+
+  /* Keep the job away from the terminal's signals */
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+  posix_spawnattr_setpgroup(&attr, 0);
+
+  pid_t pid = 0;
+  if (posix_spawn(&pid, EXEC_SHELL, &actions, &attr, argv, mutt_envlist_getlist()) == 0)
+  {
+    /* The shell exits as soon as the job is running */
+    waitpid(pid, NULL, 0);
+  }
+
+  posix_spawnattr_destroy(&attr);
+  posix_spawn_file_actions_destroy(&actions);
+}
+
 /**
  * maildir_ac_find - Find an Account that matches a Mailbox path
  */
@@ -1733,18 +2151,27 @@ int mh_mbox_sync(struct Mailbox *m, int *index_hint)
   char msgbuf[PATH_MAX + 64];
   struct Progress progress;
 
+#ifdef USE_HCACHE
+  /* Open the cache first, so the check below shares it */
+  if ((m->magic == MUTT_MAILDIR) || (m->magic == MUTT_MH))
+  {
+    hc = maildir_hcache_open(m);
+    maildir_hcache_flush(m);
+  }
+#endif
+
   if (m->magic == MUTT_MH)
     i = mh_mbox_check(m, index_hint);
   else
     i = maildir_mbox_check(m, index_hint);
 
   if (i != 0)
-    return i;
-
+  {
 #ifdef USE_HCACHE
-  if ((m->magic == MUTT_MAILDIR) || (m->magic == MUTT_MH))
-    hc = mutt_hcache_open(C_HeaderCache, mutt_b2s(m->pathbuf), NULL);
+    mutt_hcache_close(hc);
 #endif
+    return i;
+  }
 
   if (!m->quiet)
   {
@@ -1800,6 +2227,18 @@ err:
  */
 int mh_mbox_close(struct Mailbox *m)
 {
+  maildir_hcache_flush(m);
+
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+  if (mdata)
+  {
+    maildir_free_maildir(&mdata->pending);
+#ifdef USE_HCACHE
+    mutt_hcache_close(mdata->hcache);
+    mdata->hcache = NULL;
+#endif
+  }
+
   return 0;
 }
 
@@ -1815,14 +2254,25 @@ int mh_msg_close(struct Mailbox *m, struct Message *msg)
 
 /**
  * mh_msg_save_hcache - Save message to the header cache - Implements MxOps::msg_save_hcache()
+ *
+ * The Email is only marked.  The marked Emails are saved together, by
+ * maildir_hcache_flush(), so the cache is opened once for the lot.
  */
 int mh_msg_save_hcache(struct Mailbox *m, struct Email *e)
 {
-  int rc = 0;
 #ifdef USE_HCACHE
-  header_cache_t *hc = mutt_hcache_open(C_HeaderCache, mutt_b2s(m->pathbuf), NULL);
-  rc = mutt_hcache_store(hc, e->path, strlen(e->path), e, 0);
-  mutt_hcache_close(hc);
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+  if (!mdata || !e)
+    return -1;
+
+  if (!e->hcache_pending)
+  {
+    e->hcache_pending = true;
+    mdata->hcache_pending++;
+  }
+
+  if (mdata->hcache_pending >= HCACHE_FLUSH_BATCH)
+    maildir_hcache_flush(m);
 #endif
-  return rc;
+  return 0;
 }
@@ -51,10 +51,12 @@
 #include "mutt.h"
 #include "account.h"
 #include "alias.h"
+#include "batch.h"
 #include "browser.h"
 #include "color.h"
 #include "context.h"
 #include "curs_lib.h"
+#include "filter.h"
 #include "globals.h"
 #include "hook.h"
 #include "index.h"
@@ -72,6 +74,7 @@
 #include "neomutt.h"
 #include "options.h"
 #include "protos.h"
+#include "rfc1524.h"
 #include "send.h"
 #include "sendlib.h"
 #include "terminal.h"
@@ -227,6 +230,7 @@ static void usage(void)
          "  neomutt [-nRy] [-e <command>] [-F <config>] [-f <mailbox>] [-m <type>]\n"
          "  neomutt [-n] [-e <command>] [-F <config>] -A <alias>\n"
          "  neomutt [-n] [-e <command>] [-F <config>] -B\n"
+         "  neomutt [-n] [-e <command>] [-F <config>] [-R] [-f <mailbox>] -X <command>\n"
          "  neomutt [-n] [-e <command>] [-F <config>] -D [-S]\n"
          "  neomutt [-n] [-e <command>] [-F <config>] -d <level> -l <file>\n"
          "  neomutt [-n] [-e <command>] [-F <config>] -G\n"
@@ -271,6 +275,8 @@ static void usage(void)
          "  -s <subject>  Specify a subject (must be enclosed in quotes if it has spaces)\n"
          "  -v            Print the NeoMutt version and compile-time definitions and exit\n"
          "  -vv           Print the NeoMutt license and copyright information and exit\n"
+         "  -X <command>  Apply a command to the mailbox (-f) in batch mode, e.g.\n"
+         "                'delete ~d>1y' or 'save =archive ~r>30d'\n"
          "  -x            Simulate the mailx(1) send mode\n"
          "  -y            Start NeoMutt with a listing of all defined mailboxes\n"
          "  -Z            Open the first mailbox with new message or exit immediately with\n"
@@ -421,6 +427,7 @@ int main(int argc, char *argv[], char *envp[])
   struct ListHead alias_queries = STAILQ_HEAD_INITIALIZER(alias_queries);
   struct ListHead cc_list = STAILQ_HEAD_INITIALIZER(cc_list);
   struct ListHead bcc_list = STAILQ_HEAD_INITIALIZER(bcc_list);
+  struct ListHead batch_cmds = STAILQ_HEAD_INITIALIZER(batch_cmds);
   SendFlags sendflags = SEND_NO_FLAGS;
   CliFlags flags = MUTT_CLI_NO_FLAGS;
   int version = 0;
@@ -479,7 +486,7 @@ int main(int argc, char *argv[], char *envp[])
     }
 
     /* USE_NNTP 'g:G' */
-    i = getopt(argc, argv, "+A:a:Bb:F:f:c:Dd:l:Ee:g:GH:i:hm:npQ:RSs:TvxyzZ");
+    i = getopt(argc, argv, "+A:a:Bb:F:f:c:Dd:l:Ee:g:GH:i:hm:npQ:RSs:TvX:xyzZ");
     if (i != EOF)
     {
       switch (i)
@@ -562,6 +569,10 @@ int main(int argc, char *argv[], char *envp[])
         case 'v':
           version++;
           break;
+        case 'X':
+          mutt_list_insert_tail(&batch_cmds, mutt_str_strdup(optarg));
+          batch_mode = true;
+          break;
         case 'x': /* mailx compatible send mode */
           sendflags |= SEND_MAILX;
           break;
@@ -822,7 +833,21 @@ int main(int argc, char *argv[], char *envp[])
 
   if (batch_mode)
   {
-    goto main_ok; // TEST22: neomutt -B
+    if (STAILQ_EMPTY(&batch_cmds))
+      goto main_ok; // TEST22: neomutt -B
+
+    if ((mutt_buffer_len(folder) == 0) && C_Spoolfile)
+      mutt_buffer_strcpy(folder, C_Spoolfile);
+    if (mutt_buffer_len(folder) == 0)
+    {
+      mutt_error(_("No mailbox specified"));
+      goto main_curses; // TEST45: neomutt -n -F /dev/null -X sync
+    }
+    mutt_buffer_expand_path(folder);
+
+    if (mutt_batch_run(mutt_b2s(folder), &batch_cmds, (flags & MUTT_CLI_RO) || C_ReadOnly) != 0)
+      goto main_curses; // TEST46: neomutt -f mbox -X 'delete ~q'
+    goto main_ok; // TEST47: neomutt -f mbox -X 'delete ~d>1y'
   }
 
   notify_observer_add(Config->notify, NT_CONFIG, 0, mutt_hist_observer, 0);
@@ -1216,7 +1241,7 @@ int main(int argc, char *argv[], char *envp[])
 
     repeat_error = true;
     struct Mailbox *m = mx_path_resolve(mutt_b2s(folder));
-    Context = mx_mbox_open(m, ((flags & MUTT_CLI_RO) || C_ReadOnly) ? MUTT_READONLY : 0);
+    Context = mx_mbox_open(m, (((flags & MUTT_CLI_RO) || C_ReadOnly) ? MUTT_READONLY : 0) | MUTT_PARTIAL);
     if (!Context)
     {
       mailbox_free(&m);
@@ -1257,11 +1282,14 @@ main_curses:
 main_exit:
   mutt_buffer_free(&folder);
   mutt_list_free(&queries);
+  mutt_list_free(&batch_cmds);
   crypto_module_free();
+  mutt_filter_helper_stop();
   mutt_window_free();
   mutt_buffer_pool_free();
   mutt_envlist_free();
   mutt_browser_cleanup();
+  rfc1524_cache_free();
   mutt_free_opts();
   mutt_free_keys();
   cs_free(&Config);
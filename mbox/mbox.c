@@ -1729,6 +1729,50 @@ static int mmdf_msg_padding_size(struct Mailbox *m)
   return 10;
 }
 
+/**
+ * mbox_count_messages - Count the messages in a mbox or mmdf file
+ * @param m  Mailbox
+ * @param sb stat() info of the file, to restore its timestamps
+ * @retval num Number of messages
+ * @retval -1  Error
+ *
+ * Only the message separators are looked at, the headers aren't parsed.
+ */
+static int mbox_count_messages(struct Mailbox *m, struct stat *sb)
+{
+  FILE *fp = fopen(mutt_b2s(m->pathbuf), "r");
+  if (!fp)
+    return -1;
+
+  char buf[8192];
+  int count = 0;
+  bool bol = true;
+
+  while (fgets(buf, sizeof(buf), fp))
+  {
+    if (bol)
+    {
+      if (m->magic == MUTT_MMDF)
+      {
+        if (mutt_str_strcmp(buf, MMDF_SEP) == 0)
+          count++;
+      }
+      else if (is_from(buf, NULL, 0, NULL))
+        count++;
+    }
+
+    /* A line longer than the buffer is read in several pieces */
+    size_t len = strlen(buf);
+    bol = (len > 0) && (buf[len - 1] == '\n');
+  }
+
+  mutt_file_fclose(&fp);
+  mbox_reset_atime(m, sb);
+
+  /* MMDF messages begin and end with a separator */
+  return (m->magic == MUTT_MMDF) ? (count / 2) : count;
+}
+
 /**
  * mbox_mbox_check_stats - Implements MxOps::mbox_check_stats()
  */
@@ -1768,7 +1812,16 @@ static int mbox_mbox_check_stats(struct Mailbox *m, int flags)
   if (m->newly_created && ((sb.st_ctime != sb.st_mtime) || (sb.st_ctime != sb.st_atime)))
     m->newly_created = false;
 
-  if (mutt_file_stat_timespec_compare(&sb, MUTT_STAT_MTIME, &m->stats_last_checked) > 0)
+  if ((flags & MUTT_MAILBOX_CHECK_COUNT) &&
+      (mutt_file_stat_timespec_compare(&sb, MUTT_STAT_MTIME, &m->stats_last_checked) > 0))
+  {
+    int count = mbox_count_messages(m, &sb);
+    if (count < 0)
+      return -1;
+    m->msg_count = count;
+    mutt_file_get_stat_timespec(&m->stats_last_checked, &sb, MUTT_STAT_MTIME);
+  }
+  else if (mutt_file_stat_timespec_compare(&sb, MUTT_STAT_MTIME, &m->stats_last_checked) > 0)
   {
     struct Context *ctx = mx_mbox_open(m, MUTT_QUIET | MUTT_NOSORT | MUTT_PEEK);
     if (ctx)
@@ -1794,6 +1847,7 @@ struct MxOps MxMboxOps = {
   .ac_find          = mbox_ac_find,
   .ac_add           = mbox_ac_add,
   .mbox_open        = mbox_mbox_open,
+  .mbox_open_more   = NULL,
   .mbox_open_append = mbox_mbox_open_append,
   .mbox_check       = mbox_mbox_check,
   .mbox_check_stats = mbox_mbox_check_stats,
@@ -1822,6 +1876,7 @@ struct MxOps MxMmdfOps = {
   .ac_find          = mbox_ac_find,
   .ac_add           = mbox_ac_add,
   .mbox_open        = mbox_mbox_open,
+  .mbox_open_more   = NULL,
   .mbox_open_append = mbox_mbox_open_append,
   .mbox_check       = mbox_mbox_check,
   .mbox_check_stats = mbox_mbox_check_stats,
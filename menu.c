@@ -1335,6 +1335,29 @@ int menu_redraw(struct Menu *menu)
   return OP_NULL;
 }
 
+/**
+ * menu_redraw_defer - Put off redrawing a Menu while a macro is running
+ * @param menu Menu to redraw
+ * @retval true  Redraw has been put off
+ * @retval false Menu should be redrawn now
+ *
+ * Nobody sees the screen until the macro has finished, so just keep the
+ * Menu's position up to date and ask for one full redraw at the end.
+ */
+bool menu_redraw_defer(struct Menu *menu)
+{
+  if (!mutt_macro_pending())
+    return false;
+
+  if (!menu->dialog && (menu->current < menu->max))
+    menu_check_recenter(menu);
+
+  if (menu->redraw != REDRAW_NO_FLAGS)
+    menu->redraw = REDRAW_FULL;
+
+  return true;
+}
+
 /**
  * mutt_menu_loop - Menu event loop
  * @param menu Current Menu
@@ -1368,7 +1391,7 @@ int mutt_menu_loop(struct Menu *menu)
 
     mutt_curs_set(0);
 
-    if (menu_redraw(menu) == OP_REDRAW)
+    if (!menu_redraw_defer(menu) && (menu_redraw(menu) == OP_REDRAW))
       return OP_REDRAW;
 
     /* give visual indication that the next command is a tag- command */
@@ -1407,6 +1407,32 @@ int mutt_file_check_empty(const char *path)
   return st.st_size == 0;
 }
 
+/**
+ * mutt_file_willneed - Ask the kernel to read a file in the background
+ * @param path Path to the file
+ * @retval  0 Success
+ * @retval -1 Error
+ *
+ * This doesn't wait for the data; it just means that a later read is less
+ * likely to have to.
+ */
+int mutt_file_willneed(const char *path)
+{
+  if (!path)
+    return -1;
+
+  int fd = open(path, O_RDONLY | O_NONBLOCK);
+  if (fd < 0)
+    return -1;
+
+  int rc = 0;
+#ifdef HAVE_POSIX_FADVISE
+  rc = posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+  close(fd);
+  return (rc == 0) ? 0 : -1;
+}
+
 /**
  * mutt_buffer_file_expand_fmt_quote - Replace `%s` in a string with a filename
  * @param dest    Buffer for the result
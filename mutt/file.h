@@ -121,6 +121,7 @@ void        mutt_file_touch_atime(int fd);
 void        mutt_file_unlink(const char *s);
 void        mutt_file_unlink_empty(const char *path);
 int         mutt_file_unlock(int fd);
+int         mutt_file_willneed(const char *path);
 
 void        mutt_buffer_quote_filename(struct Buffer *buf, const char *filename, bool add_outer);
 void        mutt_buffer_file_expand_fmt_quote(struct Buffer *dest, const char *fmt, const char *src);
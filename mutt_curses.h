@@ -189,6 +189,7 @@ struct ColorLine
   int pair;
   STAILQ_ENTRY(ColorLine) entries;
 
+  regmatch_t next_match;  ///< used by the pager for body patterns, the next match in the current line
   bool stop_matching : 1; ///< used by the pager for body patterns, to prevent the color from being retried once it fails
 };
 STAILQ_HEAD(ColorLineHead, ColorLine);
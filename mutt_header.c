@@ -103,6 +103,7 @@ static bool label_message(struct Mailbox *m, struct Email *e, char *new)
 {
   if (!e)
     return false;
+  mutt_env_thaw(e->env);
   if (mutt_str_strcmp(e->env->x_label, new) == 0)
     return false;
 
@@ -135,6 +136,7 @@ int mutt_label_message(struct Mailbox *m, struct EmailList *el)
   if (!STAILQ_NEXT(en, entries))
   {
     // If there's only one email, use its label as a template
+    mutt_env_thaw(en->email->env);
     if (en->email->env->x_label)
       mutt_str_strfcpy(buf, en->email->env->x_label, sizeof(buf));
   }
@@ -369,10 +371,13 @@ void mutt_make_label_hash(struct Mailbox *m)
  * mutt_label_hash_add - Add a message's labels to the Hash Table
  * @param m Mailbox
  * @param e Email
+ *
+ * Labels that haven't been restored from the header cache are skipped.
+ * mutt_label_hash_rebuild() counts them.
  */
 void mutt_label_hash_add(struct Mailbox *m, struct Email *e)
 {
-  if (!m || !m->label_hash)
+  if (!m || !m->label_hash || e->env->cold)
     return;
   if (e->env->x_label)
     label_ref_inc(m, e->env->x_label);
@@ -385,8 +390,28 @@ void mutt_label_hash_add(struct Mailbox *m, struct Email *e)
  */
 void mutt_label_hash_remove(struct Mailbox *m, struct Email *e)
 {
-  if (!m || !m->label_hash)
+  if (!m || !m->label_hash || e->env->cold)
     return;
   if (e->env->x_label)
     label_ref_dec(m, e->env->x_label);
 }
+
+/**
+ * mutt_label_hash_rebuild - Count the labels of all the messages again
+ * @param m Mailbox
+ *
+ * Restore any labels that were left in the header cache and count them.
+ */
+void mutt_label_hash_rebuild(struct Mailbox *m)
+{
+  if (!m || !m->label_hash)
+    return;
+
+  mutt_hash_free(&m->label_hash);
+  mutt_make_label_hash(m);
+  for (int i = 0; i < m->msg_count; i++)
+  {
+    mutt_env_thaw(m->emails[i]->env);
+    mutt_label_hash_add(m, m->emails[i]);
+  }
+}
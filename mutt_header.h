@@ -31,6 +31,7 @@ struct EmailList;
 
 void mutt_edit_headers(const char *editor, const char *body, struct Email *msg, char *fcc, size_t fcclen);
 void mutt_label_hash_add(struct Mailbox *m, struct Email *e);
+void mutt_label_hash_rebuild(struct Mailbox *m);
 void mutt_label_hash_remove(struct Mailbox *m, struct Email *e);
 int mutt_label_message(struct Mailbox *m, struct EmailList *el);
 void mutt_make_label_hash(struct Mailbox *m);
@@ -167,6 +167,7 @@ void         menu_next_page(struct Menu *menu);
 void         menu_prev_line(struct Menu *menu);
 void         menu_prev_page(struct Menu *menu);
 void         menu_redraw_current(struct Menu *menu);
+bool         menu_redraw_defer(struct Menu *menu);
 void         menu_redraw_full(struct Menu *menu);
 void         menu_redraw_index(struct Menu *menu);
 void         menu_redraw_motion(struct Menu *menu);
@@ -42,6 +42,8 @@ struct Context;
 
 #define MUTT_PARTS_TOPLEVEL (1 << 0) /* is the top-level part */
 
+static unsigned int AttachConfigId = 0; ///< Cached fingerprint of the attachment lists
+
 /**
  * mutt_parse_mime_message - Parse a MIME email
  * @param m Mailbox
@@ -70,6 +72,7 @@ void mutt_parse_mime_message(struct Mailbox *m, struct Email *e)
   } while (false);
 
   e->attach_valid = false;
+  e->attach_id = 0;
 }
 
 /**
@@ -207,32 +210,139 @@ static int count_body_parts(struct Body *body, int flags)
   return (count < 0) ? 0 : count;
 }
 
+/**
+ * mutt_attach_config_empty - Are all the attachment lists empty?
+ * @retval true No attachments would be counted
+ */
+bool mutt_attach_config_empty(void)
+{
+  return STAILQ_EMPTY(&AttachAllow) && STAILQ_EMPTY(&AttachExclude) &&
+         STAILQ_EMPTY(&InlineAllow) && STAILQ_EMPTY(&InlineExclude);
+}
+
+/**
+ * attach_list_md5 - Add an attachment list to a checksum
+ * @param head List of AttachMatch
+ * @param tag  Character identifying the list
+ * @param ctx  Checksum context
+ */
+static void attach_list_md5(struct ListHead *head, char tag, struct Md5Ctx *ctx)
+{
+  struct ListNode *np = NULL;
+  STAILQ_FOREACH(np, head, entries)
+  {
+    struct AttachMatch *a = (struct AttachMatch *) np->data;
+    mutt_md5_process_bytes(&tag, 1, ctx);
+    mutt_md5_process(a->major, ctx);
+    mutt_md5_process_bytes("/", 1, ctx);
+    mutt_md5_process(a->minor, ctx);
+  }
+}
+
+/**
+ * mutt_attach_config_id - Get a fingerprint of the attachment configuration
+ * @retval num Fingerprint, never zero
+ *
+ * Attachment counts stored in the header cache are tagged with this value.
+ * A count is only trusted if the `attachments` and `unattachments` commands
+ * still produce the same lists.
+ */
+unsigned int mutt_attach_config_id(void)
+{
+  if (AttachConfigId != 0)
+    return AttachConfigId;
+
+  struct Md5Ctx ctx;
+  unsigned int digest[4];
+
+  mutt_md5_init_ctx(&ctx);
+  attach_list_md5(&AttachAllow, 'A', &ctx);
+  attach_list_md5(&AttachExclude, 'a', &ctx);
+  attach_list_md5(&InlineAllow, 'I', &ctx);
+  attach_list_md5(&InlineExclude, 'i', &ctx);
+  mutt_md5_finish_ctx(&ctx, digest);
+
+  AttachConfigId = digest[0] ^ digest[1] ^ digest[2] ^ digest[3];
+  if (AttachConfigId == 0)
+    AttachConfigId = 1;
+
+  return AttachConfigId;
+}
+
+/**
+ * mutt_attach_config_reset - Forget the attachment configuration fingerprint
+ *
+ * Called when the attachment lists are changed.
+ */
+void mutt_attach_config_reset(void)
+{
+  AttachConfigId = 0;
+}
+
+/**
+ * mutt_count_body_tree - Count the MIME Body parts of a Body tree
+ * @param b Top-level Body, with its parts already parsed
+ * @retval num Number of MIME Body parts
+ *
+ * Unlike mutt_count_body_parts(), this doesn't need access to the message, so
+ * it can be used on a structure supplied by the server.
+ */
+int mutt_count_body_tree(struct Body *b)
+{
+  if (mutt_attach_config_empty())
+    return 0;
+
+  return count_body_parts(b, MUTT_PARTS_TOPLEVEL);
+}
+
+/**
+ * mutt_attach_count_valid - Is the attachment count of an Email up to date?
+ * @param e Email
+ * @retval true attach_total can be used
+ *
+ * A count restored from the header cache is tagged with the attachment
+ * configuration it was made with.  It's only trusted if that still matches.
+ */
+bool mutt_attach_count_valid(struct Email *e)
+{
+  if (!e->attach_valid && (e->attach_id != 0) && (e->attach_id == mutt_attach_config_id()))
+    e->attach_valid = true;
+
+  return e->attach_valid;
+}
+
 /**
  * mutt_count_body_parts - Count the MIME Body parts
  * @param m Mailbox
  * @param e Email
  * @retval num Number of MIME Body parts
+ *
+ * The count is saved in the header cache, the next time the Email is, so it
+ * survives until the message or the attachment configuration changes.
  */
 int mutt_count_body_parts(struct Mailbox *m, struct Email *e)
 {
   bool keep_parts = false;
 
-  if (e->attach_valid)
+  if (mutt_attach_count_valid(e))
     return e->attach_total;
 
+  /* Nothing can qualify, so don't bother fetching the message */
+  if (mutt_attach_config_empty())
+  {
+    e->attach_total = 0;
+    e->attach_id = mutt_attach_config_id();
+    e->attach_valid = true;
+    return 0;
+  }
+
   if (e->content->parts)
     keep_parts = true;
   else
     mutt_parse_mime_message(m, e);
 
-  if (!STAILQ_EMPTY(&AttachAllow) || !STAILQ_EMPTY(&AttachExclude) ||
-      !STAILQ_EMPTY(&InlineAllow) || !STAILQ_EMPTY(&InlineExclude))
-  {
-    e->attach_total = count_body_parts(e->content, MUTT_PARTS_TOPLEVEL);
-  }
-  else
-    e->attach_total = 0;
-
+  e->attach_total = count_body_parts(e->content, MUTT_PARTS_TOPLEVEL);
+  e->attach_id = mutt_attach_config_id();
   e->attach_valid = true;
 
   if (!keep_parts)
@@ -23,11 +23,19 @@
 #ifndef MUTT_MUTT_PARSE_H
 #define MUTT_MUTT_PARSE_H
 
+#include <stdbool.h>
+
+struct Body;
 struct Context;
 struct Email;
 struct Mailbox;
 
-int  mutt_count_body_parts(struct Mailbox *m, struct Email *e);
-void mutt_parse_mime_message(struct Mailbox *m, struct Email *cur);
+bool         mutt_attach_config_empty(void);
+unsigned int mutt_attach_config_id(void);
+void         mutt_attach_config_reset(void);
+bool         mutt_attach_count_valid(struct Email *e);
+int          mutt_count_body_parts(struct Mailbox *m, struct Email *e);
+int          mutt_count_body_tree(struct Body *b);
+void         mutt_parse_mime_message(struct Mailbox *m, struct Email *cur);
 
 #endif /* MUTT_MUTT_PARSE_H */
@@ -39,11 +39,16 @@
 #include "mutt_thread.h"
 #include "context.h"
 #include "curs_lib.h"
+#include "globals.h"
 #include "mailbox.h"
 #include "mutt_menu.h"
 #include "mx.h"
 #include "protos.h"
 #include "sort.h"
+#ifdef USE_HCACHE
+#include "hcache/hcache.h"
+#include "hcache/serialize.h"
+#endif
 
 /* These Config Variables are only used in mutt_thread.c */
 bool C_DuplicateThreads; ///< Config: Highlight messages with duplicated message IDs
@@ -826,10 +831,348 @@ static void check_subjects(struct Mailbox *m, bool init)
   }
 }
 
+#ifdef USE_HCACHE
+#define THREAD_CACHE_KEY "/threads"
+#define THREAD_CACHE_VERSION 2
+
+/**
+ * struct ThreadCacheLink - A parent link read from the header cache
+ */
+struct ThreadCacheLink
+{
+  struct MuttThread *thread; ///< Thread being restored
+  const char *id;            ///< Its Message-ID
+  const char *parent;        ///< Message-ID of its parent, or NULL
+};
+
+/**
+ * thread_cache_open - Open the header cache that holds a Mailbox's threads
+ * @param m Mailbox
+ * @retval ptr Header cache
+ * @retval NULL The Mailbox's type doesn't keep its threads
+ */
+static header_cache_t *thread_cache_open(struct Mailbox *m)
+{
+  switch (m->magic)
+  {
+    case MUTT_MAILDIR:
+    case MUTT_MH:
+    case MUTT_NOTMUCH:
+      return mutt_hcache_open(C_HeaderCache, mutt_b2s(m->pathbuf), NULL);
+    default:
+      return NULL;
+  }
+}
+
+/**
+ * thread_refs_sum - Checksum the threading headers of an Envelope
+ * @param env Envelope
+ * @retval num Checksum of the In-Reply-To and References headers
+ */
+static unsigned int thread_refs_sum(struct Envelope *env)
+{
+  unsigned int sum = 0;
+  struct ListNode *np = NULL;
+
+  mutt_env_thaw(env);
+  STAILQ_FOREACH(np, &env->in_reply_to, entries)
+  {
+    for (const char *p = np->data; p && *p; p++)
+      sum = (sum * 33) + (unsigned char) *p;
+    sum = (sum * 33) + ' ';
+  }
+  sum = (sum * 33) + '\n';
+  STAILQ_FOREACH(np, &env->references, entries)
+  {
+    for (const char *p = np->data; p && *p; p++)
+      sum = (sum * 33) + (unsigned char) *p;
+    sum = (sum * 33) + ' ';
+  }
+  return sum;
+}
+
+/**
+ * thread_missing_id - Find the Message-ID of a missing message
+ * @param ctx    Mailbox
+ * @param thread Thread without a message
+ * @param id     Message-ID to look for, or NULL to match the Thread
+ * @retval ptr Message-ID, owned by a descendant's Envelope
+ * @retval NULL Not found
+ *
+ * A missing message is only known from the References of its descendants.
+ * If id is NULL, return the reference that leads to thread.  Otherwise,
+ * return a reference matching id.
+ */
+static const char *thread_missing_id(struct Context *ctx, struct MuttThread *thread,
+                                     const char *id)
+{
+  struct MuttThread *tmp = thread->child;
+  struct ListNode *np = NULL;
+
+  while (tmp)
+  {
+    if (tmp->message)
+    {
+      mutt_env_thaw(tmp->message->env);
+      struct ListHead *lists[] = { &tmp->message->env->in_reply_to,
+                                   &tmp->message->env->references };
+      for (size_t i = 0; i < mutt_array_size(lists); i++)
+      {
+        STAILQ_FOREACH(np, lists[i], entries)
+        {
+          if (id ? (mutt_str_strcmp(np->data, id) == 0) :
+                   (mutt_hash_find(ctx->thread_hash, np->data) == thread))
+          {
+            return np->data;
+          }
+        }
+      }
+    }
+
+    if (tmp->child)
+    {
+      tmp = tmp->child;
+      continue;
+    }
+    while ((tmp != thread) && !tmp->next)
+      tmp = tmp->parent;
+    if (tmp == thread)
+      break;
+    tmp = tmp->next;
+  }
+
+  return NULL;
+}
+
+/**
+ * thread_cache_int - Read a number from the saved threads
+ * @param[out] i   Number
+ * @param[in]  d   Data saved by mutt_thread_cache_save()
+ * @param[in]  len Length of the data
+ * @param[out] off Offset into the data
+ * @retval true  Success
+ * @retval false The data is truncated
+ */
+static bool thread_cache_int(unsigned int *i, const unsigned char *d, size_t len, int *off)
+{
+  if ((len < sizeof(int)) || (*off > (len - sizeof(int))))
+    return false;
+  serial_restore_int(i, d, off);
+  return true;
+}
+
+/**
+ * thread_cache_str - Read a Message-ID from the saved threads
+ * @param[out] str Message-ID, pointing into the data, or NULL if none was saved
+ * @param[in]  d   Data saved by mutt_thread_cache_save()
+ * @param[in]  len Length of the data
+ * @param[out] off Offset into the data
+ * @retval true  Success
+ * @retval false The data is truncated or the string isn't terminated
+ */
+static bool thread_cache_str(const char **str, const unsigned char *d, size_t len, int *off)
+{
+  unsigned int size = 0;
+  if (!thread_cache_int(&size, d, len, off) || (size > (len - *off)))
+    return false;
+
+  *str = NULL;
+  if (size == 0)
+    return true;
+  if (d[*off + size - 1] != '\0')
+    return false;
+
+  *str = (const char *) d + *off;
+  *off += size;
+  return true;
+}
+
+/**
+ * thread_cache_load - Rebuild the threads from the header cache
+ * @param ctx Mailbox
+ * @param d   Data saved by mutt_thread_cache_save()
+ * @param len Length of the data
+ * @retval true  Success
+ * @retval false The saved threads are damaged or don't match the Mailbox
+ *
+ * Messages that weren't in the Mailbox when the threads were saved are left
+ * unthreaded, for mutt_sort_threads() to add.
+ */
+static bool thread_cache_load(struct Context *ctx, const unsigned char *d, size_t len)
+{
+  struct Mailbox *m = ctx->mailbox;
+  struct Hash *hash = ctx->thread_hash;
+  struct MuttThread *thread = NULL;
+  struct ThreadCacheLink *links = NULL;
+  unsigned int version = 0, total = 0, count = 0, sum = 0, is_msg = 0;
+  int off = 0;
+  bool rc = false;
+
+  if (!thread_cache_int(&version, d, len, &off) || (version != THREAD_CACHE_VERSION))
+    return false;
+  if (!thread_cache_int(&total, d, len, &off) || (total != len))
+    return false;
+  if (!thread_cache_int(&count, d, len, &off))
+    return false;
+
+  /* Each link takes at least: two sizes, a one-byte Message-ID, sum, is_msg */
+  if (count > ((len - off) / ((4 * sizeof(int)) + 1)))
+    return false;
+
+  for (int i = 0; i < m->msg_count; i++)
+  {
+    struct Email *e = m->emails[i];
+    if (!e->env->message_id)
+      continue;
+    if (mutt_hash_find(hash, e->env->message_id))
+      return false; /* duplicate Message-ID */
+
+    thread = mutt_mem_calloc(1, sizeof(struct MuttThread));
+    thread->message = e;
+    e->thread = thread;
+    mutt_hash_insert(hash, e->env->message_id, thread);
+  }
+
+  links = mutt_mem_calloc(MAX(count, 1), sizeof(struct ThreadCacheLink));
+  for (unsigned int i = 0; i < count; i++)
+  {
+    struct ThreadCacheLink *link = &links[i];
+
+    if (!thread_cache_str(&link->id, d, len, &off) || !link->id ||
+        !thread_cache_str(&link->parent, d, len, &off) ||
+        !thread_cache_int(&sum, d, len, &off) || !thread_cache_int(&is_msg, d, len, &off))
+    {
+      goto done;
+    }
+
+    thread = mutt_hash_find(hash, link->id);
+    if (is_msg)
+    {
+      /* The message must still be here, unchanged */
+      if (!thread || thread->check_subject || (thread_refs_sum(thread->message->env) != sum))
+        goto done;
+      thread->check_subject = true;
+      thread->message->threaded = true;
+    }
+    else
+    {
+      if (thread)
+        goto done;
+      thread = mutt_mem_calloc(1, sizeof(struct MuttThread));
+      mutt_hash_insert(hash, link->id, thread);
+    }
+    link->thread = thread;
+  }
+  if (off != len)
+    goto done;
+
+  for (unsigned int i = 0; i < count; i++)
+  {
+    thread = links[i].thread;
+    if (links[i].parent)
+    {
+      struct MuttThread *parent = mutt_hash_find(hash, links[i].parent);
+      if (!parent || (parent == thread))
+        goto done;
+      insert_message(&parent->child, parent, thread);
+    }
+    else
+      insert_message(&ctx->tree, NULL, thread);
+  }
+
+  /* The new messages will be threaded from their headers */
+  for (int i = 0; i < m->msg_count; i++)
+  {
+    struct Email *e = m->emails[i];
+    if (e->thread && !e->thread->check_subject)
+    {
+      mutt_hash_delete(hash, e->env->message_id, e->thread);
+      e->thread = NULL;
+    }
+  }
+
+  /* Key the missing messages by their descendants' References, like
+   * mutt_sort_threads() does, so the saved data can be freed */
+  mutt_hash_set_destructor(hash, NULL, 0);
+  for (unsigned int i = 0; i < count; i++)
+  {
+    thread = links[i].thread;
+    if (thread->message)
+      continue;
+
+    const char *id = thread->child ? thread_missing_id(ctx, thread, links[i].id) : NULL;
+    mutt_hash_delete(hash, links[i].id, thread);
+    if (!id)
+    {
+      FREE(&thread);
+      links[i].thread = NULL;
+      mutt_hash_set_destructor(hash, thread_hash_destructor, 0);
+      goto done;
+    }
+    mutt_hash_insert(hash, id, thread);
+  }
+  mutt_hash_set_destructor(hash, thread_hash_destructor, 0);
+
+  rc = true;
+
+done:
+  FREE(&links);
+  return rc;
+}
+
+/**
+ * thread_cache_restore - Restore the threads of a Mailbox from the header cache
+ * @param ctx Mailbox
+ * @retval true The threads were restored
+ */
+static bool thread_cache_restore(struct Context *ctx)
+{
+  struct Mailbox *m = ctx->mailbox;
+  header_cache_t *hc = thread_cache_open(m);
+  if (!hc)
+    return false;
+
+  bool rc = false;
+  size_t dlen = 0;
+  void *data = mutt_hcache_fetch_raw_len(hc, THREAD_CACHE_KEY,
+                                         sizeof(THREAD_CACHE_KEY) - 1, &dlen);
+  if (!data)
+  {
+    mutt_hcache_close(hc);
+    return false;
+  }
+
+  rc = thread_cache_load(ctx, data, dlen);
+  mutt_hcache_free(hc, &data);
+  mutt_hcache_close(hc);
+
+  if (!rc)
+  {
+    /* Start again from scratch */
+    for (int i = 0; i < m->msg_count; i++)
+    {
+      m->emails[i]->thread = NULL;
+      m->emails[i]->threaded = false;
+    }
+    ctx->tree = NULL;
+    mutt_hash_free(&ctx->thread_hash);
+    ctx->thread_hash = mutt_hash_new(m->msg_count * 2, MUTT_HASH_ALLOW_DUPS);
+    mutt_hash_set_destructor(ctx->thread_hash, thread_hash_destructor, 0);
+  }
+
+  mutt_debug(LL_DEBUG2, "%s threads for %s\n", rc ? "restored" : "discarded saved",
+             mutt_b2s(m->pathbuf));
+  return rc;
+}
+#endif
+
 /**
  * mutt_sort_threads - Sort email threads
  * @param ctx  Mailbox
  * @param init If true, rebuild the thread
+ *
+ * If the Mailbox's threads were saved by mutt_thread_cache_save(), they're
+ * restored and only the messages that arrived since are threaded.
  */
 void mutt_sort_threads(struct Context *ctx, bool init)
 {
@@ -852,10 +1195,16 @@ void mutt_sort_threads(struct Context *ctx, bool init)
   if (!ctx->thread_hash)
     init = true;
 
+  bool resort = init;
   if (init)
   {
     ctx->thread_hash = mutt_hash_new(m->msg_count * 2, MUTT_HASH_ALLOW_DUPS);
     mutt_hash_set_destructor(ctx->thread_hash, thread_hash_destructor, 0);
+#ifdef USE_HCACHE
+    if (thread_cache_restore(ctx))
+      init = false;
+#endif
+    ctx->threads_cached = !init;
   }
 
   /* we want a quick way to see if things are actually attached to the top of the
@@ -879,6 +1228,7 @@ void mutt_sort_threads(struct Context *ctx, bool init)
 
     if (!cur->thread)
     {
+      ctx->threads_cached = false;
       if ((!init || C_DuplicateThreads) && cur->env->message_id)
         thread = mutt_hash_find(ctx->thread_hash, cur->env->message_id);
       else
@@ -974,6 +1324,7 @@ void mutt_sort_threads(struct Context *ctx, bool init)
 
     thread = cur->thread;
     using_refs = 0;
+    mutt_env_thaw(cur->env);
 
     while (true)
     {
@@ -1054,7 +1405,7 @@ void mutt_sort_threads(struct Context *ctx, bool init)
 
   if (ctx->tree)
   {
-    ctx->tree = mutt_sort_subthreads(ctx->tree, init);
+    ctx->tree = mutt_sort_subthreads(ctx->tree, resort);
 
     /* restore the oldsort order. */
     C_Sort = oldsort;
@@ -1180,6 +1531,85 @@ int mutt_parent_message(struct Context *ctx, struct Email *e, bool find_root)
   return parent->virtual;
 }
 
+/**
+ * mutt_thread_cache_save - Save the threads of a Mailbox in the header cache
+ * @param ctx Mailbox
+ *
+ * Only the links made from the References headers are saved.  The subject
+ * based pseudo-threads and the order of the threads depend on the config, so
+ * they're recalculated when the threads are restored.
+ *
+ * Nothing is saved unless every message has a unique Message-ID.
+ */
+void mutt_thread_cache_save(struct Context *ctx)
+{
+#ifdef USE_HCACHE
+  if (!ctx || !ctx->mailbox || !ctx->tree || !ctx->thread_hash || ctx->threads_cached)
+    return;
+
+  struct Mailbox *m = ctx->mailbox;
+  if (m->changed || m->partial || ((C_Sort & SORT_MASK) != SORT_THREADS))
+    return;
+
+  for (int i = 0; i < m->msg_count; i++)
+  {
+    struct Email *e = m->emails[i];
+    if (!e->env->message_id || !e->thread || e->thread->duplicate_thread)
+      return;
+  }
+
+  header_cache_t *hc = thread_cache_open(m);
+  if (!hc)
+    return;
+
+  unsigned char *d = mutt_mem_malloc(4096);
+  int off = 0;
+  unsigned int count = 0;
+  struct HashWalkState state = { 0 };
+  struct HashElem *he = NULL;
+
+  d = serial_dump_int(THREAD_CACHE_VERSION, d, &off);
+  int total_off = off;
+  d = serial_dump_int(0, d, &off);
+  int count_off = off;
+  d = serial_dump_int(0, d, &off);
+
+  while ((he = mutt_hash_walk(ctx->thread_hash, &state)))
+  {
+    struct MuttThread *thread = he->data;
+    if (!thread->message && !thread->child)
+      continue; /* no longer part of any thread */
+
+    const char *parent = NULL;
+    if (thread->parent && !thread->fake_thread)
+    {
+      if (thread->parent->message)
+        parent = thread->parent->message->env->message_id;
+      else
+        parent = thread_missing_id(ctx, thread->parent, NULL);
+      if (!parent)
+        goto done;
+    }
+
+    d = serial_dump_char((char *) he->key.strkey, d, &off, false);
+    d = serial_dump_char((char *) parent, d, &off, false);
+    d = serial_dump_int(thread->message ? thread_refs_sum(thread->message->env) : 0, d, &off);
+    d = serial_dump_int(thread->message ? 1 : 0, d, &off);
+    count++;
+  }
+
+  memcpy(d + total_off, &off, sizeof(int));
+  memcpy(d + count_off, &count, sizeof(int));
+  if (mutt_hcache_store_raw(hc, THREAD_CACHE_KEY, sizeof(THREAD_CACHE_KEY) - 1, d, off) == 0)
+    ctx->threads_cached = true;
+  mutt_debug(LL_DEBUG2, "saved %u thread links for %s\n", count, mutt_b2s(m->pathbuf));
+
+done:
+  FREE(&d);
+  mutt_hcache_close(hc);
+#endif
+}
+
 /**
  * mutt_set_virtual - Set the virtual index number of all the messages in a mailbox
  * @param ctx Mailbox
@@ -1212,6 +1642,28 @@ void mutt_set_virtual(struct Context *ctx)
   }
 }
 
+/**
+ * mutt_thread_collapse_new - Keep a new Email hidden in a collapsed thread
+ * @param ctx Mailbox
+ * @param e   Email that has just been threaded
+ *
+ * If the Email has joined a collapsed thread, collapse the thread again.
+ */
+void mutt_thread_collapse_new(struct Context *ctx, struct Email *e)
+{
+  if (!ctx || !e || !e->thread)
+    return;
+
+  struct MuttThread *top = e->thread;
+  while (top->parent)
+    top = top->parent;
+  while (!top->message)
+    top = top->child;
+
+  if (top->message->collapsed)
+    mutt_collapse_thread(ctx, e);
+}
+
 /**
  * mutt_traverse_thread - Recurse through an email thread, matching messages
  * @param ctx  Mailbox
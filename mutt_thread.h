@@ -75,5 +75,7 @@ int                mutt_parent_message    (struct Context *ctx, struct Email *e,
 void               mutt_set_virtual       (struct Context *ctx);
 struct MuttThread *mutt_sort_subthreads   (struct MuttThread *thread, bool init);
 void               mutt_sort_threads      (struct Context *ctx, bool init);
+void               mutt_thread_cache_save (struct Context *ctx);
+void               mutt_thread_collapse_new(struct Context *ctx, struct Email *e);
 
 #endif /* MUTT_MUTT_THREAD_H */
@@ -314,6 +314,7 @@ struct Context *mx_mbox_open(struct Mailbox *m, OpenMailboxFlags flags)
     m->readonly = true;
   if (flags & MUTT_PEEK)
     m->peekonly = true;
+  m->partial = false;
 
   if (flags & (MUTT_APPEND | MUTT_NEWFOLDER))
   {
@@ -355,6 +356,10 @@ struct Context *mx_mbox_open(struct Mailbox *m, OpenMailboxFlags flags)
   if (!m->quiet)
     mutt_message(_("Reading %s..."), mutt_b2s(m->pathbuf));
 
+  /* The backend will clear this if it reads the whole mailbox */
+  if ((flags & MUTT_PARTIAL) && m->mx_ops->mbox_open_more)
+    m->partial = true;
+
   int rc = m->mx_ops->mbox_open(ctx->mailbox);
   m->opened++;
   if (rc == 0)
@@ -389,6 +394,37 @@ struct Context *mx_mbox_open(struct Mailbox *m, OpenMailboxFlags flags)
   return ctx;
 }
 
+/**
+ * mx_mbox_open_more - Read more of a partially opened Mailbox - Wrapper for MxOps::mbox_open_more()
+ * @param m   Mailbox
+ * @param all If true, read all the remaining Emails
+ * @retval >0 Number of Emails added
+ * @retval  0 The Mailbox is completely open
+ * @retval -1 Error
+ *
+ * The new Emails are appended to the Mailbox, like new mail.  The caller is
+ * responsible for sorting them, e.g. with update_index().
+ */
+int mx_mbox_open_more(struct Mailbox *m, bool all)
+{
+  if (!m || !m->partial)
+    return 0;
+
+  if (!m->mx_ops || !m->mx_ops->mbox_open_more)
+  {
+    m->partial = false;
+    return 0;
+  }
+
+  int rc = m->mx_ops->mbox_open_more(m, all);
+  if (rc > 0)
+    mutt_mailbox_changed(m, MBN_INVALID);
+  else
+    m->partial = false;
+
+  return rc;
+}
+
 /**
  * mx_fastclose_mailbox - free up memory associated with the Mailbox
  * @param m Mailbox
@@ -409,6 +445,7 @@ void mx_fastclose_mailbox(struct Mailbox *m)
 
   if (m->mx_ops)
     m->mx_ops->mbox_close(m);
+  m->partial = false;
 
   mutt_mailbox_changed(m, MBN_CLOSED);
   m->notify2 = NULL;
@@ -579,6 +616,7 @@ int mx_mbox_close(struct Context **ptr)
 
   if (m->readonly || m->dontwrite || m->append)
   {
+    mutt_thread_cache_save(ctx);
     mx_fastclose_mailbox(m);
     FREE(ptr);
     return 0;
@@ -738,6 +776,7 @@ int mx_mbox_close(struct Context **ptr)
       mutt_message(_("Mailbox is unchanged"));
     if ((m->magic == MUTT_MBOX) || (m->magic == MUTT_MMDF))
       mbox_reset_atime(m, NULL);
+    mutt_thread_cache_save(ctx);
     mx_fastclose_mailbox(m);
     FREE(ptr);
     return 0;
@@ -1182,6 +1221,32 @@ int mx_check_empty(const char *path)
   /* not reached */
 }
 
+/**
+ * mx_mbox_prefetch - Warm the caches for a Mailbox that's likely to be opened
+ * @param m Mailbox
+ *
+ * Only local mailboxes are handled; remote ones would need the network.
+ */
+void mx_mbox_prefetch(struct Mailbox *m)
+{
+  if (!m)
+    return;
+
+  switch (m->magic)
+  {
+    case MUTT_MBOX:
+    case MUTT_MMDF:
+      mutt_file_willneed(mutt_b2s(m->pathbuf));
+      break;
+    case MUTT_MH:
+    case MUTT_MAILDIR:
+      maildir_prefetch(m);
+      break;
+    default:
+      break;
+  }
+}
+
 /**
  * mx_tags_edit - start the tag editor of the mailbox
  * @param m      Mailbox
@@ -1596,7 +1661,7 @@ int mx_ac_remove(struct Mailbox *m)
  */
 int mx_mbox_check_stats(struct Mailbox *m, int flags)
 {
-  if (!m)
+  if (!m || !m->mx_ops)
     return -1;
 
   return m->mx_ops->mbox_check_stats(m, flags);
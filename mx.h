@@ -59,6 +59,11 @@ typedef uint8_t OpenMailboxFlags;   ///< Flags for mutt_open_mailbox(), e.g. #MU
 #define MUTT_PEEK          (1 << 5) ///< Revert atime back after taking a look (if applicable)
 #define MUTT_APPENDNEW     (1 << 6) ///< Set in mx_open_mailbox_append if the mailbox doesn't exist.
                                     ///< Used by maildir/mh to create the mailbox.
+#define MUTT_PARTIAL       (1 << 7) ///< Return once the newest Emails have been read, see mx_mbox_open_more()
+
+/* flags for mx_mbox_check_stats() */
+#define MUTT_MAILBOX_CHECK_NO_FLAGS  0  ///< No flags are set
+#define MUTT_MAILBOX_CHECK_COUNT (1 << 0) ///< Only the number of messages is needed
 
 typedef uint8_t MsgOpenFlags;      ///< Flags for mx_msg_open_new(), e.g. #MUTT_ADD_FROM
 #define MUTT_MSG_NO_FLAGS       0  ///< No flags are set
@@ -130,6 +135,17 @@ struct MxOps
    * @retval -2 Aborted
    */
   int (*mbox_open)       (struct Mailbox *m);
+  /**
+   * mbox_open_more - Read more Emails into a partially opened Mailbox
+   * @param m   Mailbox being opened
+   * @param all If true, read all the remaining Emails
+   * @retval >0 Number of Emails added
+   * @retval  0 No more Emails to read
+   * @retval -1 Error
+   *
+   * This is only called if Mailbox::partial has been left set by mbox_open().
+   */
+  int (*mbox_open_more)  (struct Mailbox *m, bool all);
   /**
    * mbox_open_append - Open a Mailbox for appending
    * @param m     Mailbox to open
@@ -276,6 +292,7 @@ int             mx_mbox_check      (struct Mailbox *m, int *index_hint);
 int             mx_mbox_check_stats(struct Mailbox *m, int flags);
 int             mx_mbox_close      (struct Context **ptr);
 struct Context *mx_mbox_open       (struct Mailbox *m, OpenMailboxFlags flags);
+int             mx_mbox_open_more  (struct Mailbox *m, bool all);
 int             mx_mbox_sync       (struct Mailbox *m, int *index_hint);
 int             mx_msg_close       (struct Mailbox *m, struct Message **msg);
 int             mx_msg_commit      (struct Mailbox *m, struct Message *msg);
@@ -303,6 +320,7 @@ void                mx_alloc_memory     (struct Mailbox *m);
 int                 mx_check_empty      (const char *path);
 void                mx_fastclose_mailbox(struct Mailbox *m);
 const struct MxOps *mx_get_ops          (enum MailboxType magic);
+void                mx_mbox_prefetch    (struct Mailbox *m);
 bool                mx_tags_is_supported(struct Mailbox *m);
 
 #endif /* MUTT_MX_H */
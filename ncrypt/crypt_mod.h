@@ -33,6 +33,8 @@ struct AddressList;
 struct Body;
 struct Envelope;
 struct Email;
+struct EmailNode;
+struct Mailbox;
 struct State;
 
 /**
@@ -177,6 +179,16 @@ struct CryptModuleSpecs
    * @param top Body of the email
    */
   void         (*pgp_extract_key_from_attachment)(FILE *fp, struct Body *top);
+  /**
+   * pgp_decrypt_ahead - Start decrypting the next PGP/MIME emails in the background
+   * @param m  Mailbox
+   * @param en Email that is about to be decrypted, followed by the rest
+   */
+  void         (*pgp_decrypt_ahead)(struct Mailbox *m, struct EmailNode *en);
+  /**
+   * pgp_decrypt_ahead_done - Discard the background decryptions that weren't used
+   */
+  void         (*pgp_decrypt_ahead_done)(void);
 
   /**
    * smime_getkeys - Get the S/MIME keys required to encrypt this email
@@ -62,6 +62,8 @@ struct CryptModuleSpecs CryptModPgpClassic = {
   pgp_class_invoke_getkeys,
   pgp_class_invoke_import,
   pgp_class_extract_key_from_attachment,
+  pgp_class_decrypt_ahead,
+  pgp_class_decrypt_ahead_done,
 
   NULL, /* smime_getkeys */
   NULL, /* smime_verify_sender */
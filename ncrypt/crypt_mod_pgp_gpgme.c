@@ -78,6 +78,8 @@ struct CryptModuleSpecs CryptModPgpGpgme = {
   NULL, /* pgp_invoke_getkeys */
   pgp_gpgme_invoke_import,
   NULL, /* pgp_extract_key_from_attachment */
+  NULL, /* pgp_decrypt_ahead */
+  NULL, /* pgp_decrypt_ahead_done */
 
   NULL, /* smime_getkeys */
   NULL, /* smime_verify_sender */
@@ -60,6 +60,8 @@ struct CryptModuleSpecs CryptModSmimeClassic = {
   NULL, /* pgp_invoke_getkeys */
   NULL, /* pgp_invoke_import */
   NULL, /* pgp_extract_key_from_attachment */
+  NULL, /* pgp_decrypt_ahead */
+  NULL, /* pgp_decrypt_ahead_done */
 
   smime_class_getkeys,
   smime_class_verify_sender,
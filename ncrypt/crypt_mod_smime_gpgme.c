@@ -78,6 +78,8 @@ struct CryptModuleSpecs CryptModSmimeGpgme = {
   NULL, /* pgp_invoke_getkeys */
   NULL, /* pgp_invoke_import */
   NULL, /* pgp_extract_key_from_attachment */
+  NULL, /* pgp_decrypt_ahead */
+  NULL, /* pgp_decrypt_ahead_done */
 
   NULL, /* smime_getkeys */
   smime_gpgme_verify_sender,
@@ -41,6 +41,7 @@
 #include "mutt/mutt.h"
 #include "crypt_mod.h"
 #include "curs_lib.h"
+#include "filter.h"
 #include "ncrypt.h"
 
 struct Address;
@@ -48,10 +49,13 @@ struct AddressList;
 struct Body;
 struct Envelope;
 struct Email;
+struct EmailNode;
+struct Mailbox;
 struct State;
 
 /* These Config Variables are only used in ncrypt/cryptglue.c */
-bool C_CryptUseGpgme; ///< Config: Use GPGME crypto backend
+bool C_CryptSpawnHelper; ///< Config: Start crypto commands from a helper process
+bool C_CryptUseGpgme;    ///< Config: Use GPGME crypto backend
 
 #ifdef CRYPT_BACKEND_CLASSIC_PGP
 extern struct CryptModuleSpecs CryptModPgpClassic;
@@ -128,6 +132,12 @@ void crypt_init(void)
   if (CRYPT_MOD_CALL_CHECK(SMIME, init))
     CRYPT_MOD_CALL(SMIME, init)();
 #endif
+
+#if defined(CRYPT_BACKEND_CLASSIC_PGP) || defined(CRYPT_BACKEND_CLASSIC_SMIME)
+  /* The classic backends run a command for every operation */
+  if (C_CryptSpawnHelper && !C_CryptUseGpgme)
+    mutt_filter_helper_start();
+#endif
 }
 
 /**
@@ -339,6 +349,24 @@ void crypt_pgp_extract_key_from_attachment(FILE *fp, struct Body *top)
     CRYPT_MOD_CALL(PGP, pgp_extract_key_from_attachment)(fp, top);
 }
 
+/**
+ * crypt_pgp_decrypt_ahead - Wrapper for CryptModuleSpecs::pgp_decrypt_ahead()
+ */
+void crypt_pgp_decrypt_ahead(struct Mailbox *m, struct EmailNode *en)
+{
+  if (CRYPT_MOD_CALL_CHECK(PGP, pgp_decrypt_ahead))
+    CRYPT_MOD_CALL(PGP, pgp_decrypt_ahead)(m, en);
+}
+
+/**
+ * crypt_pgp_decrypt_ahead_done - Wrapper for CryptModuleSpecs::pgp_decrypt_ahead_done()
+ */
+void crypt_pgp_decrypt_ahead_done(void)
+{
+  if (CRYPT_MOD_CALL_CHECK(PGP, pgp_decrypt_ahead_done))
+    CRYPT_MOD_CALL(PGP, pgp_decrypt_ahead_done)();
+}
+
 /**
  * crypt_pgp_set_sender - Wrapper for CryptModuleSpecs::set_sender()
  */
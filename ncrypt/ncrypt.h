@@ -59,6 +59,8 @@ struct Body;
 struct Envelope;
 struct Email;
 struct EmailList;
+struct EmailNode;
+struct Mailbox;
 struct State;
 
 /* These Config Variables are only used in ncrypt/crypt.c */
@@ -72,6 +74,7 @@ extern unsigned char C_SmimeEncryptSelf; ///< Deprecated, see #C_SmimeSelfEncryp
 extern bool          C_SmimeSelfEncrypt;
 
 /* These Config Variables are only used in ncrypt/cryptglue.c */
+extern bool C_CryptSpawnHelper;
 extern bool C_CryptUseGpgme;
 
 /* These Config Variables are only used in ncrypt/pgp.c */
@@ -79,6 +82,7 @@ extern bool          C_PgpCheckExit;
 extern bool          C_PgpCheckGpgDecryptStatusFd;
 extern struct Regex *C_PgpDecryptionOkay;
 extern struct Regex *C_PgpGoodSign;
+extern short         C_PgpDecryptJobs;
 extern long          C_PgpTimeout;
 extern bool          C_PgpUseGpgAgent;
 
@@ -205,6 +209,8 @@ void         crypt_init(void);
 void         crypt_invoke_message(SecurityFlags type);
 int          crypt_pgp_application_handler(struct Body *m, struct State *s);
 int          crypt_pgp_check_traditional(FILE *fp, struct Body *b, bool just_one);
+void         crypt_pgp_decrypt_ahead(struct Mailbox *m, struct EmailNode *en);
+void         crypt_pgp_decrypt_ahead_done(void);
 int          crypt_pgp_decrypt_mime(FILE *fp_in, FILE **fp_out, struct Body *b, struct Body **cur);
 int          crypt_pgp_encrypted_handler(struct Body *a, struct State *s);
 void         crypt_pgp_extract_key_from_attachment(FILE *fp, struct Body *top);
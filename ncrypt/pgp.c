@@ -35,6 +35,7 @@
 #include "config.h"
 #include <limits.h>
 #include <regex.h>
+#include <signal.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -54,8 +55,11 @@
 #include "globals.h"
 #include "handler.h"
 #include "hook.h"
+#include "mailbox.h"
 #include "mutt_attach.h"
+#include "mutt_parse.h"
 #include "muttlib.h"
+#include "mx.h"
 #include "ncrypt.h"
 #include "options.h"
 #include "pgpinvoke.h"
@@ -73,6 +77,7 @@ bool C_PgpCheckExit; ///< Config: Check the exit code of PGP subprocess
 bool C_PgpCheckGpgDecryptStatusFd; ///< Config: File descriptor used for status info
 struct Regex *C_PgpDecryptionOkay; ///< Config: Text indicating a successful decryption
 struct Regex *C_PgpGoodSign; ///< Config: Text indicating a good signature
+short C_PgpDecryptJobs; ///< Config: Number of PGP/MIME emails to decrypt in parallel
 long C_PgpTimeout;           ///< Config: Time in seconds to cache a passphrase
 bool C_PgpUseGpgAgent;       ///< Config: Use a PGP agent for caching passwords
 
@@ -982,74 +987,348 @@ void pgp_class_extract_key_from_attachment(FILE *fp, struct Body *top)
 }
 
 /**
- * pgp_decrypt_part - Decrypt part of a PGP message
- * @param a      Body of attachment
- * @param s      State to use
- * @param fp_out File to write to
- * @param p      Body of parent (main email)
- * @retval ptr New Body for the attachment
+ * struct PgpDecryptJob - A PGP process decrypting an email part
+ *
+ * The output is collected in temporary files, so the process can run while
+ * NeoMutt does something else.
  */
-static struct Body *pgp_decrypt_part(struct Body *a, struct State *s,
-                                     FILE *fp_out, struct Body *p)
+struct PgpDecryptJob
 {
-  if (!a || !s || !fp_out || !p)
-    return NULL;
+  struct Body *body;      ///< Encrypted part being decrypted
+  LOFF_T offset;          ///< Offset of the data given to PGP
+  size_t length;          ///< Length of the data given to PGP
+  pid_t pid;              ///< PID of the PGP process
+  FILE *fp_out;           ///< PGP's output
+  FILE *fp_err;           ///< PGP's error messages and status
+  char tmpfile[PATH_MAX]; ///< Encrypted data given to PGP
+  STAILQ_ENTRY(PgpDecryptJob) entries;
+};
+STAILQ_HEAD(PgpDecryptJobList, PgpDecryptJob);
+
+/// Decryptions running in the background, in the order they were started
+static struct PgpDecryptJobList DecryptJobs = STAILQ_HEAD_INITIALIZER(DecryptJobs);
+
+/// A decryption has succeeded, so the passphrase, or the agent, is ready
+static bool DecryptAheadReady = false;
 
-  char buf[1024];
-  FILE *fp_pgp_in = NULL, *fp_pgp_out = NULL, *fp_pgp_tmp = NULL;
-  struct stat info;
-  struct Body *tattach = NULL;
-  char pgptmpfile[PATH_MAX];
-  pid_t pid;
-  int rv;
+/**
+ * pgp_decrypt_job_free - Free a PGP decryption job
+ * @param ptr Job to free
+ *
+ * If the PGP process is still running, it is stopped.
+ */
+static void pgp_decrypt_job_free(struct PgpDecryptJob **ptr)
+{
+  if (!ptr || !*ptr)
+    return;
 
-  FILE *fp_pgp_err = mutt_file_mkstemp();
-  if (!fp_pgp_err)
+  struct PgpDecryptJob *job = *ptr;
+  if (job->pid != -1)
+  {
+    kill(job->pid, SIGTERM);
+    mutt_wait_filter(job->pid);
+  }
+  if (job->tmpfile[0] != '\0')
+    mutt_file_unlink(job->tmpfile);
+  mutt_file_fclose(&job->fp_out);
+  mutt_file_fclose(&job->fp_err);
+  FREE(ptr);
+}
+
+/**
+ * pgp_decrypt_start - Start a PGP process to decrypt part of a file
+ * @param fp_in  File containing the encrypted data
+ * @param offset Offset of the encrypted data
+ * @param length Length of the encrypted data
+ * @param[out] job_out New decryption job
+ * @retval  0 Success
+ * @retval -1 Error creating a temporary file
+ * @retval -2 Error creating the PGP process
+ */
+static int pgp_decrypt_start(FILE *fp_in, LOFF_T offset, size_t length,
+                             struct PgpDecryptJob **job_out)
+{
+  FILE *fp_pgp_in = NULL, *fp_pgp_tmp = NULL;
+  struct PgpDecryptJob *job = mutt_mem_calloc(1, sizeof(struct PgpDecryptJob));
+  job->offset = offset;
+  job->length = length;
+  job->pid = -1;
+
+  job->fp_err = mutt_file_mkstemp();
+  job->fp_out = mutt_file_mkstemp();
+  if (!job->fp_err || !job->fp_out)
   {
     mutt_perror(_("Can't create temporary file"));
-    return NULL;
+    pgp_decrypt_job_free(&job);
+    return -1;
   }
 
-  mutt_mktemp(pgptmpfile, sizeof(pgptmpfile));
-  fp_pgp_tmp = mutt_file_fopen(pgptmpfile, "w");
+  mutt_mktemp(job->tmpfile, sizeof(job->tmpfile));
+  fp_pgp_tmp = mutt_file_fopen(job->tmpfile, "w");
   if (!fp_pgp_tmp)
   {
-    mutt_perror(pgptmpfile);
-    mutt_file_fclose(&fp_pgp_err);
-    return NULL;
+    mutt_perror(job->tmpfile);
+    job->tmpfile[0] = '\0';
+    pgp_decrypt_job_free(&job);
+    return -1;
   }
 
   /* Position the stream at the beginning of the body, and send the data to
    * the temporary file.  */
 
-  fseeko(s->fp_in, a->offset, SEEK_SET);
-  mutt_file_copy_bytes(s->fp_in, fp_pgp_tmp, a->length);
+  fseeko(fp_in, offset, SEEK_SET);
+  mutt_file_copy_bytes(fp_in, fp_pgp_tmp, length);
   mutt_file_fclose(&fp_pgp_tmp);
 
-  pid = pgp_invoke_decrypt(&fp_pgp_in, &fp_pgp_out, NULL, -1, -1,
-                           fileno(fp_pgp_err), pgptmpfile);
-  if (pid == -1)
+  job->pid = pgp_invoke_decrypt(&fp_pgp_in, NULL, NULL, -1, fileno(job->fp_out),
+                                fileno(job->fp_err), job->tmpfile);
+  if (job->pid == -1)
   {
-    mutt_file_fclose(&fp_pgp_err);
-    unlink(pgptmpfile);
-    if (s->flags & MUTT_DISPLAY)
-    {
-      state_attach_puts(
-          _("[-- Error: could not create a PGP subprocess --]\n\n"), s);
-    }
-    return NULL;
+    pgp_decrypt_job_free(&job);
+    return -2;
   }
 
   /* send the PGP passphrase to the subprocess.  Never do this if the agent is
-   * active, because this might lead to a passphrase send as the message. */
+   * active, because this might lead to a passphrase send as the message.
+   * Close the pipe now, so that the next PGP process doesn't inherit it. */
   if (!pgp_use_gpg_agent())
     fputs(PgpPass, fp_pgp_in);
   fputc('\n', fp_pgp_in);
   mutt_file_fclose(&fp_pgp_in);
 
+  *job_out = job;
+  return 0;
+}
+
+/**
+ * pgp_decrypt_ahead_find - Find a background decryption of an email part
+ * @param a Encrypted part
+ * @retval ptr Job decrypting the part
+ * @retval NULL The part isn't being decrypted
+ */
+static struct PgpDecryptJob *pgp_decrypt_ahead_find(struct Body *a)
+{
+  struct PgpDecryptJob *job = NULL;
+  STAILQ_FOREACH(job, &DecryptJobs, entries)
+  {
+    if ((job->body == a) && (job->offset == a->offset) && (job->length == a->length))
+      return job;
+  }
+  return NULL;
+}
+
+/**
+ * pgp_encrypted_part - Find the encrypted data of a PGP/MIME email
+ * @param[in]  b           Body of the email
+ * @param[out] need_decode Set to true if the part has a Content-Transfer-Encoding
+ * @retval ptr  Part containing the encrypted data
+ * @retval NULL The email isn't PGP/MIME encrypted
+ */
+static struct Body *pgp_encrypted_part(struct Body *b, bool *need_decode)
+{
+  if (mutt_is_valid_multipart_pgp_encrypted(b))
+  {
+    b = b->parts->next;
+    /* Some clients improperly encode the octetstream part. */
+    *need_decode = (b->encoding != ENC_7BIT);
+    return b;
+  }
+
+  if (mutt_is_malformed_multipart_pgp_encrypted(b))
+  {
+    *need_decode = true;
+    return b->parts->next->next;
+  }
+
+  return NULL;
+}
+
+/**
+ * pgp_decrypt_ahead_email - Start decrypting an Email in the background
+ * @param m Mailbox
+ * @param e Email
+ * @retval true A new PGP process was started
+ */
+static bool pgp_decrypt_ahead_email(struct Mailbox *m, struct Email *e)
+{
+  bool need_decode = false;
+
+  if (!(mutt_is_multipart_encrypted(e->content) & PGP_ENCRYPT))
+    return false;
+
+  mutt_parse_mime_message(m, e);
+  struct Body *b = pgp_encrypted_part(e->content, &need_decode);
+  if (!b)
+    return false;
+
+  struct PgpDecryptJob *job = NULL;
+  STAILQ_FOREACH(job, &DecryptJobs, entries)
+  {
+    if (job->body == b)
+      return false;
+  }
+
+  struct Message *msg = mx_msg_open(m, e->msgno);
+  if (!msg)
+    return false;
+
+  FILE *fp_in = msg->fp;
+  FILE *fp_decoded = NULL;
+  LOFF_T offset = b->offset;
+  size_t length = b->length;
+
+  if (need_decode)
+  {
+    /* Decode it the same way as pgp_class_decrypt_mime() */
+    fp_decoded = mutt_file_mkstemp();
+    if (!fp_decoded)
+    {
+      mx_msg_close(m, &msg);
+      return false;
+    }
+
+    struct State s = { 0 };
+    s.fp_in = msg->fp;
+    s.fp_out = fp_decoded;
+    fseeko(s.fp_in, b->offset, SEEK_SET);
+    mutt_decode_attachment(b, &s);
+
+    fflush(fp_decoded);
+    offset = 0;
+    length = ftello(fp_decoded);
+    fp_in = fp_decoded;
+  }
+
+  if (pgp_decrypt_start(fp_in, offset, length, &job) == 0)
+  {
+    job->body = b;
+    STAILQ_INSERT_TAIL(&DecryptJobs, job, entries);
+  }
+
+  mutt_file_fclose(&fp_decoded);
+  mx_msg_close(m, &msg);
+  return job;
+}
+
+/**
+ * pgp_class_decrypt_ahead - Implements CryptModuleSpecs::pgp_decrypt_ahead()
+ *
+ * Keep up to $pgp_decrypt_jobs PGP processes busy with the Emails that are
+ * about to be decrypted.  The caller still handles the Emails one at a time,
+ * in order; pgp_decrypt_part() collects the output when it gets there.
+ *
+ * Nothing is started until one decryption has succeeded, so that any
+ * passphrase or agent prompt happens once, in the foreground.
+ */
+void pgp_class_decrypt_ahead(struct Mailbox *m, struct EmailNode *en)
+{
+  if (!m || !en || (C_PgpDecryptJobs < 2) || !DecryptAheadReady)
+    return;
+
+  /* Opening the messages twice would download them twice */
+  if ((m->magic == MUTT_IMAP) || (m->magic == MUTT_POP) || (m->magic == MUTT_NNTP))
+    return;
+
+  /* Don't hand an expired passphrase to PGP */
+  if (!pgp_use_gpg_agent() && (time(NULL) >= PgpExptime))
+    return;
+
+  /* Drop the work for any Emails that were passed over without decrypting */
+  int count = 0;
+  struct PgpDecryptJob *job = NULL, *tmp = NULL;
+  STAILQ_FOREACH_SAFE(job, &DecryptJobs, entries, tmp)
+  {
+    bool wanted = false;
+    struct EmailNode *np = en;
+    for (int i = 0; np && !wanted && (i < C_PgpDecryptJobs); i++)
+    {
+      bool need_decode = false;
+      wanted = (job->body == pgp_encrypted_part(np->email->content, &need_decode));
+      np = STAILQ_NEXT(np, entries);
+    }
+
+    if (wanted)
+    {
+      count++;
+      continue;
+    }
+
+    STAILQ_REMOVE(&DecryptJobs, job, PgpDecryptJob, entries);
+    pgp_decrypt_job_free(&job);
+  }
+
+  for (int i = 0; en && (i < C_PgpDecryptJobs) && (count < C_PgpDecryptJobs); i++)
+  {
+    if (pgp_decrypt_ahead_email(m, en->email))
+      count++;
+    en = STAILQ_NEXT(en, entries);
+  }
+}
+
+/**
+ * pgp_class_decrypt_ahead_done - Implements CryptModuleSpecs::pgp_decrypt_ahead_done()
+ */
+void pgp_class_decrypt_ahead_done(void)
+{
+  struct PgpDecryptJob *job = NULL, *tmp = NULL;
+  STAILQ_FOREACH_SAFE(job, &DecryptJobs, entries, tmp)
+  {
+    STAILQ_REMOVE(&DecryptJobs, job, PgpDecryptJob, entries);
+    pgp_decrypt_job_free(&job);
+  }
+  DecryptAheadReady = false;
+}
+
+/**
+ * pgp_decrypt_part - Decrypt part of a PGP message
+ * @param a      Body of attachment
+ * @param s      State to use
+ * @param fp_out File to write to
+ * @param p      Body of parent (main email)
+ * @retval ptr New Body for the attachment
+ *
+ * If the part is already being decrypted in the background, the output of
+ * that PGP process is used.
+ */
+static struct Body *pgp_decrypt_part(struct Body *a, struct State *s,
+                                     FILE *fp_out, struct Body *p)
+{
+  if (!a || !s || !fp_out || !p)
+    return NULL;
+
+  char buf[1024];
+  FILE *fp_pgp_err = NULL;
+  struct stat info;
+  struct Body *tattach = NULL;
+  int rv;
+
+  struct PgpDecryptJob *job = pgp_decrypt_ahead_find(a);
+  if (job)
+  {
+    STAILQ_REMOVE(&DecryptJobs, job, PgpDecryptJob, entries);
+  }
+  else
+  {
+    rv = pgp_decrypt_start(s->fp_in, a->offset, a->length, &job);
+    if (rv == -2)
+    {
+      if (s->flags & MUTT_DISPLAY)
+      {
+        state_attach_puts(
+            _("[-- Error: could not create a PGP subprocess --]\n\n"), s);
+      }
+    }
+    if (rv != 0)
+      return NULL;
+  }
+
+  rv = mutt_wait_filter(job->pid);
+  job->pid = -1;
+
   /* Read the output from PGP, and make sure to change CRLF to LF, otherwise
    * read_mime_header has a hard time parsing the message.  */
-  while (fgets(buf, sizeof(buf) - 1, fp_pgp_out))
+  rewind(job->fp_out);
+  while (fgets(buf, sizeof(buf) - 1, job->fp_out))
   {
     size_t len = mutt_str_strlen(buf);
     if ((len > 1) && (buf[len - 2] == '\r'))
@@ -1057,9 +1336,9 @@ static struct Body *pgp_decrypt_part(struct Body *a, struct State *s,
     fputs(buf, fp_out);
   }
 
-  mutt_file_fclose(&fp_pgp_out);
-  rv = mutt_wait_filter(pid);
-  mutt_file_unlink(pgptmpfile);
+  fp_pgp_err = job->fp_err;
+  job->fp_err = NULL;
+  pgp_decrypt_job_free(&job);
 
   fflush(fp_pgp_err);
   rewind(fp_pgp_err);
@@ -1068,6 +1347,7 @@ static struct Body *pgp_decrypt_part(struct Body *a, struct State *s,
     mutt_error(_("Decryption failed"));
     pgp_class_void_passphrase();
     mutt_file_fclose(&fp_pgp_err);
+    DecryptAheadReady = false;
     return NULL;
   }
 
@@ -1092,9 +1372,11 @@ static struct Body *pgp_decrypt_part(struct Body *a, struct State *s,
   {
     mutt_error(_("Decryption failed"));
     pgp_class_void_passphrase();
+    DecryptAheadReady = false;
     return NULL;
   }
 
+  DecryptAheadReady = true;
   rewind(fp_out);
 
   tattach = mutt_read_mime_header(fp_out, 0);
@@ -1125,19 +1407,8 @@ int pgp_class_decrypt_mime(FILE *fp_in, FILE **fp_out, struct Body *b, struct Bo
   FILE *fp_decoded = NULL;
   int rc = 0;
 
-  if (mutt_is_valid_multipart_pgp_encrypted(b))
-  {
-    b = b->parts->next;
-    /* Some clients improperly encode the octetstream part. */
-    if (b->encoding != ENC_7BIT)
-      need_decode = true;
-  }
-  else if (mutt_is_malformed_multipart_pgp_encrypted(b))
-  {
-    b = b->parts->next->next;
-    need_decode = true;
-  }
-  else
+  b = pgp_encrypted_part(b, &need_decode);
+  if (!b)
     return -1;
 
   s.fp_in = fp_in;
@@ -33,6 +33,8 @@
 struct AddressList;
 struct Body;
 struct Email;
+struct EmailNode;
+struct Mailbox;
 struct PgpKeyInfo;
 struct State;
 
@@ -53,6 +55,8 @@ char *pgp_class_find_keys(struct AddressList *addrlist, bool oppenc_mode);
 int pgp_class_application_handler(struct Body *m, struct State *s);
 int pgp_class_encrypted_handler(struct Body *a, struct State *s);
 void pgp_class_extract_key_from_attachment(FILE *fp, struct Body *top);
+void pgp_class_decrypt_ahead(struct Mailbox *m, struct EmailNode *en);
+void pgp_class_decrypt_ahead_done(void);
 void pgp_class_void_passphrase(void);
 bool pgp_class_valid_passphrase(void);
 
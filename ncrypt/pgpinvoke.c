@@ -229,8 +229,8 @@ static pid_t pgp_invoke(FILE **fp_pgp_in, FILE **fp_pgp_out, FILE **fp_pgp_err,
 
   mutt_pgp_command(cmd, sizeof(cmd), &cctx, format);
 
-  return mutt_create_filter_fd(cmd, fp_pgp_in, fp_pgp_out, fp_pgp_err,
-                               fd_pgp_in, fd_pgp_out, fd_pgp_err);
+  return mutt_create_filter_helper(cmd, fp_pgp_in, fp_pgp_out, fp_pgp_err,
+                                   fd_pgp_in, fd_pgp_out, fd_pgp_err);
 }
 
 /*
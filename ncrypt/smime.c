@@ -410,8 +410,8 @@ static pid_t smime_invoke(FILE **fp_smime_in, FILE **fp_smime_out, FILE **fp_smi
 
   smime_command(cmd, sizeof(cmd), &cctx, format);
 
-  return mutt_create_filter_fd(cmd, fp_smime_in, fp_smime_out, fp_smime_err,
-                               fp_smime_infd, fp_smime_outfd, fp_smime_errfd);
+  return mutt_create_filter_helper(cmd, fp_smime_in, fp_smime_out, fp_smime_err,
+                                   fp_smime_infd, fp_smime_outfd, fp_smime_errfd);
 }
 
 /*
@@ -1006,6 +1006,7 @@ void smime_class_getkeys(struct Envelope *env)
     return;
   }
 
+  mutt_env_thaw(env);
   struct Address *a = NULL;
   TAILQ_FOREACH(a, &env->to, entries)
   {
@@ -2878,6 +2878,7 @@ struct MxOps MxNntpOps = {
   .ac_find          = nntp_ac_find,
   .ac_add           = nntp_ac_add,
   .mbox_open        = nntp_mbox_open,
+  .mbox_open_more   = NULL,
   .mbox_open_append = NULL,
   .mbox_check       = nntp_mbox_check,
   .mbox_sync        = nntp_mbox_sync,
@@ -47,6 +47,7 @@
 #include <limits.h>
 #include <notmuch.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
@@ -85,14 +86,24 @@ char *C_NmUnreadTag;  ///< Config: (notmuch) Tag to use for unread messages
 char *C_NmFlaggedTag; ///< Config: (notmuch) Tag to use for flagged messages
 char *C_NmRepliedTag; ///< Config: (notmuch) Tag to use for replied messages
 
+static notmuch_database_t *CountDb = NULL; ///< Database shared by a batch of counts
+static char *CountDbFilename = NULL;       ///< Filename of CountDb
+static bool CountBatch = false;            ///< A batch of counts is in progress
+
 /**
  * nm_hcache_open - Open a header cache
  * @param m Mailbox
  * @retval ptr Header cache handle
+ *
+ * If the Mailbox is open, this takes another reference to its cache.
  */
 static header_cache_t *nm_hcache_open(struct Mailbox *m)
 {
 #ifdef USE_HCACHE
+  struct NmMboxData *mdata = nm_mdata_get(m);
+  if (mdata && mdata->hcache)
+    return mutt_hcache_ref(mdata->hcache);
+
   return mutt_hcache_open(C_HeaderCache, mutt_b2s(m->pathbuf), NULL);
 #else
   return NULL;
@@ -191,6 +202,9 @@ void nm_mdata_free(void **ptr)
 
   struct NmMboxData *mdata = *ptr;
 
+#ifdef USE_HCACHE
+  mutt_hcache_close(mdata->hcache);
+#endif
   url_free(&mdata->db_url);
   FREE(&mdata->db_query);
   FREE(ptr);
@@ -1628,6 +1642,123 @@ static unsigned int count_query(notmuch_database_t *db, const char *qstr, int li
   return res;
 }
 
+/**
+ * nm_count_batch_begin - Start a batch of mailbox counts
+ *
+ * Until nm_count_batch_end() is called, nm_mbox_check_stats() keeps the
+ * database open, so all the counts share one read-only session.
+ */
+void nm_count_batch_begin(void)
+{
+  CountBatch = true;
+}
+
+/**
+ * nm_count_batch_fork - Start a batch of mailbox counts in a forked process
+ *
+ * The database the parent may have open for its counts isn't closed: it still
+ * belongs to the parent.  It's forgotten, and the counts open their own.
+ */
+void nm_count_batch_fork(void)
+{
+  CountDb = NULL;
+  CountDbFilename = NULL;
+  CountBatch = true;
+}
+
+/**
+ * nm_count_batch_end - Finish a batch of mailbox counts
+ */
+void nm_count_batch_end(void)
+{
+  CountBatch = false;
+  if (CountDb)
+  {
+    nm_db_free(CountDb);
+    mutt_debug(LL_DEBUG1, "nm: count close DB\n");
+  }
+  CountDb = NULL;
+  FREE(&CountDbFilename);
+}
+
+/**
+ * count_db_open - Open the database for counting
+ * @param filename Database filename
+ * @retval ptr  Notmuch database
+ * @retval NULL Error
+ */
+static notmuch_database_t *count_db_open(const char *filename)
+{
+  if (CountDb && (mutt_str_strcmp(filename, CountDbFilename) == 0))
+    return CountDb;
+
+  /* don't be verbose about connection, as we're called from
+   * sidebar/mailbox very often */
+  notmuch_database_t *db = nm_db_do_open(filename, false, false);
+  if (db && CountBatch)
+  {
+    if (CountDb)
+      nm_db_free(CountDb);
+    CountDb = db;
+    mutt_str_replace(&CountDbFilename, filename);
+  }
+
+  return db;
+}
+
+/**
+ * count_db_close - Close the database after counting
+ * @param db Notmuch database
+ *
+ * The database is kept open until the end of a batch.
+ */
+static void count_db_close(notmuch_database_t *db)
+{
+  if (!db || (db == CountDb))
+    return;
+
+  nm_db_free(db);
+  mutt_debug(LL_DEBUG1, "nm: count close DB\n");
+}
+
+/**
+ * count_key - Identify the state of the database that the counts depend on
+ * @param[in]  db    Notmuch database
+ * @param[in]  query Query being counted
+ * @param[in]  limit Maximum number of results
+ * @param[out] rev   Database revision, for Mailbox.stats_revision
+ * @param[out] hash  Hash of the query, for Mailbox.stats_hash
+ * @retval true  Key is valid
+ * @retval false The database has no revisions
+ *
+ * The key is the database's revision, plus a hash of its UUID, the query and
+ * the config the counts depend on.  While it doesn't change, neither do the
+ * counts.
+ */
+static bool count_key(notmuch_database_t *db, const char *query, int limit,
+                      unsigned long *rev, unsigned int *hash)
+{
+#if LIBNOTMUCH_CHECK_VERSION(4, 3, 0)
+  const char *uuid = NULL;
+  *rev = notmuch_database_get_revision(db, &uuid);
+
+  const char *parts[] = { uuid, query, C_NmExcludeTags, C_NmUnreadTag, C_NmFlaggedTag };
+  uint32_t h = 2166136261u; /* FNV-1a */
+  for (size_t i = 0; i < mutt_array_size(parts); i++)
+  {
+    for (const char *s = NONULL(parts[i]); *s; s++)
+      h = (h ^ (unsigned char) *s) * 16777619u;
+    h = (h ^ '\n') * 16777619u;
+  }
+  h = (h ^ (uint32_t) limit) * 16777619u;
+
+  *hash = h ? h : 1; /* 0 means the Mailbox hasn't been counted */
+  return true;
+#else
+  return false;
+#endif
+}
+
 /**
  * nm_email_get_folder - Get the folder for a Email
  * @param e Email
@@ -1922,6 +2053,9 @@ static int nm_mbox_check_stats(struct Mailbox *m, int flags)
   struct Url *url = NULL;
   char *db_filename = NULL, *db_query = NULL;
   notmuch_database_t *db = NULL;
+  unsigned long rev = 0;
+  unsigned int hash = 0;
+  bool have_key = false;
   int rc = -1;
   int limit = C_NmDbLimit;
   mutt_debug(LL_DEBUG1, "nm: count\n");
@@ -1965,12 +2099,19 @@ static int nm_mbox_check_stats(struct Mailbox *m, int flags)
       db_filename = C_Folder;
   }
 
-  /* don't be verbose about connection, as we're called from
-   * sidebar/mailbox very often */
-  db = nm_db_do_open(db_filename, false, false);
+  db = count_db_open(db_filename);
   if (!db)
     goto done;
 
+  /* Nothing has changed since the last count */
+  have_key = count_key(db, db_query, limit, &rev, &hash);
+  if (have_key && (hash == m->stats_hash) && (rev == m->stats_revision))
+  {
+    mutt_debug(LL_DEBUG1, "nm: count unchanged, revision %lu\n", rev);
+    rc = 0;
+    goto done;
+  }
+
   /* all emails */
   m->msg_count = count_query(db, db_query, limit);
 
@@ -1987,13 +2128,15 @@ static int nm_mbox_check_stats(struct Mailbox *m, int flags)
   m->msg_flagged = count_query(db, qstr, limit);
   FREE(&qstr);
 
-  rc = 0;
-done:
-  if (db)
+  if (have_key)
   {
-    nm_db_free(db);
-    mutt_debug(LL_DEBUG1, "nm: count close DB\n");
+    m->stats_revision = rev;
+    m->stats_hash = hash;
   }
+
+  rc = 0;
+done:
+  count_db_close(db);
   url_free(&url);
 
   mutt_debug(LL_DEBUG1, "nm: count done [rc=%d]\n", rc);
@@ -2185,6 +2328,14 @@ static int nm_mbox_open(struct Mailbox *m)
 
   mutt_debug(LL_DEBUG1, "nm: reading messages...[current count=%d]\n", m->msg_count);
 
+  /* Once the Mailbox has been read, its counts don't match the last check */
+  m->stats_hash = 0;
+
+#ifdef USE_HCACHE
+  if (!mdata->hcache)
+    mdata->hcache = mutt_hcache_open(C_HeaderCache, mutt_b2s(m->pathbuf), NULL);
+#endif
+
   progress_reset(m);
 
   if (!m->emails)
@@ -2451,11 +2602,17 @@ static int nm_mbox_sync(struct Mailbox *m, int *index_hint)
 
 /**
  * nm_mbox_close - Implements MxOps::mbox_close()
- *
- * Nothing to do.
  */
 static int nm_mbox_close(struct Mailbox *m)
 {
+#ifdef USE_HCACHE
+  struct NmMboxData *mdata = nm_mdata_get(m);
+  if (mdata)
+  {
+    mutt_hcache_close(mdata->hcache);
+    mdata->hcache = NULL;
+  }
+#endif
   return 0;
 }
 
@@ -2607,6 +2764,7 @@ struct MxOps MxNotmuchOps = {
   .ac_find          = nm_ac_find,
   .ac_add           = nm_ac_add,
   .mbox_open        = nm_mbox_open,
+  .mbox_open_more   = NULL,
   .mbox_open_append = NULL,
   .mbox_check       = nm_mbox_check,
   .mbox_check_stats = nm_mbox_check_stats,
@@ -26,6 +26,7 @@
 #include "config/lib.h"
 #include "progress.h"
 #include "mailbox.h"
+#include "hcache/hcache.h"
 
 #ifndef MUTT_NOTMUCH_NOTMUCH_PRIVATE_H
 #define MUTT_NOTMUCH_NOTMUCH_PRIVATE_H
@@ -82,6 +83,8 @@ struct NmMboxData
 
   bool noprogress : 1;     /**< Don't show the progress bar */
   bool progress_ready : 1; /**< A progress bar has been initialised */
+
+  header_cache_t *hcache;  /**< Header cache, held from mbox_open() until mbox_close() */
 };
 
 /**
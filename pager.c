@@ -67,6 +67,7 @@
 #include "opcodes.h"
 #include "options.h"
 #include "protos.h"
+#include "quoted.h"
 #include "recvattach.h"
 #include "recvcmd.h"
 #include "send.h"
@@ -144,19 +145,6 @@ static struct Email *OldHdr = NULL;
     break;                                                                     \
   }
 
-/**
- * struct QClass - Style of quoted text
- */
-struct QClass
-{
-  size_t length;
-  int index;
-  int color;
-  char *prefix;
-  struct QClass *next, *prev;
-  struct QClass *down, *up;
-};
-
 /**
  * struct Syntax - Highlighting for a line of text
  */
@@ -437,394 +425,6 @@ static void append_line(struct Line *line_info, int n, int cnt)
       (line_info[n].continuation) ? cnt + (line_info[n].syntax)[0].last : cnt;
 }
 
-/**
- * new_class_color - Create a new quoting colour
- * @param[in]     class   Class of quoted text
- * @param[in,out] q_level Quote level
- */
-static void new_class_color(struct QClass *class, int *q_level)
-{
-  class->index = (*q_level)++;
-  class->color = ColorQuote[class->index % ColorQuoteUsed];
-}
-
-/**
- * shift_class_colors - Insert a new quote colour class into a list
- * @param[in]     quote_list List of quote colours
- * @param[in]     new_class  New quote colour to inset
- * @param[in]     index      Index to insert at
- * @param[in,out] q_level    Quote level
- */
-static void shift_class_colors(struct QClass *quote_list,
-                               struct QClass *new_class, int index, int *q_level)
-{
-  struct QClass *q_list = quote_list;
-  new_class->index = -1;
-
-  while (q_list)
-  {
-    if (q_list->index >= index)
-    {
-      q_list->index++;
-      q_list->color = ColorQuote[q_list->index % ColorQuoteUsed];
-    }
-    if (q_list->down)
-      q_list = q_list->down;
-    else if (q_list->next)
-      q_list = q_list->next;
-    else
-    {
-      while (!q_list->next)
-      {
-        q_list = q_list->up;
-        if (!q_list)
-          break;
-      }
-      if (q_list)
-        q_list = q_list->next;
-    }
-  }
-
-  new_class->index = index;
-  new_class->color = ColorQuote[index % ColorQuoteUsed];
-  (*q_level)++;
-}
-
-/**
- * cleanup_quote - Free a quote list
- * @param[out] quote_list Quote list to free
- */
-static void cleanup_quote(struct QClass **quote_list)
-{
-  struct QClass *ptr = NULL;
-
-  while (*quote_list)
-  {
-    if ((*quote_list)->down)
-      cleanup_quote(&((*quote_list)->down));
-    ptr = (*quote_list)->next;
-    if ((*quote_list)->prefix)
-      FREE(&(*quote_list)->prefix);
-    FREE(quote_list);
-    *quote_list = ptr;
-  }
-}
-
-/**
- * classify_quote - Find a style for a string
- * @param[out] quote_list   List of quote colours
- * @param[in]  qptr         String to classify
- * @param[in]  length       Length of string
- * @param[out] force_redraw Set to true if a screen redraw is needed
- * @param[out] q_level      Quoting level
- * @retval ptr Quoting style
- */
-static struct QClass *classify_quote(struct QClass **quote_list, const char *qptr,
-                                     size_t length, bool *force_redraw, int *q_level)
-{
-  struct QClass *q_list = *quote_list;
-  struct QClass *class = NULL, *tmp = NULL, *ptr = NULL, *save = NULL;
-  char *tail_qptr = NULL;
-  int offset, tail_lng;
-  int index = -1;
-
-  if (ColorQuoteUsed <= 1)
-  {
-    /* not much point in classifying quotes... */
-
-    if (!*quote_list)
-    {
-      class = mutt_mem_calloc(1, sizeof(struct QClass));
-      class->color = ColorQuote[0];
-      *quote_list = class;
-    }
-    return *quote_list;
-  }
-
-  /* classify quoting prefix */
-  while (q_list)
-  {
-    if (length <= q_list->length)
-    {
-      /* case 1: check the top level nodes */
-
-      if (mutt_str_strncmp(qptr, q_list->prefix, length) == 0)
-      {
-        if (length == q_list->length)
-          return q_list; /* same prefix: return the current class */
-
-        /* found shorter prefix */
-        if (!tmp)
-        {
-          /* add a node above q_list */
-          tmp = mutt_mem_calloc(1, sizeof(struct QClass));
-          tmp->prefix = mutt_mem_calloc(1, length + 1);
-          strncpy(tmp->prefix, qptr, length);
-          tmp->length = length;
-
-          /* replace q_list by tmp in the top level list */
-          if (q_list->next)
-          {
-            tmp->next = q_list->next;
-            q_list->next->prev = tmp;
-          }
-          if (q_list->prev)
-          {
-            tmp->prev = q_list->prev;
-            q_list->prev->next = tmp;
-          }
-
-          /* make q_list a child of tmp */
-          tmp->down = q_list;
-          q_list->up = tmp;
-
-          /* q_list has no siblings for now */
-          q_list->next = NULL;
-          q_list->prev = NULL;
-
-          /* update the root if necessary */
-          if (q_list == *quote_list)
-            *quote_list = tmp;
-
-          index = q_list->index;
-
-          /* tmp should be the return class too */
-          class = tmp;
-
-          /* next class to test; if tmp is a shorter prefix for another
-           * node, that node can only be in the top level list, so don't
-           * go down after this point */
-          q_list = tmp->next;
-        }
-        else
-        {
-          /* found another branch for which tmp is a shorter prefix */
-
-          /* save the next sibling for later */
-          save = q_list->next;
-
-          /* unlink q_list from the top level list */
-          if (q_list->next)
-            q_list->next->prev = q_list->prev;
-          if (q_list->prev)
-            q_list->prev->next = q_list->next;
-
-          /* at this point, we have a tmp->down; link q_list to it */
-          ptr = tmp->down;
-          /* sibling order is important here, q_list should be linked last */
-          while (ptr->next)
-            ptr = ptr->next;
-          ptr->next = q_list;
-          q_list->next = NULL;
-          q_list->prev = ptr;
-          q_list->up = tmp;
-
-          index = q_list->index;
-
-          /* next class to test; as above, we shouldn't go down */
-          q_list = save;
-        }
-
-        /* we found a shorter prefix, so certain quotes have changed classes */
-        *force_redraw = true;
-        continue;
-      }
-      else
-      {
-        /* shorter, but not a substring of the current class: try next */
-        q_list = q_list->next;
-        continue;
-      }
-    }
-    else
-    {
-      /* case 2: try subclassing the current top level node */
-
-      /* tmp != NULL means we already found a shorter prefix at case 1 */
-      if (!tmp && (mutt_str_strncmp(qptr, q_list->prefix, q_list->length) == 0))
-      {
-        /* ok, it's a subclass somewhere on this branch */
-
-        ptr = q_list;
-        offset = q_list->length;
-
-        q_list = q_list->down;
-        tail_lng = length - offset;
-        tail_qptr = (char *) qptr + offset;
-
-        while (q_list)
-        {
-          if (length <= q_list->length)
-          {
-            if (mutt_str_strncmp(tail_qptr, (q_list->prefix) + offset, tail_lng) == 0)
-            {
-              /* same prefix: return the current class */
-              if (length == q_list->length)
-                return q_list;
-
-              /* found shorter common prefix */
-              if (!tmp)
-              {
-                /* add a node above q_list */
-                tmp = mutt_mem_calloc(1, sizeof(struct QClass));
-                tmp->prefix = mutt_mem_calloc(1, length + 1);
-                strncpy(tmp->prefix, qptr, length);
-                tmp->length = length;
-
-                /* replace q_list by tmp */
-                if (q_list->next)
-                {
-                  tmp->next = q_list->next;
-                  q_list->next->prev = tmp;
-                }
-                if (q_list->prev)
-                {
-                  tmp->prev = q_list->prev;
-                  q_list->prev->next = tmp;
-                }
-
-                /* make q_list a child of tmp */
-                tmp->down = q_list;
-                tmp->up = q_list->up;
-                q_list->up = tmp;
-                if (tmp->up->down == q_list)
-                  tmp->up->down = tmp;
-
-                /* q_list has no siblings */
-                q_list->next = NULL;
-                q_list->prev = NULL;
-
-                index = q_list->index;
-
-                /* tmp should be the return class too */
-                class = tmp;
-
-                /* next class to test */
-                q_list = tmp->next;
-              }
-              else
-              {
-                /* found another branch for which tmp is a shorter prefix */
-
-                /* save the next sibling for later */
-                save = q_list->next;
-
-                /* unlink q_list from the top level list */
-                if (q_list->next)
-                  q_list->next->prev = q_list->prev;
-                if (q_list->prev)
-                  q_list->prev->next = q_list->next;
-
-                /* at this point, we have a tmp->down; link q_list to it */
-                ptr = tmp->down;
-                while (ptr->next)
-                  ptr = ptr->next;
-                ptr->next = q_list;
-                q_list->next = NULL;
-                q_list->prev = ptr;
-                q_list->up = tmp;
-
-                index = q_list->index;
-
-                /* next class to test */
-                q_list = save;
-              }
-
-              /* we found a shorter prefix, so we need a redraw */
-              *force_redraw = true;
-              continue;
-            }
-            else
-            {
-              q_list = q_list->next;
-              continue;
-            }
-          }
-          else
-          {
-            /* longer than the current prefix: try subclassing it */
-            if (!tmp && (mutt_str_strncmp(tail_qptr, (q_list->prefix) + offset,
-                                          q_list->length - offset) == 0))
-            {
-              /* still a subclass: go down one level */
-              ptr = q_list;
-              offset = q_list->length;
-
-              q_list = q_list->down;
-              tail_lng = length - offset;
-              tail_qptr = (char *) qptr + offset;
-
-              continue;
-            }
-            else
-            {
-              /* nope, try the next prefix */
-              q_list = q_list->next;
-              continue;
-            }
-          }
-        }
-
-        /* still not found so far: add it as a sibling to the current node */
-        if (!class)
-        {
-          tmp = mutt_mem_calloc(1, sizeof(struct QClass));
-          tmp->prefix = mutt_mem_calloc(1, length + 1);
-          strncpy(tmp->prefix, qptr, length);
-          tmp->length = length;
-
-          if (ptr->down)
-          {
-            tmp->next = ptr->down;
-            ptr->down->prev = tmp;
-          }
-          ptr->down = tmp;
-          tmp->up = ptr;
-
-          new_class_color(tmp, q_level);
-
-          return tmp;
-        }
-        else
-        {
-          if (index != -1)
-            shift_class_colors(*quote_list, tmp, index, q_level);
-
-          return class;
-        }
-      }
-      else
-      {
-        /* nope, try the next prefix */
-        q_list = q_list->next;
-        continue;
-      }
-    }
-  }
-
-  if (!class)
-  {
-    /* not found so far: add it as a top level class */
-    class = mutt_mem_calloc(1, sizeof(struct QClass));
-    class->prefix = mutt_mem_calloc(1, length + 1);
-    strncpy(class->prefix, qptr, length);
-    class->length = length;
-    new_class_color(class, q_level);
-
-    if (*quote_list)
-    {
-      class->next = *quote_list;
-      (*quote_list)->prev = class;
-    }
-    *quote_list = class;
-  }
-
-  if (index != -1)
-    shift_class_colors(*quote_list, tmp, index, q_level);
-
-  return class;
-}
-
 static int braille_line = -1;
 static int braille_col = -1;
 
@@ -866,44 +466,103 @@ static int check_protected_header_marker(const char *p)
 }
 
 /**
- * mutt_is_quote_line - Is a line of message text a quote?
- * @param[in]  line   Line to test
- * @param[out] pmatch Regex sub-matches
- * @retval true Line is quoted
+ * color_line_next - Find the next match of a colour pattern in a line
+ * @param color_line Colour pattern
+ * @param buf        Line of text
+ * @param offset     Where to start searching
  *
- * Checks if line matches the #C_QuoteRegex and doesn't match #C_Smileys.
- * This is used by the pager for calling classify_quote.
+ * The match is saved in ColorLine::next_match.  Empty matches are skipped.
+ * If there are no more matches, ColorLine::stop_matching is set.
  */
-int mutt_is_quote_line(char *line, regmatch_t *pmatch)
+static void color_line_next(struct ColorLine *color_line, const char *buf, int offset)
 {
-  bool is_quote = false;
-  regmatch_t pmatch_internal[1], smatch[1];
+  regmatch_t pmatch[1];
+
+  while (buf[offset] && (regexec(&color_line->regex, buf + offset, 1, pmatch,
+                                 ((offset != 0) ? REG_NOTBOL : 0)) == 0))
+  {
+    if (pmatch[0].rm_eo != pmatch[0].rm_so)
+    {
+      color_line->next_match.rm_so = pmatch[0].rm_so + offset;
+      color_line->next_match.rm_eo = pmatch[0].rm_eo + offset;
+      return;
+    }
+
+    offset += pmatch[0].rm_so + 1; /* avoid degenerate cases */
+  }
+
+  color_line->stop_matching = true;
+}
+
+/**
+ * match_body_patterns - Highlight a line of text using a list of patterns
+ * @param buf  Line of text, without the newline
+ * @param line Line info to fill in
+ * @param head List of colour patterns
+ *
+ * The leftmost match wins.  Of matches starting at the same place, the longest
+ * wins, then the first defined.  The text after the winning match is searched
+ * for the next one.
+ *
+ * Each pattern's next match is remembered, so a pattern is only searched again
+ * when a chunk has overlapped its match.  Each pattern is usually searched for
+ * once per line, however many chunks other patterns produce.
+ */
+static void match_body_patterns(const char *buf, struct Line *line,
+                                struct ColorLineHead *head)
+{
+  struct ColorLine *color_line = NULL;
+  int offset = 0;
 
-  if (!pmatch)
-    pmatch = pmatch_internal;
+  line->chunks = 0;
 
-  if (C_QuoteRegex && C_QuoteRegex->regex &&
-      (regexec(C_QuoteRegex->regex, line, 1, pmatch, 0) == 0))
+  STAILQ_FOREACH(color_line, head, entries)
   {
-    if (C_Smileys && C_Smileys->regex &&
-        (regexec(C_Smileys->regex, line, 1, smatch, 0) == 0))
+    color_line->stop_matching = false;
+    color_line_next(color_line, buf, 0);
+  }
+
+  while (true)
+  {
+    struct ColorLine *best = NULL;
+
+    STAILQ_FOREACH(color_line, head, entries)
     {
-      if (smatch[0].rm_so > 0)
-      {
-        char c = line[smatch[0].rm_so];
-        line[smatch[0].rm_so] = 0;
+      if (color_line->stop_matching)
+        continue;
 
-        if (regexec(C_QuoteRegex->regex, line, 1, pmatch, 0) == 0)
-          is_quote = true;
+      if (color_line->next_match.rm_so < offset)
+      {
+        color_line_next(color_line, buf, offset);
+        if (color_line->stop_matching)
+          continue;
+      }
 
-        line[smatch[0].rm_so] = c;
+      if (!best || (color_line->next_match.rm_so < best->next_match.rm_so) ||
+          ((color_line->next_match.rm_so == best->next_match.rm_so) &&
+           (color_line->next_match.rm_eo > best->next_match.rm_eo)))
+      {
+        best = color_line;
       }
     }
-    else
-      is_quote = true;
-  }
 
-  return is_quote;
+    if (!best)
+      break;
+
+    /* Abort if we fill up chunks.
+     * Yes, this really happened. See #3888 */
+    if (line->chunks == SHRT_MAX)
+      break;
+
+    if (++(line->chunks) > 1)
+      mutt_mem_realloc(&(line->syntax), (line->chunks) * sizeof(struct Syntax));
+
+    struct Syntax *chunk = &line->syntax[line->chunks - 1];
+    chunk->color = best->pair;
+    chunk->first = best->next_match.rm_so;
+    chunk->last = best->next_match.rm_eo;
+    offset = chunk->last;
+  }
 }
 
 /**
@@ -925,9 +584,7 @@ static void resolve_types(char *buf, char *raw, struct Line *line_info, int n,
   struct ColorLine *color_line = NULL;
   struct ColorLineHead *head = NULL;
   regmatch_t pmatch[1];
-  bool found;
-  bool null_rx;
-  int offset, i = 0;
+  int i = 0;
 
   if ((n == 0) || IS_HEADER(line_info[n - 1].type) ||
       (check_protected_header_marker(raw) == 0))
@@ -1018,9 +675,9 @@ static void resolve_types(char *buf, char *raw, struct Line *line_info, int n,
   {
     if (q_classify && (line_info[n].quote == NULL))
     {
-      line_info[n].quote = classify_quote(quote_list, buf + pmatch[0].rm_so,
-                                          pmatch[0].rm_eo - pmatch[0].rm_so,
-                                          force_redraw, q_level);
+      line_info[n].quote = mutt_quote_classify(quote_list, buf + pmatch[0].rm_so,
+                                               pmatch[0].rm_eo - pmatch[0].rm_so,
+                                               force_redraw, q_level);
     }
     line_info[n].type = MT_COLOR_QUOTED;
   }
@@ -1039,78 +696,12 @@ static void resolve_types(char *buf, char *raw, struct Line *line_info, int n,
     if ((nl > 0) && (buf[nl - 1] == '\n'))
       buf[nl - 1] = '\0';
 
-    i = 0;
-    offset = 0;
-    line_info[n].chunks = 0;
     if (line_info[n].type == MT_COLOR_HDEFAULT)
       head = &ColorHdrList;
     else
       head = &ColorBodyList;
-    STAILQ_FOREACH(color_line, head, entries)
-    {
-      color_line->stop_matching = false;
-    }
-    do
-    {
-      if (!buf[offset])
-        break;
-
-      found = false;
-      null_rx = false;
-      STAILQ_FOREACH(color_line, head, entries)
-      {
-        if (!color_line->stop_matching &&
-            (regexec(&color_line->regex, buf + offset, 1, pmatch,
-                     ((offset != 0) ? REG_NOTBOL : 0)) == 0))
-        {
-          if (pmatch[0].rm_eo != pmatch[0].rm_so)
-          {
-            if (!found)
-            {
-              /* Abort if we fill up chunks.
-               * Yes, this really happened. See #3888 */
-              if (line_info[n].chunks == SHRT_MAX)
-              {
-                null_rx = false;
-                break;
-              }
-              if (++(line_info[n].chunks) > 1)
-              {
-                mutt_mem_realloc(&(line_info[n].syntax),
-                                 (line_info[n].chunks) * sizeof(struct Syntax));
-              }
-            }
-            i = line_info[n].chunks - 1;
-            pmatch[0].rm_so += offset;
-            pmatch[0].rm_eo += offset;
-            if (!found || (pmatch[0].rm_so < (line_info[n].syntax)[i].first) ||
-                ((pmatch[0].rm_so == (line_info[n].syntax)[i].first) &&
-                 (pmatch[0].rm_eo > (line_info[n].syntax)[i].last)))
-            {
-              (line_info[n].syntax)[i].color = color_line->pair;
-              (line_info[n].syntax)[i].first = pmatch[0].rm_so;
-              (line_info[n].syntax)[i].last = pmatch[0].rm_eo;
-            }
-            found = true;
-            null_rx = false;
-          }
-          else
-            null_rx = true; /* empty regex; don't add it, but keep looking */
-        }
-        else
-        {
-          /* Once a regexp fails to match, don't try matching it again.
-           * On very long lines this can cause a performance issue if there
-           * are other regexps that have many matches. */
-          color_line->stop_matching = true;
-        }
-      }
+    match_body_patterns(buf, &line_info[n], head);
 
-      if (null_rx)
-        offset++; /* avoid degenerate cases */
-      else
-        offset = (line_info[n].syntax)[i].last;
-    } while (found || null_rx);
     if (nl > 0)
       buf[nl] = '\n';
   }
@@ -1125,55 +716,8 @@ static void resolve_types(char *buf, char *raw, struct Line *line_info, int n,
     if ((nl > 0) && (buf[nl - 1] == '\n'))
       buf[nl - 1] = '\0';
 
-    i = 0;
-    offset = 0;
-    line_info[n].chunks = 0;
-    do
-    {
-      if (!buf[offset])
-        break;
-
-      found = false;
-      null_rx = false;
-      STAILQ_FOREACH(color_line, &ColorAttachList, entries)
-      {
-        if (regexec(&color_line->regex, buf + offset, 1, pmatch,
-                    ((offset != 0) ? REG_NOTBOL : 0)) == 0)
-        {
-          if (pmatch[0].rm_eo != pmatch[0].rm_so)
-          {
-            if (!found)
-            {
-              if (++(line_info[n].chunks) > 1)
-              {
-                mutt_mem_realloc(&(line_info[n].syntax),
-                                 (line_info[n].chunks) * sizeof(struct Syntax));
-              }
-            }
-            i = line_info[n].chunks - 1;
-            pmatch[0].rm_so += offset;
-            pmatch[0].rm_eo += offset;
-            if (!found || (pmatch[0].rm_so < (line_info[n].syntax)[i].first) ||
-                ((pmatch[0].rm_so == (line_info[n].syntax)[i].first) &&
-                 (pmatch[0].rm_eo > (line_info[n].syntax)[i].last)))
-            {
-              (line_info[n].syntax)[i].color = color_line->pair;
-              (line_info[n].syntax)[i].first = pmatch[0].rm_so;
-              (line_info[n].syntax)[i].last = pmatch[0].rm_eo;
-            }
-            found = 1;
-            null_rx = 0;
-          }
-          else
-            null_rx = 1; /* empty regex; don't add it, but keep looking */
-        }
-      }
+    match_body_patterns(buf, &line_info[n], &ColorAttachList);
 
-      if (null_rx)
-        offset++; /* avoid degenerate cases */
-      else
-        offset = (line_info[n].syntax)[i].last;
-    } while (found || null_rx);
     if (nl > 0)
       buf[nl] = '\n';
   }
@@ -1661,12 +1205,11 @@ static int display_line(FILE *fp, LOFF_T *last_pos, struct Line **line_info,
         (*last)--;
       goto out;
     }
-    if (C_QuoteRegex && C_QuoteRegex->regex &&
-        (regexec(C_QuoteRegex->regex, (char *) fmt, 1, pmatch, 0) == 0))
+    if (mutt_quote_match((char *) fmt, pmatch))
     {
       (*line_info)[n].quote =
-          classify_quote(quote_list, (char *) fmt + pmatch[0].rm_so,
-                         pmatch[0].rm_eo - pmatch[0].rm_so, force_redraw, q_level);
+          mutt_quote_classify(quote_list, (char *) fmt + pmatch[0].rm_so,
+                              pmatch[0].rm_eo - pmatch[0].rm_so, force_redraw, q_level);
     }
     else
     {
@@ -2369,7 +1912,7 @@ int mutt_pager(const char *banner, const char *fname, PagerFlags flags, struct P
 
     bool do_new_mail = false;
 
-    if (Context && Context->mailbox && !OptAttachMsg)
+    if (Context && Context->mailbox && !OptAttachMsg && !mutt_macro_pending())
     {
       int index_hint = 0; /* used to restore cursor position */
       int oldcount = Context->mailbox->msg_count;
@@ -3562,7 +3105,7 @@ int mutt_pager(const char *banner, const char *fname, PagerFlags flags, struct P
     }
   }
 
-  cleanup_quote(&rd.quote_list);
+  mutt_quote_free(&rd.quote_list);
 
   for (size_t i = 0; i < rd.max_line; i++)
   {
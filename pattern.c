@@ -1747,6 +1747,7 @@ typedef bool (*addr_predicate_t)(const struct Address *a);
  */
 static int mutt_is_predicate_recipient(bool alladdr, struct Envelope *e, addr_predicate_t p)
 {
+  mutt_env_thaw(e);
   struct AddressList *als[] = { &e->to, &e->cc };
   for (size_t i = 0; i < mutt_array_size(als); ++i)
   {
@@ -2093,11 +2094,13 @@ int mutt_pattern_exec(struct Pattern *pat, PatternExecFlags flags,
     case MUTT_PAT_TO:
       if (!e->env)
         return 0;
+      mutt_env_thaw(e->env);
       return pat->not^match_addrlist(pat, (flags & MUTT_MATCH_FULL_ADDRESS), 1,
                                      &e->env->to);
     case MUTT_PAT_CC:
       if (!e->env)
         return 0;
+      mutt_env_thaw(e->env);
       return pat->not^match_addrlist(pat, (flags & MUTT_MATCH_FULL_ADDRESS), 1,
                                      &e->env->cc);
     case MUTT_PAT_SUBJECT:
@@ -2118,17 +2121,20 @@ int mutt_pattern_exec(struct Pattern *pat, PatternExecFlags flags,
     case MUTT_PAT_REFERENCE:
       if (!e->env)
         return 0;
+      mutt_env_thaw(e->env);
       return pat->not^(match_reference(pat, &e->env->references) ||
                        match_reference(pat, &e->env->in_reply_to));
     case MUTT_PAT_ADDRESS:
       if (!e->env)
         return 0;
+      mutt_env_thaw(e->env);
       return pat->not^match_addrlist(pat, (flags & MUTT_MATCH_FULL_ADDRESS), 4,
                                      &e->env->from, &e->env->sender,
                                      &e->env->to, &e->env->cc);
     case MUTT_PAT_RECIPIENT:
       if (!e->env)
         return 0;
+      mutt_env_thaw(e->env);
       return pat->not^match_addrlist(pat, (flags & MUTT_MATCH_FULL_ADDRESS), 2,
                                      &e->env->to, &e->env->cc);
     case MUTT_PAT_LIST: /* known list, subscribed or not */
@@ -2175,6 +2181,7 @@ int mutt_pattern_exec(struct Pattern *pat, PatternExecFlags flags,
     {
       if (!e->env)
         return 0;
+      mutt_env_thaw(e->env);
 
       int result;
       if (cache)
@@ -2230,6 +2237,7 @@ int mutt_pattern_exec(struct Pattern *pat, PatternExecFlags flags,
     case MUTT_PAT_XLABEL:
       if (!e->env)
         return 0;
+      mutt_env_thaw(e->env);
       return pat->not^(e->env->x_label &&patmatch(pat, e->env->x_label));
     case MUTT_PAT_DRIVER_TAGS:
     {
@@ -2241,6 +2249,7 @@ int mutt_pattern_exec(struct Pattern *pat, PatternExecFlags flags,
     case MUTT_PAT_HORMEL:
       if (!e->env)
         return 0;
+      mutt_env_thaw(e->env);
       return pat->not^(e->env->spam && e->env->spam->data &&
                        patmatch(pat, e->env->spam->data));
     case MUTT_PAT_DUPLICATED:
@@ -2407,6 +2416,24 @@ bool mutt_limit_current_thread(struct Email *e)
   return true;
 }
 
+/**
+ * pattern_needs_body - Does a Pattern search the body of the Emails?
+ * @param pat Pattern to check
+ * @retval true The Pattern contains ~b or ~B
+ */
+static bool pattern_needs_body(struct PatternHead *pat)
+{
+  struct Pattern *p = NULL;
+  SLIST_FOREACH(p, pat, entries)
+  {
+    if ((p->op == MUTT_PAT_BODY) || (p->op == MUTT_PAT_WHOLE_MSG))
+      return true;
+    if (p->child && pattern_needs_body(p->child))
+      return true;
+  }
+  return false;
+}
+
 /**
  * mutt_pattern_func - Perform some Pattern matching
  * @param op     Operation to perform, e.g. #MUTT_LIMIT
@@ -2458,6 +2485,22 @@ int mutt_pattern_func(int op, char *prompt)
                      (op == MUTT_LIMIT) ? Context->mailbox->msg_count :
                                           Context->mailbox->vcount);
 
+  /* Decrypting the bodies is slow, so let PGP work ahead of the search */
+  struct EmailList el = STAILQ_HEAD_INITIALIZER(el);
+  struct EmailNode *en = NULL;
+  if ((WithCrypto & APPLICATION_PGP) && C_ThoroughSearch && pattern_needs_body(pat))
+  {
+    const int count = (op == MUTT_LIMIT) ? Context->mailbox->msg_count :
+                                           Context->mailbox->vcount;
+    for (int i = 0; i < count; i++)
+    {
+      el_add_email(&el, (op == MUTT_LIMIT) ?
+                            Context->mailbox->emails[i] :
+                            Context->mailbox->emails[Context->mailbox->v2r[i]]);
+    }
+    en = STAILQ_FIRST(&el);
+  }
+
   if (op == MUTT_LIMIT)
   {
     Context->mailbox->vcount = 0;
@@ -2468,6 +2511,11 @@ int mutt_pattern_func(int op, char *prompt)
     for (int i = 0; i < Context->mailbox->msg_count; i++)
     {
       mutt_progress_update(&progress, i, -1);
+      if (en)
+      {
+        crypt_pgp_decrypt_ahead(Context->mailbox, en);
+        en = STAILQ_NEXT(en, entries);
+      }
       /* new limit pattern implicitly uncollapses all threads */
       Context->mailbox->emails[i]->virtual = -1;
       Context->mailbox->emails[i]->limited = false;
@@ -2490,6 +2538,11 @@ int mutt_pattern_func(int op, char *prompt)
     for (int i = 0; i < Context->mailbox->vcount; i++)
     {
       mutt_progress_update(&progress, i, -1);
+      if (en)
+      {
+        crypt_pgp_decrypt_ahead(Context->mailbox, en);
+        en = STAILQ_NEXT(en, entries);
+      }
       if (mutt_pattern_exec(SLIST_FIRST(pat), MUTT_MATCH_FULL_ADDRESS, Context->mailbox,
                             Context->mailbox->emails[Context->mailbox->v2r[i]], NULL))
       {
@@ -2516,6 +2569,12 @@ int mutt_pattern_func(int op, char *prompt)
     }
   }
 
+  if (!STAILQ_EMPTY(&el))
+  {
+    crypt_pgp_decrypt_ahead_done();
+    mutt_emaillist_free(&el);
+  }
+
   mutt_clear_error();
 
   if (op == MUTT_LIMIT)
@@ -1282,6 +1282,7 @@ struct MxOps MxPopOps = {
   .ac_find          = pop_ac_find,
   .ac_add           = pop_ac_add,
   .mbox_open        = pop_mbox_open,
+  .mbox_open_more   = NULL,
   .mbox_open_append = NULL,
   .mbox_check       = pop_mbox_check,
   .mbox_sync        = pop_mbox_sync,
@@ -73,6 +73,7 @@ static const struct Mapping PostponeHelp[] = {
 
 static short PostCount = 0;
 static bool UpdateNumPostponed = false;
+static struct Mailbox *PostMailbox = NULL; ///< Private Mailbox for counting $postponed
 
 /**
  * mutt_num_postponed - Return the number of postponed messages
@@ -99,6 +100,7 @@ int mutt_num_postponed(struct Mailbox *m, bool force)
   {
     FREE(&OldPostponed);
     OldPostponed = mutt_str_strdup(C_Postponed);
+    mailbox_free(&PostMailbox);
     LastModify = 0;
     force = true;
   }
@@ -169,17 +171,21 @@ int mutt_num_postponed(struct Mailbox *m, bool force)
     if (optnews)
       OptNews = false;
 #endif
-    struct Mailbox *m_post = mx_path_resolve(C_Postponed);
-    struct Context *ctx = mx_mbox_open(m_post, MUTT_NOSORT | MUTT_QUIET);
-    if (!ctx)
+    /* A private Mailbox, so the stats of a visible one aren't disturbed */
+    if (!PostMailbox)
     {
-      mailbox_free(&m_post);
-      PostCount = 0;
+      PostMailbox = mailbox_new();
+      PostMailbox->flags = MB_HIDDEN;
+      mutt_buffer_strcpy(PostMailbox->pathbuf, C_Postponed);
+      mx_path_canon2(PostMailbox, C_Folder);
     }
+
+    /* Count the messages without opening the mailbox */
+    if (mx_mbox_check_stats(PostMailbox, MUTT_MAILBOX_CHECK_COUNT) >= 0)
+      PostCount = PostMailbox->msg_count;
     else
-      PostCount = ctx->mailbox->msg_count;
-    mx_fastclose_mailbox(m_post);
-    ctx_free(&ctx);
+      PostCount = 0;
+    mutt_debug(LL_DEBUG3, "%d postponed messages found\n", PostCount);
 #ifdef USE_NNTP
     if (optnews)
       OptNews = true;
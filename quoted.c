@@ -0,0 +1,603 @@
+/**
+ * @file
+ * Classify quoted text in the pager
+ *
+ * @authors
+ * Copyright (C) 1996-2002,2007,2010,2012-2013 Michael R. Elkins <me@mutt.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @page quoted Classify quoted text in the pager
+ *
+ * Quoted lines are found with $quote_regex (minus any $smileys) and sorted
+ * into a tree of #QClass, one per quote prefix, so that each level of quoting
+ * gets its own colour.
+ *
+ * Both steps run for every line the pager displays.  When $quote_regex and
+ * $smileys have their default values, the lines are scanned by hand instead
+ * of by regexec().
+ */
+
+#include "config.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "mutt/mutt.h"
+#include "quoted.h"
+#include "globals.h"
+#include "mutt_curses.h"
+#include "pager.h"
+#include "protos.h"
+
+/**
+ * new_class_color - Create a new quoting colour
+ * @param[in]     class   Class of quoted text
+ * @param[in,out] q_level Quote level
+ */
+static void new_class_color(struct QClass *class, int *q_level)
+{
+  class->index = (*q_level)++;
+  class->color = ColorQuote[class->index % ColorQuoteUsed];
+}
+
+/**
+ * shift_class_colors - Insert a new quote colour class into a list
+ * @param[in]     quote_list List of quote colours
+ * @param[in]     new_class  New quote colour to inset
+ * @param[in]     index      Index to insert at
+ * @param[in,out] q_level    Quote level
+ */
+static void shift_class_colors(struct QClass *quote_list,
+                               struct QClass *new_class, int index, int *q_level)
+{
+  struct QClass *q_list = quote_list;
+  new_class->index = -1;
+
+  while (q_list)
+  {
+    if (q_list->index >= index)
+    {
+      q_list->index++;
+      q_list->color = ColorQuote[q_list->index % ColorQuoteUsed];
+    }
+    if (q_list->down)
+      q_list = q_list->down;
+    else if (q_list->next)
+      q_list = q_list->next;
+    else
+    {
+      while (!q_list->next)
+      {
+        q_list = q_list->up;
+        if (!q_list)
+          break;
+      }
+      if (q_list)
+        q_list = q_list->next;
+    }
+  }
+
+  new_class->index = index;
+  new_class->color = ColorQuote[index % ColorQuoteUsed];
+  (*q_level)++;
+}
+
+/**
+ * quote_class_new - Create a new quoting class
+ * @param qptr   Quote prefix
+ * @param length Length of prefix
+ * @retval ptr New class
+ */
+static struct QClass *quote_class_new(const char *qptr, size_t length)
+{
+  struct QClass *class = mutt_mem_calloc(1, sizeof(struct QClass));
+  class->prefix = mutt_mem_calloc(1, length + 1);
+  strncpy(class->prefix, qptr, length);
+  class->length = length;
+  return class;
+}
+
+/**
+ * mutt_quote_free - Free a quote list
+ * @param[out] quote_list Quote list to free
+ */
+void mutt_quote_free(struct QClass **quote_list)
+{
+  struct QClass *ptr = NULL;
+
+  while (*quote_list)
+  {
+    if ((*quote_list)->down)
+      mutt_quote_free(&((*quote_list)->down));
+    ptr = (*quote_list)->next;
+    if ((*quote_list)->prefix)
+      FREE(&(*quote_list)->prefix);
+    FREE(quote_list);
+    *quote_list = ptr;
+  }
+}
+
+/**
+ * mutt_quote_classify - Find a style for a string
+ * @param[out] quote_list   List of quote colours
+ * @param[in]  qptr         String to classify
+ * @param[in]  length       Length of string
+ * @param[out] force_redraw Set to true if a screen redraw is needed
+ * @param[out] q_level      Quoting level
+ * @retval ptr Quoting style
+ */
+struct QClass *mutt_quote_classify(struct QClass **quote_list, const char *qptr,
+                                   size_t length, bool *force_redraw, int *q_level)
+{
+  struct QClass *q_list = *quote_list;
+  struct QClass *class = NULL, *tmp = NULL, *ptr = NULL, *save = NULL;
+  char *tail_qptr = NULL;
+  int offset, tail_lng;
+  int index = -1;
+
+  if (ColorQuoteUsed <= 1)
+  {
+    /* not much point in classifying quotes... */
+
+    if (!*quote_list)
+    {
+      class = mutt_mem_calloc(1, sizeof(struct QClass));
+      class->color = ColorQuote[0];
+      *quote_list = class;
+    }
+    return *quote_list;
+  }
+
+  /* classify quoting prefix */
+  while (q_list)
+  {
+    if (length <= q_list->length)
+    {
+      /* case 1: check the top level nodes */
+
+      if (mutt_str_strncmp(qptr, q_list->prefix, length) == 0)
+      {
+        if (length == q_list->length)
+          return q_list; /* same prefix: return the current class */
+
+        /* found shorter prefix */
+        if (!tmp)
+        {
+          /* add a node above q_list */
+          tmp = quote_class_new(qptr, length);
+
+          /* replace q_list by tmp in the top level list */
+          if (q_list->next)
+          {
+            tmp->next = q_list->next;
+            q_list->next->prev = tmp;
+          }
+          if (q_list->prev)
+          {
+            tmp->prev = q_list->prev;
+            q_list->prev->next = tmp;
+          }
+
+          /* make q_list a child of tmp */
+          tmp->down = q_list;
+          q_list->up = tmp;
+
+          /* q_list has no siblings for now */
+          q_list->next = NULL;
+          q_list->prev = NULL;
+
+          /* update the root if necessary */
+          if (q_list == *quote_list)
+            *quote_list = tmp;
+
+          index = q_list->index;
+
+          /* tmp should be the return class too */
+          class = tmp;
+
+          /* next class to test; if tmp is a shorter prefix for another
+           * node, that node can only be in the top level list, so don't
+           * go down after this point */
+          q_list = tmp->next;
+        }
+        else
+        {
+          /* found another branch for which tmp is a shorter prefix */
+
+          /* save the next sibling for later */
+          save = q_list->next;
+
+          /* unlink q_list from the top level list */
+          if (q_list->next)
+            q_list->next->prev = q_list->prev;
+          if (q_list->prev)
+            q_list->prev->next = q_list->next;
+
+          /* at this point, we have a tmp->down; link q_list to it */
+          ptr = tmp->down;
+          /* sibling order is important here, q_list should be linked last */
+          while (ptr->next)
+            ptr = ptr->next;
+          ptr->next = q_list;
+          q_list->next = NULL;
+          q_list->prev = ptr;
+          q_list->up = tmp;
+
+          index = q_list->index;
+
+          /* next class to test; as above, we shouldn't go down */
+          q_list = save;
+        }
+
+        /* we found a shorter prefix, so certain quotes have changed classes */
+        *force_redraw = true;
+        continue;
+      }
+      else
+      {
+        /* shorter, but not a substring of the current class: try next */
+        q_list = q_list->next;
+        continue;
+      }
+    }
+    else
+    {
+      /* case 2: try subclassing the current top level node */
+
+      /* tmp != NULL means we already found a shorter prefix at case 1 */
+      if (!tmp && (mutt_str_strncmp(qptr, q_list->prefix, q_list->length) == 0))
+      {
+        /* ok, it's a subclass somewhere on this branch */
+
+        ptr = q_list;
+        offset = q_list->length;
+
+        q_list = q_list->down;
+        tail_lng = length - offset;
+        tail_qptr = (char *) qptr + offset;
+
+        while (q_list)
+        {
+          if (length <= q_list->length)
+          {
+            if (mutt_str_strncmp(tail_qptr, (q_list->prefix) + offset, tail_lng) == 0)
+            {
+              /* same prefix: return the current class */
+              if (length == q_list->length)
+                return q_list;
+
+              /* found shorter common prefix */
+              if (!tmp)
+              {
+                /* add a node above q_list */
+                tmp = quote_class_new(qptr, length);
+
+                /* replace q_list by tmp */
+                if (q_list->next)
+                {
+                  tmp->next = q_list->next;
+                  q_list->next->prev = tmp;
+                }
+                if (q_list->prev)
+                {
+                  tmp->prev = q_list->prev;
+                  q_list->prev->next = tmp;
+                }
+
+                /* make q_list a child of tmp */
+                tmp->down = q_list;
+                tmp->up = q_list->up;
+                q_list->up = tmp;
+                if (tmp->up->down == q_list)
+                  tmp->up->down = tmp;
+
+                /* q_list has no siblings */
+                q_list->next = NULL;
+                q_list->prev = NULL;
+
+                index = q_list->index;
+
+                /* tmp should be the return class too */
+                class = tmp;
+
+                /* next class to test */
+                q_list = tmp->next;
+              }
+              else
+              {
+                /* found another branch for which tmp is a shorter prefix */
+
+                /* save the next sibling for later */
+                save = q_list->next;
+
+                /* unlink q_list from the top level list */
+                if (q_list->next)
+                  q_list->next->prev = q_list->prev;
+                if (q_list->prev)
+                  q_list->prev->next = q_list->next;
+
+                /* at this point, we have a tmp->down; link q_list to it */
+                ptr = tmp->down;
+                while (ptr->next)
+                  ptr = ptr->next;
+                ptr->next = q_list;
+                q_list->next = NULL;
+                q_list->prev = ptr;
+                q_list->up = tmp;
+
+                index = q_list->index;
+
+                /* next class to test */
+                q_list = save;
+              }
+
+              /* we found a shorter prefix, so we need a redraw */
+              *force_redraw = true;
+              continue;
+            }
+            else
+            {
+              q_list = q_list->next;
+              continue;
+            }
+          }
+          else
+          {
+            /* longer than the current prefix: try subclassing it */
+            if (!tmp && (mutt_str_strncmp(tail_qptr, (q_list->prefix) + offset,
+                                          q_list->length - offset) == 0))
+            {
+              /* still a subclass: go down one level */
+              ptr = q_list;
+              offset = q_list->length;
+
+              q_list = q_list->down;
+              tail_lng = length - offset;
+              tail_qptr = (char *) qptr + offset;
+
+              continue;
+            }
+            else
+            {
+              /* nope, try the next prefix */
+              q_list = q_list->next;
+              continue;
+            }
+          }
+        }
+
+        /* still not found so far: add it as a sibling to the current node */
+        if (!class)
+        {
+          tmp = quote_class_new(qptr, length);
+
+          if (ptr->down)
+          {
+            tmp->next = ptr->down;
+            ptr->down->prev = tmp;
+          }
+          ptr->down = tmp;
+          tmp->up = ptr;
+
+          new_class_color(tmp, q_level);
+
+          return tmp;
+        }
+        else
+        {
+          if (index != -1)
+            shift_class_colors(*quote_list, tmp, index, q_level);
+
+          return class;
+        }
+      }
+      else
+      {
+        /* nope, try the next prefix */
+        q_list = q_list->next;
+        continue;
+      }
+    }
+  }
+
+  if (!class)
+  {
+    /* not found so far: add it as a top level class */
+    class = quote_class_new(qptr, length);
+    new_class_color(class, q_level);
+
+    if (*quote_list)
+    {
+      class->next = *quote_list;
+      (*quote_list)->prev = class;
+    }
+    *quote_list = class;
+  }
+
+  if (index != -1)
+    shift_class_colors(*quote_list, tmp, index, q_level);
+
+  return class;
+}
+
+/**
+ * is_default - Does a regex config variable have its default value?
+ * @param rx  Regex
+ * @param def Default pattern, e.g. #QUOTE_REGEX_DEFAULT
+ * @retval true The pattern is the default
+ */
+static bool is_default(const struct Regex *rx, const char *def)
+{
+  return rx && rx->pattern && !rx->not && (strcmp(rx->pattern, def) == 0);
+}
+
+/**
+ * quote_scan - Match the default $quote_regex by hand
+ * @param line  Line to test
+ * @param limit Maximum number of characters to test
+ * @retval num Length of the quote prefix (0 if the line isn't quoted)
+ *
+ * The default pattern is `^([ \t]*[|>:}#])+`: any number of quote characters,
+ * each one optionally preceded by spaces or tabs.
+ */
+static size_t quote_scan(const char *line, size_t limit)
+{
+  size_t len = 0;
+  size_t i = 0;
+
+  while (true)
+  {
+    while ((i < limit) && ((line[i] == ' ') || (line[i] == '\t')))
+      i++;
+    if (i >= limit)
+      break;
+
+    switch (line[i])
+    {
+      case '|':
+      case '>':
+      case ':':
+      case '}':
+      case '#':
+        len = ++i;
+        continue;
+    }
+    break;
+  }
+
+  return len;
+}
+
+/**
+ * smiley_scan - Match the default $smileys by hand
+ * @param line Line to test
+ * @retval ptr  Start of the first smiley
+ * @retval NULL No smiley
+ *
+ * The default pattern is `(>From )|(:[-^]?[][)(><}{|/DP])`.
+ */
+static const char *smiley_scan(const char *line)
+{
+  static const char mouths[] = "][)(><}{|/DP";
+
+  for (const char *p = strpbrk(line, ":>"); p; p = strpbrk(p + 1, ":>"))
+  {
+    if (*p == '>')
+    {
+      if (strncmp(p, ">From ", 6) == 0)
+        return p;
+      continue;
+    }
+
+    const char *q = p + 1;
+    if ((*q == '-') || (*q == '^'))
+    {
+      if ((q[1] != '\0') && strchr(mouths, q[1]))
+        return p;
+    }
+    if ((*q != '\0') && strchr(mouths, *q))
+      return p;
+  }
+
+  return NULL;
+}
+
+/**
+ * quote_match - Does the start of a line match $quote_regex?
+ * @param[in]  line   Line to test
+ * @param[in]  limit  Only test this many characters
+ * @param[out] pmatch Location of the quote prefix
+ * @retval true Line is quoted
+ */
+static bool quote_match(char *line, size_t limit, regmatch_t *pmatch)
+{
+  if (!C_QuoteRegex || !C_QuoteRegex->regex)
+    return false;
+
+  if (is_default(C_QuoteRegex, QUOTE_REGEX_DEFAULT))
+  {
+    size_t len = quote_scan(line, limit);
+    pmatch[0].rm_so = 0;
+    pmatch[0].rm_eo = len;
+    return len != 0;
+  }
+
+  if (limit == SIZE_MAX)
+    return regexec(C_QuoteRegex->regex, line, 1, pmatch, 0) == 0;
+
+  char c = line[limit];
+  line[limit] = '\0';
+  bool rc = (regexec(C_QuoteRegex->regex, line, 1, pmatch, 0) == 0);
+  line[limit] = c;
+  return rc;
+}
+
+/**
+ * mutt_quote_match - Does the start of a line match $quote_regex?
+ * @param[in]  line   Line to test
+ * @param[out] pmatch Location of the quote prefix
+ * @retval true Line is quoted
+ *
+ * Unlike mutt_is_quote_line(), this doesn't check $smileys.
+ */
+bool mutt_quote_match(const char *line, regmatch_t *pmatch)
+{
+  /* line isn't modified when there's no limit */
+  return quote_match((char *) line, SIZE_MAX, pmatch);
+}
+
+/**
+ * mutt_is_quote_line - Is a line of message text a quote?
+ * @param[in]  line   Line to test
+ * @param[out] pmatch Regex sub-matches
+ * @retval true Line is quoted
+ *
+ * Checks if line matches the #C_QuoteRegex and doesn't match #C_Smileys.
+ * This is used by the pager for calling mutt_quote_classify().
+ */
+int mutt_is_quote_line(char *line, regmatch_t *pmatch)
+{
+  regmatch_t pmatch_internal[1], smatch[1];
+
+  if (!pmatch)
+    pmatch = pmatch_internal;
+
+  if (!quote_match(line, SIZE_MAX, pmatch))
+    return false;
+
+  if (!C_Smileys || !C_Smileys->regex)
+    return true;
+
+  /* A smiley ends the quote prefix */
+  size_t smiley;
+  if (is_default(C_Smileys, SMILEYS_DEFAULT))
+  {
+    const char *p = smiley_scan(line);
+    if (!p)
+      return true;
+    smiley = p - line;
+  }
+  else
+  {
+    if (regexec(C_Smileys->regex, line, 1, smatch, 0) != 0)
+      return true;
+    smiley = smatch[0].rm_so;
+  }
+
+  return (smiley > 0) && quote_match(line, smiley, pmatch);
+}
@@ -0,0 +1,53 @@
+/**
+ * @file
+ * Classify quoted text in the pager
+ *
+ * @authors
+ * Copyright (C) 1996-2002,2007,2010,2012-2013 Michael R. Elkins <me@mutt.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MUTT_QUOTED_H
+#define MUTT_QUOTED_H
+
+/* makedoc reads these through init.h, without the rest of this header */
+#define QUOTE_REGEX_DEFAULT "^([ \t]*[|>:}#])+"                ///< Default of $quote_regex
+#define SMILEYS_DEFAULT     "(>From )|(:[-^]?[][)(><}{|/DP])" ///< Default of $smileys
+
+#ifndef _MAKEDOC
+#include <regex.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * struct QClass - Style of quoted text
+ */
+struct QClass
+{
+  size_t length;              ///< Length of the prefix
+  int index;                  ///< Position in the colour cycle
+  int color;                  ///< Colour of the quoted text
+  char *prefix;               ///< Quote prefix, e.g. "> > "
+  struct QClass *next, *prev; ///< Siblings (different prefixes at the same depth)
+  struct QClass *down, *up;   ///< Children (longer prefixes) and parent
+};
+
+struct QClass *mutt_quote_classify(struct QClass **quote_list, const char *qptr, size_t length, bool *force_redraw, int *q_level);
+void           mutt_quote_free    (struct QClass **quote_list);
+bool           mutt_quote_match   (const char *line, regmatch_t *pmatch);
+#endif /* _MAKEDOC */
+
+#endif /* MUTT_QUOTED_H */
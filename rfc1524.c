@@ -34,9 +34,12 @@
 
 #include "config.h"
 #include <limits.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <time.h>
 #include "mutt/mutt.h"
 #include "email/lib.h"
 #include "mutt.h"
@@ -198,7 +201,8 @@ static char *get_field(char *s)
  * @retval 1 Success
  * @retval 0 Failure
  */
-static int get_field_text(char *field, char **entry, char *type, char *filename, int line)
+static int get_field_text(char *field, char **entry, const char *type,
+                          const char *filename, int line)
 {
   field = mutt_str_skip_whitespace(field);
   if (*field == '=')
@@ -220,208 +224,406 @@ static int get_field_text(char *field, char **entry, char *type, char *filename,
 }
 
 /**
- * rfc1524_mailcap_parse - Parse a mailcap entry
- * @param a        Email Body
- * @param filename Filename
- * @param type     Type, e.g. "text/plain"
- * @param entry    Entry, e.g. "compose"
- * @param opt      Option, see #MailcapLookup
- * @retval true  Success
- * @retval false Failure
+ * struct MailcapLine - One entry from a mailcap file
  */
-static bool rfc1524_mailcap_parse(struct Body *a, char *filename, char *type,
-                                  struct Rfc1524MailcapEntry *entry, enum MailcapLookup opt)
+struct MailcapLine
+{
+  char *subtype;            ///< Subtype, e.g. "html", or NULL if the entry is wild
+  char *fields;             ///< Everything after the type, e.g. "lynx -dump %s; copiousoutput"
+  int line;                 ///< Line number, for error messages
+  struct MailcapLine *next; ///< Next entry with the same major type
+};
+
+/**
+ * struct MailcapType - Entries for one major type, in file order
+ */
+struct MailcapType
 {
+  struct MailcapLine *first; ///< First entry for this type
+  struct MailcapLine *last;  ///< Last entry for this type
+};
+
+/**
+ * struct MailcapFile - A parsed mailcap file
+ */
+struct MailcapFile
+{
+  char *path;                       ///< Expanded path of the file
+  bool loaded;                      ///< File has been read since it last changed
+  struct timespec mtime;            ///< Modification time when the file was read
+  off_t size;                       ///< Size when the file was read
+  ino_t ino;                        ///< Inode when the file was read
+  struct Hash *types;               ///< Major type -> #MailcapType
+  STAILQ_ENTRY(MailcapFile) entries; ///< Linked list
+};
+STAILQ_HEAD(MailcapFileList, MailcapFile);
+
+/// Every mailcap file that has been looked at
+static struct MailcapFileList MailcapCache = STAILQ_HEAD_INITIALIZER(MailcapCache);
+
+/**
+ * mailcap_type_free - Free a MailcapType - Implements ::hashelem_free_t
+ */
+static void mailcap_type_free(int type, void *obj, intptr_t data)
+{
+  struct MailcapType *mt = obj;
+  struct MailcapLine *ml = mt->first;
+  while (ml)
+  {
+    struct MailcapLine *next = ml->next;
+    FREE(&ml->subtype);
+    FREE(&ml->fields);
+    FREE(&ml);
+    ml = next;
+  }
+  FREE(&mt);
+}
+
+/**
+ * mailcap_file_read - Read a mailcap file into its index
+ * @param mf Mailcap file
+ *
+ * rfc1524 mailcap file is of the format:
+ * base/type; command; extradefs
+ * type can be * for matching all
+ * base with no /type is an implicit wild
+ * command contains a %s for the filename to pass, default to pipe on stdin
+ * extradefs are of the form:
+ *  def1="definition"; def2="define \;";
+ * line wraps with a \ at the end of the line
+ * # for comments
+ */
+static void mailcap_file_read(struct MailcapFile *mf)
+{
+  FILE *fp = fopen(mf->path, "r");
+  if (!fp)
+    return;
+
+  mutt_debug(LL_DEBUG2, "Reading mailcap file: %s\n", mf->path);
+
   char *buf = NULL;
-  bool found = false;
+  size_t buflen;
   int line = 0;
+  while ((buf = mutt_file_read_line(buf, &buflen, fp, &line, MUTT_CONT)))
+  {
+    /* ignore comments */
+    if (*buf == '#')
+      continue;
+    mutt_debug(LL_DEBUG5, "mailcap entry: %s\n", buf);
 
-  /* rfc1524 mailcap file is of the format:
-   * base/type; command; extradefs
-   * type can be * for matching all
-   * base with no /type is an implicit wild
-   * command contains a %s for the filename to pass, default to pipe on stdin
-   * extradefs are of the form:
-   *  def1="definition"; def2="define \;";
-   * line wraps with a \ at the end of the line
-   * # for comments */
-
-  /* find length of basetype */
-  char *ch = strchr(type, '/');
-  if (!ch)
-    return false;
-  const int btlen = ch - type;
+    char *fields = get_field(buf);
 
-  FILE *fp = fopen(filename, "r");
-  if (fp)
-  {
-    size_t buflen;
-    while (!found && (buf = mutt_file_read_line(buf, &buflen, fp, &line, MUTT_CONT)))
+    struct MailcapLine *ml = mutt_mem_calloc(1, sizeof(*ml));
+    ml->fields = mutt_str_strdup(fields);
+    ml->line = line;
+
+    char *slash = strchr(buf, '/');
+    if (slash)
     {
-      /* ignore comments */
-      if (*buf == '#')
-        continue;
-      mutt_debug(LL_DEBUG2, "mailcap entry: %s\n", buf);
-
-      /* check type */
-      ch = get_field(buf);
-      if ((mutt_str_strcasecmp(buf, type) != 0) &&
-          ((mutt_str_strncasecmp(buf, type, btlen) != 0) ||
-           ((buf[btlen] != '\0') &&                      /* implicit wild */
-            (mutt_str_strcmp(buf + btlen, "/*") != 0)))) /* wildsubtype */
-      {
-        continue;
-      }
+      *slash = '\0';
+      if (mutt_str_strcmp(slash + 1, "*") != 0)
+        ml->subtype = mutt_str_strdup(slash + 1);
+    }
 
-      /* next field is the viewcommand */
-      char *field = ch;
-      ch = get_field(ch);
-      if (entry)
-        entry->command = mutt_str_strdup(field);
+    struct MailcapType *mt = mutt_hash_find(mf->types, buf);
+    if (mt)
+    {
+      mt->last->next = ml;
+      mt->last = ml;
+    }
+    else
+    {
+      mt = mutt_mem_calloc(1, sizeof(*mt));
+      mt->first = ml;
+      mt->last = ml;
+      mutt_hash_insert(mf->types, buf, mt);
+    }
+  }
 
-      /* parse the optional fields */
-      found = true;
-      bool copiousoutput = false;
-      bool composecommand = false;
-      bool editcommand = false;
-      bool printcommand = false;
+  FREE(&buf);
+  mutt_file_fclose(&fp);
+}
 
-      while (ch)
-      {
-        field = ch;
-        ch = get_field(ch);
-        mutt_debug(LL_DEBUG2, "field: %s\n", field);
-        size_t plen;
+/**
+ * mailcap_file_get - Get the parsed version of a mailcap file
+ * @param path Expanded path of the file
+ * @retval ptr Mailcap file, possibly with no entries
+ *
+ * The file is read the first time it's asked for, and again whenever its
+ * modification time, size or inode change.
+ */
+static struct MailcapFile *mailcap_file_get(const char *path)
+{
+  struct MailcapFile *mf = NULL;
+  STAILQ_FOREACH(mf, &MailcapCache, entries)
+  {
+    if (mutt_str_strcmp(mf->path, path) == 0)
+      break;
+  }
 
-        if (mutt_str_strcasecmp(field, "needsterminal") == 0)
-        {
-          if (entry)
-            entry->needsterminal = true;
-        }
-        else if (mutt_str_strcasecmp(field, "copiousoutput") == 0)
-        {
-          copiousoutput = true;
-          if (entry)
-            entry->copiousoutput = true;
-        }
-        else if ((plen = mutt_str_startswith(field, "composetyped", CASE_IGNORE)))
-        {
-          /* this compare most occur before compose to match correctly */
-          if (get_field_text(field + plen, entry ? &entry->composetypecommand : NULL,
-                             type, filename, line))
-          {
-            composecommand = true;
-          }
-        }
-        else if ((plen = mutt_str_startswith(field, "compose", CASE_IGNORE)))
-        {
-          if (get_field_text(field + plen, entry ? &entry->composecommand : NULL,
-                             type, filename, line))
-          {
-            composecommand = true;
-          }
-        }
-        else if ((plen = mutt_str_startswith(field, "print", CASE_IGNORE)))
-        {
-          if (get_field_text(field + plen, entry ? &entry->printcommand : NULL,
-                             type, filename, line))
-          {
-            printcommand = true;
-          }
-        }
-        else if ((plen = mutt_str_startswith(field, "edit", CASE_IGNORE)))
-        {
-          if (get_field_text(field + plen, entry ? &entry->editcommand : NULL,
-                             type, filename, line))
-            editcommand = true;
-        }
-        else if ((plen = mutt_str_startswith(field, "nametemplate", CASE_IGNORE)))
-        {
-          get_field_text(field + plen, entry ? &entry->nametemplate : NULL,
-                         type, filename, line);
-        }
-        else if ((plen = mutt_str_startswith(field, "x-convert", CASE_IGNORE)))
-        {
-          get_field_text(field + plen, entry ? &entry->convert : NULL, type, filename, line);
-        }
-        else if ((plen = mutt_str_startswith(field, "test", CASE_IGNORE)))
-        {
-          /* This routine executes the given test command to determine
-           * if this is the right entry.  */
-          char *test_command = NULL;
-
-          if (get_field_text(field + plen, &test_command, type, filename, line) && test_command)
-          {
-            struct Buffer *command = mutt_buffer_pool_get();
-            struct Buffer *afilename = mutt_buffer_pool_get();
-            mutt_buffer_strcpy(command, test_command);
-            if (C_MailcapSanitize)
-              mutt_buffer_sanitize_filename(afilename, NONULL(a->filename), true);
-            else
-              mutt_buffer_strcpy(afilename, NONULL(a->filename));
-            mutt_rfc1524_expand_command(a, mutt_b2s(afilename), type, command);
-            if (mutt_system(mutt_b2s(command)))
-            {
-              /* a non-zero exit code means test failed */
-              found = false;
-            }
-            FREE(&test_command);
-            mutt_buffer_pool_release(&command);
-            mutt_buffer_pool_release(&afilename);
-          }
-        }
-        else if (mutt_str_startswith(field, "x-neomutt-keep", CASE_IGNORE))
-        {
-          if (entry)
-            entry->xneomuttkeep = true;
-        }
-      } /* while (ch) */
+  if (!mf)
+  {
+    mf = mutt_mem_calloc(1, sizeof(*mf));
+    mf->path = mutt_str_strdup(path);
+    STAILQ_INSERT_TAIL(&MailcapCache, mf, entries);
+  }
 
-      if (opt == MUTT_MC_AUTOVIEW)
-      {
-        if (!copiousoutput)
-          found = false;
-      }
-      else if (opt == MUTT_MC_COMPOSE)
+  struct stat st = { 0 };
+  if (stat(path, &st) != 0)
+  {
+    /* The file has gone (or never existed) */
+    mutt_hash_free(&mf->types);
+    mf->loaded = false;
+    return mf;
+  }
+
+  if (mf->loaded && (mutt_file_stat_timespec_compare(&st, MUTT_STAT_MTIME, &mf->mtime) == 0) &&
+      (st.st_size == mf->size) && (st.st_ino == mf->ino))
+  {
+    return mf;
+  }
+
+  mutt_hash_free(&mf->types);
+  mf->types = mutt_hash_new(32, MUTT_HASH_STRCASECMP | MUTT_HASH_STRDUP_KEYS);
+  mutt_hash_set_destructor(mf->types, mailcap_type_free, 0);
+  mutt_file_get_stat_timespec(&mf->mtime, &st, MUTT_STAT_MTIME);
+  mf->size = st.st_size;
+  mf->ino = st.st_ino;
+  mf->loaded = true;
+
+  mailcap_file_read(mf);
+  return mf;
+}
+
+/**
+ * rfc1524_cache_free - Free the parsed mailcap files
+ */
+void rfc1524_cache_free(void)
+{
+  struct MailcapFile *mf = STAILQ_FIRST(&MailcapCache);
+  while (mf)
+  {
+    struct MailcapFile *next = STAILQ_NEXT(mf, entries);
+    mutt_hash_free(&mf->types);
+    FREE(&mf->path);
+    FREE(&mf);
+    mf = next;
+  }
+  STAILQ_INIT(&MailcapCache);
+}
+
+/**
+ * rfc1524_mailcap_entry - Check a mailcap entry and fill in the results
+ * @param a        Email Body
+ * @param ml       Mailcap entry
+ * @param filename Mailcap filename
+ * @param type     Type, e.g. "text/plain"
+ * @param entry    Entry, e.g. "compose"
+ * @param opt      Option, see #MailcapLookup
+ * @retval true  The entry matches
+ * @retval false The entry isn't suitable
+ */
+static bool rfc1524_mailcap_entry(struct Body *a, const struct MailcapLine *ml,
+                                  const char *filename, const char *type,
+                                  struct Rfc1524MailcapEntry *entry, enum MailcapLookup opt)
+{
+  /* get_field() alters the text, so work on a copy */
+  char *fields = mutt_str_strdup(ml->fields);
+  const int line = ml->line;
+
+  /* next field is the viewcommand */
+  char *field = fields;
+  char *ch = get_field(fields);
+  if (entry)
+    entry->command = mutt_str_strdup(field);
+
+  /* parse the optional fields */
+  bool found = true;
+  bool copiousoutput = false;
+  bool composecommand = false;
+  bool editcommand = false;
+  bool printcommand = false;
+
+  while (ch)
+  {
+    field = ch;
+    ch = get_field(ch);
+    mutt_debug(LL_DEBUG2, "field: %s\n", field);
+    size_t plen;
+
+    if (mutt_str_strcasecmp(field, "needsterminal") == 0)
+    {
+      if (entry)
+        entry->needsterminal = true;
+    }
+    else if (mutt_str_strcasecmp(field, "copiousoutput") == 0)
+    {
+      copiousoutput = true;
+      if (entry)
+        entry->copiousoutput = true;
+    }
+    else if ((plen = mutt_str_startswith(field, "composetyped", CASE_IGNORE)))
+    {
+      /* this compare most occur before compose to match correctly */
+      if (get_field_text(field + plen, entry ? &entry->composetypecommand : NULL,
+                         type, filename, line))
       {
-        if (!composecommand)
-          found = false;
+        composecommand = true;
       }
-      else if (opt == MUTT_MC_EDIT)
+    }
+    else if ((plen = mutt_str_startswith(field, "compose", CASE_IGNORE)))
+    {
+      if (get_field_text(field + plen, entry ? &entry->composecommand : NULL,
+                         type, filename, line))
       {
-        if (!editcommand)
-          found = false;
+        composecommand = true;
       }
-      else if (opt == MUTT_MC_PRINT)
+    }
+    else if ((plen = mutt_str_startswith(field, "print", CASE_IGNORE)))
+    {
+      if (get_field_text(field + plen, entry ? &entry->printcommand : NULL,
+                         type, filename, line))
       {
-        if (!printcommand)
-          found = false;
+        printcommand = true;
       }
+    }
+    else if ((plen = mutt_str_startswith(field, "edit", CASE_IGNORE)))
+    {
+      if (get_field_text(field + plen, entry ? &entry->editcommand : NULL,
+                         type, filename, line))
+        editcommand = true;
+    }
+    else if ((plen = mutt_str_startswith(field, "nametemplate", CASE_IGNORE)))
+    {
+      get_field_text(field + plen, entry ? &entry->nametemplate : NULL, type,
+                     filename, line);
+    }
+    else if ((plen = mutt_str_startswith(field, "x-convert", CASE_IGNORE)))
+    {
+      get_field_text(field + plen, entry ? &entry->convert : NULL, type, filename, line);
+    }
+    else if ((plen = mutt_str_startswith(field, "test", CASE_IGNORE)))
+    {
+      /* This routine executes the given test command to determine
+       * if this is the right entry.  */
+      char *test_command = NULL;
 
-      if (!found)
+      if (get_field_text(field + plen, &test_command, type, filename, line) && test_command)
       {
-        /* reset */
-        if (entry)
+        struct Buffer *command = mutt_buffer_pool_get();
+        struct Buffer *afilename = mutt_buffer_pool_get();
+        mutt_buffer_strcpy(command, test_command);
+        if (C_MailcapSanitize)
+          mutt_buffer_sanitize_filename(afilename, NONULL(a->filename), true);
+        else
+          mutt_buffer_strcpy(afilename, NONULL(a->filename));
+        mutt_rfc1524_expand_command(a, mutt_b2s(afilename), type, command);
+        if (mutt_system(mutt_b2s(command)))
         {
-          FREE(&entry->command);
-          FREE(&entry->composecommand);
-          FREE(&entry->composetypecommand);
-          FREE(&entry->editcommand);
-          FREE(&entry->printcommand);
-          FREE(&entry->nametemplate);
-          FREE(&entry->convert);
-          entry->needsterminal = false;
-          entry->copiousoutput = false;
-          entry->xneomuttkeep = false;
+          /* a non-zero exit code means test failed */
+          found = false;
         }
+        FREE(&test_command);
+        mutt_buffer_pool_release(&command);
+        mutt_buffer_pool_release(&afilename);
       }
-    } /* while (!found && (buf = mutt_file_read_line ())) */
-    mutt_file_fclose(&fp);
-  } /* if ((fp = fopen ())) */
-  FREE(&buf);
+    }
+    else if (mutt_str_startswith(field, "x-neomutt-keep", CASE_IGNORE))
+    {
+      if (entry)
+        entry->xneomuttkeep = true;
+    }
+  } /* while (ch) */
+
+  if (opt == MUTT_MC_AUTOVIEW)
+  {
+    if (!copiousoutput)
+      found = false;
+  }
+  else if (opt == MUTT_MC_COMPOSE)
+  {
+    if (!composecommand)
+      found = false;
+  }
+  else if (opt == MUTT_MC_EDIT)
+  {
+    if (!editcommand)
+      found = false;
+  }
+  else if (opt == MUTT_MC_PRINT)
+  {
+    if (!printcommand)
+      found = false;
+  }
+
+  if (!found)
+  {
+    /* reset */
+    if (entry)
+    {
+      FREE(&entry->command);
+      FREE(&entry->composecommand);
+      FREE(&entry->composetypecommand);
+      FREE(&entry->editcommand);
+      FREE(&entry->printcommand);
+      FREE(&entry->nametemplate);
+      FREE(&entry->convert);
+      entry->needsterminal = false;
+      entry->copiousoutput = false;
+      entry->xneomuttkeep = false;
+    }
+  }
+
+  FREE(&fields);
   return found;
 }
 
+/**
+ * rfc1524_mailcap_parse - Find a matching entry in a mailcap file
+ * @param a        Email Body
+ * @param filename Filename
+ * @param type     Type, e.g. "text/plain"
+ * @param entry    Entry, e.g. "compose"
+ * @param opt      Option, see #MailcapLookup
+ * @retval true  Success
+ * @retval false Failure
+ *
+ * The entries are checked in file order.  An entry matches if its type is
+ * the same as @a type, if it has no subtype (an implicit wild) or if its
+ * subtype is "*".
+ */
+static bool rfc1524_mailcap_parse(struct Body *a, const char *filename, const char *type,
+                                  struct Rfc1524MailcapEntry *entry, enum MailcapLookup opt)
+{
+  /* find basetype */
+  const char *subtype = strchr(type, '/');
+  if (!subtype)
+    return false;
+
+  struct MailcapFile *mf = mailcap_file_get(filename);
+  if (!mf->types)
+    return false;
+
+  char *major = mutt_str_substr_dup(type, subtype);
+  struct MailcapType *mt = mutt_hash_find(mf->types, major);
+  FREE(&major);
+  if (!mt)
+    return false;
+
+  subtype++;
+
+  for (struct MailcapLine *ml = mt->first; ml; ml = ml->next)
+  {
+    if (ml->subtype && (mutt_str_strcasecmp(ml->subtype, subtype) != 0))
+      continue;
+
+    if (rfc1524_mailcap_entry(a, ml, filename, type, entry, opt))
+      return true;
+  }
+
+  return false;
+}
+
 /**
  * rfc1524_new_entry - Allocate memory for a new rfc1524 entry
  * @retval ptr An un-initialized struct Rfc1524MailcapEntry
@@ -61,6 +61,7 @@ enum MailcapLookup
   MUTT_MC_AUTOVIEW,     ///< Mailcap autoview field
 };
 
+void rfc1524_cache_free(void);
 struct Rfc1524MailcapEntry *rfc1524_new_entry(void);
 void rfc1524_free_entry(struct Rfc1524MailcapEntry **entry);
 void mutt_rfc1524_expand_filename(const char *nametemplate, const char *oldfile, struct Buffer *newfile);
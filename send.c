@@ -798,6 +798,8 @@ int mutt_fetch_recips(struct Envelope *out, struct Envelope *in, SendFlags flags
   enum QuadOption hmfupto = MUTT_ABORT;
   const struct Address *followup_to = TAILQ_FIRST(&in->mail_followup_to);
 
+  mutt_env_thaw(in);
+
   if ((flags & (SEND_LIST_REPLY | SEND_GROUP_REPLY | SEND_GROUP_CHAT_REPLY)) && followup_to)
   {
     char prompt[256];
@@ -852,6 +854,7 @@ static void add_references(struct ListHead *head, struct Envelope *env)
 {
   struct ListNode *np = NULL;
 
+  mutt_env_thaw(env);
   struct ListHead *src = !STAILQ_EMPTY(&env->references) ? &env->references : &env->in_reply_to;
   STAILQ_FOREACH(np, src, entries)
   {
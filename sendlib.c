@@ -2234,6 +2234,7 @@ int mutt_rfc822_write_header(FILE *fp, struct Envelope *env,
   char *p = NULL, *q = NULL;
   bool has_agent = false; /* user defined user-agent header field exists */
 
+  mutt_env_thaw(env);
   if ((mode == MUTT_WRITE_HEADER_NORMAL) && !privacy)
     fputs(mutt_date_make_date(buf, sizeof(buf)), fp);
 
@@ -178,6 +178,8 @@ static int compare_to(const void *a, const void *b)
   struct Email **ppb = (struct Email **) b;
   char fa[128];
 
+  mutt_env_thaw((*ppa)->env);
+  mutt_env_thaw((*ppb)->env);
   mutt_str_strfcpy(fa, mutt_get_name(TAILQ_FIRST(&(*ppa)->env->to)), sizeof(fa));
   const char *fb = mutt_get_name(TAILQ_FIRST(&(*ppb)->env->to));
   int result = mutt_str_strncasecmp(fa, fb, sizeof(fa));
@@ -239,6 +241,8 @@ static int compare_spam(const void *a, const void *b)
 
   /* Firstly, require spam attributes for both msgs */
   /* to compare. Determine which msgs have one.     */
+  mutt_env_thaw((*ppa)->env);
+  mutt_env_thaw((*ppb)->env);
   ahas = (*ppa)->env && (*ppa)->env->spam;
   bhas = (*ppb)->env && (*ppb)->env->spam;
 
@@ -293,6 +297,8 @@ static int compare_label(const void *a, const void *b)
   /* As with compare_spam, not all messages will have the x-label
    * property.  Blank X-Labels are treated as null in the index
    * display, so we'll consider them as null for sort, too.       */
+  mutt_env_thaw((*ppa)->env);
+  mutt_env_thaw((*ppb)->env);
   ahas = (*ppa)->env && (*ppa)->env->x_label && *((*ppa)->env->x_label);
   bhas = (*ppb)->env && (*ppb)->env->x_label && *((*ppb)->env->x_label);
 
@@ -0,0 +1,152 @@
+/**
+ * @file
+ * Dummy code for working around build problems
+ *
+ * @authors
+ * Copyright (C) 2019 NeoMutt developers <neomutt-devel@neomutt.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <stdbool.h>
+#include <string.h>
+#include "mutt/mutt.h"
+#include "email/lib.h"
+#include "context.h"
+#include "mailbox.h"
+#include "mx.h"
+#include "sort.h"
+
+unsigned char C_Move;
+
+struct Email **g_batch_emails = NULL; ///< Emails of the Mailbox being changed
+int g_batch_count = 0;                ///< Number of Emails
+int g_batch_opens = 0;                ///< Number of calls to mx_mbox_open()
+OpenMailboxFlags g_batch_flags = 0;   ///< Flags the Mailbox was opened with
+short g_batch_sort = 0;               ///< $sort when the Mailbox was opened
+int g_batch_saved = 0;                ///< Emails copied or saved to a target
+int g_batch_syncs = 0;                ///< Number of calls to mx_mbox_sync()
+bool g_batch_dontwrite = false;       ///< Mailbox was closed with dontwrite
+int g_batch_new_mail = 0;             ///< Syncs and closes that find new mail
+int g_batch_updates = 0;              ///< Number of view updates
+bool g_batch_close_fails = false;     ///< mx_mbox_close() fails
+int g_batch_fastcloses = 0;           ///< Number of calls to mx_fastclose_mailbox()
+
+static struct Mailbox *BatchMailbox = NULL; ///< Mailbox being changed
+
+void ctx_free(struct Context **ctx)
+{
+  if (!ctx || !*ctx)
+    return;
+  mailbox_free(&(*ctx)->mailbox);
+  FREE(ctx);
+}
+
+void ctx_update(struct Context *ctx)
+{
+  g_batch_updates++;
+}
+
+void mutt_buffer_expand_path(struct Buffer *buf)
+{
+}
+
+void mutt_folder_hook(const char *path, const char *desc)
+{
+}
+
+int mutt_save_message_ctx(struct Email *e, bool delete_original, bool decode,
+                          bool decrypt, struct Mailbox *m)
+{
+  g_batch_saved++;
+  if (delete_original)
+    e->deleted = true;
+  return 0;
+}
+
+void mutt_sort_headers(struct Context *ctx, bool init)
+{
+  g_batch_updates++;
+}
+
+void mx_fastclose_mailbox(struct Mailbox *m)
+{
+  g_batch_fastcloses++;
+  if (m == BatchMailbox)
+  {
+    m->emails = NULL;
+    BatchMailbox = NULL;
+  }
+}
+
+int mx_mbox_close(struct Context **ptr)
+{
+  struct Mailbox *m = (*ptr)->mailbox;
+  if (m == BatchMailbox)
+  {
+    if (g_batch_new_mail > 0)
+    {
+      g_batch_new_mail--;
+      return MUTT_NEW_MAIL;
+    }
+    if (g_batch_close_fails)
+      return -1;
+
+    g_batch_dontwrite = m->dontwrite;
+    m->emails = NULL;
+    BatchMailbox = NULL;
+  }
+  ctx_free(ptr);
+  return 0;
+}
+
+struct Context *mx_mbox_open(struct Mailbox *m, OpenMailboxFlags flags)
+{
+  g_batch_opens++;
+  if (mutt_str_strcmp(mutt_b2s(m->pathbuf), "missing") == 0)
+    return NULL;
+
+  if (!(flags & MUTT_APPEND))
+  {
+    BatchMailbox = m;
+    g_batch_flags = flags;
+    g_batch_sort = C_Sort;
+    m->emails = g_batch_emails;
+    m->msg_count = g_batch_count;
+  }
+
+  struct Context *ctx = mutt_mem_calloc(1, sizeof(struct Context));
+  ctx->mailbox = m;
+  return ctx;
+}
+
+int mx_mbox_sync(struct Mailbox *m, int *index_hint)
+{
+  g_batch_syncs++;
+  if (g_batch_new_mail > 0)
+  {
+    g_batch_new_mail--;
+    return MUTT_NEW_MAIL;
+  }
+  return 0;
+}
+
+struct Mailbox *mx_path_resolve(const char *path)
+{
+  struct Mailbox *m = mailbox_new();
+  mutt_buffer_strcpy(m->pathbuf, path);
+  return m;
+}
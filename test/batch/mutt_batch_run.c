@@ -0,0 +1,199 @@
+/**
+ * @file
+ * Test code for mutt_batch_run()
+ *
+ * @authors
+ * Copyright (C) 2019 NeoMutt developers <neomutt-devel@neomutt.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+#include "config.h"
+#include "mutt/mutt.h"
+#include "email/lib.h"
+#include "batch.h"
+#include "mx.h"
+#include "sort.h"
+
+extern struct Email **g_batch_emails;
+extern int g_batch_count;
+extern int g_batch_opens;
+extern OpenMailboxFlags g_batch_flags;
+extern short g_batch_sort;
+extern int g_batch_saved;
+extern int g_batch_syncs;
+extern bool g_batch_dontwrite;
+extern int g_batch_new_mail;
+extern int g_batch_updates;
+extern bool g_batch_close_fails;
+extern int g_batch_fastcloses;
+
+static const char *Subjects[] = { "apple", "banana", "apple pie" };
+
+static void batch_reset(struct Email **emails)
+{
+  for (int i = 0; i < mutt_array_size(Subjects); i++)
+  {
+    if (!emails[i])
+    {
+      emails[i] = mutt_email_new();
+      emails[i]->env = mutt_env_new();
+      emails[i]->env->subject = mutt_str_strdup(Subjects[i]);
+    }
+    emails[i]->deleted = false;
+    emails[i]->flagged = false;
+    emails[i]->tagged = false;
+  }
+
+  g_batch_emails = emails;
+  g_batch_count = mutt_array_size(Subjects);
+  g_batch_opens = 0;
+  g_batch_flags = 0;
+  g_batch_sort = 0;
+  g_batch_saved = 0;
+  g_batch_syncs = 0;
+  g_batch_dontwrite = false;
+  g_batch_new_mail = 0;
+  g_batch_updates = 0;
+  g_batch_close_fails = false;
+  g_batch_fastcloses = 0;
+}
+
+static int batch_run(const char *path, const char *cmd1, const char *cmd2, bool readonly)
+{
+  struct ListHead cmds = STAILQ_HEAD_INITIALIZER(cmds);
+  mutt_list_insert_tail(&cmds, mutt_str_strdup(cmd1));
+  if (cmd2)
+    mutt_list_insert_tail(&cmds, mutt_str_strdup(cmd2));
+
+  int rc = mutt_batch_run(path, &cmds, readonly);
+  mutt_list_free(&cmds);
+  return rc;
+}
+
+void test_mutt_batch_run(void)
+{
+  // int mutt_batch_run(const char *path, struct ListHead *cmds, bool readonly);
+
+  struct Email *emails[3] = { 0 };
+  C_Sort = SORT_DATE;
+
+  {
+    batch_reset(emails);
+    TEST_CHECK(batch_run("box", "flag ~s apple", NULL, false) == 0);
+    TEST_CHECK(emails[0]->flagged && !emails[1]->flagged && emails[2]->flagged);
+    TEST_CHECK(g_batch_opens == 1);
+    TEST_CHECK((g_batch_flags & (MUTT_NOSORT | MUTT_READONLY)) == MUTT_NOSORT);
+    TEST_CHECK(!g_batch_dontwrite);
+  }
+
+  {
+    batch_reset(emails);
+    TEST_CHECK(batch_run("box", "tag ~A", "untag ~s banana", true) == 0);
+    TEST_CHECK(emails[0]->tagged && !emails[1]->tagged && emails[2]->tagged);
+    TEST_CHECK(g_batch_flags & MUTT_READONLY);
+  }
+
+  {
+    batch_reset(emails);
+    TEST_CHECK(batch_run("box", "delete ~s banana", "sync", false) == 0);
+    TEST_CHECK(!emails[0]->deleted && emails[1]->deleted && !emails[2]->deleted);
+    TEST_CHECK(g_batch_syncs == 1);
+  }
+
+  {
+    // New mail during a sync updates the view and syncs again
+    batch_reset(emails);
+    g_batch_new_mail = 1;
+    TEST_CHECK(batch_run("box", "delete ~s banana", "sync", false) == 0);
+    TEST_CHECK(emails[1]->deleted);
+    TEST_CHECK(g_batch_syncs == 2);
+    TEST_CHECK(g_batch_updates == 1);
+    TEST_CHECK(!g_batch_dontwrite);
+  }
+
+  {
+    // New mail during the close updates the view and closes again
+    batch_reset(emails);
+    g_batch_new_mail = 1;
+    TEST_CHECK(batch_run("box", "flag ~s banana", NULL, false) == 0);
+    TEST_CHECK(emails[1]->flagged);
+    TEST_CHECK(g_batch_updates == 1);
+    TEST_CHECK(!g_batch_dontwrite);
+    TEST_CHECK(g_batch_fastcloses == 0);
+  }
+
+  {
+    // A failed close still frees the Mailbox
+    batch_reset(emails);
+    g_batch_close_fails = true;
+    TEST_CHECK(batch_run("box", "flag ~s banana", NULL, false) == -1);
+    TEST_CHECK(g_batch_fastcloses == 1);
+  }
+
+  {
+    batch_reset(emails);
+    TEST_CHECK(batch_run("box", "save archive ~s pie", NULL, false) == 0);
+    TEST_CHECK(g_batch_opens == 2);
+    TEST_CHECK(g_batch_saved == 1);
+    TEST_CHECK(!emails[0]->deleted && emails[2]->deleted);
+  }
+
+  {
+    batch_reset(emails);
+    TEST_CHECK(batch_run("box", "copy archive ~s apple", NULL, false) == 0);
+    TEST_CHECK(g_batch_saved == 2);
+    TEST_CHECK(!emails[0]->deleted && !emails[2]->deleted);
+  }
+
+  {
+    // Thread patterns need a threaded Mailbox
+    batch_reset(emails);
+    TEST_CHECK(batch_run("box", "flag ~(~s banana)", NULL, false) == 0);
+    TEST_CHECK(!(g_batch_flags & MUTT_NOSORT));
+    TEST_CHECK(g_batch_sort == SORT_THREADS);
+    TEST_CHECK(C_Sort == SORT_DATE);
+  }
+
+  {
+    // A failed command stops the rest and discards the flag changes
+    batch_reset(emails);
+    TEST_CHECK(batch_run("box", "copy missing ~A", "flag ~A", false) == -1);
+    TEST_CHECK(g_batch_dontwrite);
+    TEST_CHECK(!emails[0]->flagged);
+  }
+
+  {
+    // Bad commands are rejected before the Mailbox is opened
+    static const char *bad[] = { "bogus ~A", "flag",       "save ~A",
+                                 "sync now", "delete ~x(", "copy" };
+    for (int i = 0; i < mutt_array_size(bad); i++)
+    {
+      batch_reset(emails);
+      TEST_CHECK_(batch_run("box", "tag ~A", bad[i], false) == -1, "%s", bad[i]);
+      TEST_CHECK(g_batch_opens == 0);
+    }
+  }
+
+  {
+    batch_reset(emails);
+    TEST_CHECK(batch_run("missing", "flag ~A", NULL, false) == -1);
+  }
+
+  for (int i = 0; i < mutt_array_size(emails); i++)
+    mutt_email_free(&emails[i]);
+}
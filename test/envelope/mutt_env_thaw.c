@@ -0,0 +1,107 @@
+/**
+ * @file
+ * Test code for mutt_env_thaw()
+ *
+ * @authors
+ * Copyright (C) 2019 NeoMutt developers <neomutt-devel@neomutt.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+#include "config.h"
+#include <string.h>
+#include "mutt/mutt.h"
+#include "address/lib.h"
+#include "email/lib.h"
+
+static int thaw_count = 0;
+
+static void thaw_to(struct Envelope *env, const unsigned char *data, size_t len)
+{
+  thaw_count++;
+  char *to = mutt_str_substr_dup((const char *) data, (const char *) data + len);
+  mutt_addrlist_parse(&env->to, to);
+  FREE(&to);
+}
+
+static struct Envelope *cold_env(const char *to)
+{
+  struct Envelope *env = mutt_env_new();
+  size_t len = strlen(to);
+  env->cold = mutt_mem_malloc(sizeof(struct EnvelopeCold) + len);
+  env->cold->thaw = thaw_to;
+  env->cold->len = len;
+  memcpy(env->cold->data, to, len);
+  return env;
+}
+
+void test_mutt_env_thaw(void)
+{
+  // void mutt_env_thaw(struct Envelope *env);
+
+  {
+    mutt_env_thaw(NULL);
+    TEST_CHECK_(1, "mutt_env_thaw(NULL)");
+  }
+
+  {
+    struct Envelope *env = mutt_env_new();
+    thaw_count = 0;
+    mutt_env_thaw(env);
+    TEST_CHECK(thaw_count == 0);
+    TEST_CHECK(TAILQ_EMPTY(&env->to));
+    mutt_env_free(&env);
+  }
+
+  {
+    struct Envelope *env = cold_env("apple@example.com");
+    thaw_count = 0;
+    mutt_env_thaw(env);
+    TEST_CHECK(thaw_count == 1);
+    TEST_CHECK(env->cold == NULL);
+    TEST_CHECK(mutt_str_strcmp(TAILQ_FIRST(&env->to)->mailbox, "apple@example.com") == 0);
+
+    mutt_env_thaw(env);
+    TEST_CHECK(thaw_count == 1);
+    mutt_env_free(&env);
+  }
+
+  {
+    struct Envelope *env = cold_env("apple@example.com");
+    mutt_env_free(&env);
+    TEST_CHECK(env == NULL);
+  }
+
+  {
+    struct Envelope *base = cold_env("apple@example.com");
+    struct Envelope *extra = cold_env("banana@example.com");
+    thaw_count = 0;
+    mutt_env_merge(base, &extra);
+    TEST_CHECK(thaw_count == 2);
+    TEST_CHECK(mutt_str_strcmp(TAILQ_FIRST(&base->to)->mailbox, "apple@example.com") == 0);
+    mutt_env_free(&base);
+  }
+
+  {
+    struct Envelope *e1 = cold_env("apple@example.com");
+    struct Envelope *e2 = cold_env("banana@example.com");
+    TEST_CHECK(!mutt_env_cmp_strict(e1, e2));
+    TEST_CHECK(!e1->cold && !e2->cold);
+    mutt_env_free(&e1);
+    mutt_env_free(&e2);
+  }
+}
@@ -0,0 +1,52 @@
+/**
+ * @file
+ * Test code for mutt_file_willneed()
+ *
+ * @authors
+ * Copyright (C) 2019 NeoMutt developers <neomutt-devel@neomutt.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "mutt/mutt.h"
+
+void test_mutt_file_willneed(void)
+{
+  // int mutt_file_willneed(const char *path);
+
+  {
+    TEST_CHECK(mutt_file_willneed(NULL) != 0);
+  }
+
+  {
+    TEST_CHECK(mutt_file_willneed("/does/not/exist") != 0);
+  }
+
+  {
+    char path[] = "/tmp/neomutt-willneed-XXXXXX";
+    int fd = mkstemp(path);
+    TEST_CHECK(fd >= 0);
+    TEST_CHECK(write(fd, "hello\n", 6) == 6);
+    close(fd);
+    TEST_CHECK(mutt_file_willneed(path) == 0);
+    unlink(path);
+  }
+}
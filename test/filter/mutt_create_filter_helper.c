@@ -0,0 +1,132 @@
+/**
+ * @file
+ * Test code for mutt_create_filter_helper()
+ *
+ * @authors
+ * Copyright (C) 2019 NeoMutt developers <neomutt-devel@neomutt.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+#include "config.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "mutt/mutt.h"
+#include "filter.h"
+
+extern char **environ;
+
+/**
+ * filter_read - Run a command and read the first line of its output
+ * @param cmd  Command line
+ * @param buf  Buffer for the output
+ * @param len  Length of buffer
+ * @param in   Text for the command's stdin (NULL: none)
+ * @retval num Exit status of the command
+ */
+static int filter_read(const char *cmd, char *buf, size_t len, const char *in)
+{
+  FILE *fp_in = NULL;
+  FILE *fp_out = NULL;
+  buf[0] = '\0';
+
+  pid_t pid = mutt_create_filter_helper(cmd, in ? &fp_in : NULL, &fp_out, NULL, -1, -1, -1);
+  if (!TEST_CHECK(pid > 0))
+    return -1;
+
+  if (in)
+  {
+    fputs(in, fp_in);
+    mutt_file_fclose(&fp_in);
+  }
+  if (fgets(buf, len, fp_out))
+    mutt_str_remove_trailing_ws(buf);
+  mutt_file_fclose(&fp_out);
+
+  return mutt_wait_filter(pid);
+}
+
+void test_mutt_create_filter_helper(void)
+{
+  // pid_t mutt_create_filter_helper(const char *cmd, FILE **fp_in, FILE **fp_out, FILE **fp_err, int fdin, int fdout, int fderr);
+
+  char buf[PATH_MAX];
+  char cwd[PATH_MAX];
+
+  TEST_CHECK(mutt_filter_helper_start() == 0);
+  mutt_envlist_init(environ);
+  mutt_envlist_set("NEOMUTT_FILTER_TEST", "helper", true);
+
+  {
+    TEST_CHECK(filter_read("echo hello", buf, sizeof(buf), NULL) == 0);
+    TEST_CHECK(mutt_str_strcmp(buf, "hello") == 0);
+  }
+
+  {
+    // The command is a child of the helper
+    TEST_CHECK(filter_read("echo $PPID", buf, sizeof(buf), NULL) == 0);
+    TEST_CHECK(atoi(buf) != getpid());
+  }
+
+  {
+    TEST_CHECK(filter_read("tr a-z A-Z", buf, sizeof(buf), "apple\n") == 0);
+    TEST_CHECK(mutt_str_strcmp(buf, "APPLE") == 0);
+  }
+
+  {
+    // The helper reports the command's exit status
+    TEST_CHECK(filter_read("exit 3", buf, sizeof(buf), NULL) == 3);
+  }
+
+  {
+    // The command gets NeoMutt's environment, not the helper's
+    TEST_CHECK(filter_read("echo $NEOMUTT_FILTER_TEST", buf, sizeof(buf), NULL) == 0);
+    TEST_CHECK(mutt_str_strcmp(buf, "helper") == 0);
+  }
+
+  {
+    // ...and NeoMutt's current directory
+    TEST_CHECK(getcwd(cwd, sizeof(cwd)) != NULL);
+    TEST_CHECK(filter_read("pwd", buf, sizeof(buf), NULL) == 0);
+    TEST_CHECK(mutt_str_strcmp(buf, cwd) == 0);
+  }
+
+  {
+    // Several commands can run at once
+    FILE *fp1 = NULL;
+    FILE *fp2 = NULL;
+    pid_t pid1 = mutt_create_filter_helper("echo one; exit 1", NULL, &fp1, NULL, -1, -1, -1);
+    pid_t pid2 = mutt_create_filter_helper("echo two; exit 2", NULL, &fp2, NULL, -1, -1, -1);
+    TEST_CHECK((pid1 > 0) && (pid2 > 0) && (pid1 != pid2));
+    TEST_CHECK(mutt_wait_filter(pid2) == 2);
+    TEST_CHECK(mutt_wait_filter(pid1) == 1);
+    mutt_file_fclose(&fp1);
+    mutt_file_fclose(&fp2);
+  }
+
+  mutt_filter_helper_stop();
+
+  {
+    // Without the helper, the command is forked directly
+    TEST_CHECK(filter_read("echo $PPID", buf, sizeof(buf), NULL) == 0);
+    TEST_CHECK(atoi(buf) == getpid());
+  }
+
+  mutt_envlist_free();
+}
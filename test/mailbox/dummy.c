@@ -0,0 +1,79 @@
+/**
+ * @file
+ * Dummy code for working around build problems
+ *
+ * @authors
+ * Copyright (C) 2019 NeoMutt developers <neomutt-devel@neomutt.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "mutt/mutt.h"
+#include "mailbox.h"
+#include "mutt_menu.h"
+#include "mx.h"
+
+struct MuttWindow;
+
+struct MuttWindow *MuttMessageWindow = NULL;
+pid_t g_mailbox_checker = 0; ///< Process that last ran mx_mbox_check_stats()
+
+void mutt_buffer_pretty_mailbox(struct Buffer *s)
+{
+}
+
+void mutt_menu_set_current_redraw(MuttRedrawFlags redraw)
+{
+}
+
+void mutt_update_num_postponed(void)
+{
+}
+
+/**
+ * mx_mbox_check_stats - Fake a Mailbox check
+ *
+ * "notmuch://N" has N messages, half of them unread.
+ * "notmuch://slow" takes longer than any test waits.
+ */
+int mx_mbox_check_stats(struct Mailbox *m, int flags)
+{
+  g_mailbox_checker = getpid();
+
+  const char *query = mutt_b2s(m->pathbuf) + 10;
+  if (mutt_str_strcmp(query, "slow") == 0)
+    sleep(30);
+
+  m->msg_count = atoi(query);
+  m->msg_unread = m->msg_count / 2;
+  m->has_new = (m->msg_unread > 0);
+  return 0;
+}
+
+void mx_mbox_prefetch(struct Mailbox *m)
+{
+}
+
+enum MailboxType mx_path_probe(const char *path, struct stat *st)
+{
+  if (mutt_str_startswith(path, "notmuch://", CASE_MATCH))
+    return MUTT_NOTMUCH;
+  return MUTT_UNKNOWN;
+}
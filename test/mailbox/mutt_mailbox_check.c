@@ -0,0 +1,121 @@
+/**
+ * @file
+ * Test code for mutt_mailbox_check()
+ *
+ * @authors
+ * Copyright (C) 2019 NeoMutt developers <neomutt-devel@neomutt.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+#include "config.h"
+#include <time.h>
+#include <unistd.h>
+#include "mutt/mutt.h"
+#include "mailbox.h"
+#include "mx.h"
+
+extern pid_t g_mailbox_checker;
+
+static struct Mailbox *mailbox_add(const char *path)
+{
+  struct Mailbox *m = mailbox_new();
+  mutt_buffer_strcpy(m->pathbuf, path);
+  m->magic = mx_path_probe(path, NULL);
+
+  struct MailboxNode *np = mutt_mem_calloc(1, sizeof(struct MailboxNode));
+  np->mailbox = m;
+  STAILQ_INSERT_TAIL(&AllMailboxes, np, entries);
+  return m;
+}
+
+static void mailbox_remove(struct Mailbox **m)
+{
+  struct MailboxNode *np = NULL;
+  STAILQ_FOREACH(np, &AllMailboxes, entries)
+  {
+    if (np->mailbox == *m)
+    {
+      STAILQ_REMOVE(&AllMailboxes, np, MailboxNode, entries);
+      FREE(&np);
+      break;
+    }
+  }
+  mailbox_free(m);
+}
+
+void test_mutt_mailbox_check(void)
+{
+  // int mutt_mailbox_check(struct Mailbox *m_cur, int force);
+
+  C_MailCheck = 0;
+
+  {
+    // Without a timeout, everything is checked in-process
+    C_MailCheckTimeout = 0;
+    struct Mailbox *m = mailbox_add("notmuch://4");
+    g_mailbox_checker = 0;
+    TEST_CHECK(mutt_mailbox_check(NULL, MUTT_MAILBOX_CHECK_FORCE) == 1);
+    TEST_CHECK(g_mailbox_checker == getpid());
+    TEST_CHECK(m->msg_count == 4);
+    mailbox_remove(&m);
+  }
+
+  {
+    // The slow Mailboxes are checked by a worker, whose counts are merged
+    C_MailCheckTimeout = 5;
+    struct Mailbox *m1 = mailbox_add("notmuch://4");
+    struct Mailbox *m2 = mailbox_add("notmuch://0");
+    g_mailbox_checker = 0;
+    TEST_CHECK(mutt_mailbox_check(NULL, MUTT_MAILBOX_CHECK_FORCE) == 2);
+    TEST_CHECK(g_mailbox_checker == 0);
+    TEST_CHECK((m1->msg_count == 4) && (m1->msg_unread == 2) && m1->has_new);
+    TEST_CHECK((m2->msg_count == 0) && !m2->has_new);
+    mailbox_remove(&m1);
+    mailbox_remove(&m2);
+  }
+
+  {
+    // A check that takes too long is abandoned; the earlier counts still arrive
+    C_MailCheckTimeout = 1;
+    struct Mailbox *m1 = mailbox_add("notmuch://6");
+    struct Mailbox *m2 = mailbox_add("notmuch://slow");
+    m2->msg_count = 9;
+    time_t start = time(NULL);
+    mutt_mailbox_check(NULL, MUTT_MAILBOX_CHECK_FORCE);
+    TEST_CHECK(time(NULL) - start < 5);
+    TEST_CHECK(m1->msg_count == 6);
+    TEST_CHECK(m2->msg_count == 9);
+    mailbox_remove(&m1);
+    mailbox_remove(&m2);
+  }
+
+  {
+    // Counts for a Mailbox that has gone are dropped, not given to a new one
+    C_MailCheckTimeout = 5;
+    struct Mailbox *m_old = mailbox_add("notmuch://7");
+    mutt_mailbox_check(NULL, 0);
+    mailbox_remove(&m_old);
+    struct Mailbox *m_new = mailbox_add("/dev/null/neomutt");
+    usleep(200000);
+    mutt_mailbox_check(NULL, MUTT_MAILBOX_CHECK_FORCE);
+    TEST_CHECK(m_new->msg_count == 0);
+    mailbox_remove(&m_new);
+  }
+
+  C_MailCheckTimeout = 0;
+}
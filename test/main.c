@@ -60,6 +60,7 @@
   NEOMUTT_TEST_ITEM(test_mutt_b64_buffer_encode)                               \
   NEOMUTT_TEST_ITEM(test_mutt_b64_decode)                                      \
   NEOMUTT_TEST_ITEM(test_mutt_b64_encode)                                      \
+  NEOMUTT_TEST_ITEM(test_mutt_batch_run)                                       \
   NEOMUTT_TEST_ITEM(test_mutt_body_cmp_strict)                                 \
   NEOMUTT_TEST_ITEM(test_mutt_body_free)                                       \
   NEOMUTT_TEST_ITEM(test_mutt_body_new)                                        \
@@ -142,6 +143,7 @@
   NEOMUTT_TEST_ITEM(test_mutt_env_free)                                        \
   NEOMUTT_TEST_ITEM(test_mutt_env_merge)                                       \
   NEOMUTT_TEST_ITEM(test_mutt_env_new)                                         \
+  NEOMUTT_TEST_ITEM(test_mutt_env_thaw)                                        \
   NEOMUTT_TEST_ITEM(test_mutt_env_to_intl)                                     \
   NEOMUTT_TEST_ITEM(test_mutt_env_to_local)                                    \
   NEOMUTT_TEST_ITEM(test_mutt_envlist_free)                                    \
@@ -188,6 +190,8 @@
   NEOMUTT_TEST_ITEM(test_mutt_file_unlink)                                     \
   NEOMUTT_TEST_ITEM(test_mutt_file_unlink_empty)                               \
   NEOMUTT_TEST_ITEM(test_mutt_file_unlock)                                     \
+  NEOMUTT_TEST_ITEM(test_mutt_file_willneed)                                   \
+  NEOMUTT_TEST_ITEM(test_mutt_create_filter_helper)                            \
   NEOMUTT_TEST_ITEM(test_mutt_grouplist_add)                                   \
   NEOMUTT_TEST_ITEM(test_mutt_grouplist_add_addrlist)                          \
   NEOMUTT_TEST_ITEM(test_mutt_grouplist_add_regex)                             \
@@ -251,6 +255,7 @@
   NEOMUTT_TEST_ITEM(test_log_queue_flush)                                      \
   NEOMUTT_TEST_ITEM(test_log_queue_save)                                       \
   NEOMUTT_TEST_ITEM(test_log_queue_set_max_size)                               \
+  NEOMUTT_TEST_ITEM(test_mutt_mailbox_check)                                   \
   NEOMUTT_TEST_ITEM(test_mutt_map_get_name)                                    \
   NEOMUTT_TEST_ITEM(test_mutt_map_get_value)                                   \
   NEOMUTT_TEST_ITEM(test_mutt_mb_charlen)                                      \
@@ -276,6 +281,10 @@
   NEOMUTT_TEST_ITEM(test_mutt_mem_free)                                        \
   NEOMUTT_TEST_ITEM(test_mutt_mem_malloc)                                      \
   NEOMUTT_TEST_ITEM(test_mutt_mem_realloc)                                     \
+  NEOMUTT_TEST_ITEM(test_hcache_mmapdb_close)                                  \
+  NEOMUTT_TEST_ITEM(test_hcache_mmapdb_delete)                                 \
+  NEOMUTT_TEST_ITEM(test_hcache_mmapdb_open)                                   \
+  NEOMUTT_TEST_ITEM(test_hcache_mmapdb_store)                                  \
   NEOMUTT_TEST_ITEM(test_mutt_param_cmp_strict)                                \
   NEOMUTT_TEST_ITEM(test_mutt_param_delete)                                    \
   NEOMUTT_TEST_ITEM(test_mutt_param_free)                                      \
@@ -404,6 +413,8 @@
   NEOMUTT_TEST_ITEM(test_insert_message)                                       \
   NEOMUTT_TEST_ITEM(test_is_descendant)                                        \
   NEOMUTT_TEST_ITEM(test_mutt_break_thread)                                    \
+  NEOMUTT_TEST_ITEM(test_mutt_thread_cache_save)                               \
+  NEOMUTT_TEST_ITEM(test_mutt_thread_collapse_new)                             \
   NEOMUTT_TEST_ITEM(test_thread_hash_destructor)                               \
   NEOMUTT_TEST_ITEM(test_unlink_message)                                       \
   NEOMUTT_TEST_ITEM(test_url_check_scheme)                                     \
@@ -0,0 +1,106 @@
+/**
+ * @file
+ * Common code for mmapdb tests
+ *
+ * @authors
+ * Copyright (C) 2018 Pietro Cerutti <gahr@gahr.ch>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+#include "config.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "mutt/mutt.h"
+#include "common.h"
+
+/**
+ * mmapdb_test_init - Create a directory for a test database
+ * @param dir     Template for mkdtemp(), e.g. "/tmp/neomutt-XXXXXX"
+ * @param path    Buffer for the path of the database
+ * @param pathlen Length of the buffer
+ * @retval true Success
+ */
+bool mmapdb_test_init(char *dir, char *path, size_t pathlen)
+{
+  if (!mkdtemp(dir))
+    return false;
+  snprintf(path, pathlen, "%s/hcache", dir);
+  return true;
+}
+
+/**
+ * mmapdb_test_done - Delete a test database and its directory
+ * @param dir  Directory
+ * @param path Path of the database
+ */
+void mmapdb_test_done(const char *dir, const char *path)
+{
+  unlink(path);
+  rmdir(dir);
+}
+
+/**
+ * mmapdb_test_fetch - Check the data stored under a key
+ * @param ctx      Database
+ * @param key      Key
+ * @param expected Expected data, or NULL if the key shouldn't exist
+ * @retval true The data matches
+ */
+bool mmapdb_test_fetch(void *ctx, const char *key, const char *expected)
+{
+  size_t dlen = 0;
+  void *data = hcache_mmapdb_ops.fetch(ctx, key, strlen(key), &dlen);
+  if (!expected)
+    return !data;
+
+  return data && (dlen == strlen(expected)) && (memcmp(data, expected, dlen) == 0);
+}
+
+/**
+ * mmapdb_test_store - Store a string under a key
+ * @param ctx  Database
+ * @param key  Key
+ * @param data String to store
+ * @retval 0   Success
+ * @retval num Error
+ */
+int mmapdb_test_store(void *ctx, const char *key, const char *data)
+{
+  return hcache_mmapdb_ops.store(ctx, key, strlen(key), (void *) data, strlen(data));
+}
+
+/**
+ * mmapdb_test_header - Read a field from a database's header
+ * @param path Path of the database
+ * @param off  Offset of the field, e.g. #MMAPDB_TEST_DATA_END
+ * @retval num Value of the field
+ */
+uint64_t mmapdb_test_header(const char *path, size_t off)
+{
+  uint64_t value = 0;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return 0;
+  if (pread(fd, &value, sizeof(value), off) != sizeof(value))
+    value = 0;
+  close(fd);
+  return value;
+}
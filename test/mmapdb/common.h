@@ -0,0 +1,43 @@
+/**
+ * @file
+ * Common code for mmapdb tests
+ *
+ * @authors
+ * Copyright (C) 2018 Pietro Cerutti <gahr@gahr.ch>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _TEST_MMAPDB_COMMON_H
+#define _TEST_MMAPDB_COMMON_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "hcache/backend.h"
+
+/* Offsets of the fields of struct MmapDbHeader */
+#define MMAPDB_TEST_DATA_END   16 ///< End of the records
+#define MMAPDB_TEST_IDX_OFFSET 24 ///< Offset of the saved index
+
+extern const struct HcacheOps hcache_mmapdb_ops;
+
+bool     mmapdb_test_init(char *dir, char *path, size_t pathlen);
+void     mmapdb_test_done(const char *dir, const char *path);
+bool     mmapdb_test_fetch(void *ctx, const char *key, const char *expected);
+int      mmapdb_test_store(void *ctx, const char *key, const char *data);
+uint64_t mmapdb_test_header(const char *path, size_t off);
+
+#endif /* _TEST_MMAPDB_COMMON_H */
@@ -0,0 +1,93 @@
+/**
+ * @file
+ * Test code for hcache_mmapdb_close()
+ *
+ * @authors
+ * Copyright (C) 2018 Pietro Cerutti <gahr@gahr.ch>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+#include "config.h"
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "mutt/mutt.h"
+#include "common.h"
+
+void test_hcache_mmapdb_close(void)
+{
+  // void hcache_mmapdb_close(void **vctx);
+
+#ifdef HAVE_MMAPDB
+  const struct HcacheOps *ops = &hcache_mmapdb_ops;
+  char dir[] = "/tmp/neomutt-mmapdb-XXXXXX";
+  char path[PATH_MAX];
+  struct stat st;
+
+  {
+    ops->close(NULL);
+    TEST_CHECK_(1, "ops->close(NULL)");
+  }
+
+  if (!TEST_CHECK(mmapdb_test_init(dir, path, sizeof(path))))
+    return;
+
+  {
+    // Replacing a large record many times leaves mostly stale data
+    static char big[65536];
+    void *ctx = ops->open(path);
+    TEST_CHECK(mmapdb_test_store(ctx, "small", "data") == 0);
+    for (int i = 0; i < 40; i++)
+    {
+      memset(big, 'a' + (i % 26), sizeof(big) - 1);
+      TEST_CHECK(mmapdb_test_store(ctx, "big", big) == 0);
+    }
+    TEST_CHECK(stat(path, &st) == 0);
+    TEST_CHECK(st.st_size > (40 * 65536));
+    ops->close(&ctx);
+
+    // ...so it's compacted on close
+    TEST_CHECK(stat(path, &st) == 0);
+    TEST_CHECK(st.st_size < (2 * 65536));
+    TEST_CHECK(mmapdb_test_header(path, MMAPDB_TEST_IDX_OFFSET) != 0);
+
+    char tmp[PATH_MAX];
+    snprintf(tmp, sizeof(tmp), "%s.compact", path);
+    TEST_CHECK(access(tmp, F_OK) != 0);
+
+    ctx = ops->open(path);
+    TEST_CHECK(mmapdb_test_fetch(ctx, "small", "data"));
+    TEST_CHECK(mmapdb_test_fetch(ctx, "big", big));
+    ops->close(&ctx);
+  }
+
+  {
+    // A little stale data isn't worth compacting
+    void *ctx = ops->open(path);
+    TEST_CHECK(mmapdb_test_store(ctx, "small", "more") == 0);
+    ops->close(&ctx);
+    off_t size = st.st_size;
+    TEST_CHECK(stat(path, &st) == 0);
+    TEST_CHECK(st.st_size > size);
+  }
+
+  mmapdb_test_done(dir, path);
+#endif
+}
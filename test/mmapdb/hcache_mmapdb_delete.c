@@ -0,0 +1,94 @@
+/**
+ * @file
+ * Test code for hcache_mmapdb_delete()
+ *
+ * @authors
+ * Copyright (C) 2018 Pietro Cerutti <gahr@gahr.ch>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+#include "config.h"
+#include <limits.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "mutt/mutt.h"
+#include "common.h"
+
+void test_hcache_mmapdb_delete(void)
+{
+  // int hcache_mmapdb_delete(void *vctx, const char *key, size_t keylen);
+
+#ifdef HAVE_MMAPDB
+  const struct HcacheOps *ops = &hcache_mmapdb_ops;
+  char dir[] = "/tmp/neomutt-mmapdb-XXXXXX";
+  char path[PATH_MAX];
+
+  if (!TEST_CHECK(mmapdb_test_init(dir, path, sizeof(path))))
+    return;
+
+  {
+    TEST_CHECK(ops->delete(NULL, "apple", 5) != 0);
+  }
+
+  {
+    void *ctx = ops->open(path);
+    TEST_CHECK(mmapdb_test_store(ctx, "apple", "red") == 0);
+    TEST_CHECK(mmapdb_test_store(ctx, "banana", "yellow") == 0);
+    TEST_CHECK(mmapdb_test_store(ctx, "cherry", "black") == 0);
+
+    TEST_CHECK(ops->delete(ctx, "apple", 5) == 0);
+    TEST_CHECK(mmapdb_test_fetch(ctx, "apple", NULL));
+    TEST_CHECK(mmapdb_test_fetch(ctx, "banana", "yellow"));
+
+    // A missing key can't be deleted
+    TEST_CHECK(ops->delete(ctx, "apple", 5) != 0);
+    TEST_CHECK(ops->delete(ctx, "damson", 6) != 0);
+
+    // A deleted key can be stored again
+    TEST_CHECK(mmapdb_test_store(ctx, "apple", "green") == 0);
+    TEST_CHECK(mmapdb_test_fetch(ctx, "apple", "green"));
+    TEST_CHECK(ops->delete(ctx, "cherry", 6) == 0);
+    ops->close(&ctx);
+  }
+
+  {
+    // The saved index remembers the deletion
+    void *ctx = ops->open(path);
+    TEST_CHECK(mmapdb_test_fetch(ctx, "apple", "green"));
+    TEST_CHECK(mmapdb_test_fetch(ctx, "cherry", NULL));
+    ops->close(&ctx);
+  }
+
+  {
+    // So does the log, when the index is rebuilt
+    uint64_t zero = 0;
+    int fd = open(path, O_WRONLY);
+    TEST_CHECK(pwrite(fd, &zero, sizeof(zero), MMAPDB_TEST_IDX_OFFSET) == sizeof(zero));
+    close(fd);
+
+    void *ctx = ops->open(path);
+    TEST_CHECK(mmapdb_test_fetch(ctx, "apple", "green"));
+    TEST_CHECK(mmapdb_test_fetch(ctx, "banana", "yellow"));
+    TEST_CHECK(mmapdb_test_fetch(ctx, "cherry", NULL));
+    ops->close(&ctx);
+  }
+
+  mmapdb_test_done(dir, path);
+#endif
+}
@@ -0,0 +1,184 @@
+/**
+ * @file
+ * Test code for hcache_mmapdb_open()
+ *
+ * @authors
+ * Copyright (C) 2018 Pietro Cerutti <gahr@gahr.ch>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+#include "config.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "mutt/mutt.h"
+#include "common.h"
+
+#ifdef HAVE_MMAPDB
+/**
+ * mmapdb_test_fill - Create a database with three keys
+ * @param path Path of the database
+ * @retval true Success
+ */
+static bool mmapdb_test_fill(const char *path)
+{
+  const struct HcacheOps *ops = &hcache_mmapdb_ops;
+  unlink(path);
+  void *ctx = ops->open(path);
+  if (!ctx)
+    return false;
+
+  bool ok = (mmapdb_test_store(ctx, "apple", "red") == 0) &&
+            (mmapdb_test_store(ctx, "banana", "yellow") == 0) &&
+            (mmapdb_test_store(ctx, "cherry", "black") == 0);
+  ops->close(&ctx);
+  return ok;
+}
+
+/**
+ * mmapdb_test_write - Overwrite part of a database
+ * @param path Path of the database
+ * @param off  Offset to write at
+ * @param data Data to write
+ * @param len  Length of the data
+ */
+static void mmapdb_test_write(const char *path, size_t off, const void *data, size_t len)
+{
+  int fd = open(path, O_WRONLY);
+  TEST_CHECK(pwrite(fd, data, len, off) == (ssize_t) len);
+  close(fd);
+}
+#endif
+
+void test_hcache_mmapdb_open(void)
+{
+  // void *hcache_mmapdb_open(const char *path);
+
+#ifdef HAVE_MMAPDB
+  const struct HcacheOps *ops = &hcache_mmapdb_ops;
+  char dir[] = "/tmp/neomutt-mmapdb-XXXXXX";
+  char path[PATH_MAX];
+
+  if (!TEST_CHECK(mmapdb_test_init(dir, path, sizeof(path))))
+    return;
+
+  {
+    char bad[PATH_MAX];
+    snprintf(bad, sizeof(bad), "%s/missing/hcache", dir);
+    TEST_CHECK(ops->open(bad) == NULL);
+  }
+
+  {
+    // Rebuild the index if it's out of date
+    TEST_CHECK(mmapdb_test_fill(path));
+    uint64_t bogus = 12345;
+    mmapdb_test_write(path, MMAPDB_TEST_IDX_OFFSET, &bogus, sizeof(bogus));
+
+    void *ctx = ops->open(path);
+    TEST_CHECK(mmapdb_test_fetch(ctx, "apple", "red"));
+    TEST_CHECK(mmapdb_test_fetch(ctx, "banana", "yellow"));
+    TEST_CHECK(mmapdb_test_fetch(ctx, "cherry", "black"));
+    ops->close(&ctx);
+    TEST_CHECK(mmapdb_test_header(path, MMAPDB_TEST_IDX_OFFSET) != 0);
+  }
+
+  {
+    // A truncated file loses the incomplete record
+    TEST_CHECK(mmapdb_test_fill(path));
+    uint64_t end = mmapdb_test_header(path, MMAPDB_TEST_DATA_END);
+    TEST_CHECK(truncate(path, end - 4) == 0);
+
+    void *ctx = ops->open(path);
+    TEST_CHECK(mmapdb_test_fetch(ctx, "apple", "red"));
+    TEST_CHECK(mmapdb_test_fetch(ctx, "banana", "yellow"));
+    TEST_CHECK(mmapdb_test_fetch(ctx, "cherry", NULL));
+    TEST_CHECK(mmapdb_test_store(ctx, "cherry", "red") == 0);
+    ops->close(&ctx);
+
+    ctx = ops->open(path);
+    TEST_CHECK(mmapdb_test_fetch(ctx, "cherry", "red"));
+    ops->close(&ctx);
+  }
+
+  {
+    // A corrupted record ends the log
+    TEST_CHECK(mmapdb_test_fill(path));
+    uint64_t zero = 0;
+    mmapdb_test_write(path, MMAPDB_TEST_IDX_OFFSET, &zero, sizeof(zero));
+    uint32_t keylen = 0;
+    // banana's record follows the header and apple's 24-byte record
+    mmapdb_test_write(path, 64 + 24, &keylen, sizeof(keylen));
+
+    void *ctx = ops->open(path);
+    TEST_CHECK(mmapdb_test_fetch(ctx, "apple", "red"));
+    TEST_CHECK(mmapdb_test_fetch(ctx, "banana", NULL));
+    TEST_CHECK(mmapdb_test_fetch(ctx, "cherry", NULL));
+    ops->close(&ctx);
+  }
+
+  {
+    // A file that isn't a database
+    mmapdb_test_write(path, 0, "NOTMMAP!", 8);
+    TEST_CHECK(ops->open(path) == NULL);
+  }
+
+  {
+    // While the database is being written, other users get a busy context
+    TEST_CHECK(mmapdb_test_fill(path));
+    void *ctx = ops->open(path);
+    void *busy = ops->open(path);
+    TEST_CHECK(busy != NULL);
+    TEST_CHECK(mmapdb_test_fetch(busy, "apple", NULL));
+    TEST_CHECK(mmapdb_test_store(busy, "apple", "green") != 0);
+    TEST_CHECK(ops->delete(busy, "apple", 5) != 0);
+    ops->close(&busy);
+    TEST_CHECK(mmapdb_test_fetch(ctx, "apple", "red"));
+    ops->close(&ctx);
+  }
+
+  {
+    // A child that inherited the fd doesn't keep the lock
+    int fds[2];
+    TEST_CHECK(pipe(fds) == 0);
+    void *ctx = ops->open(path);
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+      char c;
+      close(fds[1]);
+      _exit(read(fds[0], &c, 1) < 0);
+    }
+    close(fds[0]);
+    ops->close(&ctx);
+
+    ctx = ops->open(path);
+    TEST_CHECK(mmapdb_test_store(ctx, "apple", "green") == 0);
+    ops->close(&ctx);
+
+    close(fds[1]);
+    TEST_CHECK(waitpid(pid, NULL, 0) == pid);
+  }
+
+  mmapdb_test_done(dir, path);
+#endif
+}
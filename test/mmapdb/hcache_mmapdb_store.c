@@ -0,0 +1,116 @@
+/**
+ * @file
+ * Test code for hcache_mmapdb_store()
+ *
+ * @authors
+ * Copyright (C) 2018 Pietro Cerutti <gahr@gahr.ch>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+#include "config.h"
+#include <limits.h>
+#include <stdio.h>
+#include "mutt/mutt.h"
+#include "common.h"
+
+void test_hcache_mmapdb_store(void)
+{
+  // int hcache_mmapdb_store(void *vctx, const char *key, size_t keylen, void *data, size_t dlen);
+
+#ifdef HAVE_MMAPDB
+  const struct HcacheOps *ops = &hcache_mmapdb_ops;
+  char dir[] = "/tmp/neomutt-mmapdb-XXXXXX";
+  char path[PATH_MAX];
+  char key[32];
+  char data[32];
+
+  if (!TEST_CHECK(mmapdb_test_init(dir, path, sizeof(path))))
+    return;
+
+  {
+    TEST_CHECK(ops->store(NULL, "apple", 5, "x", 1) != 0);
+  }
+
+  {
+    void *ctx = ops->open(path);
+    TEST_CHECK(ctx != NULL);
+    TEST_CHECK(mmapdb_test_fetch(ctx, "apple", NULL));
+    TEST_CHECK(mmapdb_test_store(ctx, "apple", "red") == 0);
+    TEST_CHECK(mmapdb_test_store(ctx, "banana", "") == 0);
+    TEST_CHECK(mmapdb_test_fetch(ctx, "apple", "red"));
+    TEST_CHECK(mmapdb_test_fetch(ctx, "banana", ""));
+
+    // Replace a key
+    TEST_CHECK(mmapdb_test_store(ctx, "apple", "green") == 0);
+    TEST_CHECK(mmapdb_test_fetch(ctx, "apple", "green"));
+
+    // An empty key can't be stored
+    TEST_CHECK(ops->store(ctx, "", 0, "x", 1) != 0);
+
+    // Enough keys to grow the index
+    for (int i = 0; i < 3000; i++)
+    {
+      snprintf(key, sizeof(key), "key%d", i);
+      snprintf(data, sizeof(data), "data%d", i);
+      TEST_CHECK(mmapdb_test_store(ctx, key, data) == 0);
+    }
+    bool found = true;
+    for (int i = 0; i < 3000; i++)
+    {
+      snprintf(key, sizeof(key), "key%d", i);
+      snprintf(data, sizeof(data), "data%d", i);
+      found = found && mmapdb_test_fetch(ctx, key, data);
+    }
+    TEST_CHECK(found);
+    ops->close(&ctx);
+    TEST_CHECK(ctx == NULL);
+  }
+
+  {
+    // Reopen using the saved index
+    TEST_CHECK(mmapdb_test_header(path, MMAPDB_TEST_IDX_OFFSET) != 0);
+    void *ctx = ops->open(path);
+    TEST_CHECK(ctx != NULL);
+    TEST_CHECK(mmapdb_test_fetch(ctx, "apple", "green"));
+    TEST_CHECK(mmapdb_test_fetch(ctx, "banana", ""));
+    bool found = true;
+    for (int i = 0; i < 3000; i++)
+    {
+      snprintf(key, sizeof(key), "key%d", i);
+      snprintf(data, sizeof(data), "data%d", i);
+      found = found && mmapdb_test_fetch(ctx, key, data);
+    }
+    TEST_CHECK(found);
+
+    // The first write invalidates the saved index
+    TEST_CHECK(mmapdb_test_store(ctx, "cherry", "black") == 0);
+    TEST_CHECK(mmapdb_test_header(path, MMAPDB_TEST_IDX_OFFSET) == 0);
+    TEST_CHECK(mmapdb_test_fetch(ctx, "apple", "green"));
+    ops->close(&ctx);
+  }
+
+  {
+    void *ctx = ops->open(path);
+    TEST_CHECK(mmapdb_test_fetch(ctx, "cherry", "black"));
+    TEST_CHECK(mmapdb_test_fetch(ctx, "key2999", "data2999"));
+    ops->close(&ctx);
+  }
+
+  mmapdb_test_done(dir, path);
+#endif
+}
@@ -27,6 +27,47 @@
 #include "address/lib.h"
 #include "email/lib.h"
 
+static const char *multipart = "--bnd\n"
+                               "Content-Type: text/plain\n"
+                               "\n"
+                               "hello\n"
+                               "--bnd \t\n"
+                               "Content-Type: image/png\n"
+                               "Content-Disposition: attachment; filename=a.png\n"
+                               "\n"
+                               "data\n"
+                               "--bndX\n"
+                               "more\n"
+                               "--bnd--\n"
+                               "epilogue\n";
+
+static void check_parts(FILE *fp)
+{
+  const char *data = multipart;
+  const LOFF_T len = strlen(data);
+
+  struct Body *b = mutt_parse_multipart(fp, "bnd", len, false);
+  if (!TEST_CHECK(b != NULL))
+    return;
+
+  TEST_CHECK(b->type == TYPE_TEXT);
+  TEST_CHECK(b->offset == (strstr(data, "hello") - data));
+  TEST_CHECK(b->length == 5);
+
+  struct Body *b2 = b->next;
+  if (TEST_CHECK(b2 != NULL))
+  {
+    TEST_CHECK(b2->type == TYPE_IMAGE);
+    TEST_CHECK(b2->disposition == DISP_ATTACH);
+    TEST_CHECK(mutt_str_strcmp(b2->filename, "a.png") == 0);
+    TEST_CHECK(b2->offset == (strstr(data, "data") - data));
+    TEST_CHECK(b2->length == (strstr(data, "\n--bnd--") - strstr(data, "data")));
+    TEST_CHECK(b2->next == NULL);
+  }
+
+  mutt_body_free(&b);
+}
+
 void test_mutt_parse_multipart(void)
 {
   // struct Body *mutt_parse_multipart(FILE *fp, const char *boundary, off_t end_off, bool digest);
@@ -41,4 +82,26 @@ void test_mutt_parse_multipart(void)
     FILE fp = { 0 };
     TEST_CHECK(!mutt_parse_multipart(&fp, NULL, 0, false));
   }
+
+  {
+    /* A regular file, which will be memory-mapped */
+    FILE *fp = tmpfile();
+    if (TEST_CHECK(fp != NULL))
+    {
+      fputs(multipart, fp);
+      rewind(fp);
+      check_parts(fp);
+      fclose(fp);
+    }
+  }
+
+  {
+    /* An in-memory stream, which will be read into a buffer */
+    FILE *fp = fmemopen((void *) multipart, strlen(multipart), "r");
+    if (TEST_CHECK(fp != NULL))
+    {
+      check_parts(fp);
+      fclose(fp);
+    }
+  }
 }
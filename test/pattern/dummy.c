@@ -25,10 +25,15 @@
 #include <stdio.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include "mutt/mutt.h"
+#include "email/lib.h"
+#include "mutt.h"
 
 struct Address;
 struct Body;
 struct Email;
+struct EmailList;
+struct EmailNode;
 struct Envelope;
 struct Mailbox;
 struct Message;
@@ -42,9 +47,22 @@ bool g_is_mail_list = false;
 bool g_is_subscribed_list = false;
 const char *g_myvar = "hello";
 
-int crypt_valid_passphrase(int flags)
+void crypt_pgp_decrypt_ahead(struct Mailbox *m, struct EmailNode *en)
 {
-  return 0;
+}
+
+void crypt_pgp_decrypt_ahead_done(void)
+{
+}
+
+bool crypt_valid_passphrase(SecurityFlags flags)
+{
+  return false;
+}
+
+int el_add_email(struct EmailList *el, struct Email *e)
+{
+  return -1;
 }
 
 int imap_search(struct Mailbox *m, const struct Pattern *pat)
@@ -81,11 +99,6 @@ int mutt_count_body_parts(struct Mailbox *m, struct Email *e)
   return g_body_parts;
 }
 
-pid_t mutt_create_filter(const char *s, FILE **fp_in, FILE **fp_out, FILE **fp_err)
-{
-  return -1;
-}
-
 int mutt_get_field_full(const char *field, char *buf, size_t buflen,
                         int complete, bool multiple, char ***files, int *numfiles)
 {
@@ -116,11 +129,21 @@ void mutt_progress_update(struct Progress *progress, long pos, int percent)
 
 void mutt_set_flag_update(struct Mailbox *m, struct Email *e, int flag, bool bf, bool upd_mbox)
 {
-}
-
-int mutt_wait_filter(pid_t pid)
-{
-  return -1;
+  switch (flag)
+  {
+    case MUTT_DELETE:
+      e->deleted = bf;
+      break;
+    case MUTT_FLAG:
+      e->flagged = bf;
+      break;
+    case MUTT_READ:
+      e->read = bf;
+      break;
+    case MUTT_TAG:
+      e->tagged = bf;
+      break;
+  }
 }
 
 int mx_msg_close(struct Mailbox *m, struct Message **msg)
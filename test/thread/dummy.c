@@ -0,0 +1,45 @@
+/**
+ * @file
+ * Dummy code for working around build problems
+ *
+ * @authors
+ * Copyright (C) 2019 NeoMutt developers <neomutt-devel@neomutt.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <stddef.h>
+#include <string.h>
+#include "mutt/mutt.h"
+#include "email/lib.h"
+#include "sort.h"
+
+static int compare_index(const void *a, const void *b)
+{
+  const struct Email *ea = *(struct Email const *const *) a;
+  const struct Email *eb = *(struct Email const *const *) b;
+  return ea->index - eb->index;
+}
+
+void mutt_encode_path(char *buf, size_t buflen, const char *src)
+{
+  mutt_str_strfcpy(buf, src, buflen);
+}
+
+sort_t *mutt_get_sort_func(enum SortType method)
+{
+  return compare_index;
+}
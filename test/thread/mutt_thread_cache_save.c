@@ -0,0 +1,226 @@
+/**
+ * @file
+ * Test code for mutt_thread_cache_save()
+ *
+ * @authors
+ * Copyright (C) 2019 NeoMutt developers <neomutt-devel@neomutt.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include "mutt/mutt.h"
+#include "email/lib.h"
+#include "context.h"
+#include "globals.h"
+#include "mailbox.h"
+#include "mutt_thread.h"
+#include "sort.h"
+#ifdef USE_HCACHE
+#include "hcache/hcache.h"
+#endif
+
+#ifdef USE_HCACHE
+/* Message-ID, In-Reply-To; <c> and <d> both follow the missing <x> */
+static const char *Messages[][2] = {
+  { "<a@test>", NULL },
+  { "<b@test>", "<a@test>" },
+  { "<c@test>", "<x@test>" },
+  { "<d@test>", "<x@test>" },
+};
+
+static void thread_sort(struct Context *ctx)
+{
+  mutt_clear_threads(ctx);
+  mutt_sort_threads(ctx, true);
+}
+
+/**
+ * thread_find - Find the Thread of a message
+ * @param m  Mailbox
+ * @param id Message-ID
+ * @retval ptr Thread
+ */
+static struct MuttThread *thread_find(struct Mailbox *m, const char *id)
+{
+  for (int i = 0; i < m->msg_count; i++)
+    if (mutt_str_strcmp(m->emails[i]->env->message_id, id) == 0)
+      return m->emails[i]->thread;
+  return NULL;
+}
+
+/**
+ * thread_check - Check the Threads of the test messages
+ * @param m Mailbox
+ * @retval true The Threads match the headers
+ */
+static bool thread_check(struct Mailbox *m)
+{
+  struct MuttThread *a = thread_find(m, "<a@test>");
+  struct MuttThread *b = thread_find(m, "<b@test>");
+  struct MuttThread *c = thread_find(m, "<c@test>");
+  struct MuttThread *d = thread_find(m, "<d@test>");
+  return a && b && c && d && !a->parent && (b->parent == a) && c->parent &&
+         !c->parent->message && (c->parent == d->parent);
+}
+
+/**
+ * thread_cache_replace - Damage the saved threads
+ * @param m    Mailbox
+ * @param trim Number of bytes to drop from the end
+ * @param off  Offset of a number to overwrite, or -1
+ */
+static void thread_cache_replace(struct Mailbox *m, size_t trim, int off)
+{
+  header_cache_t *hc = mutt_hcache_open(C_HeaderCache, mutt_b2s(m->pathbuf), NULL);
+  if (!TEST_CHECK(hc != NULL))
+    return;
+
+  size_t dlen = 0;
+  void *data = mutt_hcache_fetch_raw_len(hc, "/threads", 8, &dlen);
+  if (TEST_CHECK((data != NULL) && (dlen > trim)))
+  {
+    unsigned char *d = mutt_mem_malloc(dlen);
+    memcpy(d, data, dlen);
+    if (off >= 0)
+    {
+      unsigned int bad = 0xffff;
+      memcpy(d + off, &bad, sizeof(bad));
+    }
+    mutt_hcache_store_raw(hc, "/threads", 8, d, dlen - trim);
+    FREE(&d);
+  }
+  mutt_hcache_free(hc, &data);
+  mutt_hcache_close(hc);
+}
+#endif
+
+void test_mutt_thread_cache_save(void)
+{
+  // void mutt_thread_cache_save(struct Context *ctx);
+
+  {
+    mutt_thread_cache_save(NULL);
+    TEST_CHECK_(1, "mutt_thread_cache_save(NULL)");
+  }
+
+#ifdef USE_HCACHE
+  char dir[] = "/tmp/neomutt-test-XXXXXX";
+  if (!TEST_CHECK(mkdtemp(dir) != NULL))
+    return;
+
+  char *old_hc = C_HeaderCache;
+  short old_sort = C_Sort;
+  C_HeaderCache = dir;
+  C_Sort = SORT_THREADS;
+
+  struct Mailbox *m = mailbox_new();
+  m->magic = MUTT_MAILDIR;
+  mutt_buffer_printf(m->pathbuf, "%s/box", dir);
+  m->msg_count = mutt_array_size(Messages);
+  m->email_max = m->msg_count;
+  m->emails = mutt_mem_calloc(m->msg_count, sizeof(struct Email *));
+  for (int i = 0; i < m->msg_count; i++)
+  {
+    struct Email *e = mutt_email_new();
+    e->index = i;
+    e->env = mutt_env_new();
+    e->env->message_id = mutt_str_strdup(Messages[i][0]);
+    e->env->subject = mutt_str_strdup(Messages[i][0]);
+    e->env->real_subj = e->env->subject;
+    if (Messages[i][1])
+      mutt_list_insert_head(&e->env->in_reply_to, mutt_str_strdup(Messages[i][1]));
+    m->emails[i] = e;
+  }
+
+  struct Context *ctx = mutt_mem_calloc(1, sizeof(struct Context));
+  ctx->mailbox = m;
+
+  {
+    // Nothing saved yet
+    thread_sort(ctx);
+    TEST_CHECK(!ctx->threads_cached);
+    TEST_CHECK(thread_check(m));
+  }
+
+  {
+    // Save and restore
+    mutt_thread_cache_save(ctx);
+    TEST_CHECK(ctx->threads_cached);
+    thread_sort(ctx);
+    TEST_CHECK(ctx->threads_cached);
+    TEST_CHECK(thread_check(m));
+  }
+
+  {
+    // A truncated record is discarded
+    thread_cache_replace(m, 1, -1);
+    thread_sort(ctx);
+    TEST_CHECK(!ctx->threads_cached);
+    TEST_CHECK(thread_check(m));
+  }
+
+  {
+    // So is a string that runs past the end of the record.
+    // The first Message-ID follows the version, length and count.
+    mutt_thread_cache_save(ctx);
+    thread_cache_replace(m, 0, 3 * sizeof(int));
+    thread_sort(ctx);
+    TEST_CHECK(!ctx->threads_cached);
+    TEST_CHECK(thread_check(m));
+  }
+
+  {
+    // A new message is threaded from its headers, then saved again
+    int last = m->msg_count - 1;
+    for (int i = 0; i < last; i++)
+    {
+      if (mutt_str_strcmp(m->emails[i]->env->message_id, "<d@test>") == 0)
+      {
+        struct Email *tmp = m->emails[i];
+        m->emails[i] = m->emails[last];
+        m->emails[last] = tmp;
+      }
+    }
+    m->msg_count--;
+    thread_sort(ctx);
+    mutt_thread_cache_save(ctx);
+    TEST_CHECK(ctx->threads_cached);
+    m->msg_count++;
+    m->emails[last]->thread = NULL;
+    thread_sort(ctx);
+    TEST_CHECK(!ctx->threads_cached);
+    TEST_CHECK(thread_check(m));
+  }
+
+  mutt_clear_threads(ctx);
+  for (int i = 0; i < m->msg_count; i++)
+    mutt_email_free(&m->emails[i]);
+  FREE(&m->emails);
+  FREE(&ctx);
+  mailbox_free(&m);
+
+  C_HeaderCache = old_hc;
+  C_Sort = old_sort;
+
+  char cmd[64];
+  snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+  TEST_CHECK(system(cmd) == 0);
+#endif
+}
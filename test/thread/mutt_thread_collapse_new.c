@@ -0,0 +1,137 @@
+/**
+ * @file
+ * Test code for mutt_thread_collapse_new()
+ *
+ * @authors
+ * Copyright (C) 2019 NeoMutt developers <neomutt-devel@neomutt.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+#include "config.h"
+#include "mutt/mutt.h"
+#include "email/lib.h"
+#include "context.h"
+#include "globals.h"
+#include "mailbox.h"
+#include "mutt_thread.h"
+#include "sort.h"
+
+/* Message-ID, In-Reply-To; the last two arrive later */
+static const char *Messages[][2] = {
+  { "<a@test>", NULL },
+  { "<b@test>", "<a@test>" },
+  { "<z@test>", NULL },
+  { "<c@test>", "<a@test>" },
+  { "<y@test>", "<z@test>" },
+};
+
+/**
+ * thread_arrive - Thread a new message and show it, if it matches the limit
+ * @param ctx Mailbox
+ * @param e   New Email
+ *
+ * This follows update_index_threaded() in the index.
+ */
+static void thread_arrive(struct Context *ctx, struct Email *e)
+{
+  ctx->mailbox->msg_count++;
+  mutt_sort_threads(ctx, false);
+  e->virtual = 1;
+  e->limited = true;
+  mutt_thread_collapse_new(ctx, e);
+  mutt_set_virtual(ctx);
+}
+
+void test_mutt_thread_collapse_new(void)
+{
+  // void mutt_thread_collapse_new(struct Context *ctx, struct Email *e);
+
+  {
+    mutt_thread_collapse_new(NULL, NULL);
+    TEST_CHECK_(1, "mutt_thread_collapse_new(NULL, NULL)");
+  }
+
+  short old_sort = C_Sort;
+  C_Sort = SORT_THREADS;
+
+  struct Email *emails[mutt_array_size(Messages)] = { 0 };
+  struct Mailbox *m = mailbox_new();
+  m->email_max = mutt_array_size(Messages);
+  m->emails = mutt_mem_calloc(m->email_max, sizeof(struct Email *));
+  m->v2r = mutt_mem_calloc(m->email_max, sizeof(int));
+  for (int i = 0; i < m->email_max; i++)
+  {
+    struct Email *e = mutt_email_new();
+    e->index = i;
+    e->msgno = i;
+    e->content = mutt_body_new();
+    e->env = mutt_env_new();
+    e->env->message_id = mutt_str_strdup(Messages[i][0]);
+    e->env->subject = mutt_str_strdup(Messages[i][0]);
+    e->env->real_subj = e->env->subject;
+    if (Messages[i][1])
+      mutt_list_insert_head(&e->env->in_reply_to, mutt_str_strdup(Messages[i][1]));
+    m->emails[i] = e;
+    emails[i] = e;
+  }
+  m->msg_count = 3;
+
+  // A limited view, matching every message, with the thread of <a> collapsed
+  struct Context *ctx = mutt_mem_calloc(1, sizeof(struct Context));
+  ctx->mailbox = m;
+  ctx->pattern = mutt_str_strdup("~A");
+  mutt_sort_threads(ctx, true);
+  for (int i = 0; i < m->msg_count; i++)
+  {
+    m->emails[i]->virtual = i;
+    m->emails[i]->limited = true;
+  }
+  mutt_collapse_thread(ctx, emails[0]);
+  mutt_set_virtual(ctx);
+  TEST_CHECK(m->vcount == 2);
+
+  {
+    // A message joining the collapsed thread stays hidden
+    thread_arrive(ctx, emails[3]);
+    TEST_CHECK(emails[3]->thread->parent == emails[0]->thread);
+    TEST_CHECK(emails[3]->virtual == -1);
+    TEST_CHECK(emails[0]->collapsed && (emails[0]->virtual >= 0));
+    TEST_CHECK(emails[0]->num_hidden == 3);
+    TEST_CHECK(m->vcount == 2);
+  }
+
+  {
+    // A message joining an open thread is shown
+    thread_arrive(ctx, emails[4]);
+    TEST_CHECK(emails[4]->thread->parent == emails[2]->thread);
+    TEST_CHECK(emails[4]->virtual >= 0);
+    TEST_CHECK(!emails[2]->collapsed);
+    TEST_CHECK(m->vcount == 3);
+  }
+
+  mutt_clear_threads(ctx);
+  for (int i = 0; i < m->msg_count; i++)
+    mutt_email_free(&m->emails[i]);
+  FREE(&m->emails);
+  FREE(&m->v2r);
+  FREE(&ctx->pattern);
+  FREE(&ctx);
+  mailbox_free(&m);
+
+  C_Sort = old_sort;
+}